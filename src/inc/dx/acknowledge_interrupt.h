@@ -0,0 +1,14 @@
+//
+// acknowledge_interrupt.h
+//
+
+#ifndef _ACKNOWLEDGE_INTERRUPT_H
+#define _ACKNOWLEDGE_INTERRUPT_H
+
+#include "dx/status.h"
+#include "dx/types.h"
+
+status_t
+acknowledge_interrupt(uintptr_t irq);
+
+#endif
@@ -22,6 +22,13 @@
 	#define NEVER_RETURNS	__attribute__ ((noreturn))
 
 
+	//
+	// Some static data must be aligned more strictly than its type requires
+	// (e.g., operands of FXRSTOR)
+	//
+	#define ALIGNED(boundary)	__attribute__ ((aligned(boundary)))
+
+
 	//
 	// Some routines must be marked as C code/linkage to prevent the
 	// compiler from mangling the symbol names.  Otherwise, the linker will
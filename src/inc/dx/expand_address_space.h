@@ -11,6 +11,14 @@
 #include "stddef.h"
 
 
+///
+/// Expansion flags.  By default, the new pages are backed by physical frames
+/// immediately.  With EXPAND_ADDRESS_SPACE_RESERVE, the kernel only reserves
+/// the range; each page is allocated + zero-filled when first touched
+///
+#define EXPAND_ADDRESS_SPACE_RESERVE	0x00000001
+
+
 status_t
 expand_address_space(	address_space_id_t	address_space,
 						const void_t*		address,
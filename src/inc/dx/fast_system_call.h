@@ -0,0 +1,23 @@
+//
+// fast_system_call.h
+//
+
+#ifndef _FAST_SYSTEM_CALL_H
+#define _FAST_SYSTEM_CALL_H
+
+#include "dx/types.h"
+
+
+///
+/// Nonzero if system calls may enter the kernel via SYSENTER rather than a
+/// software interrupt.  See call_kernel.h
+///
+extern
+bool_t __fast_system_call;
+
+
+void_t
+initialize_fast_system_call();
+
+
+#endif
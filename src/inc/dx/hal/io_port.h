@@ -25,7 +25,7 @@ io_port_read8(uint16_t port_address)
 			"movw	%1, %%dx;"			// Load the port address
 			"inb	%%dx, %%al;"		// Read the data
 			"movb	%%al, %0"			// Return the data to the caller
-			: "=g"(data)
+			: "=qm"(data)
 			: "m"(port_address)
 			: "al", "dx" );
 
@@ -0,0 +1,37 @@
+//
+// processor_type.h
+//
+// List of known/supported processor types.  Shared with user code via the
+// kernel statistics; see dx/kernel_stats.h
+//
+
+#ifndef _PROCESSOR_TYPE_H
+#define _PROCESSOR_TYPE_H
+
+#define	PROCESSOR_TYPE_UNKNOWN		0x00
+#define	PROCESSOR_TYPE_386			0x03
+#define	PROCESSOR_TYPE_486			0x04
+#define	PROCESSOR_TYPE_PENTIUM		0x05
+#define	PROCESSOR_TYPE_PENTIUM_PRO	0x06
+#define PROCESSOR_TYPE_PENTIUM_II   0x07
+#define PROCESSOR_TYPE_PENTIUM_III  0x08
+#define	PROCESSOR_TYPE_PENTIUM_IV	0x09
+
+
+//
+// Oldest processor type that implements the SYSENTER/SYSEXIT fast system-call
+// instructions.  The original Pentium Pro reports the SEP feature, but does
+// not actually support these instructions
+//
+#define PROCESSOR_TYPE_FAST_SYSTEM_CALL	PROCESSOR_TYPE_PENTIUM_II
+
+
+//
+// Oldest processor type that implements the FXSAVE/FXRSTOR instructions, for
+// saving the FPU/MMX/SSE state of each thread.  Older processors fall back to
+// FSAVE/FRSTOR
+//
+#define PROCESSOR_TYPE_FXSR				PROCESSOR_TYPE_PENTIUM_II
+
+#endif
+
@@ -11,6 +11,31 @@
 #pragma pack(8)
 
 
+//
+// Scheduling policies; selected at boot.  See kernel_stats_s
+//
+#define SCHEDULING_POLICY_LOTTERY		0
+#define SCHEDULING_POLICY_STRIDE		1
+
+
+//
+// Scheduling latency is the delay between a message waking a thread and the
+// thread gaining a processor, measured in timestamp/CPU cycles.  Each bucket
+// N of the histogram counts the latencies in [ 2^(N+10), 2^(N+11) ) cycles;
+// the first and last buckets also absorb any shorter/longer latencies
+//
+#define SCHEDULING_LATENCY_BUCKET_COUNT	16
+#define SCHEDULING_LATENCY_SHIFT		10
+
+
+//
+// Interrupt dispatch latency is the delay between an IRQ line interrupting
+// and the first of its handlers receiving the notification, measured in
+// timestamp/CPU cycles.  One entry per (PIC) IRQ line
+//
+#define INTERRUPT_STATS_IRQ_COUNT		16
+
+
 ///
 /// Kernel statistics reported via SYSTEM_CALL_VECTOR_READ_KERNEL_STATS
 ///
@@ -21,26 +46,44 @@ typedef struct kernel_stats
 	// Memory stats
 	uint32_t	address_space_count;
 	uint32_t	cow_fault_count;
+	uint32_t	cow_copy_avoided_count;		// COW fault on a sole-owner frame
+	uint32_t	demand_zero_fault_count;	// Reserved page, first touch
+	uint32_t	io_port_fault_count;		// Lazy I/O bitmap load
 	uint32_t	page_fault_count;
 	uint32_t	total_memory_size;		// Physical memory, in bytes
 	uint32_t	paged_memory_size;		// Paged physical memory, in bytes
 	uint32_t	paged_region_count;
+	uint32_t	heap_slab_count;		// Slabs in kernel heap extension
 
 	// Message stats
 	uint64_t	message_count;
+	uint64_t	direct_message_count;	// Via direct-switch fast path
 	uint32_t	pending_count;
 	uint32_t	incomplete_count;
 	uint32_t	receive_error_count;
 	uint32_t	send_error_count;
+	uint32_t	send_wait_count;		// Sender waited for mailbox room
+	uint32_t	message_cache_hit_count;	// Allocated from free list
+	uint32_t	message_cache_miss_count;	// Required new slab
 
 	// Scheduling stats
-	uint64_t	lottery_count;
-	uint64_t	idle_count;
+	uint64_t	lottery_count;			// Selected by pending messages
+	uint64_t	idle_count;				// Clock ticks spent halted
 	uint64_t	direct_handoff_count;
+	uint32_t	scheduling_policy;		// SCHEDULING_POLICY_*
+	uint32_t	scheduling_latency[ SCHEDULING_LATENCY_BUCKET_COUNT ];
+
+	// Interrupt stats, per IRQ line
+	uint32_t	interrupt_count[ INTERRUPT_STATS_IRQ_COUNT ];
+	uint32_t	interrupt_latency[ INTERRUPT_STATS_IRQ_COUNT ];	// Average
+	uint32_t	interrupt_latency_max[ INTERRUPT_STATS_IRQ_COUNT ];
 
 	// Thread stats
 	uint32_t	thread_count;
 
+	// Processor stats
+	uint32_t	processor_type;		// See dx/hal/processor_type.h
+
 	} kernel_stats_s;
 
 typedef kernel_stats_s*		kernel_stats_sp;
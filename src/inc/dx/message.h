@@ -8,6 +8,7 @@
 
 #include "dx/message_id.h"
 #include "dx/message_type.h"
+#include "dx/status.h"
 #include "dx/thread_id.h"
 #include "dx/types.h"
 
@@ -34,6 +35,70 @@ typedef message_s *		message_sp;
 typedef message_sp *	message_spp;
 
 
+
+///
+/// One piece of a gathered message payload.  The fragments are concatenated,
+/// in order, to form a single payload in the recipient's address space.  See
+/// send_gathered_message()
+///
+typedef struct message_fragment
+	{
+	const void_t *	data;
+	size_t			size;
+	} message_fragment_s;
+
+typedef message_fragment_s *	message_fragment_sp;
+typedef message_fragment_sp *	message_fragment_spp;
+
+
+///
+/// Maximum number of fragments within a single gathered payload
+///
+#define MESSAGE_FRAGMENT_COUNT_MAX	16
+
+
+
+///
+/// One operation within a batch of message operations.  The kernel processes
+/// the whole batch, in order, within a single system call.  See
+/// process_messages()
+///
+typedef struct message_operation
+	{
+	uintptr_t	type;		// MESSAGE_OPERATION_*; populated by caller
+	message_s	message;	// Outgoing, incoming or discarded message
+	status_t	status;		// Populated by the kernel
+	} message_operation_s;
+
+typedef message_operation_s *	message_operation_sp;
+typedef message_operation_sp *	message_operation_spp;
+
+
+//
+// Types of message operations
+//
+#define MESSAGE_OPERATION_SEND					1	// As send_message()
+#define MESSAGE_OPERATION_RECEIVE				2	// Poll, as receive_message()
+#define MESSAGE_OPERATION_RECEIVE_WAIT			3	// Block, as receive_message()
+#define MESSAGE_OPERATION_DELETE				4	// As delete_message()
+#define MESSAGE_OPERATION_SEND_REQUEST			5	// As post_request()
+#define MESSAGE_OPERATION_RECEIVE_REPLY			6	// Poll, as receive_reply()
+#define MESSAGE_OPERATION_RECEIVE_REPLY_WAIT	7	// Block, as receive_reply()
+
+
+///
+/// Maximum number of operations within a single batch
+///
+#define MESSAGE_OPERATION_COUNT_MAX	16
+
+
+///
+/// Maximum number of asynchronous requests that a single thread may have
+/// outstanding at once.  See post_request()
+///
+#define MESSAGE_REQUEST_COUNT_MAX	8
+
+
 void_t
 initialize_message(message_s* message);
 
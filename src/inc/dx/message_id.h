@@ -24,4 +24,11 @@ typedef message_id_tp *			message_id_tpp;
 #define MESSAGE_ID_ATOMIC		((message_id_t)(0xffffffff))
 
 
+///
+/// Wildcard id when collecting the replies to asynchronous requests: matches
+/// the reply to any outstanding request.  Never a valid request id itself
+///
+#define MESSAGE_ID_ANY			((message_id_t)(0xfffffffe))
+
+
 #endif
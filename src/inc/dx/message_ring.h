@@ -0,0 +1,79 @@
+//
+// message_ring.h
+//
+// Shared-memory rings for asynchronous message-passing
+//
+
+#ifndef _MESSAGE_RING_H
+#define _MESSAGE_RING_H
+
+#include "dx/message.h"
+#include "dx/status.h"
+#include "dx/types.h"
+
+
+
+///
+/// Number of entries in each ring.  Must be a power of two.  Both rings, plus
+/// their indices, fit within a single page
+///
+#define MESSAGE_RING_SIZE	32
+#define MESSAGE_RING_MASK	(MESSAGE_RING_SIZE - 1)
+
+
+///
+/// A pair of rings for exchanging message operations with the kernel, without
+/// trapping into the kernel for each operation.  The kernel maps one of these
+/// into the address space of the owner thread; see create_message_ring().
+///
+/// The owner thread queues send, receive and delete operations on the
+/// submission ring.  The kernel drains the submission ring whenever the owner
+/// thread enters the kernel via enter_message_ring(), and on each clock tick
+/// while the owner thread is executing.  The kernel posts the outcome of each
+/// operation on the completion ring.  Each receive operation is a request for
+/// one incoming message; its completion, which carries the message itself, is
+/// posted whenever a message arrives.
+///
+/// The head + tail indices are free-running counters; the ring index of each
+/// entry is the counter modulo MESSAGE_RING_SIZE.  The producer only ever
+/// advances the tail; and the consumer only ever advances the head.
+///
+typedef struct message_ring
+	{
+	// Submission ring: produced by the owner thread; consumed by the kernel
+	volatile uint32_t	submission_head;
+	volatile uint32_t	submission_tail;
+
+	// Completion ring: produced by the kernel; consumed by the owner thread
+	volatile uint32_t	completion_head;
+	volatile uint32_t	completion_tail;
+
+	message_operation_s	submission[ MESSAGE_RING_SIZE ];
+	message_operation_s	completion[ MESSAGE_RING_SIZE ];
+	} message_ring_s;
+
+typedef message_ring_s *	message_ring_sp;
+typedef message_ring_sp *	message_ring_spp;
+
+
+
+status_t
+create_message_ring(message_ring_spp ring);
+
+
+status_t
+enter_message_ring(	message_ring_sp	ring,
+					bool_t			wait_for_completion);
+
+
+status_t
+get_message_completion(	message_ring_sp			ring,
+						message_operation_s*	completion);
+
+
+status_t
+put_message_operation(	message_ring_sp				ring,
+						const message_operation_s*	operation);
+
+
+#endif
@@ -34,6 +34,9 @@ typedef message_type_tp *			message_type_tpp;
 #define MESSAGE_TYPE_DISABLE_INTERRUPT_HANDLER	SYSTEM_MESSAGE(9)
 #define MESSAGE_TYPE_ENABLE_INTERRUPT_HANDLER	SYSTEM_MESSAGE(10)
 
+// Signal bits, collected from the notification word; see signal_thread()
+#define MESSAGE_TYPE_NOTIFICATION				SYSTEM_MESSAGE(11)
+
 
 //
 // Generic I/O messages
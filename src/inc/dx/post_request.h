@@ -0,0 +1,29 @@
+//
+// post_request.h
+//
+
+#ifndef _POST_REQUEST_H
+#define _POST_REQUEST_H
+
+#include "dx/message.h"
+#include "dx/message_id.h"
+#include "dx/status.h"
+#include "dx/types.h"
+
+
+status_t
+post_request(const message_s* request);
+
+
+status_t
+receive_all_replies(const message_id_t*	id,
+					message_s*			reply,
+					size_t				count);
+
+status_t
+receive_reply(	message_id_t	id,
+				message_s*		reply,
+				bool_t			wait_for_reply);
+
+
+#endif
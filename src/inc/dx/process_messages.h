@@ -0,0 +1,23 @@
+//
+// process_messages.h
+//
+
+#ifndef _PROCESS_MESSAGES_H
+#define _PROCESS_MESSAGES_H
+
+#include "dx/message.h"
+#include "dx/status.h"
+#include "dx/types.h"
+
+
+status_t
+delete_and_receive_message(	message_sp	message,
+							bool_t		wait_for_message);
+
+
+status_t
+process_messages(	message_operation_s*	operation,
+					size_t					operation_count);
+
+
+#endif
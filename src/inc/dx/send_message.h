@@ -12,6 +12,16 @@ status_t
 send_message(const message_s* message);
 
 
+status_t
+send_donated_message(const message_s* message);
+
+
+status_t
+send_gathered_message(	const message_s*			message,
+						const message_fragment_s*	fragment,
+						size_t						fragment_count);
+
+
 status_t
 send_misaligned_message(const message_s* message);
 
@@ -0,0 +1,14 @@
+//
+// set_mailbox_limit.h
+//
+
+#ifndef _SET_MAILBOX_LIMIT_H
+#define _SET_MAILBOX_LIMIT_H
+
+#include "dx/status.h"
+#include "dx/types.h"
+
+status_t
+set_mailbox_limit(uint32_t limit);
+
+#endif
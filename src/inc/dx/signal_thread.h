@@ -0,0 +1,27 @@
+//
+// signal_thread.h
+//
+
+#ifndef _SIGNAL_THREAD_H
+#define _SIGNAL_THREAD_H
+
+#include "dx/status.h"
+#include "dx/thread_id.h"
+#include "dx/types.h"
+
+
+///
+/// The notification word of each thread is split between the kernel and
+/// other threads.  The kernel signals interrupt handlers on the low bits, one
+/// bit per IRQ line (bit N for IRQ N); signal_thread() rejects these bits, so
+/// no thread can forge an interrupt.  Threads may raise only the user bits
+///
+#define SIGNAL_IRQ_MASK		0x0000FFFF
+#define SIGNAL_USER_MASK	0xFFFF0000
+#define SIGNAL_USER_FIRST	0x00010000
+
+
+status_t
+signal_thread(thread_id_t thread, uintptr_t signal);
+
+#endif
@@ -34,6 +34,7 @@ typedef status_tp *		status_tpp;
 #define STATUS_MAILBOX_OVERFLOW		(-EOVERFLOW)
 #define STATUS_MESSAGE_DEADLOCK		(-EDEADLK)
 #define STATUS_RESOURCE_CONFLICT	(-EBUSY)
+#define STATUS_WOULD_BLOCK			(-EAGAIN)
 
 
 #endif
@@ -6,10 +6,24 @@
 #define _SYSTEM_CALL_VECTORS_H
 
 
+//
+// Range of vectors reserved for system calls.  These are the only vectors
+// that may be invoked via the SYSENTER fast system-call entry
+//
+#define SYSTEM_CALL_VECTOR_FIRST					80
+#define SYSTEM_CALL_VECTOR_LAST						120
+
+
 #define SYSTEM_CALL_VECTOR_RECEIVE_MESSAGE			80
 #define SYSTEM_CALL_VECTOR_SEND_AND_RECEIVE_MESSAGE	81
 #define SYSTEM_CALL_VECTOR_SEND_MESSAGE				82
 #define SYSTEM_CALL_VECTOR_DELETE_MESSAGE			83
+#define SYSTEM_CALL_VECTOR_SEND_DONATED_MESSAGE		84
+#define SYSTEM_CALL_VECTOR_SEND_GATHERED_MESSAGE	85
+#define SYSTEM_CALL_VECTOR_PROCESS_MESSAGES			86
+#define SYSTEM_CALL_VECTOR_CREATE_MESSAGE_RING		87
+#define SYSTEM_CALL_VECTOR_ENTER_MESSAGE_RING		88
+#define SYSTEM_CALL_VECTOR_SET_MAILBOX_LIMIT		89
 
 #define SYSTEM_CALL_VECTOR_CONTRACT_ADDRESS_SPACE	90
 #define SYSTEM_CALL_VECTOR_CREATE_ADDRESS_SPACE		91
@@ -18,9 +32,11 @@
 
 #define SYSTEM_CALL_VECTOR_CREATE_THREAD			100
 #define SYSTEM_CALL_VECTOR_DELETE_THREAD			101
+#define SYSTEM_CALL_VECTOR_SIGNAL_THREAD			102
 
 #define SYSTEM_CALL_VECTOR_MAP_DEVICE				110
 #define SYSTEM_CALL_VECTOR_UNMAP_DEVICE				111
+#define SYSTEM_CALL_VECTOR_ACKNOWLEDGE_INTERRUPT	112
 
 #define SYSTEM_CALL_VECTOR_READ_KERNEL_STATS		120
 
@@ -21,7 +21,8 @@ typedef thread_id_tp*		thread_id_tpp;
 //
 // Some well-known thread ids
 //
-#define THREAD_ID_NULL		((thread_id_t)(-256))	//@SMP one per CPU
+#define THREAD_ID_NULL		((thread_id_t)(-256))	// Idle thread of CPU 0;
+														// CPU n uses (NULL + n)
 
 #define THREAD_ID_BOOT		((thread_id_t)(-16))	// 0xFFFFFFF0
 #define THREAD_ID_CLEANUP	((thread_id_t)(-15))	// 0xFFFFFFF1, etc
@@ -20,7 +20,7 @@
 // The base of the stack used by the boot thread
 //
 #define BOOT_THREAD_STACK_BASE		KERNEL_BOOT_THREAD_BASE + \
-										THREAD_EXECUTION_BLOCK_SIZE
+										THREAD_CONTEXT_OFFSET
 
 
 
@@ -12,8 +12,8 @@
 #include "drivers/serial_console.hpp"
 #include "dx/capability.h"
 #include "dx/compiler_dependencies.h"
+#include "dx/hal/processor_type.h"
 #include "dx/version.h"
-#include "hal/processor_type.h"
 #include "kernel_heap.hpp"
 #include "kernel_subsystems.hpp"
 #include "klibc.hpp"
@@ -141,6 +141,16 @@ initialize_kernel(multiboot_data_sp multiboot_data)
 		__hal->initialize_processor();
 
 
+		//
+		// Allocate the message caches before any subsystem sends a message
+		//
+		if (initialize_message_caches() != STATUS_SUCCESS)
+			{
+			printf("Unable to allocate message caches\n");
+			kernel_panic(KERNEL_PANIC_REASON_MEMORY_ALLOCATION_FAILURE);
+			}
+
+
 		//
 		// Allocate the next layer of kernel subsystems.  The sequence is
 		// important here: the Thread Manager must initialize at least one
@@ -191,6 +201,14 @@ initialize_kernel(multiboot_data_sp multiboot_data)
 		initialize_user_mode();
 
 
+		//
+		// Bring up the other processors, if any.  This is deferred until
+		// the Multiboot data is no longer needed, since the startup trampoline
+		// overwrites a page of low memory
+		//
+		__hal->start_application_processors();
+
+
 		//
 		// Kernel initialization is complete.  This thread can exit now
 		//
@@ -380,7 +398,7 @@ initialize_user_mode()
 /// writes it out to the display, mainly as a boot-time nicety.
 ///
 /// @param memory_size		-- total amount of physical RAM, in MB
-/// @param processor_type	-- type of processor.  See hal/processor_type.h
+/// @param processor_type	-- type of processor.  See dx/hal/processor_type.h
 ///
 static
 void_t
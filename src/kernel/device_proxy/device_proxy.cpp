@@ -4,14 +4,15 @@
 
 #include "debug.hpp"
 #include "device_proxy.hpp"
-#include "small_message.hpp"
 #include "dx/capability.h"
 #include "dx/hal/memory.h"
 #include "dx/hal/physical_address.h"
 #include "dx/map_device.h"
+#include "dx/signal_thread.h"
 #include "dx/system_call_vectors.h"
 #include "hal/address_space_layout.h"
 #include "kernel_subsystems.hpp"
+#include "klibc.hpp"
 
 
 
@@ -21,6 +22,84 @@
 device_proxy_cp		__device_proxy	= NULL;
 
 
+
+///
+/// Constructor.  No interrupt handlers are registered yet; all IRQ lines
+/// remain masked until a handler is registered
+///
+device_proxy_c::
+device_proxy_c()
+	{
+	memset(interrupt_count, 0, sizeof(interrupt_count));
+	memset(interrupt_latency, 0, sizeof(interrupt_latency));
+	memset(interrupt_latency_max, 0, sizeof(interrupt_latency_max));
+	memset(raised_timestamp, 0, sizeof(raised_timestamp));
+	memset(unacknowledged, 0, sizeof(unacknowledged));
+
+	return;
+	}
+
+
+///
+/// Handler for ACKNOWLEDGE_INTERRUPT system calls.  The IRQ line remains
+/// masked from the time it interrupts until one of its handlers acknowledges
+/// it here, typically after silencing its device.  See
+/// wake_interrupt_handlers().
+///
+/// System call input:
+///		syscall->data0 = IRQ line
+///
+/// System call output:
+///		syscall->status	= resulting status
+///
+/// @param syscall -- system call arguments
+///
+/// @return STATUS_SUCCESS if the interrupt is acknowledged; STATUS_INVALID_DATA
+/// if the IRQ is invalid; STATUS_ACCESS_DENIED if the current thread is not a
+/// handler on this IRQ line
+///
+status_t device_proxy_c::
+acknowledge_interrupt(volatile syscall_data_s* syscall)
+	{
+	thread_cr	current_thread	= __hal->read_current_thread();
+	uintptr_t	irq				= syscall->data0;
+	status_t	status;
+
+	TRACE(SYSCALL, "System call: acknowledge interrupt (%p)\n", syscall);
+
+	lock.acquire();
+
+	if (irq >= INTERRUPT_VECTOR_PIC_COUNT)
+		{
+		status = STATUS_INVALID_DATA;
+		}
+	else if (!interrupt_handler[irq].contains(current_thread))
+		{
+		status = STATUS_ACCESS_DENIED;
+		}
+	else
+		{
+		//
+		// On a shared line, the first acknowledgement unmasks the line.  If
+		// some other device is still asserting it, then the line simply
+		// interrupts again.  The PIC mask is shared by all processors; the
+		// lock orders this against wake_interrupt_handlers() masking the
+		// line again on some other processor
+		//
+		if (unacknowledged[irq])
+			{
+			unacknowledged[irq] = FALSE;
+			__hal->unmask_interrupt(irq);
+			}
+		status = STATUS_SUCCESS;
+		}
+
+	lock.release();
+
+	return(status);
+	}
+
+
 ///
 /// Remove access to one or more I/O ports from ring-3.  On return, the thread
 /// may no longer access any of these ports
@@ -114,6 +193,16 @@ handle_interrupt(interrupt_cr interrupt)
 		case INTERRUPT_VECTOR_PIC_IRQ14:
 		case INTERRUPT_VECTOR_PIC_IRQ15:
 			__device_proxy->wake_interrupt_handlers(interrupt);
+			__io_manager->preempt_idle_thread(interrupt);
+			break;
+
+		case SYSTEM_CALL_VECTOR_ACKNOWLEDGE_INTERRUPT:
+			syscall = interrupt.validate_syscall();
+			if (syscall)
+				{
+				syscall->status =
+					__device_proxy->acknowledge_interrupt(syscall);
+				}
 			break;
 
 		case SYSTEM_CALL_VECTOR_MAP_DEVICE:
@@ -348,6 +437,70 @@ map_memory(	thread_cr					current_thread,
 	}
 
 
+///
+/// Read the per-IRQ interrupt statistics.  Usually only invoked in the
+/// context of a SYSTEM_CALL_VECTOR_READ_KERNEL_STATS syscall.
+///
+/// @param kernel_stats -- kernel statistics structure, provided by user thread
+///
+void_t device_proxy_c::
+read_stats(volatile kernel_stats_s& kernel_stats)
+	{
+	ASSERT(INTERRUPT_STATS_IRQ_COUNT == INTERRUPT_VECTOR_PIC_COUNT);
+
+	for (uint32_t i = 0; i < INTERRUPT_STATS_IRQ_COUNT; i++)
+		{
+		kernel_stats.interrupt_count[i]			= interrupt_count[i];
+		kernel_stats.interrupt_latency[i]		= interrupt_latency[i];
+		kernel_stats.interrupt_latency_max[i]	= interrupt_latency_max[i];
+		}
+
+	return;
+	}
+
+
+///
+/// Record the dispatch latency of any interrupts among these signals: the
+/// delay between each IRQ line interrupting and the first of its handlers
+/// collecting the signal.  See io_manager_c::get_notification().
+///
+/// @param signal -- the signal bits just delivered to the current thread; bit
+/// N is raised by IRQ line N
+///
+void_t device_proxy_c::
+record_interrupt_latency(uint32_t signal)
+	{
+	uint32_t latency;
+	uint32_t now = __hal->read_timestamp32();
+
+	// The line is masked until acknowledged, so no further interrupt can
+	// overwrite its timestamp; the lock only excludes other handlers
+	lock.acquire();
+
+	for (uint32_t irq = 0; irq < INTERRUPT_VECTOR_PIC_COUNT; irq++)
+		{
+		// Skip lines that did not interrupt, or whose latency another
+		// handler already recorded
+		if (!(signal & (1 << irq)) || !raised_timestamp[irq])
+			continue;
+
+		latency = now - raised_timestamp[irq];
+		raised_timestamp[irq] = 0;
+
+		// Moving average, weighted 1/8 toward the latest sample; this avoids
+		// any 64-bit division in the kernel
+		interrupt_latency[irq] += (latency >> 3) -
+			(interrupt_latency[irq] >> 3);
+		if (latency > interrupt_latency_max[irq])
+			{ interrupt_latency_max[irq] = latency; }
+		}
+
+	lock.release();
+
+	return;
+	}
+
+
 ///
 /// Adds the current thread to the list of handlers associated with the
 /// specified interrupt (IRQ) line.  The handler must be prepared to start
@@ -381,6 +534,15 @@ register_interrupt_handler(	thread_cr					current_thread,
 			}
 
 
+		//
+		// Preallocate the thread's scheduling ticket, so that interrupts
+		// can be signalled without allocating memory
+		//
+		status = current_thread.enable_notification();
+		if (status != STATUS_SUCCESS)
+			{ break; }
+
+
 		//
 		// Add this thread to the list of handlers attached to this
 		// IRQ.  This thread will now start receiving interrupt messages
@@ -396,6 +558,7 @@ register_interrupt_handler(	thread_cr					current_thread,
 		//@@lists).  Must also unmask on *all* CPU's, not just local CPU
 		lock.acquire();
 		interrupt_handler[irq] += current_thread;
+		unacknowledged[irq] = FALSE;
 		__hal->unmask_interrupt(irq);
 		lock.release();
 
@@ -566,7 +729,10 @@ unregister_interrupt_handler(	thread_cr					current_thread,
 		lock.acquire();
 		interrupt_handler[irq] -= current_thread;
 		if (interrupt_handler[irq].read_count() == 0)
-			{ __hal->mask_interrupt(irq); }
+			{
+			unacknowledged[irq] = FALSE;
+			__hal->mask_interrupt(irq);
+			}
 		lock.release();
 
 		remove_reference(current_thread);
@@ -583,8 +749,11 @@ unregister_interrupt_handler(	thread_cr					current_thread,
 
 
 ///
-/// Send a message to each each handler attached to this interrupt vector, in
-/// the assumption that one of those handlers owns the interrupting device.
+/// Notify each handler attached to this interrupt vector, in the assumption
+/// that one of those handlers owns the interrupting device.  The IRQ line is
+/// masked here, and remains masked until a handler acknowledges it via the
+/// ACKNOWLEDGE_INTERRUPT system call; so the interrupted thread never waits on
+/// the handlers, and a busy device cannot storm the processor meanwhile.
 ///
 /// Executes in interrupt context in some arbitrary (interrupted) thread
 ///
@@ -610,75 +779,41 @@ wake_interrupt_handlers(interrupt_cr interrupt)
 	ASSERT(irq < INTERRUPT_VECTOR_PIC_COUNT);
 	interrupt_handler_list_cr thread = interrupt_handler[irq];
 
-
-	//
-	// Wake all of these threads; presumably one of their devices generated
-	// this interrupt
-	//
-	thread_cr	current_thread	= __hal->read_current_thread();
-	uintptr_t	thread_count	= thread.read_count();
-
+	uintptr_t thread_count = thread.read_count();
 	ASSERT(thread_count > 0);
 
-	for (uintptr_t i = 0; i < thread_count; i++)
-		{
-		message_cp	acknowledgement;
-		message_cp	message;
-		status_t	status;
-
-		message = new small_message_c(	current_thread,
-										thread[i],
-										MESSAGE_TYPE_HANDLE_INTERRUPT,
-										rand(),		// Arbitrary message id
-										irq);
 
-		if (!message)
-			{
-			// Unable to wake driver; device will likely continue interrupting
-			// indefinitely.  This is probably not recoverable, except
-			// (possibly) if a thread on some other CPU frees enough memory
-			// to allocate new messages
-			printf("Unable to allocate interrupt message for thread %#x\n",
-				thread[i].id);
-			continue;
-			}
-
-
-		//
-		// Wake this thread/handler and give it a chance to process this
-		// device interrupt.  Block here until the handler completes.  The
-		// handler must send an explicit acknowledgement message
-		//
-		status = __io_manager->send_message(*message, &acknowledgement);
-		if (status != STATUS_SUCCESS)
-			{
-			// Message delivery error.  If this thread/driver owned this
-			// device, then the device will likely continue to interrupt.  This
-			// may or may not be recoverable
-			printf("Unable to deliver interrupt message to thread %#x (%#x)\n",
-				thread[i].id, status);
-			delete(message); // Failed transmission, so still message owner
-			continue;
-			}
+	//
+	// Silence the line until one of its handlers has serviced the device.
+	// The HAL still acknowledges the interrupt itself on return, so other
+	// lines may interrupt meanwhile.  The lock ensures an acknowledgement on
+	// another processor either precedes this, or sees the line as masked
+	//
+	lock.acquire();
+	__hal->mask_interrupt(irq);
+	unacknowledged[irq] = TRUE;
+	lock.release();
 
+	interrupt_count[irq]++;
+	raised_timestamp[irq] = __hal->read_timestamp32();
 
 
-		//
-		// Clean up the reply
-		//
-		ASSERT(acknowledgement);
-		delete(acknowledgement);
-		}
+	//
+	// Signal all of these threads; presumably one of their devices generated
+	// this interrupt.  Each handler is signalled on the bit of this IRQ
+	// line, so nothing is allocated here and delivery cannot fail
+	//
+	ASSERT((1 << irq) & SIGNAL_IRQ_MASK);
+	for (uintptr_t i = 0; i < thread_count; i++)
+		{ __io_manager->put_notification(thread[i], 1 << irq); }
 
 
 	//
-	// Done.  All threads attached to this interrupt line have had an
+	// Done.  All threads attached to this interrupt line will have an
 	// opportunity to handle this interrupt.  In theory, (at least) one of
-	// those handlers should have recognized that its device was interrupting,
-	// and silenced the device.
+	// those handlers should recognize that its device was interrupting,
+	// silence the device, and then acknowledge the interrupt
 	//
 
 	return;
 	}
-
-
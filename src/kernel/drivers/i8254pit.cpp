@@ -6,6 +6,7 @@
 
 #include "bits.hpp"
 #include "drivers/i8254pit.hpp"
+#include "klibc.hpp"
 
 
 ///
@@ -14,6 +15,90 @@
 ///
 i8254_programmable_interval_timer_c::
 i8254_programmable_interval_timer_c()
+	{
+	start_clock();
+
+	return;
+	}
+
+
+
+///
+/// Busy-waits for (at least) the specified number of microseconds, using
+/// counter 2 as the time reference.  This does not require interrupts, so
+/// it may be used during boot and with interrupts disabled, etc.  Long
+/// delays are split into multiple countdowns.
+///
+/// The PIT is shared, so only one processor should use this at a time.  In
+/// practice, this is only used on the bootstrap processor when starting +
+/// calibrating the other processors.
+///
+/// @param microseconds -- length of the delay
+///
+void_t i8254_programmable_interval_timer_c::
+delay(uint32_t microseconds)
+	{
+	io_mapped_register_c	control_port(i8254_CONTROL_PORT_ADDRESS);
+	io_mapped_register_c	counter2_port(i8254_COUNTER2_PORT_ADDRESS);
+	io_mapped_register_c	gate_port(i8254_GATE_PORT_ADDRESS);
+
+	uint16_t	countdown_interval;
+	uint32_t	interval;
+	uint8_t		gate;
+
+
+	while(microseconds > 0)
+		{
+		interval = min(microseconds, i8254_DELAY_MAX);
+		microseconds -= interval;
+
+
+		//
+		// Convert the interval into PIT counts.  The oscillator runs at
+		// ~1.193 counts per microsecond.  This cannot overflow, since the
+		// interval is bounded
+		//
+		countdown_interval = uint16_t((interval * 1193) / 1000);
+		if (countdown_interval == 0)
+			{ countdown_interval = 1; }
+
+
+		//
+		// Stop counter 2 and disconnect it from the speaker.  Then reload it
+		// in mode 0: its output drops when the count is written; and rises
+		// again when the count expires
+		//
+		gate = gate_port.read8();
+		gate &= ~(i8254_GATE_COUNTER2_ENABLE | i8254_GATE_SPEAKER_ENABLE);
+		gate_port.write8(gate);
+
+		control_port.write8(i8254_CONTROL_BINARY_COUNTING |
+							i8254_CONTROL_MODE0 |
+							i8254_CONTROL_BOTH_COUNTER_BYTES |
+							i8254_CONTROL_SELECT_COUNTER2);
+		counter2_port.write8(read_low8(countdown_interval));
+		counter2_port.write8(read_high8(countdown_interval));
+
+
+		//
+		// Start the countdown + wait for it to expire
+		//
+		gate_port.write8(gate | i8254_GATE_COUNTER2_ENABLE);
+		while(!(gate_port.read8() & i8254_GATE_COUNTER2_OUTPUT))
+			;
+		}
+
+
+	return;
+	}
+
+
+///
+/// Starts (or restarts) the periodic clock on counter 0.  On return, the PIT
+/// is active and counting; and triggers IRQ0 at i8254_COUNTER0_FREQUENCY.
+///
+void_t i8254_programmable_interval_timer_c::
+start_clock()
 	{
 	// I/O ports where the first PIT is located
 	io_mapped_register_c	control_port(i8254_CONTROL_PORT_ADDRESS);
@@ -57,7 +142,7 @@ i8254_programmable_interval_timer_c()
 					i8254_CONTROL_MODE2 |
 					i8254_CONTROL_BOTH_COUNTER_BYTES |
 					i8254_CONTROL_SELECT_COUNTER0;
-	control_port.write16(control_value);
+	control_port.write8(control_value);
 	counter0_port.write8(low_byte);
 	counter0_port.write8(high_byte);
 
@@ -69,3 +154,22 @@ i8254_programmable_interval_timer_c()
 	return;
 	}
 
+
+///
+/// Stops the periodic clock on counter 0, so that IRQ0 no longer fires.
+/// Counter 0 is left in mode 0, awaiting a new count, which is never written;
+/// its output stays low, so it never raises IRQ0.  The clock resumes on the
+/// next call to start_clock().
+///
+void_t i8254_programmable_interval_timer_c::
+stop_clock()
+	{
+	io_mapped_register_c control_port(i8254_CONTROL_PORT_ADDRESS);
+
+	control_port.write8(i8254_CONTROL_BINARY_COUNTING |
+						i8254_CONTROL_MODE0 |
+						i8254_CONTROL_BOTH_COUNTER_BYTES |
+						i8254_CONTROL_SELECT_COUNTER0);
+
+	return;
+	}
@@ -5,15 +5,20 @@
 //
 
 #include "address_space.hpp"
+#include "bits.hpp"
 #include "debug.hpp"
+#include "dx/expand_address_space.h"
 #include "dx/status.h"
 #include "hal/address_space_layout.h"
 #include "hal/page_directory.hpp"
+#include "kernel_heap.hpp"
 #include "kernel_subsystems.hpp"
 #include "memory_pool.hpp"
 #include "memory_tests.hpp"
 #include "new.hpp"
+#include "object_cache.hpp"
 #include "shared_frame.hpp"
+#include "thread.hpp"
 
 
 
@@ -66,6 +71,12 @@ run_address_space_tests()
 	status = address_space->share_frame(self, size, frame);
 	ASSERT(status == STATUS_SUCCESS);
 
+	// Reserve a range of user pages.  No frames are consumed until the pages
+	// are touched; the pages are discarded along with the address space
+	status = address_space->expand(void_tp(USER_BASE), 64*PAGE_SIZE,
+		EXPAND_ADDRESS_SPACE_RESERVE);
+	ASSERT(status == STATUS_SUCCESS);
+
 	// Clean up
 	address_space->unshare_frame(self, size);
 	remove_reference(*address_space);
@@ -105,6 +116,103 @@ run_block_tests()
 	}
 
 
+///
+/// Exercise the copy-on-write path when the faulting address space is the sole
+/// remaining owner of the shared frame: the page should become writable again
+/// in place, without copying
+///
+static
+void_t
+run_copy_on_write_tests()
+	{
+	address_space_cr	address_space =
+							__hal->read_current_thread().address_space;
+	bool_t				copied;
+	shared_frame_list_c	frame_list;
+	physical_address_t	original_frame;
+	uint32_tp			page = uint32_tp(USER_BASE);
+	status_t			status;
+	bool_t				success;
+
+	// Add a private page + fill it with some recognizable data
+	status = address_space.expand(page, PAGE_SIZE, 0);
+	ASSERT(status == STATUS_SUCCESS);
+	page[0] = 0xCAFEF00D;
+	original_frame = address_space.find_frame(page);
+	ASSERT(original_frame != INVALID_FRAME);
+
+	// Share the page, as if sending it as a message payload; the page is now
+	// copy-on-write
+	status = address_space.share_frame(page, PAGE_SIZE, frame_list);
+	ASSERT(status == STATUS_SUCCESS);
+	ASSERT(frame_list.read_count() == 1);
+
+	// Drop the reference held by the (imaginary) message, as if its
+	// recipient had since released the payload.  This address space is now
+	// the only owner of the frame
+	shared_frame_cr shared_frame = frame_list[0];
+	remove_reference(shared_frame);
+	ASSERT(read_reference_count(shared_frame) == 1);
+
+	// Fault on the page; expect the frame to be reclaimed, not copied
+	success = address_space.copy_on_write(page, &copied);
+	ASSERT(success);
+	ASSERT(!copied);
+	ASSERT(address_space.find_frame(page) == original_frame);
+	ASSERT(page[0] == 0xCAFEF00D);
+
+	// The page is writable again, so this should not fault
+	page[0] = 0;
+
+	// Clean up; this releases the frame along with its last reference
+	address_space.unshare_frame(page, PAGE_SIZE);
+
+	return;
+	}
+
+
+///
+/// Exercise the demand-zero path: pages reserved via expand() are populated
+/// with zero-filled frames on first touch
+///
+static
+void_t
+run_demand_zero_tests()
+	{
+	address_space_cr	address_space =
+							__hal->read_current_thread().address_space;
+	const
+	uint32_t			count = 4;
+	physical_address_t	frame[ count ];
+	uint32_tp			page = uint32_tp(USER_BASE);
+	status_t			status;
+
+	// Reserve a few pages; no frames are consumed yet
+	status = address_space.expand(page, count*PAGE_SIZE,
+		EXPAND_ADDRESS_SPACE_RESERVE);
+	ASSERT(status == STATUS_SUCCESS);
+
+	// Touch each page; each read takes a demand-zero fault, and should find
+	// a wiped frame
+	for (uint32_t i = 0; i < count*PAGE_SIZE/sizeof(uint32_t); i++)
+		{ ASSERT(page[i] == 0); }
+
+	// The pages are now present, so writes no longer fault
+	page[0] = 0x12345678;
+	ASSERT(page[0] == 0x12345678);
+
+	// A second fault on a page that is already present (e.g., another thread
+	// lost the race to populate it) is still handled
+	ASSERT(address_space.demand_zero(page));
+
+	// Clean up
+	address_space.decommit_frame(page, count, frame);
+	__memory_manager->free_frames(frame, count);
+
+	return;
+	}
+
+
 ///
 /// Exercise the frame allocator: allocate, coalesce, free blocks of frames
 ///
@@ -127,6 +235,87 @@ run_frame_tests()
 	for (uint32_t i = 0; i < frame_count; i++)
 		{ __memory_manager->free_frames(&frame[i], 1); }
 
+	// Allocate an odd-sized block of contiguous frames.  The excess frames
+	// in the underlying power-of-two block are returned to the region
+	// immediately; the requested frames are released piecemeal here
+	status = __memory_manager->allocate_frames(frame, frame_count - 1,
+		MEMORY_DMA32);
+	ASSERT(status == STATUS_SUCCESS);
+	for (uint32_t i = 1; i < frame_count - 1; i++)
+		{ ASSERT(frame[i] == frame[i-1] + PAGE_SIZE); }
+
+	for (uint32_t i = 0; i < frame_count - 1; i++)
+		{ __memory_manager->free_frames(&frame[i], 1); }
+
+	// Allocate a block large enough to require an entire region.  This
+	// should be aligned on a superpage boundary
+	uint32_t			super_page_frame_count = SUPER_PAGE_SIZE / PAGE_SIZE;
+	physical_address_tp	super_page_frame =
+		new physical_address_t[ super_page_frame_count ];
+	ASSERT(super_page_frame);
+
+	status = __memory_manager->allocate_frames(super_page_frame,
+		super_page_frame_count, MEMORY_DMA32);
+	ASSERT(status == STATUS_SUCCESS);
+	ASSERT(is_aligned(void_tp(super_page_frame[0]), SUPER_PAGE_SIZE));
+	for (uint32_t i = 1; i < super_page_frame_count; i++)
+		{ ASSERT(super_page_frame[i] == super_page_frame[i-1] + PAGE_SIZE); }
+
+	__memory_manager->free_frames(super_page_frame, super_page_frame_count);
+	delete[](super_page_frame);
+
+	// Frames for ISA DMA must lie below 16MB.  There may be no such memory
+	// available for paging, in which case the request simply fails
+	status = __memory_manager->allocate_frames(frame, frame_count,
+		MEMORY_DMA16);
+	if (status == STATUS_SUCCESS)
+		{
+		ASSERT(frame[frame_count-1] + PAGE_SIZE - 1 <= MEMORY_DMA16_LIMIT);
+		__memory_manager->free_frames(frame, frame_count);
+		}
+
+	return;
+	}
+
+
+///
+/// Exercise the expansion of the kernel heap beyond its fixed pools
+///
+static
+void_t
+run_kernel_heap_tests()
+	{
+	const
+	uint32_t	count = 32;
+	uint32_t	extension_count = 0;
+	uint32_t	i;
+	void_tp		block[ count ];
+
+	// Allocate more 8KB blocks than the fixed pool can hold; expect some of
+	// these to spill into the heap extension
+	for (i = 0; i < count; i++)
+		{
+		block[i] = __kernel_heap->allocate_block(8192, MEMORY_ALIGN_PAGE);
+		ASSERT(block[i]);
+		ASSERT(is_aligned(block[i], 8192));
+
+		if (uintptr_t(block[i]) >= KERNEL_HEAP_EXTENSION_BASE &&
+			uintptr_t(block[i]) < KERNEL_HEAP_EXTENSION_END)
+			{ extension_count++; }
+		}
+	ASSERT(extension_count > 0);
+
+	// Requests for identity-mapped memory must never come from the extension
+	void_tp identity = __kernel_heap->allocate_block(PAGE_SIZE,
+		MEMORY_ALIGN_PAGE | MEMORY_IDENTITY_MAPPED);
+	ASSERT(uintptr_t(identity) < KERNEL_DATA_PAGE0_END);
+	__kernel_heap->free_block(identity);
+
+	// Once all of the blocks are freed, their slabs may be released
+	for (i = 0; i < count; i++)
+		{ __kernel_heap->free_block(block[i]); }
+	ASSERT(__kernel_heap->release_free_slabs() > 0);
+
 	return;
 	}
 
@@ -158,6 +347,51 @@ run_memory_calculation_tests()
 	}
 
 
+///
+/// Allocate a private object cache; exercise its allocation, deletion and
+/// growth
+///
+static
+void_t
+run_object_cache_tests()
+	{
+	const
+	uint32_t		count = 64;
+	uint32_t		i;
+	void_tp			object[ count ];
+	object_cache_c	cache(100);
+
+	// Allocate enough objects to span multiple slabs
+	for (i = 0; i < count; i++)
+		{
+		object[i] = cache.allocate_object();
+		ASSERT(object[i]);
+		ASSERT(is_aligned(object[i], 8));
+		ASSERT(i == 0 || object[i] != object[i-1]);
+		}
+	ASSERT(cache.read_object_count() >= count);
+	ASSERT(cache.read_miss_count() > 1);
+
+	// Return the objects to the cache; then reallocate them without growing
+	uint32_t object_count = cache.read_object_count();
+	for (i = 0; i < count; i++)
+		{ cache.free_object(object[i]); }
+	for (i = 0; i < count; i++)
+		{
+		object[i] = cache.allocate_object();
+		ASSERT(object[i]);
+		}
+	ASSERT(cache.read_object_count() == object_count);
+	ASSERT(cache.read_hit_count() >= count);
+
+	// Return the objects; the cache then releases its slabs when destroyed
+	for (i = 0; i < count; i++)
+		{ cache.free_object(object[i]); }
+
+	return;
+	}
+
+
 ///
 /// Exercise the basic page directory/table methods
 ///
@@ -239,8 +473,12 @@ run_memory_tests()
 
 	run_address_space_tests();
 	run_block_tests();
+	run_copy_on_write_tests();
+	run_demand_zero_tests();
 	run_frame_tests();
+	run_kernel_heap_tests();
 	run_memory_calculation_tests();
+	run_object_cache_tests();
 	run_page_directory_tests();
 	run_pool_tests();
 	//@DMA memory, mapping/unmapping, etc
@@ -4,9 +4,11 @@
 // Unittest for message-handling functions
 //
 
+#include "address_space.hpp"
 #include "debug.hpp"
 #include "dx/status.h"
 #include "dx/thread_id.h"
+#include "hal/address_space_layout.h"
 #include "kernel_subsystems.hpp"
 #include "kernel_threads.hpp"
 #include "large_message.hpp"
@@ -37,7 +39,8 @@ run_large_payload_tests()
 	ASSERT(message);
 
 	// Attempt to gather this payload; expect this to fail because the payload
-	// lies within the kernel superpage
+	// lies within kernel memory that is neither user-visible nor explicitly
+	// shared, so can be neither shared nor copied
 	status = message->collect_payload();
 	ASSERT(status != STATUS_SUCCESS);
 	delete(message);
@@ -75,6 +78,173 @@ run_large_payload_tests()
 	}
 
 
+///
+/// Create a large message from several small, misaligned fragments and
+/// ensure they are reassembled, in order, at a second address.  Then gather a
+/// payload that includes a whole page, which is shared instead
+///
+static
+void_t
+run_gathered_payload_tests()
+	{
+	uint8_t				data[ 64 ];
+	message_fragment_s	fragment[ 2 ];
+	message_cp			message;
+	uint8_tp			page = uint8_tp(USER_BASE);
+	uint8_tp			payload;
+	status_t			status;
+	thread_cr			thread = __hal->read_current_thread();
+
+	for (uint32_t i = 0; i < sizeof(data); i++)
+		{ data[i] = uint8_t(i); }
+
+	// Two fragments, at arbitrary (and different) offsets
+	fragment[0].data = data + 3;
+	fragment[0].size = 20;
+	fragment[1].data = data + 41;
+	fragment[1].size = 17;
+
+	// The payload lies within kernel memory, so must be explicitly shared
+	status = thread.address_space.share_kernel_frames(data, sizeof(data));
+	ASSERT(status == STATUS_SUCCESS);
+
+	message = new large_message_c(thread, thread, MESSAGE_TYPE_NULL, rand(),
+		fragment, 2);
+	ASSERT(message);
+
+	// Gather the payload.  None of the fragments spans a whole page, so the
+	// payload is copied rather than shared
+	status = message->collect_payload();
+	ASSERT(status == STATUS_SUCCESS);
+
+	status = message->deliver_payload();
+	ASSERT(status == STATUS_SUCCESS);
+
+	// Ensure the fragments were concatenated, unaltered, at the same offset
+	// as the first fragment
+	payload = uint8_tp(message->read_payload());
+	ASSERT(message->read_payload_size() == 37);
+	ASSERT(PAGE_OFFSET(payload) == PAGE_OFFSET(fragment[0].data));
+	ASSERT(memcmp(payload, data + 3, 20) == 0);
+	ASSERT(memcmp(payload + 20, data + 41, 17) == 0);
+
+	delete(message);
+
+
+	//
+	// A fragment that covers a whole, aligned page is shared rather than
+	// copied.  Here, the first fragment is a private user page; the second
+	// is a few bytes of kernel data, so is copied as before
+	//
+	status = thread.address_space.expand(page, PAGE_SIZE, 0);
+	ASSERT(status == STATUS_SUCCESS);
+	memset(page, 0xA5, PAGE_SIZE);
+
+	fragment[0].data = page;
+	fragment[0].size = PAGE_SIZE;
+	fragment[1].data = data + 41;
+	fragment[1].size = 17;
+
+	message = new large_message_c(thread, thread, MESSAGE_TYPE_NULL, rand(),
+		fragment, 2);
+	ASSERT(message);
+
+	status = message->collect_payload();
+	ASSERT(status == STATUS_SUCCESS);
+
+	status = message->deliver_payload();
+	ASSERT(status == STATUS_SUCCESS);
+
+	// The first page of the payload is the sender's own frame; the second
+	// holds the copied tail
+	payload = uint8_tp(message->read_payload());
+	ASSERT(message->read_payload_size() == PAGE_SIZE + 17);
+	ASSERT(PAGE_OFFSET(payload) == 0);
+	ASSERT(thread.address_space.find_frame(payload) ==
+		thread.address_space.find_frame(page));
+	ASSERT(memcmp(payload, page, PAGE_SIZE) == 0);
+	ASSERT(memcmp(payload + PAGE_SIZE, data + 41, 17) == 0);
+
+	// Clean up; the sender's page is released along with its last reference
+	delete(message);
+	thread.address_space.unshare_frame(payload, PAGE_SIZE + 17);
+	thread.address_space.free_large_payload_block(payload);
+	thread.address_space.unshare_frame(page, PAGE_SIZE);
+
+	return;
+	}
+
+
+///
+/// Create a large message with a donated payload.  The sender surrenders
+/// its frames outright: the recipient sees the same frames, writable and
+/// without copy-on-write; and the sender's pages revert to reserved
+///
+static
+void_t
+run_donated_payload_tests()
+	{
+	physical_address_t	frame[ 2 ];
+	uint32_t			frame_count = sizeof(frame) / sizeof(frame[0]);
+	message_cp			message;
+	uint32_tp			payload;
+	uint32_tp			sender_payload = uint32_tp(USER_BASE);
+	size_t				size = frame_count * PAGE_SIZE;
+	status_t			status;
+	thread_cr			thread = __hal->read_current_thread();
+
+	// Add a few private pages to donate
+	status = thread.address_space.expand(sender_payload, size, 0);
+	ASSERT(status == STATUS_SUCCESS);
+	for (uint32_t i = 0; i < frame_count; i++)
+		{
+		sender_payload[ i*PAGE_SIZE/sizeof(uint32_t) ] = i + 1;
+		frame[i] = thread.address_space.find_frame(
+			sender_payload + i*PAGE_SIZE/sizeof(uint32_t));
+		ASSERT(frame[i] != INVALID_FRAME);
+		}
+
+	message = new large_message_c(thread, thread, MESSAGE_TYPE_NULL, rand(),
+		sender_payload, size);
+	ASSERT(message);
+	message->control |= MESSAGE_CONTROL_DONATE;
+
+	// Collect the payload; the sender no longer has any frames here
+	status = message->collect_payload();
+	ASSERT(status == STATUS_SUCCESS);
+	for (uint32_t i = 0; i < frame_count; i++)
+		{
+		ASSERT(thread.address_space.find_frame(
+			sender_payload + i*PAGE_SIZE/sizeof(uint32_t)) == INVALID_FRAME);
+		}
+
+	// Deliver the payload; expect the original frames, unaltered, at a new
+	// address
+	status = message->deliver_payload();
+	ASSERT(status == STATUS_SUCCESS);
+	payload = uint32_tp(message->read_payload());
+	ASSERT(payload != sender_payload);
+	ASSERT(message->read_payload_size() == size);
+	for (uint32_t i = 0; i < frame_count; i++)
+		{
+		uint32_tp page = payload + i*PAGE_SIZE/sizeof(uint32_t);
+		ASSERT(thread.address_space.find_frame(page) == frame[i]);
+		ASSERT(*page == i + 1);
+
+		// The recipient owns this frame, so this should not fault
+		*page = 0;
+		}
+
+	// Clean up.  The recipient's frames are private, so are released here;
+	// the sender's pages simply remain reserved
+	delete(message);
+	thread.address_space.unshare_frame(payload, size);
+	thread.address_space.free_large_payload_block(payload);
+
+	return;
+	}
+
+
 ///
 /// Create a message with a "medium" payload and copy it to a second address
 ///
@@ -111,6 +281,222 @@ run_medium_payload_tests()
 	}
 
 
+///
+/// Entry point for a test thread that responds to every incoming message, and
+/// discards its (medium) payload.  Used by run_medium_payload_benchmark()
+/// below
+///
+static
+void_t
+echo_test_thread()
+	{
+	message_cp	message;
+	status_t	status;
+	thread_cr	thread = __hal->read_current_thread();
+
+	for(;;)
+		{
+		status = __io_manager->receive_message(&message);
+		ASSERT(status == STATUS_SUCCESS);
+
+		status = put_response(*message, MESSAGE_TYPE_NULL, STATUS_SUCCESS);
+		ASSERT(status == STATUS_SUCCESS);
+
+		// This thread now owns the payload block, if any
+		if (message->read_payload_size() > 0)
+			{
+			thread.address_space.free_medium_payload_block(
+				message->read_payload());
+			}
+
+		delete(message);
+		}
+
+	return;
+	}
+
+
+///
+/// Create an echo thread within the given address space, and wait until it
+/// is running
+///
+/// @param address_space -- the address space of the new thread
+///
+/// @return the new thread; the caller holds a reference to it
+///
+static
+thread_cp
+start_echo_thread(address_space_cp address_space)
+	{
+	message_cp	message;
+	status_t	status;
+	thread_cp	thread;
+
+	thread = __thread_manager->create_thread(echo_test_thread, address_space,
+		THREAD_ID_AUTO_ALLOCATE);
+	ASSERT(thread);
+
+	message = new small_message_c(__hal->read_current_thread(), *thread,
+		MESSAGE_TYPE_NULL, rand());
+	ASSERT(message != NULL);
+	status = __io_manager->put_message(*message);
+	ASSERT(status == STATUS_SUCCESS);
+
+	status = __io_manager->receive_message(&message);
+	ASSERT(status == STATUS_SUCCESS);
+	delete(message);
+
+	return(thread);
+	}
+
+
+///
+/// Send a series of medium messages to an echo thread, each while the thread
+/// is waiting for it; so each payload is copied straight into the recipient's
+/// payload block.  See medium_message_c::collect_payload()
+///
+/// @param recipient	-- an echo thread; see start_echo_thread()
+/// @param source		-- the payload
+/// @param size			-- size of the payload, in bytes
+/// @param iterations	-- the number of messages to send
+///
+/// @return the number of processor cycles spent sending the messages
+///
+static
+uint32_t
+send_medium_payloads(	thread_cr	recipient,
+						uint8_tp	source,
+						size_t		size,
+						uint32_t	iterations)
+	{
+	uint32_t	cycles = 0;
+	message_cp	message;
+	uint32_t	start;
+	status_t	status;
+	thread_cr	thread = __hal->read_current_thread();
+
+	for (uint32_t i = 0; i < iterations; i++)
+		{
+		// The recipient may have been preempted after responding to the
+		// previous message, before it could wait for the next one
+		while (recipient.state != THREAD_STATE_WAITING)
+			{ thread_yield(); }
+
+		message = new medium_message_c(thread, recipient, MESSAGE_TYPE_NULL,
+			rand(), source, size);
+		ASSERT(message != NULL);
+
+		start = __hal->read_timestamp32();
+		status = __io_manager->put_message(*message);
+		cycles += __hal->read_timestamp32() - start;
+		ASSERT(status == STATUS_SUCCESS);
+
+		// Wait for the recipient to consume it
+		status = __io_manager->receive_message(&message);
+		ASSERT(status == STATUS_SUCCESS);
+		delete(message);
+		}
+
+	return(cycles);
+	}
+
+
+///
+/// Compare the cost of sending a medium payload to a recipient that is not
+/// waiting for it (the payload is staged within the message, then copied again
+/// when received) against sending it to a recipient that is already waiting
+/// (the payload is copied once, straight into the recipient's payload block);
+/// the latter both within the current address space, and into a second
+/// address space.  Results are in processor cycles, averaged over several
+/// iterations
+///
+static
+void_t
+run_medium_payload_benchmark()
+	{
+	const
+	uint32_t			ITERATIONS = 64;
+	uint32_t			direct_cycles;
+	thread_cp			local;
+	message_cp			message;
+	uint32_t			receive_cycles;
+	address_space_cp	remote;
+	uint32_t			remote_cycles;
+	thread_cp			remote_thread;
+	uint8_t				source[ MEDIUM_MESSAGE_PAYLOAD_SIZE ];
+	uint32_t			staged_cycles;
+	uint32_t			start;
+	status_t			status;
+	thread_cr			thread = __hal->read_current_thread();
+
+
+	// Recipients that wait for each message, in this address space and in
+	// a second address space
+	local = start_echo_thread(NULL);
+
+	remote = __memory_manager->create_address_space(5678);	// Arbitrary id
+	ASSERT(remote);
+	remote_thread = start_echo_thread(remote);
+
+	for (uint32_t i = 0; i < sizeof(source); i++)
+		{ source[i] = uint8_t(i); }
+
+	for (size_t size = 16; size <= MEDIUM_MESSAGE_PAYLOAD_SIZE; size *= 2)
+		{
+		// The staged path.  The current thread is running, not waiting, so
+		// a message to itself is staged when sent, and copied again when
+		// received
+		staged_cycles	= 0;
+		receive_cycles	= 0;
+		for (uint32_t i = 0; i < ITERATIONS; i++)
+			{
+			message = new medium_message_c(thread, thread, MESSAGE_TYPE_NULL,
+				rand(), source, size);
+			ASSERT(message != NULL);
+
+			start = __hal->read_timestamp32();
+			status = __io_manager->put_message(*message);
+			staged_cycles += __hal->read_timestamp32() - start;
+			ASSERT(status == STATUS_SUCCESS);
+
+			start = __hal->read_timestamp32();
+			status = __io_manager->receive_message(&message);
+			receive_cycles += __hal->read_timestamp32() - start;
+			ASSERT(status == STATUS_SUCCESS);
+			ASSERT(memcmp(message->read_payload(), source, size) == 0);
+			thread.address_space.free_medium_payload_block(
+				message->read_payload());
+			delete(message);
+			}
+
+		// The direct path, to a waiting recipient
+		direct_cycles = send_medium_payloads(*local, source, size,
+			ITERATIONS);
+
+		// The direct path, into another address space.  The recipient's
+		// block is not visible here, so the copy page carries every byte
+		remote_cycles = send_medium_payloads(*remote_thread, source, size,
+			ITERATIONS);
+
+		TRACE(TEST, "Medium payload, %d bytes: %d + %d cycles staged "
+			"(send + receive), %d cycles direct, %d cycles direct (remote)\n",
+			size, staged_cycles / ITERATIONS, receive_cycles / ITERATIONS,
+			direct_cycles / ITERATIONS, remote_cycles / ITERATIONS);
+		}
+
+	// Clean up
+	__thread_manager->delete_thread(*local);
+	remove_reference(*local);
+	__thread_manager->delete_thread(*remote_thread);
+	remove_reference(*remote_thread);
+
+	remove_reference(*remote);
+	__memory_manager->delete_address_space(*remote);
+
+	return;
+	}
+
+
 ///
 /// Attempt to create a scheduling deadlock by sending a blocking message
 /// to the current thread.
@@ -141,6 +527,666 @@ run_message_deadlock_tests()
 	}
 
 
+///
+/// Entry point for a test thread that never receives any messages
+///
+static
+void_t
+idle_test_thread()
+	{
+	for(;;)
+		{ __hal->suspend_processor(); }
+
+	return;
+	}
+
+
+///
+/// Threads used by the flow-control tests; see run_send_wait_tests()
+///
+static thread_cp	flow_control_observer	= NULL;
+static thread_cp	flow_control_recipient	= NULL;
+static thread_cp	flow_control_sender		= NULL;
+
+
+///
+/// Create a test thread + send it an empty message, so that it becomes
+/// eligible for the lottery and starts executing.  The thread never receives
+/// the message; it is discarded when the thread is deleted
+///
+/// @param entry -- the entry point of the new thread
+///
+/// @return the new thread; the caller holds a reference to it
+///
+static
+thread_cp
+start_test_thread(thread_start_fp entry)
+	{
+	message_cp	message;
+	status_t	status;
+	thread_cp	thread;
+
+	thread = __thread_manager->create_thread(entry, NULL,
+		THREAD_ID_AUTO_ALLOCATE);
+	ASSERT(thread);
+
+	message = new small_message_c(__hal->read_current_thread(), *thread,
+		MESSAGE_TYPE_NULL, MESSAGE_ID_ATOMIC);
+	ASSERT(message != NULL);
+	status = __io_manager->put_message(*message);
+	ASSERT(status == STATUS_SUCCESS);
+
+	return(thread);
+	}
+
+
+///
+/// Entry point for a test thread that makes room in the mailbox of the
+/// flow-control recipient, once the flow-control sender is waiting for it
+///
+static
+void_t
+room_test_thread()
+	{
+	status_t status;
+
+	while (flow_control_sender->state != THREAD_STATE_SENDING)
+		{ __hal->suspend_processor(); }
+
+	status = flow_control_recipient->set_mailbox_limit(2);
+	ASSERT(status == STATUS_SUCCESS);
+
+	for(;;)
+		{ __hal->suspend_processor(); }
+
+	return;
+	}
+
+
+///
+/// Entry point for a test thread that wakes the flow-control observer, once
+/// the flow-control sender is waiting for room
+///
+static
+void_t
+watch_test_thread()
+	{
+	message_cp	message;
+	status_t	status;
+
+	while (flow_control_sender->state != THREAD_STATE_SENDING)
+		{ __hal->suspend_processor(); }
+
+	message = new small_message_c(__hal->read_current_thread(),
+		*flow_control_observer, MESSAGE_TYPE_NULL, MESSAGE_ID_ATOMIC);
+	ASSERT(message != NULL);
+	status = __io_manager->put_message(*message);
+	ASSERT(status == STATUS_SUCCESS);
+
+	for(;;)
+		{ __hal->suspend_processor(); }
+
+	return;
+	}
+
+
+///
+/// Entry point for a test thread that sends a message to the flow-control
+/// recipient, waiting for room if necessary
+///
+static
+void_t
+sending_test_thread()
+	{
+	message_cp	message;
+	status_t	status;
+
+	message = new small_message_c(__hal->read_current_thread(),
+		*flow_control_recipient, MESSAGE_TYPE_NULL, MESSAGE_ID_ATOMIC);
+	ASSERT(message != NULL);
+	status = __io_manager->put_message(*message, TRUE);
+	if (status != STATUS_SUCCESS)
+		{ delete(message); }
+
+	for(;;)
+		{ __hal->suspend_processor(); }
+
+	return;
+	}
+
+
+///
+/// Post several asynchronous requests to the current thread, then reply to
+/// them out of order.  Each reply must be routed to its own request, and
+/// never confused with an unsolicited message.  Finally, post a request to a
+/// thread that is destroyed before it can reply.
+///
+static
+void_t
+run_async_request_tests()
+	{
+	message_cp		incoming[2];
+	message_cp		message;
+	message_cp		reply;
+	message_id_t	request_id[] = { 0x1234, 0x5678 };
+	status_t		status;
+	thread_cr		thread = __hal->read_current_thread();
+	message_cp		unsolicited;
+	thread_cp		victim;
+
+
+	//
+	// Post two requests; a duplicate request id is rejected
+	//
+	for (uint32_t i = 0; i < 2; i++)
+		{
+		message = new small_message_c(thread, thread, MESSAGE_TYPE_NULL,
+			request_id[i]);
+		ASSERT(message != NULL);
+		status = __io_manager->send_request(*message);
+		ASSERT(status == STATUS_SUCCESS);
+		}
+
+	message = new small_message_c(thread, thread, MESSAGE_TYPE_NULL,
+		request_id[0]);
+	ASSERT(message != NULL);
+	status = __io_manager->send_request(*message);
+	ASSERT(status == STATUS_RESOURCE_CONFLICT);
+	delete(message);
+
+
+	//
+	// Neither request has been answered yet
+	//
+	status = __io_manager->receive_reply(&reply, MESSAGE_ID_ANY, FALSE);
+	ASSERT(status == STATUS_MAILBOX_EMPTY);
+
+
+	//
+	// Receive both requests, then reply in reverse order.  An unsolicited
+	// message arrives in the meantime
+	//
+	for (uint32_t i = 0; i < 2; i++)
+		{
+		status = __io_manager->receive_message(&incoming[i], FALSE);
+		ASSERT(status == STATUS_SUCCESS);
+		ASSERT(incoming[i]->id == request_id[i]);
+		ASSERT(incoming[i]->expects_reply());
+		}
+
+	unsolicited = new small_message_c(thread, thread, MESSAGE_TYPE_NULL,
+		MESSAGE_ID_ATOMIC);
+	ASSERT(unsolicited != NULL);
+	status = __io_manager->send_message(*unsolicited);
+	ASSERT(status == STATUS_SUCCESS);
+
+	for (uint32_t i = 2; i > 0; i--)
+		{
+		status = put_response(*incoming[i-1], MESSAGE_TYPE_NULL,
+			STATUS_SUCCESS);
+		ASSERT(status == STATUS_SUCCESS);
+		delete(incoming[i-1]);
+		}
+
+
+	//
+	// Collect one specific reply, then whichever remains
+	//
+	status = __io_manager->receive_reply(&reply, request_id[0], FALSE);
+	ASSERT(status == STATUS_SUCCESS);
+	ASSERT(reply->id == request_id[0]);
+	delete(reply);
+
+	status = __io_manager->receive_reply(&reply, MESSAGE_ID_ANY, TRUE);
+	ASSERT(status == STATUS_SUCCESS);
+	ASSERT(reply->id == request_id[1]);
+	delete(reply);
+
+	status = __io_manager->receive_reply(&reply, MESSAGE_ID_ANY, TRUE);
+	ASSERT(status == STATUS_INVALID_DATA);
+
+
+	//
+	// The unsolicited message is still waiting in the mailbox
+	//
+	status = __io_manager->receive_message(&message, FALSE);
+	ASSERT(status == STATUS_SUCCESS);
+	ASSERT(message->id == MESSAGE_ID_ATOMIC);
+	delete(message);
+
+
+	//
+	// A recipient that exits without replying still answers the request,
+	// with an abort message
+	//
+	victim = __thread_manager->create_thread(idle_test_thread, NULL,
+		THREAD_ID_AUTO_ALLOCATE);
+	ASSERT(victim);
+
+	message = new small_message_c(thread, *victim, MESSAGE_TYPE_NULL,
+		request_id[0]);
+	ASSERT(message != NULL);
+	status = __io_manager->send_request(*message);
+	ASSERT(status == STATUS_SUCCESS);
+
+	__thread_manager->delete_thread(*victim);
+	remove_reference(*victim);
+
+	status = __io_manager->receive_reply(&reply, request_id[0], TRUE);
+	ASSERT(status == STATUS_SUCCESS);
+	ASSERT(reply->type == MESSAGE_TYPE_ABORT);
+	delete(reply);
+
+	return;
+	}
+
+
+///
+/// Process two batches of message operations, as in PROCESS_MESSAGES.  The
+/// first sends a medium message to the current thread + receives it; a
+/// second receive finds the mailbox empty, but the batch continues.  The
+/// second batch deletes the payload, then stops at an invalid operation
+/// before sending anything else
+///
+static
+void_t
+run_process_messages_tests()
+	{
+	message_operation_s	operation[ 3 ];
+	uint8_t				payload[ 16 ];
+	uint32_t			processed;
+	message_cp			message;
+	message_s			received;
+	status_t			status;
+	thread_cr			thread = __hal->read_current_thread();
+	const
+	status_t			UNTOUCHED = status_t(0x7FFFFFFF);
+
+
+	for (uint32_t i = 0; i < sizeof(payload); i++)
+		{ payload[i] = uint8_t(i); }
+
+
+	//
+	// Send + receive; the second receive fails, but does not stop the batch
+	//
+	memset(operation, 0, sizeof(operation));
+	operation[0].type					= MESSAGE_OPERATION_SEND;
+	operation[0].message.u.destination	= thread.id;
+	operation[0].message.type			= MESSAGE_TYPE_NULL;
+	operation[0].message.id				= 0x4321;
+	operation[0].message.data			= payload;
+	operation[0].message.data_size		= sizeof(payload);
+	operation[1].type					= MESSAGE_OPERATION_RECEIVE;
+	operation[2].type					= MESSAGE_OPERATION_RECEIVE;
+
+	status = __io_manager->process_messages(operation, 3, &processed);
+	ASSERT(status == STATUS_SUCCESS);
+	ASSERT(processed == 3);
+	ASSERT(operation[0].status == STATUS_SUCCESS);
+	ASSERT(operation[1].status == STATUS_SUCCESS);
+	ASSERT(operation[2].status == STATUS_MAILBOX_EMPTY);
+
+	received = operation[1].message;
+	ASSERT(received.u.source == thread.id);
+	ASSERT(received.id == 0x4321);
+	ASSERT(received.data_size == sizeof(payload));
+	ASSERT(received.data != payload);
+	ASSERT(memcmp(received.data, payload, sizeof(payload)) == 0);
+
+
+	//
+	// Delete the payload; then an invalid operation stops the batch, so the
+	// final send never executes
+	//
+	memset(operation, 0, sizeof(operation));
+	operation[0].type					= MESSAGE_OPERATION_DELETE;
+	operation[0].message				= received;
+	operation[1].type					= 0xBAD;
+	operation[1].status					= UNTOUCHED;
+	operation[2].type					= MESSAGE_OPERATION_SEND;
+	operation[2].message.u.destination	= thread.id;
+	operation[2].status					= UNTOUCHED;
+
+	status = __io_manager->process_messages(operation, 3, &processed);
+	ASSERT(status == STATUS_INVALID_DATA);
+	ASSERT(processed == 1);
+	ASSERT(operation[0].status == STATUS_SUCCESS);
+	ASSERT(operation[1].status == STATUS_INVALID_DATA);
+	ASSERT(operation[2].status == UNTOUCHED);
+
+	status = __io_manager->receive_message(&message, FALSE);
+	ASSERT(status == STATUS_MAILBOX_EMPTY);
+
+	return;
+	}
+
+
+///
+/// Signal an idle thread.  Signals are only delivered once the thread has
+/// enabled notification; repeated signals coalesce behind a single scheduling
+/// ticket, and are collected all at once; and the ticket is released when the
+/// thread is deleted, even if it is still pooled.
+///
+static
+void_t
+run_notification_tests()
+	{
+	bool_t		pending;
+	uint32_t	signal;
+	status_t	status;
+	message_cp	ticket;
+	thread_cp	victim;
+
+
+	victim = __thread_manager->create_thread(idle_test_thread, NULL,
+		THREAD_ID_AUTO_ALLOCATE);
+	ASSERT(victim);
+
+	// Notification not yet enabled, so the signal is ignored
+	__io_manager->put_notification(*victim, 1 << 3);
+	ASSERT(victim->ticket_count == 0);
+
+	status = victim->enable_notification();
+	ASSERT(status == STATUS_SUCCESS);
+
+
+	//
+	// Three signals on two bits, but only one ticket
+	//
+	__io_manager->put_notification(*victim, 1 << 5);
+	__io_manager->put_notification(*victim, 1 << 3);
+	__io_manager->put_notification(*victim, 1 << 3);
+	ASSERT(victim->ticket_count == 1);
+
+
+	//
+	// All pending bits are collected at once; nothing else is pending, so
+	// the ticket should now leave the pool
+	//
+	pending = victim->get_notification(&signal, &ticket);
+	ASSERT(pending);
+	ASSERT(signal == ((1 << 5) | (1 << 3)));
+	ASSERT(ticket != NULL);
+
+	pending = victim->get_notification(&signal, &ticket);
+	ASSERT(!pending);
+	ASSERT(ticket == NULL);
+
+
+	// The ticket is deliberately left in the pool here; deletion removes
+	// it and releases it
+	__thread_manager->delete_thread(*victim);
+	remove_reference(*victim);
+
+	return;
+	}
+
+
+///
+/// Fill the mailbox of an idle thread.  Once the mailbox reaches its limit,
+/// further messages are refused, without harming the recipient; raising the
+/// limit makes room again.
+///
+static
+void_t
+run_mailbox_limit_tests()
+	{
+	uint32_t	i;
+	message_cp	message;
+	status_t	status;
+	thread_cr	thread = __hal->read_current_thread();
+	thread_cp	victim;
+
+
+	victim = __thread_manager->create_thread(idle_test_thread, NULL,
+		THREAD_ID_AUTO_ALLOCATE);
+	ASSERT(victim);
+
+	status = victim->set_mailbox_limit(0);
+	ASSERT(status == STATUS_INVALID_DATA);
+	status = victim->set_mailbox_limit(MAILBOX_LIMIT_MAX + 1);
+	ASSERT(status == STATUS_INVALID_DATA);
+	status = victim->set_mailbox_limit(2);
+	ASSERT(status == STATUS_SUCCESS);
+
+
+	//
+	// Fill the mailbox; the next message is refused, since the kernel never
+	// waits for room here
+	//
+	for (i = 0; i < 3; i++)
+		{
+		message = new small_message_c(thread, *victim, MESSAGE_TYPE_NULL,
+			MESSAGE_ID_ATOMIC);
+		ASSERT(message != NULL);
+
+		status = __io_manager->put_message(*message);
+		if (i < 2)
+			{ ASSERT(status == STATUS_SUCCESS); }
+		else
+			{
+			ASSERT(status == STATUS_WOULD_BLOCK);
+			delete(message);
+			}
+		}
+
+	// Each pending message is one scheduling ticket
+	ASSERT(victim->ticket_count == 2);
+
+
+	//
+	// Raising the limit makes room for one more
+	//
+	status = victim->set_mailbox_limit(3);
+	ASSERT(status == STATUS_SUCCESS);
+
+	message = new small_message_c(thread, *victim, MESSAGE_TYPE_NULL,
+		MESSAGE_ID_ATOMIC);
+	ASSERT(message != NULL);
+	status = __io_manager->put_message(*message);
+	ASSERT(status == STATUS_SUCCESS);
+	ASSERT(victim->ticket_count == 3);
+
+
+	__thread_manager->delete_thread(*victim);
+	remove_reference(*victim);
+
+	return;
+	}
+
+
+///
+/// Send to a full mailbox, waiting for room.  The current thread waits until
+/// a helper thread raises the limit of the mailbox, then completes its send.
+/// A second sender is deleted while it is still waiting; it must no longer
+/// be queued on, or hold a reference to, the recipient.
+///
+static
+void_t
+run_send_wait_tests()
+	{
+	int32_t		recipient_references;
+	thread_cp	helper;
+	message_cp	message;
+	int32_t		sender_references;
+	status_t	status;
+	thread_cr	thread = __hal->read_current_thread();
+
+
+	flow_control_recipient = __thread_manager->create_thread(
+		idle_test_thread, NULL, THREAD_ID_AUTO_ALLOCATE);
+	ASSERT(flow_control_recipient);
+
+	status = flow_control_recipient->set_mailbox_limit(1);
+	ASSERT(status == STATUS_SUCCESS);
+
+	message = new small_message_c(thread, *flow_control_recipient,
+		MESSAGE_TYPE_NULL, MESSAGE_ID_ATOMIC);
+	ASSERT(message != NULL);
+	status = __io_manager->put_message(*message);
+	ASSERT(status == STATUS_SUCCESS);
+
+
+	//
+	// The mailbox is full, so the current thread waits here until the
+	// helper makes room
+	//
+	flow_control_sender = &thread;
+	helper = start_test_thread(room_test_thread);
+
+	message = new small_message_c(thread, *flow_control_recipient,
+		MESSAGE_TYPE_NULL, MESSAGE_ID_ATOMIC);
+	ASSERT(message != NULL);
+	status = __io_manager->put_message(*message, TRUE);
+	ASSERT(status == STATUS_SUCCESS);
+	ASSERT(thread.state == THREAD_STATE_READY);
+	ASSERT(flow_control_recipient->ticket_count == 2);
+
+
+	__thread_manager->delete_thread(*helper);
+	remove_reference(*helper);
+
+
+	//
+	// The mailbox is full again.  Delete another sender while it waits.  The
+	// current thread never loses the CPU to the clock, so sleep until the
+	// sender is known to be waiting
+	//
+	flow_control_observer = &thread;
+	flow_control_sender	= start_test_thread(sending_test_thread);
+	helper				= start_test_thread(watch_test_thread);
+
+	status = __io_manager->receive_message(&message);
+	ASSERT(status == STATUS_SUCCESS);
+	ASSERT(message->source == *helper);
+	delete(message);
+
+	ASSERT(flow_control_sender->state == THREAD_STATE_SENDING);
+	recipient_references	= read_reference_count(*flow_control_recipient);
+	sender_references		= read_reference_count(*flow_control_sender);
+
+	// The thread table, the sender queue + the unread start message all
+	// release the sender; and the sender no longer holds the recipient.  Its
+	// undelivered message still holds references to both threads
+	__thread_manager->delete_thread(*flow_control_sender);
+	ASSERT(read_reference_count(*flow_control_sender) ==
+		sender_references - 3);
+	ASSERT(read_reference_count(*flow_control_recipient) ==
+		recipient_references - 1);
+	remove_reference(*flow_control_sender);
+
+
+	__thread_manager->delete_thread(*helper);
+	remove_reference(*helper);
+	__thread_manager->delete_thread(*flow_control_recipient);
+	remove_reference(*flow_control_recipient);
+
+	flow_control_observer	= NULL;
+	flow_control_recipient	= NULL;
+	flow_control_sender		= NULL;
+
+	return;
+	}
+
+
+///
+/// State shared with the ring test thread; see run_message_ring_tests()
+///
+static thread_cp		ring_test_observer	= NULL;
+static message_ring_sp	ring_test_page		= NULL;
+static status_t			ring_test_status	= STATUS_SUCCESS;
+
+
+///
+/// Entry point for a test thread that creates its message rings, and then
+/// attempts to delete them as if they were a message payload.  Reports back
+/// to the observer thread
+///
+static
+void_t
+ring_test_thread()
+	{
+	message_cp			message;
+	message_operation_s	operation;
+	uint32_t			processed;
+	status_t			status;
+	thread_cr			thread = __hal->read_current_thread();
+
+	status = __io_manager->create_message_ring(thread);
+	ASSERT(status == STATUS_SUCCESS);
+	ASSERT(thread.message_ring);
+	ring_test_page = thread.message_ring;
+
+	memset(&operation, 0, sizeof(operation));
+	operation.type				= MESSAGE_OPERATION_DELETE;
+	operation.message.data		= thread.message_ring;
+	operation.message.data_size	= PAGE_SIZE;
+	status = __io_manager->process_messages(&operation, 1, &processed);
+	ASSERT(status == STATUS_SUCCESS);
+	ring_test_status = operation.status;
+
+	// The rings remain mapped + usable
+	thread.message_ring->submission_tail++;
+	ASSERT(thread.message_ring->submission_tail == 1);
+	thread.message_ring->submission_tail--;
+
+	message = new small_message_c(thread, *ring_test_observer,
+		MESSAGE_TYPE_NULL, MESSAGE_ID_ATOMIC);
+	ASSERT(message != NULL);
+	status = __io_manager->put_message(*message);
+	ASSERT(status == STATUS_SUCCESS);
+
+	for(;;)
+		{ __hal->suspend_processor(); }
+
+	return;
+	}
+
+
+///
+/// A thread cannot release its own message rings via DELETE_MESSAGE: the
+/// attempt fails, the rings remain mapped, and they are released exactly once
+/// when the thread exits.
+///
+static
+void_t
+run_message_ring_tests()
+	{
+	thread_cp	helper;
+	message_cp	message;
+	status_t	status;
+	thread_cr	thread = __hal->read_current_thread();
+
+
+	ring_test_observer	= &thread;
+	helper				= start_test_thread(ring_test_thread);
+
+	status = __io_manager->receive_message(&message);
+	ASSERT(status == STATUS_SUCCESS);
+	ASSERT(message->source == *helper);
+	delete(message);
+
+	ASSERT(ring_test_status == STATUS_INVALID_DATA);
+	ASSERT(helper->message_ring == ring_test_page);
+	ASSERT(thread.address_space.find_frame(ring_test_page) != INVALID_FRAME);
+
+
+	//
+	// The thread exits; the last reference releases its rings
+	//
+	__thread_manager->delete_thread(*helper);
+	ASSERT(read_reference_count(*helper) == 1);
+	remove_reference(*helper);
+	ASSERT(thread.address_space.find_frame(ring_test_page) == INVALID_FRAME);
+
+	ring_test_observer	= NULL;
+	ring_test_page		= NULL;
+
+	return;
+	}
+
+
 ///
 /// Send a couple of null/empty messages.  Exercises basic mailbox management
 /// and the I/O Manager (non-blocking) message-passing methods.
@@ -187,8 +1233,17 @@ run_message_tests()
 	TRACE(TEST, "Running message tests ...\n");
 
 	run_large_payload_tests();
+	run_gathered_payload_tests();
+	run_donated_payload_tests();
 	run_medium_payload_tests();
+	run_medium_payload_benchmark();
 	run_message_deadlock_tests();
+	run_async_request_tests();
+	run_process_messages_tests();
+	run_notification_tests();
+	run_mailbox_limit_tests();
+	run_send_wait_tests();
+	run_message_ring_tests();
 	run_null_message_tests();
 
 	TRACE(TEST, "Running message tests ... done!\n");
@@ -9,11 +9,16 @@
 #include "dx/address_space_id.h"
 #include "dx/capability.h"
 #include "dx/status.h"
+#include "hal/address_space_layout.h"
 #include "hal/spinlock.hpp"
 #include "kernel_subsystems.hpp"
+#include "message.hpp"
+#include "message_pool.hpp"
 #include "small_message.hpp"
 #include "thread.hpp"
+#include "thread_layout.h"
 #include "thread_tests.hpp"
+#include "user_thread.hpp"
 
 
 
@@ -24,7 +29,36 @@ const
 thread_id_t	THREAD_ID_CAPABILITY		= 1024,
 			THREAD_ID_GRACEFUL_EXIT		= 1025,
 			THREAD_ID_FORCED_EXIT		= 1026,
-			THREAD_ID_NEVER_START		= 1027;
+			THREAD_ID_NEVER_START		= 1027,
+			THREAD_ID_FPU_FAULT			= 1028;
+
+
+//
+// Number of threads created by run_block_tests(); enough to overflow the
+// thread block cache
+//
+const
+uint32_t	BLOCK_TEST_THREAD_COUNT		= 100;
+
+
+//
+// User-mode code for the thread launched from run_fpu_fault_tests(): unmask
+// the divide-by-zero exception, divide by zero, then wait for the pending
+// exception.  The thread should never get past the fwait
+//
+static
+const
+uint8_t		FPU_FAULT_CODE[] =
+	{
+	0xDB, 0xE3,						// fninit
+	0x68, 0x7B, 0x03, 0x00, 0x00,	// pushl	$0x037B (control word, ZM=0)
+	0xD9, 0x2C, 0x24,				// fldcw	(%esp)
+	0xD9, 0xE8,						// fld1
+	0xD9, 0xEE,						// fldz
+	0xDE, 0xF9,						// fdivp	(1.0 / 0.0)
+	0x9B,							// fwait	(raises #MF)
+	0xEB, 0xFE						// jmp		.
+	};
 
 
 
@@ -152,6 +186,43 @@ forced_exit_thread()
 	}
 
 
+///
+/// Entry point (and sole routine) for the watcher thread launched from
+/// run_fpu_fault_tests() below.  Responds to the test message only after the
+/// faulting user thread has been removed from the Thread Table
+///
+static
+void_t
+fpu_fault_watch_thread()
+	{
+	message_cp	test_message;
+	thread_cp	thread;
+	status_t	status;
+
+	test_message = receive_test_message();
+
+	for(;;)
+		{
+		thread = __thread_manager->find_thread(THREAD_ID_FPU_FAULT);
+		if (!thread)
+			{ break; }
+
+		remove_reference(*thread);
+		__hal->suspend_processor();
+		}
+
+	status = put_response(*test_message, MESSAGE_TYPE_NULL, STATUS_SUCCESS);
+	ASSERT(status == STATUS_SUCCESS);
+	delete(test_message);
+
+	// Just loop until destroyed
+	for(;;)
+		{ __hal->suspend_processor(); }
+
+	return;
+	}
+
+
 ///
 /// Entry point (and sole routine) for the graceful thread launched from
 /// run_exit_tests() below
@@ -204,6 +275,45 @@ run_capability_tests()
 	}
 
 
+///
+/// Creates + destroys a batch of threads, to exercise the thread block cache.
+/// Each thread context must sit at the expected offset within its block, so
+/// that read_current_thread() can locate it
+///
+static
+void_t
+run_block_tests()
+	{
+	thread_cp	thread[ BLOCK_TEST_THREAD_COUNT ];
+	uintptr_t	block;
+	uint32_t	i;
+
+
+	for (i = 0; i < BLOCK_TEST_THREAD_COUNT; i++)
+		{
+		thread[i] = __thread_manager->create_thread(graceful_exit_thread,
+			NULL, THREAD_ID_AUTO_ALLOCATE);
+		ASSERT(thread[i]);
+
+		block = uintptr_t(thread[i]) & THREAD_EXECUTION_BLOCK_ALIGNMENT_MASK;
+		ASSERT(uintptr_t(thread[i]) - block == THREAD_CONTEXT_OFFSET);
+		ASSERT(block >= KERNEL_THREAD_AREA_BASE);
+		ASSERT(block < KERNEL_THREAD_AREA_END);
+		}
+
+
+	// None of these threads ever executed, so destroy them explicitly
+	for (i = 0; i < BLOCK_TEST_THREAD_COUNT; i++)
+		{
+		__thread_manager->delete_thread(*thread[i]);
+		remove_reference(*thread[i]);
+		}
+
+
+	return;
+	}
+
+
 ///
 /// Creates a couple of threads + ensures they exit correctly
 ///
@@ -272,6 +382,171 @@ run_exit_tests()
 	}
 
 
+///
+/// Raises an unmasked floating-point exception (#MF) in user mode.  Only the
+/// offending thread should be destroyed; the kernel and the other threads
+/// keep running
+///
+static
+void_t
+run_fpu_fault_tests()
+	{
+	address_space_cr	address_space =
+							__hal->read_current_thread().address_space;
+	physical_address_t	frame;
+	uint8_tp			page = uint8_tp(USER_BASE);
+	message_cp			response;
+	status_t			status;
+	thread_cr			thread = __hal->read_current_thread();
+	thread_cp			user_thread;
+	thread_cp			watch_thread;
+
+
+	// Install the user code; the stack grows down from the end of the page
+	status = address_space.expand(page, PAGE_SIZE, 0);
+	ASSERT(status == STATUS_SUCCESS);
+	memcpy(page, FPU_FAULT_CODE, sizeof(FPU_FAULT_CODE));
+
+	user_thread = __thread_manager->create_thread(user_thread_entry,
+		&address_space, THREAD_ID_FPU_FAULT, CAPABILITY_INHERIT_PARENT,
+		page, page + PAGE_SIZE);
+	ASSERT(user_thread);
+
+	status = put_message(thread, *user_thread,
+		MESSAGE_TYPE_START_USER_THREAD, MESSAGE_ID_ATOMIC);
+	ASSERT(status == STATUS_SUCCESS);
+
+	// Block until the user thread has faulted and been destroyed
+	watch_thread = __thread_manager->create_thread(fpu_fault_watch_thread,
+		NULL, THREAD_ID_AUTO_ALLOCATE);
+	ASSERT(watch_thread);
+
+	response = send_test_message(*watch_thread);
+	delete(response);
+
+	// The user thread took the #NM before the #MF, so it owned an FPU
+	// context; this is now the last reference to it
+	ASSERT(user_thread->fpu_context != NULL);
+	ASSERT(read_reference_count(*user_thread) == 1);
+	remove_reference(*user_thread);
+
+	// Clean up
+	__thread_manager->delete_thread(*watch_thread);
+	remove_reference(*watch_thread);
+
+	address_space.decommit_frame(page, 1, &frame);
+	__memory_manager->free_frames(&frame, 1);
+
+	return;
+	}
+
+
+///
+/// Exercise the stride scheduler on a private pool of tickets, held by two
+/// threads that never start.  The scheduler always selects the thread with
+/// the lowest pass, then charges it STRIDE_ONE / tickets; so a thread with
+/// three tickets executes three times as often as one with a single ticket.
+/// A thread that returns after idling resumes at the global pass
+///
+static
+void_t
+run_stride_tests()
+	{
+	uint32_t			count[2] = { 0, 0 };
+	uint32_t			global_pass = 0;
+	uint32_t			i;
+	message_cp			message[4];
+	message_pool_c		pool;
+	uint32_t			processor = __hal->read_current_processor_index();
+	thread_cp			thread[2];
+	thread_cp			winner;
+
+
+	for (i = 0; i < 2; i++)
+		{
+		thread[i] = __thread_manager->create_thread(graceful_exit_thread,
+			NULL, THREAD_ID_AUTO_ALLOCATE);
+		ASSERT(thread[i]);
+		}
+
+	// One ticket for the first thread; three for the second
+	for (i = 0; i < 4; i++)
+		{
+		message[i] = new small_message_c(__hal->read_current_thread(),
+			*thread[ i == 0 ? 0 : 1 ], MESSAGE_TYPE_NULL, MESSAGE_ID_ATOMIC);
+		ASSERT(message[i] != NULL);
+		pool += *message[i];
+		}
+	ASSERT(thread[0]->ticket_count == 1);
+	ASSERT(thread[1]->ticket_count == 3);
+
+
+	//
+	// Both threads start at the same pass; the first one in the pool wins
+	// the tie.  Each winner is charged according to its tickets
+	//
+	winner = io_manager_c::select_stride_thread(pool, processor, &global_pass);
+	ASSERT(winner == thread[0]);
+	ASSERT(thread[0]->pass == STRIDE_ONE);
+
+	winner = io_manager_c::select_stride_thread(pool, processor, &global_pass);
+	ASSERT(winner == thread[1]);
+	ASSERT(thread[1]->pass == STRIDE_ONE / 3);
+	ASSERT(global_pass == 0);
+
+
+	//
+	// Over many selections, each thread receives its proportional share
+	//
+	for (i = 0; i < 400; i++)
+		{
+		winner = io_manager_c::select_stride_thread(pool, processor,
+			&global_pass);
+		ASSERT(winner == thread[0] || winner == thread[1]);
+		count[ winner == thread[0] ? 0 : 1 ]++;
+		}
+	ASSERT(count[0] >= 99 && count[0] <= 101);
+	ASSERT(count[0] + count[1] == 400);
+
+
+	//
+	// The first thread idles while the second runs alone.  When it returns,
+	// it resumes at the global pass, rather than at its own stale pass
+	//
+	pool -= *message[0];
+	for (i = 0; i < 30; i++)
+		{
+		winner = io_manager_c::select_stride_thread(pool, processor,
+			&global_pass);
+		ASSERT(winner == thread[1]);
+		}
+	ASSERT(int32_t(thread[0]->pass - global_pass) < 0);
+
+	pool += *message[0];
+	winner = io_manager_c::select_stride_thread(pool, processor, &global_pass);
+	ASSERT(winner == thread[0]);
+	ASSERT(thread[0]->pass == global_pass + STRIDE_ONE);
+
+
+	//
+	// Cleanup
+	//
+	for (i = 0; i < 4; i++)
+		{
+		pool -= *message[i];
+		delete(message[i]);
+		}
+
+	for (i = 0; i < 2; i++)
+		{
+		__thread_manager->delete_thread(*thread[i]);
+		remove_reference(*thread[i]);
+		}
+
+	return;
+	}
+
+
 ///
 /// Entry point into this file.  Runs the various thread tests
 ///
@@ -280,8 +555,11 @@ run_thread_tests()
 	{
 	TRACE(TEST, "Running thread tests ...\n");
 
+	run_block_tests();
 	run_capability_tests();
 	run_exit_tests();
+	run_fpu_fault_tests();
+	run_stride_tests();
 
 	TRACE(TEST, "Running thread tests ... done\n");
 
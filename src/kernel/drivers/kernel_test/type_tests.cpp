@@ -9,6 +9,7 @@
 #include "hal/atomic_int32.hpp"
 #include "hal/io_port_map.hpp"
 #include "hash_table.hpp"
+#include "intrusive_queue.hpp"
 #include "list.hpp"
 #include "queue.hpp"
 #include "type_tests.hpp"
@@ -20,6 +21,16 @@ uint32_t	test_data[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 },
 			test_data_count = sizeof(test_data) / sizeof(test_data[0]);
 
 
+///
+/// Test object for the intrusive_queue_m template
+///
+typedef struct intrusive_test_node
+	{
+	uint32_t					data;
+	struct intrusive_test_node*	queue_next;
+	} intrusive_test_node_s;
+
+
 ///
 /// Exercises the atomic_int32_c type
 ///
@@ -128,6 +139,69 @@ run_hash_tests()
 	}
 
 
+///
+/// Exercises the intrusive_queue_m template.  Adds + removes various objects
+/// from both ends, and from the middle, of a simple intrusive queue
+///
+static
+void_t
+run_intrusive_queue_tests()
+	{
+	uint32_t							i;
+	intrusive_test_node_s				node[ test_data_count ];
+	intrusive_queue_m<intrusive_test_node_s>	queue;
+
+	// Add some objects to the queue, alternating between the tail + head
+	for (i = 0; i < test_data_count; i++)
+		{
+		node[i].data = test_data[i];
+		if (i & 1)
+			queue.push(node[i]);
+		else
+			queue.push_head(node[i]);
+		ASSERT(queue.read_count() == i + 1);
+		}
+
+	// Remove the objects.  The even-numbered objects were pushed onto the
+	// head, in increasing order; the odd-numbered ones onto the tail
+	for (i = 0; i < test_data_count; i++)
+		{
+		uint32_t expected = (i < test_data_count/2 ?
+			test_data[ test_data_count - 2 - 2*i ] :
+			test_data[ 2*(i - test_data_count/2) + 1 ]);
+
+		intrusive_test_node_s& object = queue.pop();
+		ASSERT(object.data == expected);
+		ASSERT(queue.read_count() == test_data_count - i - 1);
+		}
+
+	// The queue should be empty now
+	ASSERT(queue.is_empty());
+
+	// Remove objects from the head, middle + tail of the queue
+	for (i = 0; i < test_data_count; i++)
+		{ queue.push(node[i]); }
+	ASSERT(queue.remove(node[0]));
+	ASSERT(queue.remove(node[ test_data_count/2 ]));
+	ASSERT(queue.remove(node[ test_data_count - 1 ]));
+	ASSERT(!queue.remove(node[0]));
+	ASSERT(queue.read_count() == test_data_count - 3);
+
+	// The remaining objects are still in order; the tail is still valid
+	queue.push(node[0]);
+	for (i = 1; i < test_data_count - 1; i++)
+		{
+		if (i == test_data_count/2)
+			continue;
+		ASSERT(queue.pop().data == test_data[i]);
+		}
+	ASSERT(queue.pop().data == test_data[0]);
+	ASSERT(queue.is_empty());
+
+	return;
+	}
+
+
 ///
 /// Exercises the io_port_map_c logic
 ///
@@ -246,6 +320,7 @@ run_type_tests()
 	run_bitmap_tests(map32);
 	run_bitmap_tests(map1024);
 	run_hash_tests();
+	run_intrusive_queue_tests();
 	run_io_port_map_tests();
 	run_list_tests();
 	run_queue_tests();
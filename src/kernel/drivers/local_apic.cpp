@@ -0,0 +1,272 @@
+//
+// local_apic.cpp
+//
+// A basic driver for the local APIC on each processor.
+//
+
+#include "debug.hpp"
+#include "drivers/local_apic.hpp"
+
+
+
+///
+/// Constructor.  The APIC registers must already be mapped (uncached) at the
+/// given address.  Does not touch the hardware.
+///
+/// @param apic_base_address -- virtual address of the APIC registers
+///
+local_apic_c::
+local_apic_c(uintptr_t apic_base_address):
+	base_address(apic_base_address),
+	timer_count(0)
+	{
+	return;
+	}
+
+
+local_apic_c::
+~local_apic_c()
+	{
+	return;
+	}
+
+
+///
+/// Sends an EOI to the local APIC on the current processor.  Only required
+/// for interrupts delivered by the APIC itself (i.e., not for interrupts from
+/// the PIC, nor for spurious interrupts)
+///
+void_t local_apic_c::
+acknowledge_interrupt()
+	{
+	memory_mapped_register_c eoi(base_address + LOCAL_APIC_EOI_OFFSET);
+
+	eoi.write32(0);
+
+	return;
+	}
+
+
+///
+/// Sends a fixed interrupt on the given vector to every processor except the
+/// current one.  Processors that have not started yet ignore it
+///
+/// @param vector -- vector for the interrupt
+///
+/// @return STATUS_SUCCESS if the APIC accepted the IPI; non-zero otherwise
+///
+status_t local_apic_c::
+broadcast_interrupt(uint8_t vector)
+	{
+	return(send_ipi(0, LOCAL_APIC_ICR_DESTINATION_OTHERS | vector));
+	}
+
+
+///
+/// Measures the rate of the local APIC timer on the current processor,
+/// relative to the PIT.  On return, start_timer() will generate clock ticks
+/// at the same rate as the PIT/IRQ0.  Assumes that all processors share the
+/// same bus clock, so this only needs to execute once, on the bootstrap
+/// processor.
+///
+/// @param pit -- the PIT driver, for the reference delay
+///
+void_t local_apic_c::
+calibrate_timer(i8254_programmable_interval_timer_cr pit)
+	{
+	memory_mapped_register_c	current(base_address +
+									LOCAL_APIC_TIMER_CURRENT_COUNT_OFFSET);
+	memory_mapped_register_c	divide(base_address +
+									LOCAL_APIC_TIMER_DIVIDE_OFFSET);
+	memory_mapped_register_c	initial(base_address +
+									LOCAL_APIC_TIMER_INITIAL_COUNT_OFFSET);
+	memory_mapped_register_c	timer(base_address + LOCAL_APIC_TIMER_OFFSET);
+
+	uint32_t					elapsed;
+
+
+	//
+	// Start a masked, one-shot countdown from the maximum count; and see how
+	// far it decrements over a known interval
+	//
+	timer.write32(LOCAL_APIC_TIMER_MASKED);
+	divide.write32(LOCAL_APIC_TIMER_DIVIDE_BY_16);
+	initial.write32(0xFFFFFFFF);
+
+	pit.delay(LOCAL_APIC_CALIBRATION_INTERVAL);
+
+	elapsed = 0xFFFFFFFF - current.read32();
+	initial.write32(0);
+
+
+	//
+	// Scale the count to match the rate of the PIT
+	//
+	timer_count = (elapsed * (1000000 / LOCAL_APIC_CALIBRATION_INTERVAL)) /
+		i8254_COUNTER0_FREQUENCY;
+	if (timer_count == 0)
+		{ timer_count = 1; }
+
+	TRACE(ALL, "Local APIC timer: %d counts per tick\n", timer_count);
+
+	return;
+	}
+
+
+///
+/// Software-enables the local APIC on the current processor.  The APIC must
+/// be enabled before it can send or receive any IPIs
+///
+/// @param spurious_vector -- vector for spurious APIC interrupts
+///
+void_t local_apic_c::
+enable(uint8_t spurious_vector)
+	{
+	memory_mapped_register_c spurious(base_address +
+		LOCAL_APIC_SPURIOUS_OFFSET);
+
+	spurious.write32(LOCAL_APIC_SPURIOUS_ENABLE | spurious_vector);
+
+	return;
+	}
+
+
+///
+/// Returns the APIC id of the current processor.  No side effects.
+///
+uint32_t local_apic_c::
+read_id()
+	{
+	memory_mapped_register_c id(base_address + LOCAL_APIC_ID_OFFSET);
+
+	return(id.read32() >> LOCAL_APIC_ID_SHIFT);
+	}
+
+
+///
+/// Sends an INIT IPI to the specified processor.  This resets the target
+/// processor + leaves it waiting for a STARTUP IPI
+///
+/// @param apic_id -- APIC id of the target processor
+///
+/// @return STATUS_SUCCESS if the APIC accepted the IPI; non-zero otherwise
+///
+status_t local_apic_c::
+send_init(uint32_t apic_id)
+	{
+	return(send_ipi(apic_id,
+					LOCAL_APIC_ICR_DELIVERY_INIT |
+					LOCAL_APIC_ICR_LEVEL_ASSERT |
+					LOCAL_APIC_ICR_TRIGGER_LEVEL));
+	}
+
+
+///
+/// Sends the raw IPI command to the specified processor; and waits for the
+/// local APIC to accept it.
+///
+/// @param apic_id -- APIC id of the target processor
+/// @param command -- low word of the interrupt command register
+///
+/// @return STATUS_SUCCESS if the APIC accepted the IPI; non-zero otherwise
+///
+status_t local_apic_c::
+send_ipi(	uint32_t	apic_id,
+			uint32_t	command)
+	{
+	memory_mapped_register_c	icr_high(base_address +
+									LOCAL_APIC_ICR_HIGH_OFFSET);
+	memory_mapped_register_c	icr_low(base_address +
+									LOCAL_APIC_ICR_LOW_OFFSET);
+	uint32_t					i;
+	status_t					status = STATUS_IO_ERROR;
+
+
+	icr_high.write32(apic_id << LOCAL_APIC_ICR_DESTINATION_SHIFT);
+	icr_low.write32(command);
+
+	for (i = 0; i < LOCAL_APIC_DELIVERY_TIMEOUT; i++)
+		{
+		if (!(icr_low.read32() & LOCAL_APIC_ICR_DELIVERY_PENDING))
+			{
+			status = STATUS_SUCCESS;
+			break;
+			}
+		}
+
+	return(status);
+	}
+
+
+///
+/// Sends a STARTUP IPI to the specified processor.  The target processor
+/// begins executing, in real mode, at (vector * 4KB)
+///
+/// @param apic_id	-- APIC id of the target processor
+/// @param vector	-- page number of the startup code; must be below 1MB
+///
+/// @return STATUS_SUCCESS if the APIC accepted the IPI; non-zero otherwise
+///
+status_t local_apic_c::
+send_startup(	uint32_t	apic_id,
+				uint8_t		vector)
+	{
+	return(send_ipi(apic_id, LOCAL_APIC_ICR_DELIVERY_STARTUP | vector));
+	}
+
+
+///
+/// Arms the timer on the current processor for a single expiration, after
+/// the given number of clock ticks; this replaces any periodic timer.  The
+/// timer must already be calibrated.  The expiration generates an interrupt
+/// on the given vector, which must be acknowledged via acknowledge_interrupt()
+///
+/// @param vector		-- vector for the timer interrupt
+/// @param tick_count	-- delay until the interrupt, in clock ticks
+///
+void_t local_apic_c::
+start_one_shot_timer(	uint8_t		vector,
+						uint32_t	tick_count)
+	{
+	memory_mapped_register_c	divide(base_address +
+									LOCAL_APIC_TIMER_DIVIDE_OFFSET);
+	memory_mapped_register_c	initial(base_address +
+									LOCAL_APIC_TIMER_INITIAL_COUNT_OFFSET);
+	memory_mapped_register_c	timer(base_address + LOCAL_APIC_TIMER_OFFSET);
+
+	ASSERT(timer_count > 0);
+	ASSERT(tick_count > 0);
+	ASSERT(tick_count <= 0xFFFFFFFF / timer_count);
+
+	divide.write32(LOCAL_APIC_TIMER_DIVIDE_BY_16);
+	timer.write32(vector);
+	initial.write32(timer_count * tick_count);
+
+	return;
+	}
+
+
+///
+/// Starts the periodic timer on the current processor.  The timer must
+/// already be calibrated.  Each expiration generates an interrupt on the
+/// given vector, which must be acknowledged via acknowledge_interrupt()
+///
+/// @param vector -- vector for the timer interrupt
+///
+void_t local_apic_c::
+start_timer(uint8_t vector)
+	{
+	memory_mapped_register_c	divide(base_address +
+									LOCAL_APIC_TIMER_DIVIDE_OFFSET);
+	memory_mapped_register_c	initial(base_address +
+									LOCAL_APIC_TIMER_INITIAL_COUNT_OFFSET);
+	memory_mapped_register_c	timer(base_address + LOCAL_APIC_TIMER_OFFSET);
+
+	ASSERT(timer_count > 0);
+
+	divide.write32(LOCAL_APIC_TIMER_DIVIDE_BY_16);
+	timer.write32(LOCAL_APIC_TIMER_PERIODIC | vector);
+	initial.write32(timer_count);
+
+	return;
+	}
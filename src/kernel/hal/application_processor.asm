@@ -0,0 +1,178 @@
+//
+// application_processor.asm
+//
+// Startup logic for the application processors (AP) on SMP hosts.  Each AP
+// wakes in real mode, at the page specified in the STARTUP IPI; switches
+// into protected mode with the kernel GDT; enables paging with the kernel
+// page directory; and finally enters the C++ initialization logic in
+// application_processor_entry().
+//
+// The bootstrap processor starts the AP's one at a time, so all AP's may
+// share the same trampoline + startup parameters below.
+//
+
+#include "hal/address_space_layout.h"
+#include "selector.h"
+#include "x86.h"
+
+
+//
+// Do not clear any of the EFLAGS reserved bits
+//
+#define EFLAGS_RESERVED_BITS		0x2
+
+
+//
+// Offset of the given trampoline symbol, relative to the start of the
+// trampoline.  The real-mode code executes with CS = DS = the base of the
+// trampoline, so all data references must be relative
+//
+#define TRAMPOLINE_OFFSET(symbol)	(symbol - ap_trampoline_start)
+
+
+
+.text
+
+
+//
+// ap_trampoline_start/ap_trampoline_end
+//
+// The real-mode trampoline.  The bootstrap processor copies this block of
+// code to SMP_TRAMPOLINE_BASE before starting each AP.  The code must be
+// position-independent, since it executes from the copy, not from the
+// original kernel image.
+//
+// On entry:
+//	CS:IP		= (SMP_TRAMPOLINE_VECTOR << 8):0000
+//	CR0.PE		= 0 (real mode)
+//	CR0.PG		= 0 (paging is disabled)
+//	EFLAGS.IF	= 0 (interrupts are disabled)
+//
+.code16
+.align 4
+.global ap_trampoline_start
+ap_trampoline_start:
+	cli
+	movw	%cs, %ax
+	movw	%ax, %ds
+
+
+	//
+	// Load the kernel GDT; the bootstrap processor has already built it.
+	// Then switch into protected mode and jump directly into the kernel
+	// image, which is identity-mapped
+	//
+	lgdtl	TRAMPOLINE_OFFSET(ap_trampoline_gdt_descriptor)
+
+	movl	%cr0, %eax
+	orl		$CR0_PE, %eax
+	movl	%eax, %cr0
+
+	ljmpl	$GDT_KERNEL_CODE_SELECTOR, $ap_protected_mode_entry
+
+
+	//
+	// The GDT descriptor; this matches the descriptor in load_gdt()
+	//
+.align 4
+ap_trampoline_gdt_descriptor:
+	.word	KERNEL_GDT_SIZE - 1		// Last valid byte (limit) of GDT
+	.long	KERNEL_GDT_BASE			// Base address of GDT
+
+.global ap_trampoline_end
+ap_trampoline_end:
+
+
+
+//
+// ap_protected_mode_entry
+//
+// Protected-mode entry point for each AP.  Executes directly from the kernel
+// image.  Never returns.
+//
+.code32
+.align 4
+ap_protected_mode_entry:
+	//
+	// Reload the data selectors for the kernel GDT; and reset FS + GS
+	//
+	movw	$GDT_KERNEL_DATA_SELECTOR, %ax
+	movw	%ax, %ds
+	movw	%ax, %es
+	movw	%ax, %ss
+
+	movw	$GDT_NULL_SELECTOR, %ax
+	movw	%ax, %fs
+	movw	%ax, %gs
+
+
+	//
+	// Switch to the stack of the idle thread for this processor.  See also
+	// hal::read_current_thread()
+	//
+	movl	ap_startup_stack, %esp
+
+
+	//
+	// Enable paging with the kernel page directory.  This is the same
+	// sequence as hal::enable_paging() on the bootstrap processor.  The
+	// idle thread may live in the kernel heap extension, so its stack is
+	// not usable until paging is enabled
+	//
+	movl	%cr4, %eax
+	orl		$CR4_PSE, %eax
+	movl	%eax, %cr4
+
+	movl	ap_startup_page_directory, %eax
+	movl	%eax, %cr3
+
+	movl	%cr0, %eax
+	orl		$(CR0_PG | CR0_WP), %eax
+	movl	%eax, %cr0
+
+	movl	%cr4, %eax
+	orl		$CR4_PGE, %eax
+	movl	%eax, %cr4
+
+	pushl	$EFLAGS_RESERVED_BITS
+	popf
+
+
+	//
+	// The IDT is shared by all processors
+	//
+	call	reload_idt
+
+
+	//
+	// Finish the initialization in C++; this never returns
+	//
+	pushl	ap_startup_index
+	call	application_processor_entry
+
+1:
+	cli
+	hlt
+	jmp		1b
+
+
+
+.data
+
+
+//
+// Startup parameters for the next AP.  The bootstrap processor fills these
+// in before sending each STARTUP IPI
+//
+.align 4
+.global ap_startup_index
+ap_startup_index:
+	.long	0
+
+.global ap_startup_page_directory
+ap_startup_page_directory:
+	.long	0
+
+.global ap_startup_stack
+ap_startup_stack:
+	.long	0
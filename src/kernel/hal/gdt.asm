@@ -101,7 +101,19 @@ load_gdt:
 	INSTALL_DATA_DESCRIPTOR(GDT_KERNEL_DATA_INDEX, RING0)
 	INSTALL_CODE_DESCRIPTOR(GDT_USER_CODE_INDEX, RING3)
 	INSTALL_DATA_DESCRIPTOR(GDT_USER_DATA_INDEX, RING3)
-	INSTALL_TSS_DESCRIPTOR(GDT_TSS_INDEX, KERNEL_TSS_BASE)
+
+
+	//
+	// Install one TSS descriptor for each possible processor.  The TSS
+	// descriptors are contiguous in the GDT; and the TSS structures themselves
+	// are contiguous in the TSS pool
+	//
+	.set	tss_index, 0
+	.rept	PROCESSOR_COUNT_MAX
+	INSTALL_TSS_DESCRIPTOR(	(GDT_TSS_INDEX + tss_index),
+							(KERNEL_TSS_BASE + tss_index * KERNEL_TSS_SIZE))
+	.set	tss_index, tss_index + 1
+	.endr
 
 
 	//
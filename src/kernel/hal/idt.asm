@@ -132,6 +132,14 @@ load_idt:
 	INSTALL_INTERRUPT_GATE(INTERRUPT_VECTOR_PIC_IRQ15);
 
 
+	//
+	// Install gates for local APIC interrupts
+	//
+	INSTALL_INTERRUPT_GATE(INTERRUPT_VECTOR_LOCAL_TIMER);
+	INSTALL_INTERRUPT_GATE(INTERRUPT_VECTOR_LOCAL_TLB_SHOOTDOWN);
+	INSTALL_INTERRUPT_GATE(INTERRUPT_VECTOR_LOCAL_SPURIOUS);
+
+
 	//
 	// Install gates for soft-interrupts
 	//
@@ -145,6 +153,12 @@ load_idt:
 	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_SEND_AND_RECEIVE_MESSAGE);
 	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_SEND_MESSAGE);
 	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_DELETE_MESSAGE);
+	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_SEND_DONATED_MESSAGE);
+	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_SEND_GATHERED_MESSAGE);
+	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_PROCESS_MESSAGES);
+	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_CREATE_MESSAGE_RING);
+	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_ENTER_MESSAGE_RING);
+	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_SET_MAILBOX_LIMIT);
 
 	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_CONTRACT_ADDRESS_SPACE);
 	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_CREATE_ADDRESS_SPACE);
@@ -153,9 +167,11 @@ load_idt:
 
 	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_CREATE_THREAD);
 	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_DELETE_THREAD);
+	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_SIGNAL_THREAD);
 
 	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_MAP_DEVICE);
 	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_UNMAP_DEVICE);
+	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_ACKNOWLEDGE_INTERRUPT);
 
 	INSTALL_TRAP_GATE(SYSTEM_CALL_VECTOR_READ_KERNEL_STATS);
 
@@ -167,19 +183,38 @@ load_idt:
 
 
 	//
-	// Make the new IDT visible to the processor, using the inline descriptor
+	// Make the new IDT visible to the processor, using the descriptor
 	// defined below
 	//
-	lidt	1f
+	lidt	idt_descriptor
 
 	ret
 
 
+
+//
+// reload_idt()
+//
+// Loads the (existing) IDT into the current processor.  The IDT itself is
+// shared by all processors, so the application processors only need to load
+// the descriptor built for the bootstrap processor.
+//
+// C/C++ prototype --
+//		void_t reload_idt(void_t);
+//
+.align 4
+.global reload_idt
+reload_idt:
+	lidt	idt_descriptor
+	ret
+
+
+
 	//
 	// The IDT descriptor
 	//
 .align 4
-1:
+idt_descriptor:
 	.word	KERNEL_IDT_SIZE - 1		// Last valid byte (limit) of the IDT
 	.long	KERNEL_IDT_BASE			// Base address of the IDT
 
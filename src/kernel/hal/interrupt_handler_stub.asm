@@ -13,6 +13,8 @@
 #include "interrupt_handler_stub.h"
 #include "selector.h"
 #include "thread.h"
+#include "tss.h"
+#include "x86.h"
 
 
 
@@ -30,7 +32,8 @@
 // just defer the real interrupt processing to the HAL (the
 // ::dispatch_interrupt() routine in x86_hal.cpp).  However,
 // each stub is responsible for indicating its interrupt/exception
-// vector and any associated data to the HAL.
+// vector and any associated data to the HAL, plus the location of
+// the frame (EIP, CS, EFLAGS ...) pushed by the processor itself.
 //
 
 
@@ -71,6 +74,8 @@
 .global INTERRUPT_HANDLER_NAME(vector);							\
 INTERRUPT_HANDLER_NAME(vector):									\
 	SAVE_THREAD_CONTEXT											\
+	leal SAVED_THREAD_CONTEXT_SIZE(%esp), %ebx;					\
+	pushl %ebx;			/* the processor trap frame */			\
 	pushl $0;			/* no error code with this interrupt */	\
 	pushl $vector;		/* the interrupt vector */				\
 	jmp common_stub		/* commmon interrupt processing */
@@ -93,7 +98,7 @@ INTERRUPT_HANDLER_NAME(vector):									\
 common_stub:													\
 	RESTORE_KERNEL_CONTEXT										\
 	call dispatch_interrupt;									\
-	addl $8, %esp;		/* pop the error code and vector */		\
+	addl $12, %esp;		/* pop the frame, error code + vector */\
 	RESTORE_THREAD_CONTEXT										\
 	iret
 
@@ -114,6 +119,8 @@ common_stub:													\
 INTERRUPT_HANDLER_NAME(vector):									\
 	xchgl %eax, 0(%esp);		/* swap error code with EAX */	\
 	SAVE_THREAD_CONTEXT											\
+	leal SAVED_THREAD_CONTEXT_SIZE+4(%esp), %ebx;				\
+	pushl %ebx;					/* the processor trap frame */	\
 	pushl %eax;					/* the error code, now in EAX */\
 	pushl $vector;				/* the interrupt vector */		\
 	jmp common_stub_with_error	/* common interrupt processing */
@@ -135,7 +142,7 @@ INTERRUPT_HANDLER_NAME(vector):									\
 common_stub_with_error:											\
 	RESTORE_KERNEL_CONTEXT										\
 	call dispatch_interrupt;									\
-	addl $8, %esp;			/* pop the error code and vector */	\
+	addl $12, %esp;		/* pop the frame, error code + vector */\
 	RESTORE_THREAD_CONTEXT										\
 	popl %eax;				/* restore EAX, clean up stack */	\
 	iret
@@ -158,6 +165,8 @@ common_stub_with_error:											\
 .global INTERRUPT_HANDLER_NAME(vector);							\
 INTERRUPT_HANDLER_NAME(vector):									\
 	SAVE_THREAD_CONTEXT											\
+	leal SAVED_THREAD_CONTEXT_SIZE(%esp), %ebx;					\
+	pushl %ebx;			/* the processor trap frame */			\
 	pushl %eax;			/* pointer to system call arguments */	\
 	pushl $vector;		/* the interrupt vector */				\
 	jmp common_stub		/* commmon interrupt processing */
@@ -221,6 +230,14 @@ MAKE_INTERRUPT_HANDLER_STUB(INTERRUPT_VECTOR_PIC_IRQ14)
 MAKE_INTERRUPT_HANDLER_STUB(INTERRUPT_VECTOR_PIC_IRQ15)
 
 
+//
+// Handlers for local APIC interrupts
+//
+MAKE_INTERRUPT_HANDLER_STUB(INTERRUPT_VECTOR_LOCAL_TIMER)
+MAKE_INTERRUPT_HANDLER_STUB(INTERRUPT_VECTOR_LOCAL_TLB_SHOOTDOWN)
+MAKE_INTERRUPT_HANDLER_STUB(INTERRUPT_VECTOR_LOCAL_SPURIOUS)
+
+
 //
 // Handlers for soft interrupts
 //
@@ -234,6 +251,12 @@ MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_RECEIVE_MESSAGE)
 MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_SEND_AND_RECEIVE_MESSAGE)
 MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_SEND_MESSAGE)
 MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_DELETE_MESSAGE)
+MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_SEND_DONATED_MESSAGE)
+MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_SEND_GATHERED_MESSAGE)
+MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_PROCESS_MESSAGES)
+MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_CREATE_MESSAGE_RING)
+MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_ENTER_MESSAGE_RING)
+MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_SET_MAILBOX_LIMIT)
 
 MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_CONTRACT_ADDRESS_SPACE)
 MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_CREATE_ADDRESS_SPACE)
@@ -242,9 +265,11 @@ MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_EXPAND_ADDRESS_SPACE)
 
 MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_CREATE_THREAD)
 MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_DELETE_THREAD)
+MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_SIGNAL_THREAD)
 
 MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_MAP_DEVICE)
 MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_UNMAP_DEVICE)
+MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_ACKNOWLEDGE_INTERRUPT)
 
 MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_READ_KERNEL_STATS)
 
@@ -256,3 +281,54 @@ MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL(SYSTEM_CALL_VECTOR_READ_KERNEL_STATS)
 MAKE_INTERRUPT_HANDLER_COMMON_STUB
 MAKE_INTERRUPT_HANDLER_COMMON_STUB_WITH_ERROR
 
+
+
+//
+// Fast system-call entry point, installed in MSR_SYSENTER_EIP by the HAL
+// on processors that support SYSENTER/SYSEXIT.  This is an alternative to the
+// MAKE_INTERRUPT_HANDLER_STUB_FOR_SYSCALL() stubs above: the system call
+// vector is passed in ESI rather than encoded in an INT instruction.
+//
+// On entry, the processor has reloaded CS + SS and disabled interrupts, but
+// ESP still points at the base of the TSS for this processor (see
+// MSR_SYSENTER_ESP); the user thread has loaded:
+//	- EAX with a pointer to the system call arguments;
+//	- ECX with its current stack pointer;
+//	- EDX with its return address; and
+//	- ESI with the system call vector.
+// The contents of all other registers are unknown.
+//
+// The stub switches to the kernel stack of the current thread (TSS.ESP0)
+// and builds the same stack frame that an INT would have pushed, so that
+// the rest of the kernel cannot distinguish between the two entry paths.
+// The system call returns via SYSEXIT, back to the caller's return address
+// and stack.  The vector is validated in ::dispatch_system_call()
+//
+.align 4
+.global system_call_fast_entry
+system_call_fast_entry:
+	movl	TSS_ESP0_OFFSET(%esp), %esp	// kernel stack of this thread
+
+	pushl	$GDT_USER_DATA_SELECTOR		// SS
+	pushl	%ecx						// ESP
+	pushfl								// EFLAGS
+	orl		$EFLAGS_IF, 0(%esp)
+	pushl	$GDT_USER_CODE_SELECTOR		// CS
+	pushl	%edx						// EIP
+	sti									// Same as a trap gate, from here
+
+	SAVE_THREAD_CONTEXT
+	leal	SAVED_THREAD_CONTEXT_SIZE(%esp), %ebx
+	pushl	%ebx			// the trap frame built above
+	pushl	%eax			// pointer to system call arguments
+	pushl	%esi			// the system call vector
+	RESTORE_KERNEL_CONTEXT
+	call	dispatch_system_call
+	addl	$12, %esp		// pop the frame, arguments + vector
+	RESTORE_THREAD_CONTEXT
+
+	cli
+	movl	0(%esp), %edx	// EIP
+	movl	12(%esp), %ecx	// ESP
+	sti						// Interrupts remain blocked until after SYSEXIT
+	sysexit
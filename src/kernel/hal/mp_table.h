@@ -0,0 +1,107 @@
+//
+// mp_table.h
+//
+// Structures from the Intel MultiProcessor Specification (v1.4).  The BIOS
+// builds these tables to describe the processors (and APIC's, buses, etc) in
+// the system.  Only the fields necessary for locating + starting the
+// application processors are used here.
+//
+
+#ifndef _MP_TABLE_H
+#define _MP_TABLE_H
+
+#include "dx/types.h"
+
+
+#pragma pack(1)
+
+
+//
+// The MP floating pointer structure.  The BIOS places this in one of several
+// well-known regions of low memory, on a 16-byte boundary.
+//
+#define MP_FLOATING_POINTER_SIGNATURE	0x5F504D5F	// "_MP_"
+
+//
+// Physical regions searched for the floating pointer structure: the first
+// 1KB of the EBDA, or else the last 1KB of base memory; and the BIOS ROM.
+// The BIOS data area records the EBDA segment and the size of base memory
+//
+#define MP_BDA_EBDA_SEGMENT				0x40E
+#define MP_BDA_BASE_MEMORY_SIZE			0x413	// In KB
+#define MP_SEARCH_SIZE					1024
+#define MP_SEARCH_BIOS_ROM_BASE			0xF0000
+#define MP_SEARCH_BIOS_ROM_SIZE			0x10000
+
+
+typedef struct mp_floating_pointer
+	{
+	uint32_t	signature;
+	uint32_t	configuration_table;	// Physical address
+	uint8_t		length;					// In 16-byte units
+	uint8_t		revision;
+	uint8_t		checksum;
+	uint8_t		feature[5];
+	} mp_floating_pointer_s;
+
+typedef mp_floating_pointer_s *		mp_floating_pointer_sp;
+typedef mp_floating_pointer_sp *	mp_floating_pointer_spp;
+
+
+//
+// The header of the MP configuration table.  The table entries immediately
+// follow the header
+//
+#define MP_CONFIGURATION_TABLE_SIGNATURE	0x504D4350	// "PCMP"
+
+typedef struct mp_configuration_table
+	{
+	uint32_t	signature;
+	uint16_t	length;
+	uint8_t		revision;
+	uint8_t		checksum;
+	uint8_t		oem_id[8];
+	uint8_t		product_id[12];
+	uint32_t	oem_table;
+	uint16_t	oem_table_size;
+	uint16_t	entry_count;
+	uint32_t	local_apic_address;
+	uint16_t	extended_table_length;
+	uint8_t		extended_table_checksum;
+	uint8_t		reserved;
+	} mp_configuration_table_s;
+
+typedef mp_configuration_table_s *		mp_configuration_table_sp;
+typedef mp_configuration_table_sp *		mp_configuration_table_spp;
+
+
+//
+// Table entries.  Processor entries are 20 bytes; all other entry types are
+// 8 bytes.  Only the processor entries are parsed here
+//
+#define MP_ENTRY_TYPE_PROCESSOR			0
+#define MP_ENTRY_SIZE_PROCESSOR			20
+#define MP_ENTRY_SIZE_OTHER				8
+
+#define MP_PROCESSOR_FLAG_ENABLED		0x01
+#define MP_PROCESSOR_FLAG_BOOT			0x02
+
+typedef struct mp_processor_entry
+	{
+	uint8_t		type;
+	uint8_t		local_apic_id;
+	uint8_t		local_apic_version;
+	uint8_t		flags;
+	uint32_t	signature;
+	uint32_t	feature_flags;
+	uint32_t	reserved[2];
+	} mp_processor_entry_s;
+
+typedef mp_processor_entry_s *		mp_processor_entry_sp;
+typedef mp_processor_entry_sp *		mp_processor_entry_spp;
+
+
+#pragma pack()
+
+
+#endif
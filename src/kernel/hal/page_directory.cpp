@@ -4,10 +4,26 @@
 
 #include "bits.hpp"
 #include "dx/hal/memory.h"
+#include "hal/address_space_layout.h"
 #include "hal/page_directory.hpp"
+#include "kernel_heap.hpp"
 #include "kernel_subsystems.hpp"
 
 
+///
+/// Flushes a single page from the TLB of every processor.  See
+/// hal::invalidate_tlb()
+///
+/// @param page -- an address within the victim page
+///
+void_t
+invalidate_processor_tlbs(const void_tp page)
+	{
+	__hal->invalidate_tlb(page);
+	return;
+	}
+
+
 ///
 /// Constructor.  Setup the default address space + default kernel mappings.
 ///
@@ -24,6 +40,20 @@ page_directory_c()
 	entry[0] = KERNEL_CODE_PAGE;
 	entry[1] = KERNEL_RAMDISK_PAGE;
 	entry[2] = KERNEL_DATA_PAGE;
+	entry[3] = KERNEL_APIC_PAGE;
+
+	// The page tables for the heap extension + thread area are likewise
+	// shared by all address spaces, so that the kernel may map pages there
+	// without updating every page directory
+	uint32_t kernel_entry =
+		calculate_index(void_tp(KERNEL_PAGE_TABLE_AREA_BASE));
+	for (uint32_t i = 0; i < KERNEL_PAGE_TABLE_COUNT; i++)
+		{
+		ASSERT(__kernel_heap);
+		entry[ kernel_entry + i ].commit_frame(
+			physical_address_t(__kernel_heap->read_page_table(i)),
+			MEMORY_WRITABLE);
+		}
 
 	return;
 	}
@@ -39,9 +69,13 @@ page_directory_c::
 	// kernel and span all of the active address spaces
 	uint32_t payload_entry = calculate_index(void_tp(PAYLOAD_AREA_BASE));
 
-	// Destroy any child page tables that were allocated at runtime
+	// Destroy any child page tables that were allocated at runtime.
+	// Superpage entries have no page table
 	for (uint32_t i = payload_entry; i < ENTRIES_PER_PAGE_DIRECTORY; i++)
 		{
+		if (this->entry[i].is_super_page())
+			continue;
+
 		//@assumes page tables are id-mapped
 		page_table_cp page_table = page_table_cp(this->entry[i]);
 
@@ -5,7 +5,7 @@
 //
 
 
-#include "hal/processor_type.h"
+#include "dx/hal/processor_type.h"
 
 
 
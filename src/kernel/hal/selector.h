@@ -11,14 +11,15 @@
 
 
 //
-// Indices into the GDT
+// Indices into the GDT.  SYSENTER + SYSEXIT require the kernel code, kernel
+// data, user code and user data descriptors to be adjacent, in this order
 //
 #define GDT_NULL_INDEX			0	// Null/unused, per the Intel documentation
 #define GDT_KERNEL_CODE_INDEX	1
 #define GDT_KERNEL_DATA_INDEX	2
 #define GDT_USER_CODE_INDEX		3
 #define GDT_USER_DATA_INDEX		4
-#define GDT_TSS_INDEX			8
+#define GDT_TSS_INDEX			8	// First of PROCESSOR_COUNT_MAX TSS entries
 
 
 //
@@ -34,4 +35,12 @@
 #define GDT_TSS_SELECTOR			MAKE_SELECTOR(GDT_TSS_INDEX, RING0)
 
 
+//
+// Each processor loads its own TSS, so the TSS selector also identifies the
+// current processor.  See hal::read_current_processor_index()
+//
+#define MAKE_TSS_SELECTOR(processor)	\
+	MAKE_SELECTOR((GDT_TSS_INDEX + (processor)), RING0)
+
+
 #endif
@@ -1,7 +1,7 @@
 //
 // spinlock.cpp
 //
-// Implementation of "uniprocessor spinlock" objects
+// Implementation of spinlock objects
 //
 
 #include "debug.hpp"
@@ -12,30 +12,69 @@
 
 
 ///
-/// "Acquires" the spinlock by disabling interrupts.  The thread may
-/// now continue without fear of preemption.
+/// Acquires the spinlock.  Disables interrupts on the local processor; then
+/// spins until the lock is available.  The thread may now continue without
+/// fear of preemption.
 ///
-/// The Intel processor documentation describes the recommended logic
-/// for implementing a spinlock for a multi-processor host.
+/// The logic here follows the recommended spinlock implementation in the Intel
+/// processor documentation: spin on a plain read (with PAUSE) until the lock
+/// looks free, and only then attempt the locked exchange.
 ///
 void_t spinlock_c::
 acquire()
 	{
+	uintptr_t	previous_interrupt_state;
+	uint32_t	processor;
+	uint32_t	value;
+
+
 	//
 	// Disable interrupts; and cache the previous interrupt state so that
 	// the release logic can reenable interrupts if necessary
 	//
-	interrupt_state = __hal->disable_interrupts();
+	previous_interrupt_state = __hal->disable_interrupts();
 
 
 	//
 	// Spinlocks may not be acquired recursively; so prevent the current
-	// thread from re-acquiring the spinlock a second time.
+	// processor from re-acquiring the spinlock a second time.  Only this
+	// processor can write its own index here, so no race
 	//
-	ASSERT(!acquired);
-	if (acquired)
+	processor = __hal->read_current_processor_index();
+	ASSERT(owner != processor);
+	if (owner == processor)
 		kernel_panic(KERNEL_PANIC_REASON_REACQUIRED_SPINLOCK, uintptr_t(this));
-	acquired = TRUE;
+
+
+	//
+	// Spin until the lock is available
+	//
+	for(;;)
+		{
+		value = TRUE;
+		__asm volatile(	"xchgl %0, %1"
+						: "+r"(value), "+m"(acquired)
+						:
+						: "memory"	);
+		if (!value)
+			break;
+
+		// Meanwhile, the owner may be waiting on this processor to flush
+		// its TLB; see hal::invalidate_tlb()
+		while(acquired)
+			{
+			__hal->service_tlb_shootdown();
+			__hal->pause_processor();
+			}
+		}
+
+
+	//
+	// Here, the lock is held; no other processor will touch these fields
+	// until it is released
+	//
+	owner			= processor;
+	interrupt_state	= previous_interrupt_state;
 
 	return;
 	}
@@ -50,12 +89,20 @@ acquire()
 void_t spinlock_c::
 release()
 	{
+	uintptr_t previous_interrupt_state = interrupt_state;
+
 	ASSERT(acquired);
+	ASSERT(owner == __hal->read_current_processor_index());
+
+	// Release the lock.  Stores are not reordered with older stores on
+	// Intel processors, so a compiler barrier is enough here
+	owner = PROCESSOR_INDEX_INVALID;
+	__asm volatile("" : : : "memory");
 	acquired = FALSE;
 
 	// If interrupts were initially enabled, then re-enable them now.
 	// This thread may now be preempted.
-	__hal->enable_interrupts(interrupt_state);
+	__hal->enable_interrupts(previous_interrupt_state);
 
 	return;
 	}
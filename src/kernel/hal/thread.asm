@@ -7,6 +7,7 @@
 //
 
 #include "hal/address_space_layout.h"
+#include "selector.h"
 #include "thread.h"
 #include "thread_layout.h"
 #include "tss.h"
@@ -67,7 +68,7 @@ initialize_thread_context:
 	//
 	movl	8(%ebp), %eax	// thread_c context
 	andl	$THREAD_EXECUTION_BLOCK_ALIGNMENT_MASK, %eax
-	addl	$THREAD_EXECUTION_BLOCK_SIZE, %eax	// Base of the stack
+	addl	$THREAD_CONTEXT_OFFSET, %eax		// Base of the stack
 	movl	%eax, %esp
 
 
@@ -160,7 +161,7 @@ initialize_thread_context:
 //		switch_thread(	uint32_tpp			old_stack,		// at (EBP + 8)
 //						uint32_tp			new_stack,		// at (EBP + 12)
 //						page_directory_cp	new_page_dir,	// at (EBP + 16)
-//						uint8_tp			io_bitmap);		// at (EBP + 20)
+//						uint32_t			io_bitmap_valid);// at (EBP + 20)
 //
 .align 4
 .global switch_thread
@@ -207,11 +208,13 @@ switch_thread:
 
 	//
 	// Reload the base of this kernel stack into TSS.ESP0, in case this thread
-	// takes an interrupt while executing at ring-3
+	// takes an interrupt while executing at ring-3.  Each processor has its
+	// own TSS
 	//
-	movl	$KERNEL_TSS_BASE, %edi	//@SMP: each CPU needs its own TSS
+	TSS_LOAD_CURRENT_BASE
+	movl	%esp, %eax
 	andl	$THREAD_EXECUTION_BLOCK_ALIGNMENT_MASK, %eax
-	addl	$THREAD_EXECUTION_BLOCK_SIZE, %eax
+	addl	$THREAD_CONTEXT_OFFSET, %eax
 	movl	%eax, TSS_ESP0_OFFSET(%edi)
 
 
@@ -241,18 +244,21 @@ switch_thread:
 
 
 	//
-	// If this new thread has a customized I/O bitmap, then load it into the
-	// TSS; if not, then just mark the TSS bitmap as invalid.  Note that EDI
-	// still points to the TSS here
+	// If the customized I/O bitmap of this new thread is still resident in
+	// the TSS, then just mark it as valid again; if not, then mark the TSS
+	// bitmap as invalid.  The bitmap is never copied here: the first port I/O
+	// instruction of the new thread faults instead, and the HAL loads the
+	// bitmap then (see hal::load_io_port_map()).  Note that EDI still points
+	// to the TSS here
 	//
-	movl	20(%ebp), %esi	// I/O bitmap of new thread
-	test	$0xFFFFFFFF, %esi
+	movl	20(%ebp), %esi	// Is the bitmap of the new thread resident?
+	test	%esi, %esi
 	jnz		1f
 	movw	$TSS_IO_BITMAP_ADDRESS_INVALID, TSS_IO_BITMAP_ADDRESS_OFFSET(%edi)
 	jmp		2f
 
 1:
-	TSS_RELOAD_BITMAP
+	movw	$TSS_IO_BITMAP_ADDRESS_VALID, TSS_IO_BITMAP_ADDRESS_OFFSET(%edi)
 
 
 2:
@@ -17,7 +17,8 @@
 // allows to processor to resume execution of the thread later as if
 // the thread had never been suspended.  This should be used to save
 // the existing thread context prior to handling an interrupt or
-// switching to another thread.  Floating-point context is not saved.
+// switching to another thread.  Floating-point context is not saved here;
+// it is switched lazily, see hal::load_fpu_context().
 //
 #define SAVE_THREAD_CONTEXT		\
 	pusha;						\
@@ -27,6 +28,10 @@
 	pushl	%gs;				\
 	pushfl;		// Required for context switch, not for IRQ
 
+// Size of the block pushed by SAVE_THREAD_CONTEXT: EFLAGS, four segment
+// registers + eight general registers
+#define SAVED_THREAD_CONTEXT_SIZE	(13 * 4)
+
 
 
 //
@@ -36,7 +41,7 @@
 // effectively restores the state of an interrupted/suspended thread.
 // This should be used to restore the original thread context after
 // servicing an interrupt or after resuming a suspended thread.
-// Floating-point context is not restored.
+// Floating-point context is not restored here.
 //
 #define RESTORE_THREAD_CONTEXT		\
 	popfl;							\
@@ -16,25 +16,38 @@
 ///
 /// Creates + installs a TSS on this CPU.  Populates the SS0, bitmap base and
 /// bitmap terminator fields; all others are zero.  The I/O bitmap is initially
-/// invalid/empty
+/// invalid/empty.  Each processor uses its own TSS from the pool of TSS
+/// structures; and its own TSS descriptor in the GDT
 ///
 /// C/C++ prototype --
-///		void_t load_tss(void_t)
+///		void_t load_tss(uint32_t processor_index)		// at (EBP + 8)
 ///
 .align 4
 .global load_tss
 load_tss:
+	pushl	%ebp
+	movl	%esp, %ebp
+
 	pushl	%eax
 	pushl	%ecx
+	pushl	%edx
 	pushl	%edi
 
 
+	//
+	// Locate the TSS for this processor
+	//
+	movl	8(%ebp), %eax
+	imull	$KERNEL_TSS_SIZE, %eax, %edx
+	addl	$KERNEL_TSS_BASE, %edx
+
+
 	//
 	// Wipe the entire region of memory reserved for this TSS.  Assumes the
 	// TSS begins + ends on 32b boundaries.  Assumes %es already contains the
 	// (new) flat data descriptor
 	//
-	movl	$KERNEL_TSS_BASE, %edi	//@SMP: each CPU needs its own TSS
+	movl	%edx, %edi
 	movl	$(KERNEL_TSS_SIZE >> 2), %ecx	// sizeof(TSS) in 32-bit words
 	xorl	%eax, %eax
 	rep
@@ -48,7 +61,7 @@ load_tss:
 	//	- an empty I/O bitmap; this may change or be overwritten on each
 	//	  context switch
 	//
-	movl	$KERNEL_TSS_BASE, %edi
+	movl	%edx, %edi
 	movw	$GDT_KERNEL_DATA_SELECTOR, TSS_SS0_OFFSET(%edi)
 	movw	$TSS_IO_BITMAP_ADDRESS_INVALID, TSS_IO_BITMAP_ADDRESS_OFFSET(%edi)
 
@@ -63,15 +76,20 @@ load_tss:
 
 
 	//
-	// Make the TSS visible to the CPU
+	// Make the TSS visible to the CPU.  The selector is unique to this
+	// processor
 	//
-	movw	$GDT_TSS_SELECTOR, %ax
-	ltrw	%ax		//@SMP: each CPU needs its own TSS
+	movl	8(%ebp), %eax
+	shll	$3, %eax
+	addl	$GDT_TSS_SELECTOR, %eax
+	ltrw	%ax
 
 	popl	%edi
+	popl	%edx
 	popl	%ecx
 	popl	%eax
 
+	popl	%ebp
 	ret
 
 
@@ -96,16 +114,17 @@ reload_io_port_map:
 	pushl	%ebp
 	movl	%esp, %ebp
 
+	pushl	%eax
 	pushl	%esi
 	pushl	%edi
 	pushl	%ecx
 
 
 	//
-	// Load pointers to the bitmap; and the current TSS
+	// Load pointers to the bitmap; and the TSS of the current processor
 	//
 	movl	8(%ebp), %esi
-	movl	$KERNEL_TSS_BASE, %edi	//@SMP: each CPU needs its own TSS
+	TSS_LOAD_CURRENT_BASE
 
 
 	//
@@ -118,6 +137,7 @@ reload_io_port_map:
 	popl	%ecx
 	popl	%edi
 	popl	%esi
+	popl	%eax
 
 	popl	%ebp
 	ret
@@ -55,6 +55,24 @@
 #define TSS_IO_BITMAP_ADDRESS_INVALID	0xFFFF
 
 
+//
+// Locate the TSS of the current processor.  Each processor loads the TSS
+// selector that corresponds to its own TSS within the TSS pool (see
+// load_tss()), so the current task register is enough to find it.
+//
+// Assumes selector.h and hal/address_space_layout.h are already included
+//
+// On completion, %edi points to the base of the TSS.  Destroys %eax
+//
+#define TSS_LOAD_CURRENT_BASE												  \
+	xorl	%eax, %eax;														  \
+	strw	%ax;															  \
+	subl	$GDT_TSS_SELECTOR, %eax;										  \
+	shrl	$3, %eax;							/* Index of this processor */ \
+	imull	$KERNEL_TSS_SIZE, %eax, %edi;									  \
+	addl	$KERNEL_TSS_BASE, %edi
+
+
 //
 // Common sequence of instructions for copying/reloading the I/O port bitmap
 // at the end of the TSS.  Mark the bitmap as valid within the TSS; and copy
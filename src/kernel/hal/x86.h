@@ -21,6 +21,11 @@
 #define CR0_CD			0x40000000	// Cache disable
 #define CR0_NW			0x20000000	// Not write-through (i.e., writeback)
 #define CR0_WP			0x00010000	// Write protect
+#define CR0_NE			0x00000020	// Native FPU error reporting
+#define CR0_TS			0x00000008	// Task switched (FPU state is stale)
+#define CR0_EM			0x00000004	// FPU emulation
+#define CR0_MP			0x00000002	// Monitor coprocessor
+#define CR0_PE			0x00000001	// Protected mode enable
 
 
 //
@@ -28,6 +33,25 @@
 //
 #define CR4_PSE			0x00000010	// Enable page-size extensions
 #define CR4_PGE			0x00000080	// Enable global pages
+#define CR4_OSFXSR		0x00000200	// Enable FXSAVE/FXRSTOR + SSE
+
+
+//
+// Model-specific registers for the SYSENTER/SYSEXIT fast system-call entry
+//
+#define MSR_SYSENTER_CS		0x174	// Kernel code selector
+#define MSR_SYSENTER_ESP	0x175	// Kernel stack pointer
+#define MSR_SYSENTER_EIP	0x176	// Kernel entry point
+
+
+
+//
+// Size of the saved FPU/MMX/SSE context of each thread.  FXSAVE writes 512
+// bytes, aligned on a 16-byte boundary; the older FSAVE only writes 108
+// bytes, so the same buffer suffices for either
+//
+#define FPU_CONTEXT_SIZE	512
+#define FPU_CONTEXT_ALIGN	16
 
 
 #endif
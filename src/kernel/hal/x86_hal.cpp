@@ -8,11 +8,17 @@
 #include "debug.hpp"
 #include "drivers/i8254pit.hpp"
 #include "drivers/i8259pic.hpp"
+#include "drivers/local_apic.hpp"
+#include "dx/hal/processor_type.h"
+#include "dx/system_call_vectors.h"
 #include "hal/address_space_layout.h"
+#include "hal/processor.h"
 #include "hal/x86_hal.hpp"
 #include "kernel_panic.hpp"
 #include "kernel_subsystems.hpp"
+#include "kernel_threads.hpp"
 #include "klibc.hpp"
+#include "mp_table.h"
 #include "selector.h"
 #include "thread_layout.h"
 #include "x86.h"
@@ -32,6 +38,110 @@ x86_hardware_abstraction_layer_cp		__hal = NULL;
 //
 static i8254_programmable_interval_timer_cp			i8254PIT;
 static i8259_programmable_interrupt_controller_cp	i8259PIC;
+static local_apic_cp								local_apic = NULL;
+
+
+
+//
+// Per-processor state.  The processor count only increases, as each
+// application processor finishes its initialization.  The previous thread
+// is only valid while a processor is switching threads; see
+// hal::switch_thread() and hal::switch_thread_complete()
+//
+static volatile uint32_t	processor_count = 1;
+static thread_cp			previous_thread[ PROCESSOR_COUNT_MAX ];
+
+
+//
+// The I/O port bitmap currently resident in the TSS of each processor, if
+// any.  The bitmap is only copied into the TSS lazily, on the first port I/O
+// fault after a context switch; switching back to the address space whose
+// bitmap is still resident costs nothing.  See hal::load_io_port_map()
+//
+static io_port_map_cp		resident_io_port_map[ PROCESSOR_COUNT_MAX ];
+
+
+//
+// The thread whose FPU/MMX/SSE state is currently live in the registers of
+// each processor, if any.  CR0.TS is clear only while this thread executes,
+// so any other thread traps (#NM) on its first FPU instruction; see
+// hal::load_fpu_context().  While the bootstrap processor is the only
+// processor, the owner keeps its state in the registers even after it loses
+// the CPU, so an FPU-heavy thread that alternates with FPU-free threads never
+// saves or restores its state.  Once other processors start, a thread could
+// resume elsewhere, so its state is saved whenever it loses the CPU
+//
+static thread_cp			fpu_owner[ PROCESSOR_COUNT_MAX ];
+static bool_t				fpu_lazy_save = TRUE;
+
+
+//
+// A clean FXSAVE image: the FPU as FNINIT leaves it, plus the default MXCSR
+// and zeroed MMX/XMM registers.  FNINIT alone would leave the SSE state of
+// the previous owner visible, so on FXSR processors, each thread starts from
+// this image instead; see initialize_fpu_context()
+//
+static const uint32_t		fpu_clean_context[ FPU_CONTEXT_SIZE / 4 ]
+								ALIGNED(FPU_CONTEXT_ALIGN) =
+	{
+	0x0000037F,		// FCW: all x87 exceptions masked; FSW: clear
+	0, 0, 0, 0, 0,	// FTW: all registers empty; FOP, FIP + FDP: clear
+	0x00001F80		// MXCSR: all SIMD exceptions masked
+	};
+
+
+//
+// Tickless idle.  The clock tick only serves to preempt threads, so each
+// processor stops its tick while its idle thread executes; see
+// hal::stop_clock_tick().  The time spent halted is measured in timestamp
+// cycles, and only converted into clock ticks when read
+//
+static bool_t				clock_tick_stopped[ PROCESSOR_COUNT_MAX ];
+static uint64_t				idle_cycles[ PROCESSOR_COUNT_MAX ];
+static uint32_t				cycles_per_tick = 1;
+
+
+//
+// TLB shootdown.  A processor that invalidates a page table entry must also
+// flush any stale copy of that translation from the TLB of every other
+// processor, before the underlying frame can be reused.  Only one shootdown
+// is in flight at a time; each target processor acknowledges the request by
+// clearing its own flag.  See hal::invalidate_tlb()
+//
+static volatile uint32_t	tlb_shootdown_busy = FALSE;
+static volatile uintptr_t	tlb_shootdown_page;
+static volatile bool_t		tlb_shootdown_request[ PROCESSOR_COUNT_MAX ];
+
+
+
+//
+// Timeouts for starting each application processor, in microseconds.  These
+// follow the INIT/STARTUP sequence recommended in the MultiProcessor
+// Specification
+//
+const
+uint32_t	AP_INIT_DELAY			= 10000,	// 10 ms
+			AP_STARTUP_ATTEMPTS		= 2,
+			AP_STARTUP_POLL_DELAY	= 1000,		// 1 ms
+			AP_STARTUP_TIMEOUT		= 100;		// In poll intervals
+
+
+//
+// Only the bootstrap processor receives device interrupts; and there are no
+// wakeup IPIs here.  So an idle application processor cannot stop its clock
+// entirely, but instead looks for work queued by other processors at this
+// (much slower) rate, in clock ticks
+//
+const
+uint32_t	AP_IDLE_TICK_COUNT		= 25;		// 50 ms
+
+
+//
+// Interval for calibrating the timestamp counter against the PIT, in
+// microseconds
+//
+const
+uint32_t	TIMESTAMP_CALIBRATION_INTERVAL	= 10000;	// 10 ms
 
 
 
@@ -56,7 +166,7 @@ ASM_LINKAGE
 void_t		switch_thread(	uint32_tpp			old_stack,
 							uint32_tp			new_stack,
 							page_directory_cp	new_page_directory,
-							uint8_tp			io_bitmap);
+							uint32_t			io_bitmap_valid);
 
 
 
@@ -78,13 +188,37 @@ ASM_LINKAGE
 void_t		load_idt();
 
 ASM_LINKAGE
-void_t		load_tss();
+void_t		load_tss(uint32_t processor_index);
+
+ASM_LINKAGE
+void_t		reload_idt();
 
 ASM_LINKAGE
 void_t		reload_io_port_map(const uint8_t* map);
 
 
 
+//
+// Fast system-call entry point, for SYSENTER.  See interrupt_handler_stub.asm
+//
+ASM_LINKAGE
+void_t		system_call_fast_entry();
+
+
+
+//
+// Startup trampoline + parameters for the application processors.  See
+// application_processor.asm
+//
+ASM_LINKAGE	uint8_t				ap_trampoline_start[];
+ASM_LINKAGE	uint8_t				ap_trampoline_end[];
+
+ASM_LINKAGE	volatile uint32_t	ap_startup_index;
+ASM_LINKAGE	volatile uint32_t	ap_startup_page_directory;
+ASM_LINKAGE	volatile uint32_t	ap_startup_stack;
+
+
+
 
 
 
@@ -95,6 +229,353 @@ void_t		reload_io_port_map(const uint8_t* map);
 ///////////////////////////////////////////////////////////////////////////
 
 
+///
+/// Validates the checksum on one of the MP structures.  All of the bytes in
+/// each structure must sum to zero.  No side effects.
+///
+/// @return TRUE if the checksum is valid; FALSE otherwise
+///
+static
+bool_t
+is_valid_mp_checksum(	const uint8_t*	data,
+						uint32_t		size)
+	{
+	uint8_t sum = 0;
+
+	for (uint32_t i = 0; i < size; i++)
+		{ sum = uint8_t(sum + data[i]); }
+
+	return(sum == 0 ? TRUE : FALSE);
+	}
+
+
+///
+/// Searches the given range of (identity-mapped) memory for the MP floating
+/// pointer structure.  No side effects.
+///
+/// @return a pointer to the structure; or NULL if not found
+///
+static
+mp_floating_pointer_sp
+find_mp_floating_pointer(	uintptr_t	start,
+							uint32_t	size)
+	{
+	mp_floating_pointer_sp	pointer = NULL;
+	uintptr_t				end		= start + size;
+
+	// The structure is always aligned on a 16-byte boundary
+	for (; start + sizeof(*pointer) <= end; start += 16)
+		{
+		mp_floating_pointer_sp candidate = mp_floating_pointer_sp(start);
+
+		if (candidate->signature == MP_FLOATING_POINTER_SIGNATURE &&
+			is_valid_mp_checksum(uint8_tp(candidate), sizeof(*candidate)))
+			{
+			pointer = candidate;
+			break;
+			}
+		}
+
+	return(pointer);
+	}
+
+
+///
+/// Locates the MP configuration table built by the BIOS, if any.  Searches
+/// the well-known locations defined by the MultiProcessor Specification, in
+/// order: the first 1KB of the EBDA; the last 1KB of base memory; and the
+/// BIOS ROM.  No side effects.
+///
+/// @return a pointer to the configuration table; or NULL if the host has no
+/// (usable) configuration table
+///
+static
+mp_configuration_table_sp
+find_mp_configuration_table()
+	{
+	uintptr_t					ebda;
+	uintptr_t					memory_size;
+	mp_floating_pointer_sp		pointer;
+	mp_configuration_table_sp	table = NULL;
+
+
+	do
+		{
+		//
+		// The BIOS data area contains the segment of the EBDA; and the size
+		// of base memory, in KB.  Read these through volatile pointers, so
+		// the compiler cannot reason about the (fixed, low) addresses
+		//
+		const volatile uint16_t* volatile ebda_segment =
+			(const volatile uint16_t*)(MP_BDA_EBDA_SEGMENT);
+		const volatile uint16_t* volatile base_memory_size =
+			(const volatile uint16_t*)(MP_BDA_BASE_MEMORY_SIZE);
+
+		ebda		= uintptr_t(*ebda_segment) << 4;
+		memory_size	= uintptr_t(*base_memory_size) * 1024;
+
+		pointer = NULL;
+		if (ebda)
+			{ pointer = find_mp_floating_pointer(ebda, MP_SEARCH_SIZE); }
+		if (!pointer && memory_size > MP_SEARCH_SIZE)
+			{
+			pointer = find_mp_floating_pointer(memory_size - MP_SEARCH_SIZE,
+				MP_SEARCH_SIZE);
+			}
+		if (!pointer)
+			{
+			pointer = find_mp_floating_pointer(MP_SEARCH_BIOS_ROM_BASE,
+				MP_SEARCH_BIOS_ROM_SIZE);
+			}
+		if (!pointer)
+			{
+			TRACE(ALL, "No MP floating pointer structure\n");
+			break;
+			}
+
+
+		//
+		// A missing configuration table implies one of the default
+		// configurations, which are not supported here.  The table must lie
+		// within the kernel code page, which is identity-mapped
+		//
+		if (pointer->configuration_table == 0 ||
+			pointer->configuration_table >= KERNEL_DATA_PAGE0_BASE)
+			{
+			TRACE(ALL, "No usable MP configuration table\n");
+			break;
+			}
+
+		table = mp_configuration_table_sp(pointer->configuration_table);
+		if (table->signature != MP_CONFIGURATION_TABLE_SIGNATURE ||
+			!is_valid_mp_checksum(uint8_tp(table), table->length))
+			{
+			TRACE(ALL, "Invalid MP configuration table at %p\n", table);
+			table = NULL;
+			break;
+			}
+
+		} while(0);
+
+
+	return(table);
+	}
+
+
+///
+/// Reads the specified model-specific register.  Only the low 32 bits are
+/// returned.
+///
+static
+uint32_t
+read_msr(uint32_t msr)
+	{
+	uint32_t low;
+	uint32_t high;
+
+	__asm volatile("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
+
+	return(low);
+	}
+
+
+///
+/// Writes the specified model-specific register.  The high 32 bits are
+/// always cleared.
+///
+static
+void_t
+write_msr(	uint32_t msr,
+			uint32_t value)
+	{
+	__asm volatile("wrmsr" : : "c"(msr), "a"(value), "d"(0));
+
+	return;
+	}
+
+
+///
+/// Divides a 64b value by a 32b divisor, without the 64b division helpers
+/// of libgcc.  The high word is divided first, so the second division
+/// cannot overflow.
+///
+static
+uint64_t
+divide64(	uint64_t dividend,
+			uint32_t divisor)
+	{
+	uint32_t high		= uint32_t(dividend >> 32);
+	uint32_t low		= uint32_t(dividend);
+	uint32_t remainder	= high % divisor;
+
+	high /= divisor;
+	__asm("divl %2" : "+a"(low), "+d"(remainder) : "rm"(divisor) : "cc");
+
+	return((uint64_t(high) << 32) | low);
+	}
+
+
+///
+/// Read the full 64b CPU timestamp.  Unlike read_timestamp32(), this does not
+/// wrap within any realistic idle period
+///
+static
+inline
+uint64_t
+read_timestamp64()
+	{
+	uint64_t timestamp64;
+
+	__asm volatile("rdtsc" : "=A"(timestamp64));
+
+	return(timestamp64);
+	}
+
+
+///
+/// Clear CR0.TS, so that FPU instructions no longer trap
+///
+static
+inline
+void_t
+clear_task_switched()
+	{
+	__asm volatile("clts");
+	return;
+	}
+
+
+///
+/// Load a clean FPU/MMX/SSE state into the registers of the current
+/// processor, for a thread that has never used the FPU.  Assumes CR0.TS is
+/// clear
+///
+static
+void_t
+initialize_fpu_context()
+	{
+	if (__hal->read_processor_type() >= PROCESSOR_TYPE_FXSR)
+		{ __asm volatile("fxrstor (%0)" : : "r"(fpu_clean_context)); }
+	else
+		{ __asm volatile("fninit"); }
+
+	return;
+	}
+
+
+///
+/// Restore the FPU/MMX/SSE state of the given thread into the registers of
+/// the current processor.  Assumes CR0.TS is clear
+///
+static
+void_t
+restore_fpu_context(thread_cr thread)
+	{
+	ASSERT(thread.fpu_context);
+	if (__hal->read_processor_type() >= PROCESSOR_TYPE_FXSR)
+		{ __asm volatile("fxrstor (%0)" : : "r"(thread.fpu_context)); }
+	else
+		{ __asm volatile("frstor (%0)" : : "r"(thread.fpu_context)); }
+
+	return;
+	}
+
+
+///
+/// Save the FPU/MMX/SSE state of the given thread, which must currently be
+/// live in the registers of the current processor.  Assumes CR0.TS is clear.
+/// Afterwards, the registers may no longer hold the thread state (FSAVE
+/// reinitializes the FPU)
+///
+static
+void_t
+save_fpu_context(thread_cr thread)
+	{
+	ASSERT(thread.fpu_context);
+	if (__hal->read_processor_type() >= PROCESSOR_TYPE_FXSR)
+		{
+		__asm volatile("fxsave (%0)"
+			:
+			: "r"(thread.fpu_context)
+			: "memory");
+		}
+	else
+		{
+		__asm volatile("fnsave (%0)"
+			:
+			: "r"(thread.fpu_context)
+			: "memory");
+		}
+
+	return;
+	}
+
+
+///
+/// Set CR0.TS, so that the next FPU instruction traps (#NM)
+///
+static
+inline
+void_t
+set_task_switched()
+	{
+	__asm volatile(	"movl	%%cr0, %%eax;"
+					"orl	%0,    %%eax;"
+					"movl	%%eax, %%cr0;"
+					:
+					: "i"(CR0_TS)
+					: "eax");
+	return;
+	}
+
+
+///
+/// Destroys the current thread after an FPU exception or failure from which
+/// it cannot recover.  The kernel itself never uses the FPU, so the same
+/// fault in kernel mode is a kernel bug.  Only returns if the deletion
+/// request cannot be allocated; the thread then retries the faulting
+/// instruction, and likely faults again.
+///
+/// @param interrupt -- the exception raised by the current thread
+///
+static
+void_t
+fault_current_thread(interrupt_cr interrupt)
+	{
+	thread_cr current_thread = __hal->read_current_thread();
+
+	if (!interrupt.is_user_interrupt())
+		{
+		kernel_panic(KERNEL_PANIC_REASON_UNEXPECTED_INTERRUPT,
+					interrupt.vector,
+					interrupt.data);
+		}
+
+	TRACE(ALL, "Thread %#x faulted (vector %d); destroying it\n",
+		current_thread.id, interrupt.vector);
+
+	send_deletion_message(current_thread.id);
+
+	return;
+	}
+
+
+///
+/// Entry point for each application processor, after the startup trampoline
+/// has enabled protected mode + paging.  Executes on the stack of the idle
+/// thread for this processor.  Never returns.
+///
+/// @param processor_index -- index of this processor
+///
+ASM_LINKAGE
+void_t
+application_processor_entry(uint32_t processor_index)
+	{
+	ASSERT(__hal);
+	__hal->initialize_application_processor(processor_index);
+	}
+
+
 ///
 /// Table of interrupt handlers.  Each interrupt vector has (at most) one
 /// handler within the kernel.  IDT gates that are marked "not present" do not
@@ -155,8 +636,8 @@ interrupt_handler_fp interrupt_handler[] =
 	__device_proxy->handle_interrupt,	// PIC_IRQ13
 	__device_proxy->handle_interrupt,	// PIC_IRQ14
 	__device_proxy->handle_interrupt,	// PIC_IRQ15
-	NULL,								// 48 - unused, no gate
-	NULL,								// 49 - unused, no gate
+	__io_manager->handle_interrupt,		// LOCAL_TIMER
+	__hal->handle_interrupt,			// LOCAL_TLB_SHOOTDOWN
 	NULL,								// 50 - unused, no gate
 	NULL,								// 51 - unused, no gate
 	NULL,								// 52 - unused, no gate
@@ -170,7 +651,7 @@ interrupt_handler_fp interrupt_handler[] =
 	NULL,								// 60 - unused, no gate
 	NULL,								// 61 - unused, no gate
 	NULL,								// 62 - unused, no gate
-	NULL,								// 63 - unused, no gate
+	__hal->handle_interrupt,			// LOCAL_SPURIOUS
 	__io_manager->handle_interrupt,		// SOFT_YIELD
 	NULL,								// 65 - unused, no gate
 	NULL,								// 66 - unused, no gate
@@ -191,12 +672,12 @@ interrupt_handler_fp interrupt_handler[] =
 	__io_manager->handle_interrupt,		// SEND_AND_RECEIVE_MESSAGE
 	__io_manager->handle_interrupt,		// SEND_MESSAGE
 	__io_manager->handle_interrupt,		// DELETE_MESSAGE
-	NULL,								// 84 - unused, no gate
-	NULL,								// 85 - unused, no gate
-	NULL,								// 86 - unused, no gate
-	NULL,								// 87 - unused, no gate
-	NULL,								// 88 - unused, no gate
-	NULL,								// 89 - unused, no gate
+	__io_manager->handle_interrupt,		// SEND_DONATED_MESSAGE
+	__io_manager->handle_interrupt,		// SEND_GATHERED_MESSAGE
+	__io_manager->handle_interrupt,		// PROCESS_MESSAGES
+	__io_manager->handle_interrupt,		// CREATE_MESSAGE_RING
+	__io_manager->handle_interrupt,		// ENTER_MESSAGE_RING
+	__io_manager->handle_interrupt,		// SET_MAILBOX_LIMIT
 	__memory_manager->handle_interrupt,	// CONTRACT_ADDRESS_SPACE
 	__memory_manager->handle_interrupt,	// CREATE_ADDRESS_SPACE
 	__memory_manager->handle_interrupt,	// DELETE_ADDRESS_SPACE
@@ -209,7 +690,7 @@ interrupt_handler_fp interrupt_handler[] =
 	NULL,								// 99 - unused, no gate
 	__thread_manager->handle_interrupt,	// CREATE_THREAD
 	__thread_manager->handle_interrupt,	// DELETE_THREAD
-	NULL,								// 102
+	__io_manager->handle_interrupt,		// SIGNAL_THREAD
 	NULL,								// 103
 	NULL,								// 104
 	NULL,								// 105
@@ -219,7 +700,7 @@ interrupt_handler_fp interrupt_handler[] =
 	NULL,								// 109
 	__device_proxy->handle_interrupt,	// MAP_DEVICE
 	__device_proxy->handle_interrupt,	// UNMAP_DEVICE
-	NULL,								// 112
+	__device_proxy->handle_interrupt,	// ACKNOWLEDGE_INTERRUPT
 	NULL,								// 113
 	NULL,								// 114
 	NULL,								// 115
@@ -237,6 +718,37 @@ interrupt_handler_fp interrupt_handler[] =
 
 
 
+///
+/// The frame pushed by the processor itself on each interrupt, exception or
+/// trap, just above any error code.  ESP + SS follow only if the interrupt
+/// arrived from ring 3.  Each stub in interrupt_handler_stub.asm passes the
+/// location of this frame to dispatch_interrupt()
+///
+typedef struct trap_frame
+	{
+	uintptr_t	eip;
+	uintptr_t	cs;
+	uintptr_t	eflags;
+	} trap_frame_s;
+
+
+///
+/// Did the given interrupt preempt user code, rather than the kernel?
+///
+/// @param frame -- the trap frame of the interrupted code
+///
+/// @return TRUE if the interrupt arrived from ring 3
+///
+static
+inline
+bool_t
+is_user_interrupt(const trap_frame_s* frame)
+	{
+	return(bool_t((frame->cs & 0x3) == RING3));
+	}
+
+
+
 ///
 /// Main entry point into the interrupt-handling logic.  The assembly-level
 /// handlers all invoke this function when an interrupt or exception
@@ -251,13 +763,19 @@ interrupt_handler_fp interrupt_handler[] =
 /// If the current thread is exiting (and thus yielding the processor here),
 /// then this routine will never return.
 ///
+/// @param vector	-- the interrupt vector
+/// @param data		-- the error code or system call data, if any
+/// @param frame	-- the trap frame pushed by the processor
+///
 ASM_LINKAGE
 void_t
-dispatch_interrupt(	uint32_t	vector,
-					uintptr_t	data	)
+dispatch_interrupt(	uint32_t			vector,
+					uintptr_t			data,
+					const trap_frame_s*	frame	)
 	{
 	interrupt_handler_fp	handler;
-	interrupt_c				interrupt(vector, data);
+	interrupt_c				interrupt(vector, data,
+								is_user_interrupt(frame));
 
 
 	//
@@ -275,10 +793,14 @@ dispatch_interrupt(	uint32_t	vector,
 
 	//
 	// Let the PIC driver send its EOI and perform any other cleanup
-	// as necessary
+	// as necessary.  Likewise, interrupts from the local APIC timer, or from
+	// other processors, must be acknowledged on the local processor
 	//
 	if (interrupt.is_pic_interrupt())
 		i8259PIC->acknowledge_interrupt(interrupt);
+	else if (interrupt.vector == INTERRUPT_VECTOR_LOCAL_TIMER ||
+		interrupt.vector == INTERRUPT_VECTOR_LOCAL_TLB_SHOOTDOWN)
+		local_apic->acknowledge_interrupt();
 
 
 	//
@@ -293,6 +815,53 @@ dispatch_interrupt(	uint32_t	vector,
 		{ __hal->switch_thread(interrupt.read_next_thread()); }
 
 
+	//
+	// The interrupted thread is about to resume in user mode.  If the clock
+	// interrupt requested it, drain its message ring first.  The drain may
+	// allocate + fault on the ring, so it waits until here, after the EOI and
+	// any context switch, and then executes with interrupts enabled, just as
+	// a system call would.  It never delays any other interrupt
+	//
+	if (interrupt.is_message_ring_drain_pending())
+		{
+		__hal->enable_interrupts();
+		__io_manager->drain_message_ring(__hal->read_current_thread(), FALSE);
+		__hal->disable_interrupts();
+		}
+
+
+	return;
+	}
+
+
+///
+/// Entry point for system calls issued via SYSENTER.  Unlike the INT path,
+/// the vector here is supplied by the user thread in a register, so it must
+/// be validated before dispatching.  A request for any vector other than a
+/// system call is treated exactly as an INT to a missing IDT gate would be:
+/// as a segment-not-present fault, with the IDT bit set in the error code.
+///
+/// Otherwise identical to dispatch_interrupt().  See system_call_fast_entry
+/// in interrupt_handler_stub.asm
+///
+ASM_LINKAGE
+void_t
+dispatch_system_call(	uint32_t			vector,
+						uintptr_t			data,
+						const trap_frame_s*	frame	)
+	{
+	if (vector >= SYSTEM_CALL_VECTOR_FIRST &&
+		vector <= SYSTEM_CALL_VECTOR_LAST &&
+		interrupt_handler[ vector ])
+		{
+		dispatch_interrupt(vector, data, frame);
+		}
+	else
+		{
+		dispatch_interrupt(INTERRUPT_VECTOR_SEGMENT_NOT_PRESENT,
+			(vector << 3) | 0x2, frame);
+		}
+
 	return;
 	}
 
@@ -328,7 +897,7 @@ x86_hardware_abstraction_layer_c()
 	//
 	load_gdt();
 	load_idt();
-	load_tss();	//@@SMP: one TSS per CPU
+	load_tss(PROCESSOR_INDEX_BOOT);
 
 
 	//
@@ -340,6 +909,70 @@ x86_hardware_abstraction_layer_c()
 		{ kernel_panic(KERNEL_PANIC_REASON_MEMORY_ALLOCATION_FAILURE); }
 
 
+	//
+	// Measure the rate of the timestamp counter against the PIT, so that
+	// idle time can be reported in clock ticks.  Assumes that the counter
+	// runs at the same rate on all processors
+	//
+	uint32_t start = read_timestamp32();
+	i8254PIT->delay(TIMESTAMP_CALIBRATION_INTERVAL);
+	cycles_per_tick = (read_timestamp32() - start) /
+		(TIMESTAMP_CALIBRATION_INTERVAL / (1000000 / i8254_COUNTER0_FREQUENCY));
+	if (cycles_per_tick == 0)
+		{ cycles_per_tick = 1; }
+
+
+	return;
+	}
+
+
+///
+/// Releases the saved FPU state of a thread that is being destroyed.  The
+/// thread may still own the FPU of some processor, although it can no longer
+/// execute, so forget its live state there, too.
+///
+/// @param thread -- the victim thread
+///
+void_t x86_hardware_abstraction_layer_c::
+discard_fpu_context(thread_cr thread)
+	{
+	uintptr_t interrupt_state = disable_interrupts();
+
+	for (uint32_t i = 0; i < PROCESSOR_COUNT_MAX; i++)
+		{
+		if (fpu_owner[i] == &thread)
+			{ fpu_owner[i] = NULL; }
+		}
+
+	enable_interrupts(interrupt_state);
+
+	delete[](thread.fpu_context);
+	thread.fpu_context = NULL;
+
+	return;
+	}
+
+
+///
+/// Discards any cached copy of the given I/O port bitmap, on every processor.
+/// Each processor then reloads the bitmap, if necessary, on its next port
+/// I/O fault.  Invoked when the bitmap changes; or just before it is
+/// destroyed, since a new bitmap could later reuse the same address.
+///
+/// On SMP machines, a thread that is currently executing on another
+/// processor continues with the old bitmap until it loses the CPU
+///
+/// @param map -- the stale I/O port bitmap
+///
+void_t x86_hardware_abstraction_layer_c::
+discard_io_port_map(io_port_map_cr map)
+	{
+	for (uint32_t i = 0; i < PROCESSOR_COUNT_MAX; i++)
+		{
+		if (resident_io_port_map[i] == &map)
+			{ resident_io_port_map[i] = NULL; }
+		}
+
 	return;
 	}
 
@@ -391,6 +1024,32 @@ enable_paging(address_space_cr address_space)
 	}
 
 
+///
+/// Saves the FPU state of whichever thread owns the FPU of the current
+/// processor, if any, so that the thread may resume on any processor.  On
+/// return, no thread owns this FPU, and CR0.TS is set.
+///
+/// Assumes interrupts are disabled
+///
+void_t x86_hardware_abstraction_layer_c::
+flush_fpu_context()
+	{
+	uint32_t	index	= read_current_processor_index();
+	thread_cp	owner	= fpu_owner[ index ];
+
+	if (owner)
+		{
+		clear_task_switched();
+		save_fpu_context(*owner);
+		fpu_owner[ index ] = NULL;
+		}
+
+	set_task_switched();
+
+	return;
+	}
+
+
 ///
 /// Interrupt handler for some of the low-level processor exceptions.  The HAL
 /// handles these errors directly.
@@ -414,26 +1073,115 @@ handle_interrupt(interrupt_cr interrupt)
 			break;
 
 
-		// The processor should not generate any of these interrupts or
-		// exceptions under normal conditions
-		case INTERRUPT_VECTOR_NON_MASKABLE_INTERRUPT:
-		case INTERRUPT_VECTOR_INVALID_OPCODE:
-		case INTERRUPT_VECTOR_DEVICE_NOT_AVAILABLE:
-		case INTERRUPT_VECTOR_COPROCESSOR_OVERRUN:
-		case INTERRUPT_VECTOR_INVALID_TSS:
-		case INTERRUPT_VECTOR_FLOATING_POINT_ERROR:
-		case INTERRUPT_VECTOR_MACHINE_CHECK:
-			kernel_panic(KERNEL_PANIC_REASON_UNEXPECTED_INTERRUPT,
-						interrupt.vector,
-						interrupt.data);
-			break;
+		//
+		// The local APIC may generate spurious interrupts if an interrupt is
+		// withdrawn before the processor accepts it.  These must not be
+		// acknowledged; just ignore them
+		//
+		case INTERRUPT_VECTOR_LOCAL_SPURIOUS:
+			break;
+
+
+		//
+		// Another processor has invalidated a page table entry; flush the
+		// stale translation here, too
+		//
+		case INTERRUPT_VECTOR_LOCAL_TLB_SHOOTDOWN:
+			service_tlb_shootdown();
+			break;
+
+
+		//
+		// The current thread touched the FPU for the first time since it
+		// last lost the CPU; switch the FPU state now
+		//
+		case INTERRUPT_VECTOR_DEVICE_NOT_AVAILABLE:
+			load_fpu_context(interrupt);
+			break;
+
+
+		//
+		// An unmasked x87 exception in the current thread.  Threads cannot
+		// install their own exception handlers, so the thread cannot
+		// recover; discard the exception, and destroy the thread
+		//
+		case INTERRUPT_VECTOR_FLOATING_POINT_ERROR:
+			__asm volatile("fnclex");
+			fault_current_thread(interrupt);
+			break;
+
+
+		// The processor should not generate any of these interrupts or
+		// exceptions under normal conditions
+		case INTERRUPT_VECTOR_NON_MASKABLE_INTERRUPT:
+		case INTERRUPT_VECTOR_INVALID_OPCODE:
+		case INTERRUPT_VECTOR_COPROCESSOR_OVERRUN:
+		case INTERRUPT_VECTOR_INVALID_TSS:
+		case INTERRUPT_VECTOR_MACHINE_CHECK:
+			kernel_panic(KERNEL_PANIC_REASON_UNEXPECTED_INTERRUPT,
+						interrupt.vector,
+						interrupt.data);
+			break;
+
+		default:
+			ASSERT(FALSE);
+			break;
+		}
+
+	return;
+	}
+
+
+///
+/// Initialization for each application processor.  Loads the TSS for this
+/// processor; enables the local APIC + its timer; and then starts executing
+/// the idle thread for this processor.  Never returns.
+///
+/// Executes on the application processor itself, on the stack of its idle
+/// thread.  See application_processor.asm
+///
+/// @param index -- index of this processor
+///
+void_t x86_hardware_abstraction_layer_c::
+initialize_application_processor(uint32_t index)
+	{
+	ASSERT(index < PROCESSOR_COUNT_MAX);
+	ASSERT(local_apic);
+
+
+	//
+	// The GDT + IDT are shared by all processors, but each processor needs
+	// its own TSS
+	//
+	load_tss(index);
+	ASSERT(read_current_processor_index() == index);
+	ASSERT(read_current_thread() == *__idle_thread[ index ]);
+
+
+	//
+	// Enable the local APIC before enabling interrupts.  Device interrupts
+	// are only routed to the bootstrap processor, so the only interrupts
+	// taken here are from the local timer
+	//
+	local_apic->enable(INTERRUPT_VECTOR_LOCAL_SPURIOUS);
+	initialize_processor();
+
+
+	//
+	// Let the bootstrap processor know that this processor is alive, then
+	// start taking clock ticks.  From here, the I/O Manager may dispatch
+	// threads on this processor
+	//
+	TRACE(ALL, "Processor %d (APIC id %d) started\n", index,
+		local_apic->read_id());
+	processor_count = index + 1;
+	local_apic->start_timer(INTERRUPT_VECTOR_LOCAL_TIMER);
 
-		default:
-			ASSERT(FALSE);
-			break;
-		}
 
-	return;
+	//
+	// Run the idle thread; this never returns
+	//
+	run_thread();
 	}
 
 
@@ -452,12 +1200,48 @@ initialize_processor()
 			: "i"( ~(CR0_CD | CR0_NW) )
 			: "eax");
 
-	//@here, maybe also set CR0.MP for FP support; see Intel docs, chapter
-	//@on cpu init, "x87 FPU init"
+	// Enable the FPU, with native error reporting.  Set CR0.TS, so that the
+	// first FPU instruction of each thread traps, and the FPU state is only
+	// switched lazily; see load_fpu_context()
+	__asm(	"movl	%%cr0, %%eax;"
+			"andl	%0,    %%eax;"
+			"orl	%1,    %%eax;"
+			"movl	%%eax, %%cr0;"
+			:
+			: "i"( ~CR0_EM ),
+			  "i"(CR0_MP | CR0_NE | CR0_TS)
+			: "eax");
+
+	// Enable FXSAVE/FXRSTOR, if supported.  This also enables the SSE
+	// instructions, if any; SIMD exceptions remain disabled
+	if (processor_type >= PROCESSOR_TYPE_FXSR)
+		{
+		__asm(	"movl	%%cr4, %%eax;"
+				"orl	%0,    %%eax;"
+				"movl	%%eax, %%cr4;"
+				:
+				: "i"(CR4_OSFXSR)
+				: "eax");
+		}
 
 	//@dump/validate MTRR's?
 	//@enable RDTSC from ring3 in CR4?
 
+	// Configure the SYSENTER/SYSEXIT fast system-call entry, if supported.
+	// SYSENTER loads ESP with the base of the TSS for this processor; the
+	// entry stub then switches to the kernel stack of the current thread via
+	// TSS.ESP0, which changes on each context switch.  SYSEXIT derives the
+	// user selectors from the kernel code selector, which relies on the
+	// layout of the GDT (see selector.h).  User code learns whether this
+	// path is available via the processor type in the kernel statistics
+	if (processor_type >= PROCESSOR_TYPE_FAST_SYSTEM_CALL)
+		{
+		write_msr(MSR_SYSENTER_CS, GDT_KERNEL_CODE_SELECTOR);
+		write_msr(MSR_SYSENTER_ESP, KERNEL_TSS_BASE +
+			read_current_processor_index() * KERNEL_TSS_SIZE);
+		write_msr(MSR_SYSENTER_EIP, uintptr_t(system_call_fast_entry));
+		}
+
 	// Enable interrupts; this is necessary before making any timing
 	// calculations since the PIT provides the clock reference.  All other
 	// kernel system must be ready to handle device interrupts here.
@@ -485,6 +1269,78 @@ initialize_thread_context(thread_cr thread)
 	}
 
 
+///
+/// Invalidates the cached translation, if any, for a single page on every
+/// processor.  The local TLB entry is flushed immediately.  On SMP hosts,
+/// the other processors are interrupted to flush their own entries; and
+/// this only returns once all of them have done so, after which the old
+/// frame behind the page may be safely reused.
+///
+/// While waiting, the other processors may have interrupts disabled, so
+/// they also answer shootdown requests while spinning on a lock.  See
+/// spinlock_c::acquire()
+///
+/// @param page -- an address within the victim page
+///
+void_t x86_hardware_abstraction_layer_c::
+invalidate_tlb(const void_tp page)
+	{
+	uint32_t	index;
+	uintptr_t	interrupt_state;
+	uint32_t	value;
+
+
+	invalidate_local_tlb(page);
+
+	if (processor_count > 1)
+		{
+		interrupt_state	= disable_interrupts();
+		index			= read_current_processor_index();
+
+
+		//
+		// Claim the shootdown request.  Another processor may be waiting
+		// on this one to answer its own request meanwhile
+		//
+		for(;;)
+			{
+			value = TRUE;
+			__asm volatile(	"xchgl %0, %1"
+							: "+r"(value), "+m"(tlb_shootdown_busy)
+							:
+							: "memory"	);
+			if (!value)
+				break;
+
+			service_tlb_shootdown();
+			pause_processor();
+			}
+
+
+		//
+		// Interrupt all of the other processors; and wait until each one has
+		// flushed its own translation
+		//
+		tlb_shootdown_page = uintptr_t(page);
+		for (uint32_t i = 0; i < processor_count; i++)
+			{ tlb_shootdown_request[i] = (i != index); }
+
+		local_apic->broadcast_interrupt(INTERRUPT_VECTOR_LOCAL_TLB_SHOOTDOWN);
+
+		for (uint32_t i = 0; i < processor_count; i++)
+			{
+			while(tlb_shootdown_request[i])
+				{ pause_processor(); }
+			}
+
+		tlb_shootdown_busy = FALSE;
+		enable_interrupts(interrupt_state);
+		}
+
+	return;
+	}
+
+
 ///
 /// Reload the current selectors for user-mode execution + jump out to the
 /// specified user address.  Execution of the current thread continues at
@@ -544,6 +1400,96 @@ jump_to_user(	void_tp start_address,
 	}
 
 
+///
+/// Handler for the device-not-available (#NM) trap.  Each context switch sets
+/// CR0.TS unless the new thread already owns the FPU, so this only executes
+/// when the current thread actually uses the FPU after a switch.  Save the
+/// state of the previous owner, if any; and restore the state of the current
+/// thread, or initialize a clean FPU on its first use.  Threads that never
+/// touch the FPU, such as most drivers + servers, never pay for any of this.
+///
+/// Assumes interrupts are disabled
+///
+/// @param interrupt -- the #NM trap itself
+///
+void_t x86_hardware_abstraction_layer_c::
+load_fpu_context(interrupt_cr interrupt)
+	{
+	thread_cr	current_thread	= read_current_thread();
+	uint32_t	index			= read_current_processor_index();
+	thread_cp	owner			= fpu_owner[ index ];
+	bool_t		first_use		= FALSE;
+
+	//
+	// First use of the FPU by this thread.  Allocate its save area before
+	// disturbing the state of the previous owner.  Without the save area,
+	// the thread cannot use the FPU at all; CR0.TS remains set
+	//
+	if (owner != &current_thread && !current_thread.fpu_context)
+		{
+		current_thread.fpu_context = new(FPU_CONTEXT_ALIGN)
+			uint8_t[ FPU_CONTEXT_SIZE ];
+		if (!current_thread.fpu_context)
+			{
+			fault_current_thread(interrupt);
+			return;
+			}
+
+		first_use = TRUE;
+		}
+
+	clear_task_switched();
+
+	if (owner != &current_thread)
+		{
+		if (owner)
+			{ save_fpu_context(*owner); }
+
+		if (first_use)
+			{ initialize_fpu_context(); }
+		else
+			{ restore_fpu_context(current_thread); }
+
+		fpu_owner[ index ] = &current_thread;
+		}
+
+	return;
+	}
+
+
+///
+/// Loads the I/O port bitmap of the current thread into the TSS of the
+/// current processor, if it is not already resident.  switch_thread() never
+/// copies the bitmap; so the first port I/O instruction after a switch to a
+/// different driver faults (#GP), and the fault handler loads the bitmap
+/// here.  The thread then retries the instruction.
+///
+/// Assumes interrupts are disabled
+///
+/// @param thread -- the current (faulting) thread
+///
+/// @return TRUE if the bitmap was loaded, and the faulting instruction
+/// should be retried; FALSE if the fault is genuine, because the thread has
+/// no bitmap, or its bitmap was already resident
+///
+bool_t x86_hardware_abstraction_layer_c::
+load_io_port_map(thread_cr thread)
+	{
+	uint32_t		index	= read_current_processor_index();
+	io_port_map_cp	map		= thread.address_space.io_port_map;
+	bool_t			loaded	= FALSE;
+
+	if (map && map != resident_io_port_map[ index ])
+		{
+		::reload_io_port_map(uint8_tp(map));
+		resident_io_port_map[ index ] = map;
+		loaded = TRUE;
+		}
+
+	return(loaded);
+	}
+
+
 ///
 /// Mask the specified IRQ line
 ///
@@ -556,6 +1502,25 @@ mask_interrupt(uintptr_t irq)
 	}
 
 
+///
+/// Returns the index of the current processor.  Each processor loads its own
+/// TSS selector, so the task register identifies the processor.  Before the
+/// TSS is loaded, this is always the bootstrap processor.  No side effects.
+///
+uint32_t x86_hardware_abstraction_layer_c::
+read_current_processor_index()
+	{
+	uint32_t	index = PROCESSOR_INDEX_BOOT;
+	uint16_t	selector;
+
+	__asm volatile("str %0" : "=r"(selector));
+	if (selector >= GDT_TSS_SELECTOR)
+		{ index = (selector - GDT_TSS_SELECTOR) >> 3; }
+
+	return(index);
+	}
+
+
 ///
 /// Returns a reference to the currently-executing thread.  No side effects.
 ///
@@ -566,15 +1531,45 @@ read_current_thread()
 	uint32_t	esp;
 
 	// Use the current stack pointer to locate the current thread; this assumes
-	// the current thread_c context is nicely aligned at the far-end of the
-	// current stack.  This assumes 32b pointers
+	// the current thread_c context sits at a fixed offset in the execution
+	// block, just beyond the base of the current stack.  This assumes 32b
+	// pointers
 	__asm("movl %%esp, %0" : "=r"(esp));
-	current_thread = thread_cp(esp & THREAD_EXECUTION_BLOCK_ALIGNMENT_MASK);
+	current_thread = thread_cp((esp & THREAD_EXECUTION_BLOCK_ALIGNMENT_MASK) +
+		THREAD_CONTEXT_OFFSET);
 
 	return(*current_thread);
 	}
 
 
+///
+/// Returns the total time that all processors have spent halted, in clock
+/// ticks.  This is only a statistic: the count of another processor may be
+/// read while it changes.  No side effects.
+///
+uint64_t x86_hardware_abstraction_layer_c::
+read_idle_tick_count()
+	{
+	uint64_t tick_count = 0;
+
+	for (uint32_t i = 0; i < processor_count; i++)
+		{ tick_count += divide64(idle_cycles[i], cycles_per_tick); }
+
+	return(tick_count);
+	}
+
+
+///
+/// Returns the number of processors currently executing.  This is always at
+/// least one (the bootstrap processor).  No side effects.
+///
+uint32_t x86_hardware_abstraction_layer_c::
+read_processor_count()
+	{
+	return(processor_count);
+	}
+
+
 ///
 /// Read the last faulting virtual address.  No side effects.
 ///
@@ -625,16 +1620,23 @@ read_timestamp32()
 void_t x86_hardware_abstraction_layer_c::
 reload_io_port_map(thread_cr owner_thread)
 	{
-	thread_cr current_thread = read_current_thread();
+	thread_cr		current_thread	= read_current_thread();
+	uintptr_t		interrupt_state;
+	io_port_map_cp	map				= owner_thread.address_space.io_port_map;
 
-	ASSERT(owner_thread.address_space.io_port_map);
+	ASSERT(map);
 
-	if (current_thread == owner_thread)
+	interrupt_state = disable_interrupts();
+
+	// Any copies of the bitmap cached in other TSS's are now stale
+	discard_io_port_map(*map);
+
+	if (&current_thread.address_space == &owner_thread.address_space)
 		{
 		// The I/O port bitmap of the current (calling) thread has changed, so
 		// automatically reload the TSS contents
-		::reload_io_port_map(
-			uint8_tp(current_thread.address_space.io_port_map));
+		::reload_io_port_map(uint8_tp(map));
+		resident_io_port_map[ read_current_processor_index() ] = map;
 		}
 
 	// else, the current thread is manipulating the port map on some other
@@ -643,6 +1645,8 @@ reload_io_port_map(thread_cr owner_thread)
 	// it will continue executing with the (old) I/O bitmap until it loses the
 	// CPU
 
+	enable_interrupts(interrupt_state);
+
 	return;
 	}
 
@@ -668,6 +1672,13 @@ run_thread()
 		thread.id);
 
 
+	//
+	// This thread is starting in place of some other thread, which has now
+	// released this processor
+	//
+	switch_thread_complete();
+
+
 	//
 	// The CPU disabled interrupts while handling the clock tick that
 	// launched this thread; so re-enable them here before starting
@@ -702,6 +1713,26 @@ run_thread()
 	}
 
 
+///
+/// Answers the pending TLB shootdown request, if any, from another processor
+/// by flushing the victim translation on the local processor.  Safe to call
+/// at any time; and cheap when there is no request.  See invalidate_tlb()
+///
+void_t x86_hardware_abstraction_layer_c::
+service_tlb_shootdown()
+	{
+	uint32_t index = read_current_processor_index();
+
+	if (tlb_shootdown_request[index])
+		{
+		invalidate_local_tlb(void_tp(tlb_shootdown_page));
+		tlb_shootdown_request[index] = FALSE;
+		}
+
+	return;
+	}
+
+
 ///
 /// Generates an explicit INTERRUPT_VECTOR_YIELD interrupt.
 ///
@@ -721,11 +1752,260 @@ soft_yield()
 
 
 ///
-/// Halts/idles the processor until an interrupt occurs.
+/// Starts a single application processor, via the INIT/STARTUP IPI sequence.
+/// Allocates the idle thread for the new processor.  Assumes the startup
+/// trampoline is already in place.  Only one processor is started at a time.
+///
+/// @param apic_id -- APIC id of the new processor
+///
+/// @return STATUS_SUCCESS if the processor is running; non-zero otherwise
+///
+status_t x86_hardware_abstraction_layer_c::
+start_application_processor(uint32_t apic_id)
+	{
+	uint32_t	index = processor_count;
+	thread_cp	idle_thread;
+	status_t	status = STATUS_IO_ERROR;
+
+
+	do
+		{
+		ASSERT(index < PROCESSOR_COUNT_MAX);
+		idle_thread = __thread_manager->create_idle_thread(index);
+		if (!idle_thread)
+			{
+			status = STATUS_INSUFFICIENT_MEMORY;
+			break;
+			}
+
+
+		//
+		// The new processor starts executing on the stack of its idle thread,
+		// in the kernel address space
+		//
+		ap_startup_index			= index;
+		ap_startup_page_directory	=
+			uint32_t(idle_thread->address_space.page_directory);
+		ap_startup_stack			=
+			(uintptr_t(idle_thread) & THREAD_EXECUTION_BLOCK_ALIGNMENT_MASK) +
+			THREAD_CONTEXT_OFFSET;
+
+
+		//
+		// Reset the processor; then wake it at the trampoline.  The second
+		// STARTUP IPI is only necessary if the processor misses the first
+		//
+		if (local_apic->send_init(apic_id) != STATUS_SUCCESS)
+			break;
+		i8254PIT->delay(AP_INIT_DELAY);
+
+		for (uint32_t i = 0; i < AP_STARTUP_ATTEMPTS; i++)
+			{
+			if (local_apic->send_startup(apic_id, SMP_TRAMPOLINE_VECTOR) !=
+				STATUS_SUCCESS)
+				break;
+
+			for (uint32_t j = 0; j < AP_STARTUP_TIMEOUT; j++)
+				{
+				if (processor_count > index)
+					break;
+				i8254PIT->delay(AP_STARTUP_POLL_DELAY);
+				}
+
+			if (processor_count > index)
+				{
+				status = STATUS_SUCCESS;
+				break;
+				}
+			}
+
+		} while(0);
+
+
+	return(status);
+	}
+
+
+///
+/// Discovers + starts all of the application processors, if any.  The
+/// bootstrap processor is already running.  This should only execute once,
+/// on the bootstrap processor, after all of the kernel subsystems are ready
+/// to schedule threads on other processors.
+///
+/// If the host has no MP configuration table, or the local APIC is not
+/// accessible via the kernel APIC page, then the kernel simply continues with
+/// only the bootstrap processor.
+///
+void_t x86_hardware_abstraction_layer_c::
+start_application_processors()
+	{
+	uintptr_t					apic_base;
+	uint8_tp					entry;
+	mp_configuration_table_sp	table;
+
+
+	do
+		{
+		//
+		// Locate the list of processors built by the BIOS
+		//
+		table = find_mp_configuration_table();
+		if (!table)
+			break;
+
+
+		//
+		// Locate the local APIC.  Its registers must fall within the
+		// kernel APIC page
+		//
+		apic_base =
+			read_msr(LOCAL_APIC_BASE_MSR) & LOCAL_APIC_BASE_MSR_ADDRESS_MASK;
+		if (apic_base < APIC_PHYSICAL_BASE ||
+			apic_base >= APIC_PHYSICAL_BASE + SUPER_PAGE_SIZE)
+			{
+			printf("Local APIC at unexpected address %p\n", apic_base);
+			break;
+			}
+
+		local_apic = new local_apic_c(KERNEL_APIC_PAGE_BASE +
+			(apic_base - APIC_PHYSICAL_BASE));
+		if (!local_apic)
+			break;
+
+		local_apic->enable(INTERRUPT_VECTOR_LOCAL_SPURIOUS);
+		local_apic->calibrate_timer(*i8254PIT);
+
+
+		//
+		// Install the trampoline where the application processors can find
+		// it in real mode
+		//
+		memcpy(	void_tp(SMP_TRAMPOLINE_BASE),
+				ap_trampoline_start,
+				ap_trampoline_end - ap_trampoline_start);
+
+
+		//
+		// Once other processors are running, a thread might resume on a
+		// different processor, so its FPU state must not linger in the
+		// registers of this one.  See switch_thread()
+		//
+		uintptr_t interrupt_state = disable_interrupts();
+		fpu_lazy_save = FALSE;
+		flush_fpu_context();
+		enable_interrupts(interrupt_state);
+
+
+		//
+		// Start each of the enabled application processors, in table order.
+		// Stop at the first failure, since the idle thread for that index is
+		// already committed
+		//
+		entry = uint8_tp(table) + sizeof(*table);
+		for (uint32_t i = 0; i < table->entry_count; i++)
+			{
+			if (*entry != MP_ENTRY_TYPE_PROCESSOR)
+				{
+				entry += MP_ENTRY_SIZE_OTHER;
+				continue;
+				}
+
+			mp_processor_entry_sp processor = mp_processor_entry_sp(entry);
+			entry += MP_ENTRY_SIZE_PROCESSOR;
+
+			if (!(processor->flags & MP_PROCESSOR_FLAG_ENABLED) ||
+				(processor->flags & MP_PROCESSOR_FLAG_BOOT))
+				continue;
+
+			if (processor_count >= PROCESSOR_COUNT_MAX)
+				{
+				printf("Ignoring processor (APIC id %d)\n",
+					processor->local_apic_id);
+				continue;
+				}
+
+			if (start_application_processor(processor->local_apic_id) !=
+				STATUS_SUCCESS)
+				{
+				printf("Unable to start processor (APIC id %d)\n",
+					processor->local_apic_id);
+				break;
+				}
+			}
+
+		} while(0);
+
+
+	printf("Running on %d processor(s)\n", processor_count);
+
+	return;
+	}
+
+
+///
+/// Restarts the periodic clock tick on the current processor, if its idle
+/// thread stopped it.  Called whenever a thread other than the idle thread
+/// is dispatched.  See stop_clock_tick().
+///
+void_t x86_hardware_abstraction_layer_c::
+start_clock_tick()
+	{
+	uint32_t index = read_current_processor_index();
+
+	if (clock_tick_stopped[index])
+		{
+		if (index == PROCESSOR_INDEX_BOOT)
+			{ i8254PIT->start_clock(); }
+		else
+			{ local_apic->start_timer(INTERRUPT_VECTOR_LOCAL_TIMER); }
+
+		clock_tick_stopped[index] = FALSE;
+		}
+
+	return;
+	}
+
+
+///
+/// Stops the periodic clock tick on the current processor, which is about to
+/// idle.  There are no timed waits in the kernel, so the idle processor has
+/// no deadline; any new work arrives via some other interrupt instead.  The
+/// bootstrap processor thus stops its clock entirely, until the next device
+/// interrupt.  The application processors receive no device interrupts, so
+/// instead arm a single, distant tick, to look for work queued by other
+/// processors.  Called whenever the idle thread is dispatched.
+///
+void_t x86_hardware_abstraction_layer_c::
+stop_clock_tick()
+	{
+	uint32_t index = read_current_processor_index();
+
+	//@a wakeup IPI would let the application processors stop their clocks
+	if (index != PROCESSOR_INDEX_BOOT)
+		{
+		local_apic->start_one_shot_timer(INTERRUPT_VECTOR_LOCAL_TIMER,
+			AP_IDLE_TICK_COUNT);
+		}
+	else if (!clock_tick_stopped[index])
+		{ i8254PIT->stop_clock(); }
+
+	clock_tick_stopped[index] = TRUE;
+
+	return;
+	}
+
+
+///
+/// Halts/idles the processor until an interrupt occurs.  While the idle
+/// thread executes, the clock tick may be stopped, so the delay here is
+/// unbounded; see stop_clock_tick().  The time spent halted is accumulated
+/// as idle time.
 ///
 void_t x86_hardware_abstraction_layer_c::
 suspend_processor()
 	{
+	uint64_t	start;
+
 #ifdef DEBUG
 	uint32_t	eflags;
 
@@ -737,10 +2017,13 @@ suspend_processor()
 	ASSERT(eflags & EFLAGS_IF);
 #endif
 
-	// Suspend the processor until an interrupt occurs; the longest
-	// possible delay here will be one full clock tick since the PIT
-	// is guaranteed to interrupt within that time
+	// Suspend the processor until an interrupt occurs; and account for the
+	// time spent here.  If the interrupt switches threads, then the caller
+	// may resume on some other processor, which is charged instead
+	start = read_timestamp64();
 	__asm("hlt");
+	idle_cycles[ read_current_processor_index() ] +=
+		read_timestamp64() - start;
 
 	return;
 	}
@@ -765,20 +2048,53 @@ suspend_processor()
 void_t x86_hardware_abstraction_layer_c::
 switch_thread(thread_cr new_thread)
 	{
-	thread_cr old_thread = read_current_thread();
+	uint32_t		index		= read_current_processor_index();
+	io_port_map_cp	map			= new_thread.address_space.io_port_map;
+	thread_cr		old_thread	= read_current_thread();
 
 	ASSERT(old_thread != new_thread);
 	ASSERT(new_thread.address_space.page_directory);
 
 
+	//
+	// Remember the old thread, so that the new thread can release it once
+	// the old thread is no longer using this processor (its stack, etc)
+	//
+	previous_thread[ index ] = &old_thread;
+
+
+	//
+	// Lazy FPU switching.  If the new thread already owns the FPU here,
+	// then it resumes with its FPU state intact; otherwise, its first FPU
+	// instruction traps.  Once other processors are running, save the state
+	// of the old thread now, in case it resumes elsewhere
+	//
+	if (!fpu_lazy_save && fpu_owner[ index ] == &old_thread)
+		{ flush_fpu_context(); }
+
+	if (fpu_owner[ index ] == &new_thread)
+		{ clear_task_switched(); }
+	else
+		{ set_task_switched(); }
+
+
 	//
 	// Switch to the new thread; this does not return until the I/O Manager
-	// allocates the processor to the current/old thread again
+	// allocates the processor to the current/old thread again.  The I/O
+	// bitmap of the new thread is never copied here: it is only marked valid
+	// if it is still resident in this TSS; and otherwise loaded on demand
 	//
 	::switch_thread(&old_thread.stack_top,
 					new_thread.stack_top,
 					new_thread.address_space.page_directory,
-					uint8_tp(new_thread.address_space.io_port_map));
+					(map && map == resident_io_port_map[ index ]));
+
+
+	//
+	// Here, the old thread is executing again, perhaps on a different
+	// processor.  Release whichever thread last ran on this processor
+	//
+	switch_thread_complete();
 
 
 	//
@@ -797,6 +2113,30 @@ switch_thread(thread_cr new_thread)
 	}
 
 
+///
+/// Finishes a context switch.  Invoked in the context of the new thread, once
+/// the previous thread has completely released the current processor.  The
+/// previous thread may now execute on any other processor; or be destroyed,
+/// if it was exiting.
+///
+/// Assumes interrupts are still disabled on the local processor.
+///
+void_t x86_hardware_abstraction_layer_c::
+switch_thread_complete()
+	{
+	uint32_t	index	= read_current_processor_index();
+	thread_cp	thread	= previous_thread[ index ];
+
+	if (thread)
+		{
+		thread->processor			= PROCESSOR_INDEX_INVALID;
+		previous_thread[ index ]	= NULL;
+		}
+
+	return;
+	}
+
+
 ///
 /// Halts the processor, presumably in response to some fatal system
 /// error or shutdown.  Never returns.
@@ -8,6 +8,7 @@
 #include "counted_object.hpp"
 #include "dx/address_space_id.h"
 #include "dx/hal/physical_address.h"
+#include "dx/message.h"
 #include "dx/status.h"
 #include "dx/types.h"
 #include "hal/address_space_layout.h"
@@ -22,10 +23,21 @@
 
 ///
 /// Maximum number of pages that may be added via a single EXPAND_ADDRESS_SPACE
-/// system call
+/// system call.  Requests that are aligned on superpage boundaries are
+/// instead mapped with 4MB pages, up to a separate limit
 ///
 const
-uintptr_t	EXPAND_ADDRESS_SPACE_PAGE_COUNT		= 96;
+uintptr_t	EXPAND_ADDRESS_SPACE_PAGE_COUNT			= 96,
+			EXPAND_ADDRESS_SPACE_SUPER_PAGE_COUNT	= 16;
+
+
+///
+/// Maximum number of pages that may be reserved (but not yet allocated) via
+/// a single EXPAND_ADDRESS_SPACE system call.  See
+/// EXPAND_ADDRESS_SPACE_RESERVE
+///
+const
+uintptr_t	EXPAND_ADDRESS_SPACE_RESERVE_PAGE_COUNT	= 16384;
 
 
 
@@ -64,16 +76,40 @@ class   address_space_c:
 		memory_pool_cp			large_payload_pool[ LARGE_PAYLOAD_POOL_COUNT ];
 		interrupt_spinlock_c	lock;
 		memory_pool_c			medium_payload_pool;
+		memory_pool_c			message_ring_pool;
 		page_directory_cp		page_directory;
 		shared_frame_table_c	shared_frame_table;
 
 
+		status_t
+			commit_zero_frame(	page_table_entry_cr	entry,
+								const void_tp		page);
+
+		status_t
+			copy_fragment(	const message_fragment_s*	fragment,
+							uint32_t					fragment_count,
+							size_t						position,
+							uintptr_t					offset,
+							size_t						size,
+							shared_frame_cpp			shared_frame);
+
+		status_t
+			expand_super_pages(	const void_tp	first_new_page,
+								uint32_t		super_page_count);
+
+		status_t
+			reserve_frame(	const void_tp	first_new_page,
+							uint32_t		page_count);
+
 		shared_frame_cp
 			share_frame(const void_tp address);
 
 		void_t
 			unshare_frame(const void_tp address);
 
+		status_t
+			zero_super_page(physical_address_t super_page);
+
 
 	public:
 		const address_space_id_t	id;
@@ -86,7 +122,17 @@ class   address_space_c:
 
 
 		bool_t
-			copy_on_write(const void_tp address);
+			copy_on_write(	const void_tp	address,
+							bool_tp			copied);
+
+		status_t
+			copy_payload(	address_space_cr	target,
+							void_tp				target_address,
+							const void_tp		data,
+							size_t				size);
+
+		bool_t
+			demand_zero(const void_tp address);
 
 
 		//
@@ -103,11 +149,18 @@ class   address_space_c:
 							shared_frame_list_cr	frame,
 							uint32_t				flags);
 
+		status_t
+			commit_payload_frame(	void_tp					page,
+									shared_frame_list_cr	frame);
+
 		void_t
 			decommit_frame(	void_tp				page,
 							uint32_t			page_count,
 							physical_address_tp	frame);
 
+		physical_address_t
+			find_frame(const void_tp address);
+
 
 		//
 		// Expansion + contraction
@@ -123,6 +176,17 @@ class   address_space_c:
 		//
 		// Share + revoke physical frames with/from other address spaces
 		//
+		status_t
+			donate_frame(	const void_tp			address,
+							size_t					size,
+							shared_frame_list_cr	frame);
+
+		status_t
+			gather_frame(	const message_fragment_s*	fragment,
+							uint32_t					fragment_count,
+							uintptr_t					offset,
+							shared_frame_list_cr		frame);
+
 		status_t
 			share_frame(const void_tp			address,
 						size_t					size,
@@ -151,6 +215,15 @@ class   address_space_c:
 			free_medium_payload_block(const void_tp block);
 
 
+		//
+		// Allocate + release pages for message rings
+		//
+		void_tp
+			allocate_message_ring_page();
+		status_t
+			free_message_ring_page(const void_tp page);
+
+
 		//
 		// I/O port management
 		//
@@ -5,6 +5,7 @@
 #ifndef _DEVICE_PROXY_HPP
 #define _DEVICE_PROXY_HPP
 
+#include "dx/kernel_stats.h"
 #include "dx/system_call.h"
 #include "dx/types.h"
 #include "hal/interrupt_vectors.h"
@@ -39,9 +40,23 @@ class   device_proxy_c
 		interrupt_handler_list_c interrupt_handler[INTERRUPT_VECTOR_PIC_COUNT];
 		interrupt_spinlock_c	 lock;
 
+		// Lines masked on delivery, until one of their handlers acknowledges
+		// the interrupt.  Protected by the lock
+		bool_t		unacknowledged[INTERRUPT_VECTOR_PIC_COUNT];
+
 		//@bitmap of available I/O ports
 
 
+		// Statistics, per IRQ line
+		uint32_t	interrupt_count[INTERRUPT_VECTOR_PIC_COUNT];
+		uint32_t	interrupt_latency[INTERRUPT_VECTOR_PIC_COUNT];
+		uint32_t	interrupt_latency_max[INTERRUPT_VECTOR_PIC_COUNT];
+		uint32_t	raised_timestamp[INTERRUPT_VECTOR_PIC_COUNT];
+
+
+		status_t
+			acknowledge_interrupt(volatile syscall_data_s* syscall);
+
 		status_t
 			map_device(volatile syscall_data_s* syscall);
 
@@ -92,14 +107,19 @@ class   device_proxy_c
 	protected:
 
 	public:
-		device_proxy_c()
-			{ return; }
+		device_proxy_c();
 		~device_proxy_c()
 			{ return; }
 
 		static
 		void_t
 			handle_interrupt(interrupt_cr interrupt);
+
+		void_t
+			read_stats(volatile kernel_stats_s& kernel_stats);
+
+		void_t
+			record_interrupt_latency(uint32_t signal);
 	};
 
 
@@ -4,6 +4,8 @@
 // A simple driver for the Intel 8254 Programmable Interval Timer (PIT).
 // The PIT triggers IRQ0 at a constant rate, allowing the OS to perform
 // internal maintenance, thread scheduling, etc, at regular intervals.
+// The clock may be stopped while there is no work to schedule, and
+// restarted later; see hal::stop_clock_tick().
 //
 // Although the PIT actually supports three different counters, this
 // driver really only manages counter 0 (the system clock).  The other
@@ -84,7 +86,27 @@ const
 uint16_t	i8254_COUNTER0_PORT_ADDRESS			= 0x40,
 			i8254_COUNTER1_PORT_ADDRESS			= 0x41,
 			i8254_COUNTER2_PORT_ADDRESS			= 0x42,
-			i8254_CONTROL_PORT_ADDRESS			= 0x43;
+			i8254_CONTROL_PORT_ADDRESS			= 0x43,
+			i8254_GATE_PORT_ADDRESS				= 0x61;	// System port B
+
+
+//
+// Bit definitions for the gate/status port.  Counter 2 is gated by software
+// (rather than the system clock), so it can be used for short busy-waits
+// without disturbing the clock interrupt on counter 0
+//
+const
+uint8_t		i8254_GATE_COUNTER2_ENABLE			= 0x01,
+			i8254_GATE_SPEAKER_ENABLE			= 0x02,
+			i8254_GATE_COUNTER2_OUTPUT			= 0x20;
+
+
+//
+// Longest delay possible with a single countdown on counter 2, in
+// microseconds.  The 16b counter wraps at approximately 54.9 ms
+//
+const
+uint32_t	i8254_DELAY_MAX						= 50000;	// 50 ms
 
 
 //
@@ -103,6 +125,14 @@ class   i8254_programmable_interval_timer_c
 	public:
 		i8254_programmable_interval_timer_c();
 		~i8254_programmable_interval_timer_c();
+
+		void_t
+			delay(uint32_t microseconds);
+
+		void_t
+			start_clock();
+		void_t
+			stop_clock();
 	};
 
 
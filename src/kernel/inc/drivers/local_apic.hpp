@@ -0,0 +1,137 @@
+//
+// local_apic.hpp
+//
+// A basic driver for the local Advanced Programmable Interrupt Controller
+// (APIC) on each processor.  Only the features required for multiprocessor
+// support are used here: starting the application processors, the local
+// timer and end-of-interrupt.  Device interrupts are still routed through the
+// legacy PIC, to the bootstrap processor.
+//
+// Every processor sees its own local APIC at the same address, so a single
+// instance of this driver serves all processors; each method only touches the
+// APIC of the current/calling processor.
+//
+
+#ifndef _LOCAL_APIC_HPP
+#define _LOCAL_APIC_HPP
+
+#include "drivers/i8254pit.hpp"
+#include "dx/status.h"
+#include "dx/types.h"
+#include "hal/memory_mapped_register.hpp"
+
+
+
+//
+// Model-specific register that holds the physical base address of the
+// local APIC
+//
+const
+uint32_t	LOCAL_APIC_BASE_MSR						= 0x1B;
+
+const
+uint32_t	LOCAL_APIC_BASE_MSR_BOOT_PROCESSOR		= 0x00000100,
+			LOCAL_APIC_BASE_MSR_ENABLE				= 0x00000800,
+			LOCAL_APIC_BASE_MSR_ADDRESS_MASK		= 0xFFFFF000;
+
+
+//
+// Offsets to the various APIC registers, relative to the APIC base address
+//
+const
+uint32_t	LOCAL_APIC_ID_OFFSET					= 0x020,
+			LOCAL_APIC_EOI_OFFSET					= 0x0B0,
+			LOCAL_APIC_SPURIOUS_OFFSET				= 0x0F0,
+			LOCAL_APIC_ICR_LOW_OFFSET				= 0x300,
+			LOCAL_APIC_ICR_HIGH_OFFSET				= 0x310,
+			LOCAL_APIC_TIMER_OFFSET					= 0x320,
+			LOCAL_APIC_TIMER_INITIAL_COUNT_OFFSET	= 0x380,
+			LOCAL_APIC_TIMER_CURRENT_COUNT_OFFSET	= 0x390,
+			LOCAL_APIC_TIMER_DIVIDE_OFFSET			= 0x3E0;
+
+
+//
+// Bit definitions for the various APIC registers
+//
+const
+uint32_t	LOCAL_APIC_ID_SHIFT						= 24,
+
+			LOCAL_APIC_SPURIOUS_ENABLE				= 0x00000100,
+
+			LOCAL_APIC_ICR_DELIVERY_INIT			= 0x00000500,
+			LOCAL_APIC_ICR_DELIVERY_STARTUP			= 0x00000600,
+			LOCAL_APIC_ICR_DELIVERY_PENDING			= 0x00001000,
+			LOCAL_APIC_ICR_LEVEL_ASSERT				= 0x00004000,
+			LOCAL_APIC_ICR_TRIGGER_LEVEL			= 0x00008000,
+			LOCAL_APIC_ICR_DESTINATION_OTHERS		= 0x000C0000,
+			LOCAL_APIC_ICR_DESTINATION_SHIFT		= 24,
+
+			LOCAL_APIC_TIMER_MASKED					= 0x00010000,
+			LOCAL_APIC_TIMER_PERIODIC				= 0x00020000,
+			LOCAL_APIC_TIMER_DIVIDE_BY_16			= 0x00000003;
+
+
+//
+// Interval used for calibrating the local timer against the PIT, in
+// microseconds
+//
+const
+uint32_t	LOCAL_APIC_CALIBRATION_INTERVAL			= 10000;	// 10 ms
+
+
+//
+// Upper bound on polling for IPI delivery.  The APIC normally accepts each
+// IPI within a few microseconds
+//
+const
+uint32_t	LOCAL_APIC_DELIVERY_TIMEOUT				= 100000;
+
+
+
+//
+// The actual APIC driver
+//
+class   local_apic_c;
+typedef local_apic_c *	local_apic_cp;
+typedef local_apic_cp *	local_apic_cpp;
+typedef local_apic_c &	local_apic_cr;
+class   local_apic_c
+	{
+	private:
+		uintptr_t	base_address;	// Virtual address of APIC registers
+		uint32_t	timer_count;	// Initial count for the periodic timer
+
+		status_t
+			send_ipi(	uint32_t	apic_id,
+						uint32_t	command);
+
+	protected:
+
+	public:
+		local_apic_c(uintptr_t apic_base_address);
+		~local_apic_c();
+
+		void_t
+			acknowledge_interrupt();
+		status_t
+			broadcast_interrupt(uint8_t vector);
+		void_t
+			calibrate_timer(i8254_programmable_interval_timer_cr pit);
+		void_t
+			enable(uint8_t spurious_vector);
+		uint32_t
+			read_id();
+		status_t
+			send_init(uint32_t apic_id);
+		status_t
+			send_startup(	uint32_t	apic_id,
+							uint8_t		vector);
+		void_t
+			start_one_shot_timer(	uint8_t		vector,
+									uint32_t	tick_count);
+		void_t
+			start_timer(uint8_t vector);
+	};
+
+
+#endif
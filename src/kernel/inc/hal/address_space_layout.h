@@ -8,6 +8,7 @@
 
 #include "dx/user_space_layout.h"
 #include "dx/hal/memory.h"
+#include "hal/processor.h"
 #include "thread_layout.h"
 
 
@@ -23,7 +24,9 @@
 //							Non-paged.  Identity-mapped with a single
 //							superpage, so it (physically) contains/spans the
 //							BIOS data area, the Multiboot structure, the ISA
-//							hole and the VGA buffer.
+//							hole and the VGA buffer.  On SMP hosts, the
+//							startup trampoline for the application
+//							processors is copied to 0x1000.
 //
 // 0x00400000 - 0x007FFFFF:	Remainder of ramdisk.  Kernel only.  Non-paged.
 //							Identity-mapped with a single superpage
@@ -32,6 +35,23 @@
 //							GDT, IDT + TSS.  Kernel runtime heap.  Kernel only.
 //							Non-paged.  Identity-mapped with a single superpage
 //
+// 0x00C00000 - 0x00FFFFFF:	"Kernel APIC page".  Maps the physical range
+//							0xFEC00000 - 0xFEFFFFFF, which contains the I/O
+//							APIC and the local APIC.  Kernel only.  Non-paged.
+//							Uncached.  Mapped with a single superpage
+//
+// 0x01000000 - 0x01FFFFFF:	"Kernel heap extension".  Additional slabs for the
+//							runtime heap, mapped on demand once the fixed
+//							pools in kernel data page 0 are exhausted.  Kernel
+//							only.  Non-paged.  Mapped with 4KB pages; the
+//							page tables are shared by all address spaces.
+//
+// 0x02000000 - 0x03FFFFFF:	"Kernel thread area".  Thread execution blocks:
+//							the context + kernel stack of each thread, each
+//							preceded by an unmapped guard page.  Kernel only.
+//							Non-paged.  Mapped with 4KB pages; the page tables
+//							are shared by all address spaces.
+//
 // 0x20000000 - 0x3FFFFFFF: Message payload area.  The payload of each incoming
 //							message is mapped into some virtually-contiguous
 //							portion of this range.  User visible.  Paged.
@@ -61,14 +81,15 @@
 
 
 //
-// Sizes of the fixed structures
+// Sizes of the fixed structures.  Each processor has its own TSS; these are
+// packed together in a single pool, indexed by processor
 //
-//@SMP: pool of TSS, one per CPU
 #define		KERNEL_BOOT_THREAD_SIZE		THREAD_EXECUTION_BLOCK_SIZE
 #define		KERNEL_GDT_SIZE				PAGE_SIZE
 #define		KERNEL_IDT_SIZE				PAGE_SIZE
 #define		KERNEL_TSS_SIZE				(128 + 8192)	// TSS + bitmap + pad
-#define		KERNEL_HEAP_DESCRIPTOR_SIZE	PAGE_SIZE
+#define		KERNEL_TSS_POOL_SIZE		(KERNEL_TSS_SIZE * PROCESSOR_COUNT_MAX)
+#define		KERNEL_HEAP_DESCRIPTOR_SIZE	(5 * PAGE_SIZE)
 
 
 
@@ -81,7 +102,7 @@
 #define		KERNEL_IDT_BASE				(KERNEL_GDT_BASE + KERNEL_GDT_SIZE)
 #define		KERNEL_TSS_BASE				(KERNEL_IDT_BASE + KERNEL_IDT_SIZE)
 #define		KERNEL_HEAP_DESCRIPTOR_BASE	(KERNEL_TSS_BASE + \
-											KERNEL_TSS_SIZE)
+											KERNEL_TSS_POOL_SIZE)
 
 
 //
@@ -164,6 +185,101 @@
 
 
 
+//////////////////////////////////////////////////////////////////////////
+//
+// Kernel heap extension
+//
+//////////////////////////////////////////////////////////////////////////
+
+
+//
+// The heap extension is subdivided into fixed-size slabs, each of which
+// holds blocks of a single size.  See kernel_heap_c::expand()
+//
+#define		KERNEL_HEAP_EXTENSION_BASE	0x01000000		// 16MB
+#define		KERNEL_HEAP_EXTENSION_SIZE	(4 * SUPER_PAGE_SIZE)
+#define		KERNEL_HEAP_EXTENSION_END	(KERNEL_HEAP_EXTENSION_BASE + \
+											KERNEL_HEAP_EXTENSION_SIZE)
+
+#define		KERNEL_HEAP_SLAB_SIZE		(4 * PAGE_SIZE)
+#define		KERNEL_HEAP_SLAB_PAGE_COUNT	(KERNEL_HEAP_SLAB_SIZE / PAGE_SIZE)
+#define		KERNEL_HEAP_SLAB_COUNT		(KERNEL_HEAP_EXTENSION_SIZE / \
+											KERNEL_HEAP_SLAB_SIZE)
+
+
+
+//////////////////////////////////////////////////////////////////////////
+//
+// Kernel thread area
+//
+//////////////////////////////////////////////////////////////////////////
+
+
+//
+// The thread area is subdivided into thread execution blocks.  See
+// thread_layout.h and thread_block_cache_c
+//
+#define		KERNEL_THREAD_AREA_BASE		0x02000000		// 32MB
+#define		KERNEL_THREAD_AREA_SIZE		(8 * SUPER_PAGE_SIZE)
+#define		KERNEL_THREAD_AREA_END		(KERNEL_THREAD_AREA_BASE + \
+											KERNEL_THREAD_AREA_SIZE)
+
+#define		KERNEL_THREAD_BLOCK_COUNT	(KERNEL_THREAD_AREA_SIZE / \
+											THREAD_EXECUTION_BLOCK_SIZE)
+
+
+
+//
+// The heap extension + the thread area are both mapped with 4KB pages.  The
+// page tables that span both ranges are allocated once at boot, and shared
+// by every page directory, so any page mapped here is immediately visible
+// in all address spaces.  See kernel_heap_c::find_entry()
+//
+#define		KERNEL_PAGE_TABLE_AREA_BASE	KERNEL_HEAP_EXTENSION_BASE
+#define		KERNEL_PAGE_TABLE_AREA_END	KERNEL_THREAD_AREA_END
+#define		KERNEL_PAGE_TABLE_COUNT		((KERNEL_PAGE_TABLE_AREA_END - \
+											KERNEL_PAGE_TABLE_AREA_BASE) / \
+											SUPER_PAGE_SIZE)
+
+
+
+//////////////////////////////////////////////////////////////////////////
+//
+// Kernel APIC page
+//
+//////////////////////////////////////////////////////////////////////////
+
+
+//
+// The APIC registers live in a fixed (but relocatable) physical range near
+// the top of the 4GB address space.  The entire range is mapped into the
+// kernel with a single, uncached superpage.  If the BIOS relocated the local
+// APIC outside of this range, then the kernel runs uniprocessor
+//
+#define		KERNEL_APIC_PAGE_BASE	0x00C00000		// 12MB
+#define		APIC_PHYSICAL_BASE		0xFEC00000		// Start of physical range
+
+
+
+//////////////////////////////////////////////////////////////////////////
+//
+// AP startup trampoline
+//
+//////////////////////////////////////////////////////////////////////////
+
+
+//
+// Application processors start in real mode at a page-aligned address below
+// 1MB, as specified in the STARTUP IPI.  The kernel copies the startup
+// trampoline to this (identity-mapped) page before waking each processor.
+// This is the second page of physical memory, which is unused once the
+// kernel has booted
+//
+#define		SMP_TRAMPOLINE_BASE		0x00001000
+#define		SMP_TRAMPOLINE_VECTOR	(SMP_TRAMPOLINE_BASE >> 12)
+
+
+
 //////////////////////////////////////////////////////////////////////////
 //
 // Message payload area
@@ -198,6 +314,17 @@
 #define		LARGE_PAYLOAD_POOL_COUNT	8
 
 
+//
+// One further pool holds the message rings of the threads in each address
+// space (See dx/message_ring.h), one page per thread.  These pages are never
+// message payloads, so io_manager_c::syscall_delete_message() refuses to
+// release them
+//
+#define		MESSAGE_RING_POOL_BASE		(LARGE_PAYLOAD_POOL_BASE + \
+											LARGE_PAYLOAD_POOL_COUNT * \
+											PAYLOAD_POOL_SIZE)
+
+
 
 //////////////////////////////////////////////////////////////////////////
 //
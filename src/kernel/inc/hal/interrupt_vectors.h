@@ -85,6 +85,18 @@
 					INTERRUPT_VECTOR_FIRST_PIC_IRQ + 1)
 
 
+//
+// Local APIC interrupts.  These are only generated on SMP hosts, where each
+// application processor receives its clock ticks from its own local APIC
+// timer rather than the PIC; and where processors interrupt each other to
+// flush stale TLB entries.  The low four bits of the spurious vector must
+// be set on P6-family processors
+//
+#define		INTERRUPT_VECTOR_LOCAL_TIMER			48
+#define		INTERRUPT_VECTOR_LOCAL_TLB_SHOOTDOWN	49
+#define		INTERRUPT_VECTOR_LOCAL_SPURIOUS			63
+
+
 //
 // Internal (kernel-only) soft interrupts.  These are not system calls, and
 // not available to usermode threads
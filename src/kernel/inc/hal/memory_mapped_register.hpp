@@ -0,0 +1,70 @@
+//
+// memory_mapped_register.hpp
+//
+// A hardware_register_c implementation for devices mapped into the physical
+// address space (e.g., the local APIC).
+//
+
+
+#ifndef _MEMORY_MAPPED_REGISTER_HPP
+#define _MEMORY_MAPPED_REGISTER_HPP
+
+#include "dx/types.h"
+#include "hardware_register.hpp"
+
+
+class   memory_mapped_register_c;
+typedef memory_mapped_register_c *    memory_mapped_register_cp;
+typedef memory_mapped_register_cp *   memory_mapped_register_cpp;
+typedef memory_mapped_register_c &    memory_mapped_register_cr;
+class   memory_mapped_register_c: public hardware_register_c
+	{
+	private:
+		volatile uint8_t*	address;	// Must already be mapped + uncached
+
+	protected:
+
+	public:
+		memory_mapped_register_c(uintptr_t register_address):
+			address((volatile uint8_t*)(register_address))
+			{ return; }
+		~memory_mapped_register_c()
+			{ return; }
+
+		uint8_t
+			read8()
+				{ return(*address); }
+		uint16_t
+			read16()
+				{ return(*(volatile uint16_t*)(address)); }
+		uint32_t
+			read32()
+				{ return(*(volatile uint32_t*)(address)); }
+
+		void_t
+			write8(uint8_t data)
+				{ *address = data; return; }
+		void_t
+			write16(uint16_t data)
+				{ *(volatile uint16_t*)(address) = data; return; }
+		void_t
+			write32(uint32_t data)
+				{ *(volatile uint32_t*)(address) = data; return; }
+
+
+		inline
+		uint8_t
+			operator=(uint8_t data)
+				{ write8(data); return(data); }
+		inline
+		uint16_t
+			operator=(uint16_t data)
+				{ write16(data); return(data); }
+		inline
+		uint32_t
+			operator=(uint32_t data)
+				{ write32(data); return(data); }
+	};
+
+
+#endif
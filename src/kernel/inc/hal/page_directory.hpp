@@ -82,19 +82,32 @@ class   page_directory_c
 			find_present_entry(void_tpp address);
 
 
+		///
+		/// Return the top-level entry that maps the given address; this is
+		/// either a 4MB superpage or a pointer to a child page table.  No
+		/// side effects
+		///
+		inline
+		page_table_entry_cr
+			find_directory_entry(const void_tp address)
+				{ return(entry[ calculate_index(address) ]); }
+
+
 		///
 		/// Page directories must always be page-aligned; and should be zero'd
 		/// so that the CPU does not mistake their prior contents entries in
-		/// the directory.  As a convenience, and to avoid allocation errors,
-		/// automatically inject the required new() flags.  The default
-		/// ::delete() can reclaim this memory on deletion.
+		/// the directory.  The kernel also assumes they are identity-mapped.
+		/// As a convenience, and to avoid allocation errors, automatically
+		/// inject the required new() flags.  The default ::delete() can reclaim this
+		/// memory on deletion.
 		///
 		static
 		void_tp
 			operator new(size_t size)
 				{
 				ASSERT(size == sizeof(page_directory_c));
-				return ::operator new(size, MEMORY_ZERO | MEMORY_ALIGN_PAGE);
+				return ::operator new(size,
+					MEMORY_ZERO | MEMORY_ALIGN_PAGE | MEMORY_IDENTITY_MAPPED);
 				}
 	};
 
@@ -125,16 +125,18 @@ class   page_table_c
 		///
 		/// Page tables must always be page-aligned; and should be zero'd
 		/// so that the CPU does not mistake their prior contents entries in
-		/// the table.  As a convenience, and to avoid allocation errors,
-		/// automatically inject the required new() flags.  The default
-		/// ::delete() can reclaim this memory on deletion.
+		/// the table.  The kernel also assumes they are identity-mapped.  As a
+		/// convenience, and to avoid allocation errors, automatically inject
+		/// the required new() flags.  The default ::delete() can reclaim this
+		/// memory on deletion.
 		///
 		static
 		void_tp
 			operator new(size_t size)
 				{
 				ASSERT(size == sizeof(page_table_c));
-				return ::operator new(size, MEMORY_ZERO | MEMORY_ALIGN_PAGE);
+				return ::operator new(size,
+					MEMORY_ZERO | MEMORY_ALIGN_PAGE | MEMORY_IDENTITY_MAPPED);
 				}
 
 	};
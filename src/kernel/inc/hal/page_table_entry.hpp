@@ -33,7 +33,7 @@ uint32_t	// Hardware-defined bits (see the Intel documentation)
 			// Software-defined bits
 			PAGE_SHARED			= 0x0200,
 			PAGE_COPY_ON_WRITE	= 0x0400,
-			PAGE_UNUSED_BIT		= 0x0800;	//@free/unused bit
+			PAGE_DEMAND_ZERO	= 0x0800;	// Not present; zero-fill on touch
 
 
 //
@@ -56,7 +56,8 @@ uint32_t	PAGE_BASE_ADDRESS_MASK		= 0xFFFFF000,
 const
 uint32_t	KERNEL_CODE_PAGE		= uint32_t(0x00000183),	// 4M page @ 0M
 			KERNEL_RAMDISK_PAGE		= uint32_t(0x00400181),	// 4M page @ 4M
-			KERNEL_DATA_PAGE		= uint32_t(0x00800183);	// 4M page @ 8M
+			KERNEL_DATA_PAGE		= uint32_t(0x00800183),	// 4M page @ 8M
+			KERNEL_APIC_PAGE		= uint32_t(0xFEC0019B);	// Uncached @ 12M
 
 
 
@@ -67,6 +68,14 @@ class	page_table_c;
 typedef	page_table_c* page_table_cp;
 
 
+//
+// Flushes a single page from the TLB of every processor.  This is just a
+// wrapper around hal::invalidate_tlb(), to avoid including the HAL here
+//
+void_t
+invalidate_processor_tlbs(const void_tp page);
+
+
 
 ///
 /// A single entry in a page table/directory.  With the exception of a few
@@ -96,13 +105,10 @@ class   page_table_entry_c
 		void_t
 			invalidate_tlb(const void_tp page)
 				{
+				// Invalidate the corresponding TLB entry on all processors
+				//@not necessary on addr space deletion
 				if (page)
-					{
-					// Invalidate the corresponding TLB entry
-					//@not necessary on addr space deletion
-					//@SMP: update TLB's on all CPU's
-					__asm("invlpg %0" : : "m"(*uint8_tp(page)));
-					}
+					{ invalidate_processor_tlbs(page); }
 
 				return;
 				}
@@ -162,6 +168,32 @@ class   page_table_entry_c
 				}
 
 
+		///
+		/// Commit a block of physical frames to this page directory entry, as
+		/// a single 4MB superpage.  Otherwise identical to commit_frame()
+		///
+		/// @param frame	-- the first frame of the physical superpage
+		/// @param flags	-- allocation flags + permissions.  See new.hpp
+		///
+		/// @return STATUS_SUCCESS if the superpage is successfully bound;
+		/// nonzero on error
+		///
+		status_t
+			commit_super_page(	physical_address_t	frame,
+								uint32_t			flags)
+				{
+				status_t status;
+
+				ASSERT((frame & (SUPER_PAGE_SIZE-1)) == 0);
+
+				status = commit_frame(frame, flags);
+				if (status == STATUS_SUCCESS)
+					{ bits |= PAGE_4M_SIZE; }
+
+				return(status);
+				}
+
+
 		///
 		/// Remove the physical frame behind this virtual address/page in the
 		/// current address space.  On return, this virtual address is no
@@ -186,6 +218,22 @@ class   page_table_entry_c
 				}
 
 
+		///
+		/// Reserve this page without backing it by a physical frame.  The page
+		/// remains not-present; the first access faults, at which point the
+		/// kernel commits a zero-filled frame.  See
+		/// address_space_c::demand_zero()
+		///
+		inline
+		void_t
+			reserve_frame()
+				{
+				if (!is_present())
+					{ bits = PAGE_DEMAND_ZERO; }
+				return;
+				}
+
+
 		///
 		/// Mark this entry as "shared", since there are potentially multiple
 		/// references to the underlying page frame
@@ -219,6 +267,40 @@ class   page_table_entry_c
 				}
 
 
+		///
+		/// Restore write access to a shared page, without copying it.  This is
+		/// only safe once no other address space references the underlying
+		/// frame.  The page remains marked as shared, so that its frame is
+		/// still released via its shared-frame descriptor
+		///
+		inline
+		void_t
+			reclaim_frame(const void_tp page)
+				{
+				ASSERT(is_present());
+				ASSERT(is_shared());
+
+				bits &= ~PAGE_COPY_ON_WRITE;
+				bits |= PAGE_WRITABLE;
+				invalidate_tlb(page);
+
+				return;
+				}
+
+
+		///
+		/// Return the physical frame behind this page; or the base of the
+		/// physical superpage.  No side effects
+		///
+		inline
+		physical_address_t
+			read_frame() const
+				{
+				ASSERT(is_present());
+				return(bits & PAGE_BASE_ADDRESS_MASK);
+				}
+
+
 		///
 		/// Mark this page as swapped out
 		///
@@ -265,6 +347,13 @@ class   page_table_entry_c
 			is_copy_on_write() const
 				{ return (bits & PAGE_COPY_ON_WRITE ? TRUE : FALSE); }
 		inline
+		bool_t
+			is_demand_zero() const
+				{
+				return ((bits & (PAGE_PRESENT | PAGE_DEMAND_ZERO)) ==
+					PAGE_DEMAND_ZERO ? TRUE : FALSE);
+				}
+		inline
 		bool_t
 			is_dirty() const
 				{ return (bits & PAGE_DIRTY ? TRUE : FALSE); }
@@ -285,6 +374,10 @@ class   page_table_entry_c
 			is_swapped() const
 				{ return (FALSE); } //@(bits == PAGE_SWAPPED?)
 		inline
+		bool_t
+			is_user() const
+				{ return (bits & PAGE_USER ? TRUE : FALSE); }
+		inline
 		bool_t
 			is_writable() const
 				{ return (bits & PAGE_WRITABLE ? TRUE : FALSE); }
@@ -0,0 +1,29 @@
+//
+// processor.h
+//
+// Limits + well-known indices for the processors (CPUs) in the host.  These
+// are plain definitions so that the assembly logic can use them, too.
+//
+
+#ifndef _PROCESSOR_H
+#define _PROCESSOR_H
+
+
+//
+// Maximum number of processors supported by the kernel.  Any additional
+// processors found at boot are simply ignored.  This determines the size of
+// the per-CPU structures (TSS pool, idle threads, etc)
+//
+#define	PROCESSOR_COUNT_MAX			8
+
+
+//
+// Each processor is identified by a small, zero-based index.  The bootstrap
+// processor is always index zero; the application processors are numbered
+// in the order in which they are started
+//
+#define	PROCESSOR_INDEX_BOOT		0
+#define	PROCESSOR_INDEX_INVALID		0xFFFFFFFF
+
+
+#endif
@@ -1,20 +0,0 @@
-//
-// processor_type.h
-//
-// List of known/supported processor types
-//
-
-#ifndef _PROCESSOR_TYPE_H
-#define _PROCESSOR_TYPE_H
-
-#define	PROCESSOR_TYPE_UNKNOWN		0x00
-#define	PROCESSOR_TYPE_386			0x03
-#define	PROCESSOR_TYPE_486			0x04
-#define	PROCESSOR_TYPE_PENTIUM		0x05
-#define	PROCESSOR_TYPE_PENTIUM_PRO	0x06
-#define PROCESSOR_TYPE_PENTIUM_II   0x07
-#define PROCESSOR_TYPE_PENTIUM_III  0x08
-#define	PROCESSOR_TYPE_PENTIUM_IV	0x09
-
-#endif
-
@@ -1,23 +1,26 @@
 //
 // spinlock.hpp
 //
-// Various spinlock objects.  In a uni-processor HAL, acquiring and
-// releasing a spinlock just disables and re-enables interrupts,
-// respectively; but these are also useful for documenting protected
-// access patterns, etc.
+// Various spinlock objects.  Acquiring a spinlock disables interrupts on
+// the local processor, then spins until the lock is available; releasing the
+// lock re-enables interrupts, if necessary.  On a uniprocessor host, the lock
+// is always available, so this degenerates into simply disabling and
+// re-enabling interrupts.
 //
 
 #ifndef _SPINLOCK_HPP
 #define _SPINLOCK_HPP
 
 #include "dx/types.h"
+#include "hal/processor.h"
 
 
 
 //
-// Normal spinlock.  In the uniprocessor HAL, holding one of these locks
-// prevents the I/O Manager from executing; and therefore guarantees that
-// the current thread will not be preempted while it holds the lock
+// Normal spinlock.  Holding one of these locks prevents the I/O Manager from
+// executing on the local processor; and therefore guarantees that the current
+// thread will not be preempted while it holds the lock.  Other processors
+// spin until the lock is released
 //
 class   spinlock_c;
 typedef spinlock_c *    spinlock_cp;
@@ -26,15 +29,17 @@ typedef spinlock_c &    spinlock_cr;
 class   spinlock_c
 	{
 	private:
-		bool_t		acquired;
-		uint32_t	interrupt_state;
+		volatile uint32_t	acquired;
+		uintptr_t			interrupt_state;
+		volatile uint32_t	owner;		// Processor holding the lock
 
 	protected:
 
 	public:
 		spinlock_c():
 			acquired(FALSE),
-			interrupt_state(0)
+			interrupt_state(0),
+			owner(PROCESSOR_INDEX_INVALID)
 			{ return; }
 		~spinlock_c()
 			{ return; }
@@ -51,11 +56,9 @@ class   spinlock_c
 // Interrupt spinlock.  Primarily useful for protecting resources/structures
 // that are shared between interrupt- and non-interrupt paths.
 //
-// In the uniprocessor HAL, this is just a wrapper around the spinlock_c
-// implementation, since the base spinlock_c implementation provides the
-// necessary synchronization. In a multiprocessor implementation, however,
-// interrupt_spinlock_c still acquires the underlying spinlock_c, but must
-// also disable interrupts on the local processor.
+// This is just a wrapper around the spinlock_c implementation, since the base
+// spinlock_c implementation already disables interrupts on the local
+// processor before spinning on the lock itself.
 //
 // Because all scheduling decisions occur within the context of the
 // clock interrupt, holding one of these locks prevents the I/O Manager
@@ -79,12 +82,6 @@ class   interrupt_spinlock_c:
 			{ return; }
 		~interrupt_spinlock_c()
 			{ return; }
-
-		// acquire() should disable local interrupts, then
-		// call spinlock_c::acquire()
-
-		// release() should re-enable local interrupts (if enabled
-		// when the lock was acquired), then call spinlock_c::release()
 	};
 
 
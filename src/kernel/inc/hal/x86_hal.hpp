@@ -6,9 +6,11 @@
 // hardware.  The HAL is intended to hide assorted processor and system
 // quirks, rather than provide a mechanism for portability.
 //
-// This is a uniprocessor HAL.  A multiprocessor HAL would require
-// a variety of changes for synchronization, per-CPU structures, APIC
-// management, etc.
+// The HAL supports both uniprocessor and SMP hosts.  On SMP hosts, the
+// bootstrap processor discovers the application processors via the MP
+// tables; and starts each one with its own TSS, idle thread and local APIC
+// timer.  Device interrupts are still routed via the PIC, to the bootstrap
+// processor only.
 //
 
 #ifndef _X86_HAL_HPP
@@ -35,14 +37,25 @@ class   x86_hardware_abstraction_layer_c
 	private:
 		uint32_t processor_type;
 
+		static
+		void_t
+			flush_fpu_context();
+
+		static
+		void_t
+			load_fpu_context(interrupt_cr interrupt);
+
 
 		static
 		void_t
 			run_thread() NEVER_RETURNS;
 
+		status_t
+			start_application_processor(uint32_t apic_id);
+
 		static
 		void_t
-			switch_thread_complete(thread_cr new_thread);
+			switch_thread_complete();
 
 
 	protected:
@@ -64,8 +77,26 @@ class   x86_hardware_abstraction_layer_c
 		void_t
 			enable_paging(address_space_cr address_space);
 		static
+		inline
+		void_t
+			invalidate_local_tlb(const void_tp page)
+				{
+				// Flush this page from the TLB of the current processor only
+				__asm volatile(	"invlpg %0"
+								:
+								: "m"(*uint8_tp(page))
+								: "memory");
+				return;
+				}
+		static
+		void_t
+			invalidate_tlb(const void_tp page);
+		static
 		void_tp
 			read_page_fault_address();
+		static
+		void_t
+			service_tlb_shootdown();
 
 
 		//
@@ -126,33 +157,51 @@ class   x86_hardware_abstraction_layer_c
 
 
 		//
-		// Processor management.  A multi-processor HAL would require
-		// logic to manage some sort of per-CPU descriptors here
+		// Processor management
 		//
+		void_t
+			initialize_application_processor(uint32_t index) NEVER_RETURNS;
 		void_t
 			initialize_processor();
 		static
 		inline
+		void_t
+			pause_processor()
+				{ __asm volatile("pause"); return; }
+		static
 		uint32_t
-			read_current_processor_index()
-				{ return(0); }
+			read_current_processor_index();
 		static
 		thread_cr
 			read_current_thread();
 		static
-		inline
+		uint64_t
+			read_idle_tick_count();
+		static
 		uint32_t
-			read_processor_count()
-				{ return(1); }
+			read_processor_count();
 		inline
 		uint32_t
 			read_processor_type() const
 				{ return(processor_type); }
+		void_t
+			start_application_processors();
 		static
 		void_t
 			suspend_processor();
 
 
+		//
+		// Clock management
+		//
+		static
+		void_t
+			start_clock_tick();
+		static
+		void_t
+			stop_clock_tick();
+
+
 		//
 		// System management
 		//
@@ -179,9 +228,25 @@ class   x86_hardware_abstraction_layer_c
 			switch_thread(thread_cr new_thread);
 
 
+		//
+		// FPU management
+		//
+		static
+		void_t
+			discard_fpu_context(thread_cr thread);
+
+
 		//
 		// I/O port management
 		//
+		static
+		void_t
+			discard_io_port_map(io_port_map_cr map);
+
+		static
+		bool_t
+			load_io_port_map(thread_cr thread);
+
 		static
 		void_t
 			reload_io_port_map(thread_cr thread);
@@ -25,7 +25,9 @@ class   interrupt_c
 	{
 	private:
 		bool_t		claimed;
+		bool_t		message_ring_drain;
 		thread_cp	next_thread;
+		bool_t		user_mode;
 
 
 	public:
@@ -35,9 +37,12 @@ class   interrupt_c
 
 	public:
 		interrupt_c(uint32_t	interrupt_vector,
-					uintptr_t	interrupt_data = 0):
+					uintptr_t	interrupt_data = 0,
+					bool_t		interrupted_user_mode = FALSE):
 			claimed(FALSE),
+			message_ring_drain(FALSE),
 			next_thread(NULL),
+			user_mode(interrupted_user_mode),
 			data(interrupt_data),
 			vector(interrupt_vector)
 			{ ASSERT(vector < INTERRUPT_VECTOR_LAST); return; }
@@ -93,6 +98,13 @@ class   interrupt_c
 				return (slave_pic_interrupt);
 				}
 
+		/// Did this interrupt preempt user code, rather than the kernel?
+		/// If so, the interrupted thread holds no kernel locks
+		inline
+		bool_t
+			is_user_interrupt() const
+				{ return(user_mode); }
+
 
 		//
 		// Methods for supporting context switches
@@ -115,6 +127,24 @@ class   interrupt_c
 				}
 
 
+		//
+		// Work deferred until the interrupted thread returns to user mode;
+		// see dispatch_interrupt()
+		//
+		inline
+		bool_t
+			is_message_ring_drain_pending() const
+				{ return(message_ring_drain); }
+		inline
+		void_t
+			request_message_ring_drain()
+				{
+				ASSERT(user_mode);
+				message_ring_drain = TRUE;
+				return;
+				}
+
+
 		//
 		// Support for system calls
 		//
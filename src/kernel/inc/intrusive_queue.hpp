@@ -0,0 +1,184 @@
+//
+// intrusive_queue.hpp
+//
+// A template for a queue of objects that carry their own link fields.
+//
+// Unlike the queue_m template, this queue never allocates any memory: each
+// object embeds the link that threads it into the queue.  As a consequence,
+// an object may reside in at most one intrusive queue at a time.  As with
+// queue_m, the queue merely keeps pointers to the objects; the caller must
+// not delete any objects without first removing them from the queue, etc.
+//
+// Specializing the template requires one type:
+// * The DATATYPE should be the type of data/object stored in the queue; this
+//   type must contain a "DATATYPE* queue_next" field that is accessible to
+//   the template (e.g., via friend declaration).  The queue owns this field
+//   while the object is enqueued
+//
+
+#ifndef _INTRUSIVE_QUEUE_HPP
+#define _INTRUSIVE_QUEUE_HPP
+
+#include "dx/types.h"
+#include "kernel_panic.hpp"
+
+
+//
+// Simple intrusive FIFO template.  No builtin locks.
+//
+template <class DATATYPE>
+class intrusive_queue_m
+	{
+	private:
+		uint32_t		count;
+		DATATYPE*		head;
+		DATATYPE*		tail;
+
+
+	public:
+		intrusive_queue_m():
+			count(0),
+			head(NULL),
+			tail(NULL)
+			{ return; }
+		~intrusive_queue_m()
+			{
+			reset();
+			return;
+			}
+
+		inline
+		bool_t
+			is_empty() const
+				{ return(count == 0); }
+
+		inline
+		uint32_t
+			read_count() const
+				{ return(count); }
+
+
+		//
+		// Add a new object to the end of the queue.  Never allocates; always
+		// succeeds.  Performance is O(1).
+		//
+		void_t
+			push(DATATYPE& object)
+				{
+				object.queue_next = NULL;
+
+				// Insert the object at the end of the queue
+				if (tail)
+					tail->queue_next = &object;	// Intermediate element
+				else
+					head = &object;				// First element in queue
+				tail = &object;
+
+				count++;
+
+				return;
+				}
+
+
+		//
+		// Add a new object to the head/front of the queue.  Never allocates;
+		// always succeeds.  Performance is O(1).
+		//
+		void_t
+			push_head(DATATYPE& object)
+				{
+				object.queue_next = head;
+
+				// Insert the object at the front of the queue
+				head = &object;
+
+				// First element?
+				if (!tail)
+					tail = &object;
+
+				count++;
+
+				return;
+				}
+
+
+		//
+		// Remove the object at the head of the queue.  This simply unlinks
+		// the object; the caller still owns it.  Performance is O(1).
+		//
+		DATATYPE&
+			pop()
+				{
+				DATATYPE* object = head;
+
+				if (count > 0)
+					{
+					// Remove the object at the front of the queue
+					head = object->queue_next;
+					if (!head)
+						tail = NULL;
+
+					object->queue_next = NULL;
+					count--;
+					}
+				else
+					{
+					// The queue is empty
+					kernel_panic(KERNEL_PANIC_REASON_QUEUE_UNDERRUN,
+						uintptr_t(this));
+					}
+
+				return(*object);
+				}
+
+
+		//
+		// Remove the given object from anywhere in the queue.  This simply
+		// unlinks the object; the caller still owns it.  Returns FALSE if
+		// the object is not in this queue.  Performance is O(n).
+		//
+		bool_t
+			remove(DATATYPE& object)
+				{
+				DATATYPE*	previous	= NULL;
+				DATATYPE*	current		= head;
+
+				// Locate the object + its predecessor
+				while (current && current != &object)
+					{
+					previous	= current;
+					current		= current->queue_next;
+					}
+
+				if (!current)
+					return(FALSE);
+
+				// Unlink the object
+				if (previous)
+					previous->queue_next = object.queue_next;
+				else
+					head = object.queue_next;
+				if (tail == &object)
+					tail = previous;
+
+				object.queue_next = NULL;
+				count--;
+
+				return(TRUE);
+				}
+
+
+		//
+		// Remove all items in the queue.  On return, the queue is empty
+		//
+		void_t
+			reset()
+				{
+				while(count)
+					{ pop(); }
+				return;
+				}
+
+	};
+
+#endif
@@ -34,6 +34,23 @@ const
 uint32_t SCHEDULING_QUANTUM_DEFAULT = 12;
 
 
+///
+/// On SMP hosts, the lottery winner may already be executing on another
+/// processor.  Redraw at most this many times before idling the current
+/// processor instead
+///
+const
+uint32_t LOTTERY_DRAW_MAX = 4;
+
+
+///
+/// The stride scheduler charges the selected thread this much virtual time,
+/// divided by its count of pending messages (tickets)
+///
+const
+uint32_t STRIDE_ONE = 0x100000;
+
+
 
 class   io_manager_c;
 typedef io_manager_c *    io_manager_cp;
@@ -48,12 +65,19 @@ class   io_manager_c
 
 		// Statistics
 		atomic_int32_c		direct_handoff_count;	//@rolls over in ~1.5 years
-		atomic_int32_c		idle_count;				//@rolls over in ~1.5 years
+		atomic_int32_c		direct_message_count;
 		atomic_int32_c		incomplete_count;
 		atomic_int32_c		lottery_count;			//@rolls over in ~1.5 years
 		atomic_int32_c		message_count;
 		atomic_int32_c		receive_error_count;
 		atomic_int32_c		send_error_count;
+		atomic_int32_c		send_wait_count;
+		uint32_t			scheduling_latency[SCHEDULING_LATENCY_BUCKET_COUNT];
+
+
+		// Scheduling policy; see select_next_thread()
+		uint32_t			scheduling_policy;
+		uint32_t			stride_pass;		// Global virtual time
 
 
 		message_cp
@@ -62,17 +86,57 @@ class   io_manager_c
 								message_id_t	request_id,
 								status_t		status);
 
+		status_t
+			claim_message(message_cpp message);
+
+		bool_t
+			get_notification(	thread_cr			thread,
+								direct_message_sr	message);
+
+		status_t
+			process_message(message_operation_sp	operation,
+							bool_t					wait_for_room);
+
+		void_t
+			record_scheduling_latency(thread_cr thread);
+
+		thread_cp
+			select_lottery_thread(uint32_t processor);
 		thread_cr
 			select_next_thread(thread_cr current_thread);
 
+		bool_t
+			send_direct_message(thread_cr					destination,
+								volatile syscall_data_s*	syscall,
+								bool_t						wait_for_reply);
+
+		void_t
+			syscall_create_message_ring(volatile syscall_data_s* syscall);
 		void_t
 			syscall_delete_message(volatile syscall_data_s* syscall);
+		void_t
+			syscall_enter_message_ring(volatile syscall_data_s* syscall);
+		void_t
+			syscall_process_messages(volatile syscall_data_s* syscall);
 		void_t
 			syscall_receive_message(volatile syscall_data_s* syscall);
+		void_t
+			syscall_receive_reply(volatile syscall_data_s* syscall);
 		void_t
 			syscall_send_and_receive_message(volatile syscall_data_s* syscall);
 		void_t
-			syscall_send_message(volatile syscall_data_s* syscall);
+			syscall_send_gathered_message(volatile syscall_data_s* syscall);
+		void_t
+			syscall_send_message(	volatile syscall_data_s*	syscall,
+									uintptr_t					control,
+									bool_t						wait_for_room);
+		void_t
+			syscall_send_request(	volatile syscall_data_s*	syscall,
+									bool_t						wait_for_room);
+		void_t
+			syscall_set_mailbox_limit(volatile syscall_data_s* syscall);
+		void_t
+			syscall_signal_thread(volatile syscall_data_s* syscall);
 
 
 	protected:
@@ -86,13 +150,29 @@ class   io_manager_c
 			delete_messages(thread_cr	thread,
 							message_cp	deletion_message);
 
+		status_t
+			create_message_ring(thread_cr thread);
+
+		void_t
+			drain_message_ring(	thread_cr	thread,
+								bool_t		wait_for_completion);
+
 		static
 		void_t
 			handle_interrupt(interrupt_cr interrupt);
 
+		void_t
+			preempt_idle_thread(interrupt_cr interrupt);
+
 		void_t
 			read_stats(volatile kernel_stats_s& kernel_stats);
 
+		static
+		thread_cp
+			select_stride_thread(	message_pool_cr	pool,
+									uint32_t		processor,
+									uint32_tp		global_pass);
+
 
 		//
 		// Nonblocking message primitives
@@ -100,18 +180,29 @@ class   io_manager_c
 		status_t
 			get_message(message_cpp message);
 		status_t
-			put_message(message_cr message);
+			put_message(message_cr	message,
+						bool_t		wait_for_room = FALSE);
+
+
+		//
+		// Notifications: signal bits, delivered without allocating
+		//
+		void_t
+			put_notification(	thread_cr	thread,
+								uint32_t	signal);
 
 
 		//
 		// Full message-passing semantics
 		//
 		status_t
-			receive_message(message_cpp message,
-							bool_t		wait_for_message = TRUE);
+			receive_message(message_cpp			message,
+							bool_t				wait_for_message = TRUE,
+							direct_message_sp	direct_message = NULL);
 		status_t
 			send_message(	message_cr	request,
-							message_cpp	response);
+							message_cpp	response,
+							bool_t		wait_for_room = FALSE);
 
 		/// Non-blocking message transmission
 		inline
@@ -121,6 +212,27 @@ class   io_manager_c
 				ASSERT(!request.is_blocking());
 				return(put_message(request));
 				}
+
+
+		//
+		// Batches of send, receive + delete operations; see PROCESS_MESSAGES
+		//
+		status_t
+			process_messages(	message_operation_sp	operation,
+								uint32_t				count,
+								uint32_tp				processed);
+
+
+		//
+		// Asynchronous requests, with replies correlated by message id
+		//
+		status_t
+			receive_reply(	message_cpp		reply,
+							message_id_t	id,
+							bool_t			wait_for_reply = TRUE);
+		status_t
+			send_request(	message_cr	request,
+							bool_t		wait_for_room = FALSE);
 	};
 
 
@@ -7,17 +7,56 @@
 #ifndef _KERNEL_HEAP_HPP
 #define _KERNEL_HEAP_HPP
 
+#include "bitmap.hpp"
 #include "delete.hpp"
+#include "dx/kernel_stats.h"
+#include "dx/status.h"
 #include "dx/types.h"
+#include "hal/address_space_layout.h"
+#include "hal/spinlock.hpp"
 #include "memory_pool.hpp"
 #include "new.hpp"
 
 
 
+//
+// Forward references
+//
+class	page_table_c;
+typedef	page_table_c* page_table_cp;
+
+class	page_table_entry_c;
+typedef	page_table_entry_c* page_table_entry_cp;
+
+
+
+///
+/// The heap allocates blocks of 2^N bytes, from 8 bytes (N = 3) up to 8KB
+/// (N = 13).  Each block size is a separate "size class"
+///
+const
+uint32_t	HEAP_MIN_BLOCK_ORDER	= 3,
+			HEAP_MAX_BLOCK_ORDER	= 13,
+			HEAP_SIZE_CLASS_COUNT	= HEAP_MAX_BLOCK_ORDER -
+										HEAP_MIN_BLOCK_ORDER + 1;
+
+
+
 ///
 /// Memory heap for allocating kernel structures at runtime.  This heap
 /// handles all operator new() and operator delete() requests
 ///
+/// The heap is initially a set of fixed memory pools within kernel data
+/// page 0, which is identity-mapped.  Once a pool is exhausted, the heap
+/// expands into the heap extension area (see address_space_layout.h): each
+/// slab there is backed by frames from the Page Frame Manager + carved into
+/// blocks of a single size class.  Slabs that become completely free are
+/// cached until the system runs low on physical memory; see
+/// release_free_slabs().
+///
+/// The heap also owns the kernel page tables that map the heap extension and
+/// the thread area; see find_entry().
+///
 class   kernel_heap_c;
 typedef kernel_heap_c *    kernel_heap_cp;
 typedef kernel_heap_cp *   kernel_heap_cpp;
@@ -25,7 +64,37 @@ typedef kernel_heap_c &    kernel_heap_cr;
 class   kernel_heap_c
 	{
 	private:
-		// The memory pools that comprise the kernel heap
+		//
+		// Each free block within a slab is overlaid with this link
+		//
+		struct  free_block_s;
+		typedef free_block_s *    free_block_sp;
+		typedef free_block_sp *   free_block_spp;
+		typedef free_block_s &    free_block_sr;
+		struct  free_block_s
+			{
+			free_block_sp	next;
+			};
+
+
+		//
+		// Descriptor for a single slab within the heap extension.  Slabs of
+		// the same size class that contain free blocks are linked together
+		//
+		struct  heap_slab_s;
+		typedef heap_slab_s *    heap_slab_sp;
+		typedef heap_slab_sp *   heap_slab_spp;
+		typedef heap_slab_s &    heap_slab_sr;
+		struct  heap_slab_s
+			{
+			heap_slab_sp	next;
+			free_block_sp	free_list;
+			uint16_t		free_count;
+			uint16_t		size_class;
+			};
+
+
+		// The memory pools that comprise the fixed portion of the heap
 		memory_pool_c	pool8;
 		memory_pool_c	pool16;
 		memory_pool_c	pool32;
@@ -38,9 +107,45 @@ class   kernel_heap_c
 		memory_pool_c	pool8192;
 
 
+		// The heap extension
+		bool_t					expandable;
+		interrupt_spinlock_c	lock;
+		page_table_cp			page_table[ KERNEL_PAGE_TABLE_COUNT ];
+		heap_slab_sp			partial_slab[ HEAP_SIZE_CLASS_COUNT ];
+		heap_slab_s				slab_table[ KERNEL_HEAP_SLAB_COUNT ];
+		uint32_t				slab_count;
+		bitmap1024_c			slab_map;
+
+
+		void_tp
+			allocate_pool_block(memory_pool_cr	pool,
+								uint32_t		flags);
+
+		void_tp
+			allocate_slab_block(size_t block_size);
+
+		status_t
+			expand(uint32_t size_class);
+
 		memory_pool_cp
 			find_pool(const void_tp block);
 
+		void_t
+			free_slab_block(void_tp block);
+
+
+		///
+		/// Does this address lie within the heap extension?  No side effects
+		///
+		static
+		inline
+		bool_t
+			is_extension_block(const void_tp block)
+				{
+				return(uintptr_t(block) >= KERNEL_HEAP_EXTENSION_BASE &&
+					uintptr_t(block) < KERNEL_HEAP_EXTENSION_END);
+				}
+
 
 	protected:
 
@@ -52,9 +157,32 @@ class   kernel_heap_c
 		void_tp
 			allocate_block(	size_t		size,
 							uint32_t	flags	);
+
+		void_t
+			enable_expansion();
+
+		page_table_entry_cp
+			find_entry(const void_tp address);
+
 		void_t
 			free_block(void_tp memory);
 
+		void_t
+			read_stats(volatile kernel_stats_s& kernel_stats);
+
+		uint32_t
+			release_free_slabs();
+
+
+		///
+		/// Return the page table that maps the given 4MB portion of the heap
+		/// extension + thread area.  No side effects.  See page_directory_c
+		/// constructor
+		///
+		inline
+		page_table_cp
+			read_page_table(uint32_t index) const
+				{ return(page_table[ index ]); }
 	};
 
 
@@ -26,7 +26,7 @@ typedef enum
 	KERNEL_PANIC_REASON_MEMORY_ALLOCATION_FAILURE,
 	KERNEL_PANIC_REASON_MESSAGE_FAILURE,
 	KERNEL_PANIC_REASON_QUEUE_UNDERRUN,
-	KERNEL_PANIC_REASON_REACQUIRED_SPINLOCK,	// Only valid on uni-processors
+	KERNEL_PANIC_REASON_REACQUIRED_SPINLOCK,
 	KERNEL_PANIC_REASON_UNABLE_TO_CREATE_SYSTEM_THREAD,
 	KERNEL_PANIC_REASON_UNEXPECTED_INTERRUPT
 	} kernel_panic_reason_e;
@@ -10,6 +10,8 @@
 #ifndef _KERNEL_THREADS_HPP
 #define _KERNEL_THREADS_HPP
 
+#include "dx/thread_id.h"
+#include "hal/processor.h"
 #include "thread.hpp"
 
 
@@ -31,5 +33,21 @@ extern
 thread_cp		__null_thread;
 
 
+/// Each processor has its own idle thread, which only executes on that
+/// processor.  The idle thread of the bootstrap processor is the null thread
+extern
+thread_cp		__idle_thread[ PROCESSOR_COUNT_MAX ];
+
+
+///
+/// Returns TRUE if the given thread is the idle thread of some processor;
+/// FALSE otherwise.  No side effects
+///
+inline
+bool_t
+is_idle_thread(const thread_c& thread)
+	{ return(thread.id - THREAD_ID_NULL < PROCESSOR_COUNT_MAX); }
+
+
 #endif
 
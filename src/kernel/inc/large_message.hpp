@@ -5,6 +5,7 @@
 #ifndef _LARGE_MESSAGE_HPP
 #define _LARGE_MESSAGE_HPP
 
+#include "dx/message.h"
 #include "dx/status.h"
 #include "dx/types.h"
 #include "message.hpp"
@@ -16,7 +17,9 @@
 /// A "large message" is a message carrying an external payload of one or
 /// more pages.  Unlike small_message_c and medium_message_c, there is no
 /// maximum size on the payload.  The payload is delivered to the recipient
-/// through shared memory.
+/// through shared memory.  The sender may provide the payload as a list of
+/// fragments, at any alignment; these are gathered into a single, contiguous
+/// payload in the recipient's address space.
 ///
 class   large_message_c;
 typedef large_message_c *    large_message_cp;
@@ -26,10 +29,12 @@ class   large_message_c:
 	public message_c
 	{
 	private:
+		message_fragment_s		fragment[ MESSAGE_FRAGMENT_COUNT_MAX ];
+		uint32_t				fragment_count;		// Sender's addr space
 		shared_frame_list_c		frame;
-		const size_t			payload_size;
+		size_t					payload_size;
+		uintptr_t				receiver_offset;	// Offset within 1st page
 		void_tp					receiver_payload;	// Recipient's addr space
-		const void_tp			sender_payload;		// Sender's addr space
 
 
 	protected:
@@ -43,8 +48,27 @@ class   large_message_c:
 						size_t			message_payload_size,
 						void_tp			message_receiver_payload = NULL);
 
+		large_message_c(thread_cr					message_source,
+						thread_cr					message_destination,
+						message_type_t				message_type,
+						message_id_t				message_id,
+						const message_fragment_s*	message_fragment,
+						uint32_t					message_fragment_count,
+						void_tp						message_receiver_payload = NULL);
+
 		~large_message_c();
 
+
+		//
+		// Allocation via dedicated object cache
+		//
+		static
+		void_tp
+			operator new(size_t size);
+		static
+		void_t
+			operator delete(void_tp message);
+
 		status_t
 			collect_payload();
 
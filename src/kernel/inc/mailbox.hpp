@@ -5,18 +5,52 @@
 #ifndef _MAILBOX_HPP
 #define _MAILBOX_HPP
 
+#include "dx/message.h"
+#include "dx/message_id.h"
+#include "dx/thread_id.h"
 #include "dx/types.h"
+#include "intrusive_queue.hpp"
 #include "message.hpp"
 
 
 
 
 ///
-/// Maximum backlog of messages.  If a mailbox exceeds this limit, subsequent
-/// messages are discarded; and the owner thread is killed
+/// Default + maximum backlog of messages.  Once a mailbox reaches its limit,
+/// subsequent senders must wait for room, or their messages are refused.
+/// Each thread may adjust the limit on its own mailbox, up to the maximum.
+/// See thread_c::put_message()
 ///
 const
-uint32_t MAILBOX_DEFAULT_LIMIT	= 64;
+uint32_t	MAILBOX_DEFAULT_LIMIT	= 64,
+			MAILBOX_LIMIT_MAX		= 1024;
+
+
+
+//
+// A queue of threads, each waiting for room in the same full mailbox
+//
+typedef intrusive_queue_m<thread_c>	thread_queue_c;
+typedef thread_queue_c *			thread_queue_cp;
+typedef thread_queue_cp *			thread_queue_cpp;
+typedef thread_queue_c &			thread_queue_cr;
+
+
+
+///
+/// An asynchronous request still awaiting its reply.  The reply is recognized
+/// by the id of the original recipient + the id of the request itself.  An
+/// unused slot has an invalid destination
+///
+struct  pending_request_s;
+typedef pending_request_s *    pending_request_sp;
+typedef pending_request_sp *   pending_request_spp;
+typedef pending_request_s &    pending_request_sr;
+struct  pending_request_s
+	{
+	thread_id_t		destination;
+	message_id_t	id;
+	};
 
 
 
@@ -32,18 +66,132 @@ struct  mailbox_s
 	{
 	public:
 		bool_t				enabled;
+		uint32_t			limit;
 		message_queue_c		message_queue;
+		pending_request_s	pending_request[ MESSAGE_REQUEST_COUNT_MAX ];
+		message_queue_c		reply_queue;	// Replies to pending_request[]
+		thread_queue_c		sender_queue;	// Senders waiting for room
 
 
 		mailbox_s():
-			enabled(TRUE)
-			{ return; }
+			enabled(TRUE),
+			limit(MAILBOX_DEFAULT_LIMIT)
+			{
+			for (uint32_t i = 0; i < MESSAGE_REQUEST_COUNT_MAX; i++)
+				{ pending_request[i].destination = THREAD_ID_INVALID; }
+			return;
+			}
+
+
+		///
+		/// Record a new asynchronous request, so that its reply is routed to
+		/// the reply queue.  Fails if the request id is already outstanding
+		/// or if there are too many requests outstanding
+		///
+		inline
+		bool_t
+			add_request(thread_id_t		destination,
+						message_id_t	id)
+				{
+				pending_request_sp	request = NULL;
+				bool_t				success = TRUE;
+
+				for (uint32_t i = 0; i < MESSAGE_REQUEST_COUNT_MAX; i++)
+					{
+					if (pending_request[i].destination == THREAD_ID_INVALID)
+						{
+						if (!request)
+							{ request = &pending_request[i]; }
+						}
+					else if (pending_request[i].id == id)
+						{
+						success = FALSE;
+						}
+					}
+
+				if (success && request)
+					{
+					request->destination	= destination;
+					request->id				= id;
+					}
+
+				return(success && request ? TRUE : FALSE);
+				}
+
+
+		///
+		/// Is the given request, or any request if the id is MESSAGE_ID_ANY,
+		/// still awaiting its reply?  No side effects
+		///
+		inline
+		bool_t
+			has_pending_request(message_id_t id) const
+				{
+				bool_t pending = FALSE;
+
+				for (uint32_t i = 0; i < MESSAGE_REQUEST_COUNT_MAX; i++)
+					{
+					if (pending_request[i].destination != THREAD_ID_INVALID &&
+						(id == MESSAGE_ID_ANY || pending_request[i].id == id))
+						{ pending = TRUE; }
+					}
+
+				return(pending);
+				}
+
+
+		///
+		/// Is this message the reply to an outstanding request?  No side
+		/// effects
+		///
+		inline
+		bool_t
+			is_pending_request(	thread_id_t		source,
+								message_id_t	id) const
+				{
+				bool_t pending = FALSE;
+
+				for (uint32_t i = 0; i < MESSAGE_REQUEST_COUNT_MAX; i++)
+					{
+					if (pending_request[i].destination == source &&
+						pending_request[i].id == id)
+						{ pending = TRUE; }
+					}
+
+				return(pending);
+				}
 
 
 		inline
 		bool_t
 			overflow() const
-				{ return(message_queue.read_count() >= MAILBOX_DEFAULT_LIMIT);}
+				{ return(message_queue.read_count() >= limit); }
+
+
+		///
+		/// Retire an outstanding request, typically because its reply has
+		/// arrived.  Returns TRUE if the request was outstanding; FALSE
+		/// otherwise
+		///
+		inline
+		bool_t
+			remove_request(	thread_id_t		source,
+							message_id_t	id)
+				{
+				bool_t removed = FALSE;
+
+				for (uint32_t i = 0; i < MESSAGE_REQUEST_COUNT_MAX; i++)
+					{
+					if (pending_request[i].destination == source &&
+						pending_request[i].id == id)
+						{
+						pending_request[i].destination = THREAD_ID_INVALID;
+						removed = TRUE;
+						}
+					}
+
+				return(removed);
+				}
 
 	};
 
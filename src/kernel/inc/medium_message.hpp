@@ -25,7 +25,9 @@ uint32_t	MEDIUM_MESSAGE_PAYLOAD_SIZE	= 256;
 /// A "medium" message is a message carrying a payload of up to
 /// MEDIUM_MESSAGE_PAYLOAD_SIZE bytes.  The payload is embedded directly within
 /// the message object itself and is copied directly to the destination
-/// address space.
+/// address space.  If the recipient is already waiting for a message, then the
+/// payload skips the embedded buffer, and is copied only once, straight from
+/// the sender to the recipient.
 ///
 class   medium_message_c;
 typedef medium_message_c *    medium_message_cp;
@@ -35,12 +37,17 @@ class   medium_message_c:
 	public message_c
 	{
 	private:
+		bool_t			direct_copy;		// Already in recipient's addr space
 		uint8_t			payload[ MEDIUM_MESSAGE_PAYLOAD_SIZE ];
 		const size_t	payload_size;
 		void_tp			receiver_payload;	// Recipient's addr space
 		const void_tp	sender_payload;		// Sender's addr space
 
 
+		bool_t
+			copy_payload();
+
+
 	protected:
 
 	public:
@@ -51,8 +58,18 @@ class   medium_message_c:
 							void_tp			message_payload,
 							size_t			message_payload_size);
 
-		~medium_message_c()
-			{ return; }
+		~medium_message_c();
+
+
+		//
+		// Allocation via dedicated object cache
+		//
+		static
+		void_tp
+			operator new(size_t size);
+		static
+		void_t
+			operator delete(void_tp message);
 
 
 		status_t
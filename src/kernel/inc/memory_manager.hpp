@@ -24,7 +24,10 @@ typedef memory_manager_c &    memory_manager_cr;
 class   memory_manager_c
 	{
 	private:
+		atomic_int32_c		cow_copy_avoided_count;
 		atomic_int32_c		cow_fault_count;
+		atomic_int32_c		demand_zero_fault_count;
+		atomic_int32_c		io_port_fault_count;
 		atomic_int32_c		page_fault_count;
 
 
@@ -64,6 +64,15 @@ class   memory_pool_c
 			is_empty() const
 				{ return(bitmap.is_full()); }
 
+
+		///
+		/// Size, in bytes, of each block in this pool.  No side effects.
+		///
+		inline
+		size_t
+			read_block_size() const
+				{ return(block_size); }
+
 	};
 
 
@@ -11,8 +11,9 @@
 #include "dx/status.h"
 #include "dx/thread_id.h"
 #include "dx/types.h"
+#include "intrusive_queue.hpp"
 #include "list.hpp"
-#include "queue.hpp"
+#include "object_cache.hpp"
 
 
 
@@ -29,7 +30,9 @@ typedef	thread_c &		thread_cr;
 //
 const
 uintptr_t	MESSAGE_CONTROL_NONE		= 0x00,
-			MESSAGE_CONTROL_BLOCKING	= 0x01;
+			MESSAGE_CONTROL_BLOCKING	= 0x01,
+			MESSAGE_CONTROL_DONATE		= 0x02,	// Sender surrenders payload
+			MESSAGE_CONTROL_REQUEST		= 0x04;	// Asynchronous request
 //@target CPU?	Same CPU (for thread exit)?
 
 
@@ -46,8 +49,12 @@ class	message_c
 	// Allow the Message Pool to access the lottery index
 	friend class message_pool_c;
 
+	// Allow the mailbox queue to access the queue link
+	template <class DATATYPE> friend class intrusive_queue_m;
+
 	private:
 		uint32_t				pool_index;
+		message_c*				queue_next;
 
 
 	protected:
@@ -81,11 +88,24 @@ class	message_c
 		~message_c();
 
 
+		inline
+		bool_t
+			expects_reply() const
+				{
+				return (control &
+					(MESSAGE_CONTROL_BLOCKING | MESSAGE_CONTROL_REQUEST));
+				}
+
 		inline
 		bool_t
 			is_blocking() const
 				{ return (control & MESSAGE_CONTROL_BLOCKING); }
 
+		inline
+		bool_t
+			is_donated() const
+				{ return (control & MESSAGE_CONTROL_DONATE); }
+
 
 		///
 		/// Collect the payload, if any, for delivery to the recipient.
@@ -124,10 +144,37 @@ class	message_c
 
 
 
+///
+/// A register-sized message, passed directly from sender to receiver without
+/// allocating a message_c or visiting the lottery pool.  Only small messages
+/// (a single payload word) are eligible.  See
+/// io_manager_c::send_direct_message()
+///
+struct  direct_message_s;
+typedef direct_message_s *    direct_message_sp;
+typedef direct_message_sp *   direct_message_spp;
+typedef direct_message_s &    direct_message_sr;
+struct  direct_message_s
+	{
+	uintptr_t		control;
+	message_id_t	id;
+	uintptr_t		payload;
+	thread_id_t		source;
+	message_type_t	type;
+
+	inline
+	bool_t
+		is_blocking() const
+			{ return (control & MESSAGE_CONTROL_BLOCKING); }
+	};
+
+
+
 //
-// A queue of messages
+// A queue of messages.  Each message resides in at most one queue at a time
+// (typically the mailbox of its recipient), so the queue never allocates
 //
-typedef queue_m<message_c>			message_queue_c;
+typedef intrusive_queue_m<message_c>	message_queue_c;
 typedef message_queue_c *			message_queue_cp;
 typedef message_queue_cp *			message_queue_cpp;
 typedef message_queue_c &			message_queue_cr;
@@ -142,6 +189,15 @@ typedef message_list_cp *			message_list_cpp;
 typedef message_list_c &			message_list_cr;
 
 
+//
+// Object caches for each flavor of message.  See initialize_message_caches()
+//
+extern object_cache_cp	__large_message_cache;
+extern object_cache_cp	__medium_message_cache;
+extern object_cache_cp	__small_message_cache;
+
+
+
 //
 // Various message-related convenience functions
 //
@@ -153,7 +209,11 @@ allocate_message(	thread_cr		source,
 					message_id_t	id,
 					void_tp			payload,
 					size_t			payload_size,
-					void_tp			receiver_payload);
+					void_tp			receiver_payload,
+					uintptr_t		control				= MESSAGE_CONTROL_NONE);
+
+status_t
+initialize_message_caches();
 
 status_t
 put_message(thread_cr		source,
@@ -162,7 +222,9 @@ put_message(thread_cr		source,
 			message_id_t	id,
 			void_tp			payload				= void_tp(0xFFFFFFFF),
 			size_t			payload_size		= 0,
-			void_tp			receiver_payload	= NULL);
+			void_tp			receiver_payload	= NULL,
+			uintptr_t		control				= MESSAGE_CONTROL_NONE,
+			bool_t			wait_for_room		= FALSE);
 
 
 status_t
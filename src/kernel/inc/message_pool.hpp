@@ -14,6 +14,7 @@
 #include "kernel_panic.hpp"
 #include "klibc.hpp"
 #include "message.hpp"
+#include "thread.hpp"
 
 
 
@@ -32,8 +33,11 @@
 ///		- Random access to messages within the pool must be fast
 ///		- Message removal must be fast, given a handle to the message (i.e.,
 ///		  given a pointer to message X, it must be easy to remove X from pool)
-///		- No need for message iteration.  Order of messages within the pool
-///		  is not important
+///		- Order of messages within the pool is not important.  Iteration is
+///		  only needed by the stride scheduler, and may be slow
+///
+/// The pool also tracks the number of messages (lottery tickets) held by each
+/// thread; see thread_c::ticket_count
 ///
 class   message_pool_c;
 typedef message_pool_c *    message_pool_cp;
@@ -74,6 +78,18 @@ class   message_pool_c
 				{ return(count); }
 
 
+		///
+		/// Is this message currently pending in the pool?  No side effects
+		///
+		inline
+		bool_t
+			contains(message_cr message) const
+				{
+				return(message.pool_index < count &&
+					pool.read(message.pool_index) == &message);
+				}
+
+
 		///
 		/// Add a new message to the pool.  Performance follows the
 		/// dynamic_array_m implementation
@@ -87,6 +103,8 @@ class   message_pool_c
 			pool.write(count, &message);	// Pointer copy
 			count++;
 
+			message.destination.ticket_count++;
+
 			return;
 			}
 
@@ -107,6 +125,9 @@ class   message_pool_c
 			pool.swap(victim.pool_index, count-1);
 			count--;
 
+			ASSERT(victim.destination.ticket_count > 0);
+			victim.destination.ticket_count--;
+
 			// Update the cached index of the message that took its place
 			if (count > 0)
 				{
@@ -120,6 +141,20 @@ class   message_pool_c
 			}
 
 
+		///
+		/// Return the message at the given index in the pool.  The index of
+		/// any message may change whenever another message is removed from
+		/// the pool.  No side effects
+		///
+		inline
+		message_cr
+		operator[] (uint32_t index) const
+			{
+			ASSERT(index < count);
+			return(*pool.read(index));
+			}
+
+
 		///
 		/// Select and return a random message from the pool.  The selected
 		/// message remains in the pool.  Performance follows the
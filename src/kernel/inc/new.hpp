@@ -44,7 +44,7 @@ uint32_t	MEMORY_SHARED			= 0x00400000,	// Shared frame/page
 			MEMORY_DMA16			= 0x01000000,	// 16b DMA (e.g., ISA)
 			MEMORY_DMA32			= 0x02000000,	// 32b DMA (e.g., SAC PCI)
 			MEMORY_DMA64			= 0x04000000,	// 64b DMA (e.g., DAC PCI)
-			MEMORY_UNUSED_BIT		= 0x08000000,	//@@unused/free bit
+			MEMORY_IDENTITY_MAPPED	= 0x08000000,	// Virtual == physical address
 			MEMORY_ZERO				= 0x10000000,	// Memory must be zero'd
 			MEMORY_PAGED			= 0x20000000,	// Memory may be paged out
 			MEMORY_WRITABLE			= 0x40000000,	// Memory is writable
@@ -58,6 +58,13 @@ const
 uint32_t	MEMORY_USER_DEFAULT = MEMORY_PAGED | MEMORY_WRITABLE | MEMORY_USER;
 
 
+/// Highest physical address reachable by each class of DMA device.  There
+/// is no PAE, so every frame lies below 4GB; and MEMORY_DMA64 is unlimited
+const
+uint32_t	MEMORY_DMA16_LIMIT		= 0x00FFFFFF,	// 16MB (ISA)
+			MEMORY_DMA32_LIMIT		= 0xFFFFFFFF;	// 4GB
+
+
 
 /// Extract the desired alignment from a mask of allocation flags
 inline
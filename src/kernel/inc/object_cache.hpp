@@ -0,0 +1,115 @@
+//
+// object_cache.hpp
+//
+// A cache of fixed-size kernel objects
+//
+
+#ifndef _OBJECT_CACHE_HPP
+#define _OBJECT_CACHE_HPP
+
+#include "dx/status.h"
+#include "dx/types.h"
+#include "hal/spinlock.hpp"
+
+
+
+///
+/// A cache of fixed-size objects; i.e., a simple slab allocator.  The cache
+/// carves page-sized slabs, obtained from the kernel heap, into blocks of
+/// the object size, and threads the free blocks onto a free list.  Allocation
+/// and deallocation are O(1): a block is simply popped from, or pushed onto,
+/// the free list.  When the free list is exhausted, the cache grows by one
+/// slab.  Slabs are only returned to the heap when the cache itself is
+/// destroyed.
+///
+/// This is typically useful for objects that are frequently allocated and
+/// freed (e.g., messages); and whose sizes do not match the power-of-two
+/// blocks of the kernel heap.
+///
+class   object_cache_c;
+typedef object_cache_c *    object_cache_cp;
+typedef object_cache_cp *   object_cache_cpp;
+typedef object_cache_c &    object_cache_cr;
+class   object_cache_c
+	{
+	private:
+		//
+		// Each free block in the cache is overlaid with this link
+		//
+		struct  free_object_s;
+		typedef free_object_s *    free_object_sp;
+		typedef free_object_sp *   free_object_spp;
+		typedef free_object_s &    free_object_sr;
+		struct  free_object_s
+			{
+			free_object_sp	next;
+			};
+
+
+		//
+		// Each slab begins with this link, followed by its objects
+		//
+		struct  slab_s;
+		typedef slab_s *    slab_sp;
+		typedef slab_sp *   slab_spp;
+		typedef slab_s &    slab_sr;
+		struct  slab_s
+			{
+			slab_sp		next;
+			uint32_t	reserved;	// Keeps the objects 8B-aligned
+			};
+
+
+		free_object_sp			free_list;
+		uint32_t				hit_count;
+		interrupt_spinlock_c	lock;
+		uint32_t				miss_count;
+		uint32_t				object_count;
+		const size_t			object_size;
+		const uint32_t			objects_per_slab;
+		slab_sp					slab_list;
+
+
+		status_t
+			grow();
+
+
+	protected:
+
+	public:
+		object_cache_c(size_t size);
+		~object_cache_c();
+
+
+		void_tp
+			allocate_object();
+
+		void_t
+			free_object(void_tp object);
+
+
+		//
+		// Statistics
+		//
+
+		/// Number of allocations satisfied from the free list
+		inline
+		uint32_t
+			read_hit_count() const
+				{ return(hit_count); }
+
+		/// Number of allocations that first required a new slab
+		inline
+		uint32_t
+			read_miss_count() const
+				{ return(miss_count); }
+
+		/// Total number of objects in the cache, either allocated or free
+		inline
+		uint32_t
+			read_object_count() const
+				{ return(object_count); }
+	};
+
+
+#endif
@@ -13,7 +13,9 @@
 
 
 ///
-/// A single physical frame, shared between two or more address spaces
+/// A single physical frame, shared between two or more address spaces.  The
+/// frame is released when the last reference to this descriptor disappears,
+/// unless the frame has since been detached
 ///
 class   shared_frame_c;
 typedef shared_frame_c *    shared_frame_cp;
@@ -23,7 +25,7 @@ class   shared_frame_c:
 	public counted_object_c
 	{
 	public:
-		const physical_address_t	address;
+		physical_address_t	address;
 
 
 	public:
@@ -32,6 +34,17 @@ class   shared_frame_c:
 			{ return; }
 
 		~shared_frame_c();
+
+
+		///
+		/// Transfer ownership of the underlying frame elsewhere (e.g., to
+		/// the recipient of a donated payload).  The frame is no longer
+		/// released along with this descriptor
+		///
+		inline
+		void_t
+			detach_frame()
+				{ address = INVALID_FRAME; return; }
 	};
 
 
@@ -61,6 +61,17 @@ class   small_message_c:
 			{ return; }
 
 
+		//
+		// Allocation via dedicated object cache
+		//
+		static
+		void_tp
+			operator new(size_t size);
+		static
+		void_t
+			operator delete(void_tp message);
+
+
 		status_t
 			collect_payload()
 				{ return(STATUS_SUCCESS); }
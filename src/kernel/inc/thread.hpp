@@ -13,10 +13,12 @@
 #include "dx/capability.h"
 #include "dx/compiler_dependencies.h"
 #include "dx/message_id.h"
+#include "dx/message_ring.h"
 #include "dx/status.h"
 #include "dx/thread_id.h"
 #include "dx/types.h"
 #include "hal/atomic_int32.hpp"
+#include "hal/processor.h"
 #include "hal/spinlock.hpp"
 #include "mailbox.hpp"
 
@@ -37,8 +39,10 @@ typedef void_t (*thread_start_fp)();
 ///
 typedef enum
 	{
-	THREAD_STATE_READY,
-	THREAD_STATE_BLOCKED
+	THREAD_STATE_READY,		// Eligible for execution
+	THREAD_STATE_BLOCKED,	// Waiting for a reply from some other thread
+	THREAD_STATE_WAITING,	// Waiting for any message to arrive
+	THREAD_STATE_SENDING	// Waiting for room in a full mailbox
 	} thread_state_e;
 
 
@@ -68,19 +72,36 @@ class   thread_c:
 	// The HAL touches each thread's stack context
 	friend class x86_hardware_abstraction_layer_c;
 
+	// Allow the sender queue of a mailbox to access the queue link
+	template <class DATATYPE> friend class intrusive_queue_m;
+
 
 	private:
 		message_id_t			blocking_message_id;
 		thread_cp				blocking_thread;
-		message_cp				bonus_message;
+		bool_t					bonus_pending;	// Quantum exhausted
 		capability_mask_t		capability_mask;	//@atomic_int32?
 		message_cp				deletion_acknowledgement;
+		direct_message_s		direct_message;
+		bool_t					direct_message_pending;
+		bool_t					direct_receive;	// Accepts direct messages?
 		interrupt_spinlock_c	lock;
 		mailbox_s				mailbox;
+		uint32_t				notification;	// Pending signal bits
+		thread_c*				queue_next;	// Waiting for room; see mailbox_s
+		bool_t					reply_wait;	// Only a reply wakes thread?
+		message_cp				scheduling_ticket;	// See allocate_ticket()
+		thread_cp				send_wait_thread;	// Waiting for room here
 		uint32_tp				stack_top;	//@uintptr_tp?
+		thread_cp				wakeup_thread;	// Woken via direct message
+
 
-		//@SMP: processor affinity, last processor used
 
+		//
+		// Reusable lottery ticket, for bonus messages + notifications
+		//
+		bool_t
+			allocate_ticket();
 
 
 		//
@@ -96,6 +117,24 @@ class   thread_c:
 			unblock_on(message_cr message);
 
 
+		//
+		// Asynchronous request handling
+		//
+		message_cp
+			find_reply(	message_id_t	request_id,
+						bool_t			remove);
+
+
+		//
+		// Flow control
+		//
+		void_t
+			collect_senders(thread_queue_cr sender);
+		static
+		void_t
+			wake_senders(thread_queue_cr sender);
+
+
 		//
 		// Simultaneous thread-locking
 		//
@@ -115,10 +154,37 @@ class   thread_c:
 		address_space_cr		address_space;
 		const void_tp			copy_page;		// COW support
 		const thread_id_t		id;
+		volatile uint32_t		processor;	// CPU executing this thread
 		thread_state_e			state;
 		atomic_int32_c			tick_count;
 
 
+		//
+		// Saved FPU/MMX/SSE state, if any.  Only allocated when the thread
+		// first touches the FPU; see x86_hardware_abstraction_layer_c::
+		// load_fpu_context()
+		//
+		uint8_tp				fpu_context;
+
+
+		//
+		// Scheduling state.  Only valid while holding the I/O Manager lock;
+		// see io_manager_c::select_next_thread()
+		//
+		uint32_t				pass;				// Stride-scheduling time
+		uint32_t				ready_timestamp;	// Woken at this time
+		uint32_t				ticket_count;		// Messages in the pool
+
+
+		//
+		// Asynchronous message rings, if any.  See
+		// io_manager_c::drain_message_ring()
+		//
+		message_ring_sp			message_ring;
+		bool_t					message_ring_busy;
+		uint32_t				message_ring_receive_count;
+
+
 		//
 		// Initial/startup context
 		//
@@ -138,12 +204,22 @@ class   thread_c:
 		~thread_c();
 
 
+		//
+		// Each thread context lives within its own execution block, which is
+		// recycled via the Thread Manager rather than the kernel heap
+		//
+		static
+		void_t
+			operator delete(void_tp thread);
+
+
 		//
 		// Thread cleanup
 		//
 		void_t
 			mark_for_deletion(	message_list_cr	leftover_messages,
-								message_cp		acknowlegement);
+								message_cp		acknowlegement,
+								message_cpp		ticket);
 
 
 		//
@@ -156,7 +232,49 @@ class   thread_c:
 		message_cp
 			maybe_put_bonus_message();
 		status_t
-			put_message(message_cr message);
+			put_message(message_cr	message,
+						bool_tp		waiting = NULL);
+		bool_t
+			wait_on_mailbox(bool_t accept_direct_message = FALSE);
+
+
+		//
+		// Asynchronous requests + replies
+		//
+		status_t
+			add_request(thread_id_t		destination,
+						message_id_t	request_id);
+		void_t
+			cancel_request(	thread_id_t		destination,
+							message_id_t	request_id);
+		status_t
+			get_reply(	message_cpp		message,
+						message_id_t	request_id);
+		bool_t
+			wait_on_reply(message_id_t request_id);
+
+
+		//
+		// Direct-switch message delivery + receipt
+		//
+		bool_t
+			get_direct_message(direct_message_sr message);
+		thread_cp
+			get_wakeup_thread();
+		bool_t
+			put_direct_message(const direct_message_sr message);
+
+
+		//
+		// Notifications: signal bits, delivered without allocating
+		//
+		status_t
+			enable_notification();
+		bool_t
+			get_notification(	uint32_tp	signal,
+								message_cpp	ticket);
+		message_cp
+			put_notification(uint32_t signal);
 
 
 		//
@@ -166,6 +284,8 @@ class   thread_c:
 		void_t
 			disable_mailbox()
 				{ mailbox.enabled = FALSE; }
+		status_t
+			set_mailbox_limit(uint32_t limit);
 
 
 		//
@@ -0,0 +1,109 @@
+//
+// thread_block_cache.hpp
+//
+// Allocator for thread execution blocks
+//
+
+#ifndef _THREAD_BLOCK_CACHE_HPP
+#define _THREAD_BLOCK_CACHE_HPP
+
+#include "bitmap.hpp"
+#include "dx/types.h"
+#include "hal/address_space_layout.h"
+#include "hal/spinlock.hpp"
+#include "thread_layout.h"
+
+
+
+///
+/// Maximum number of free blocks retained for reuse; and the number of
+/// bitmaps required to track every block in the thread area
+///
+const
+uint32_t	THREAD_BLOCK_CACHE_SIZE	= 64,
+			THREAD_BLOCK_MAP_COUNT	= KERNEL_THREAD_BLOCK_COUNT / 1024;
+
+
+
+///
+/// Allocator for thread execution blocks.  Each block occupies a fixed slot
+/// within the kernel thread area: an unmapped guard page, followed by a
+/// single page for the thread context + kernel stack (see thread_layout.h).
+/// This page is backed by a frame from the Page Frame Manager when the slot
+/// is first allocated.
+///
+/// Freed blocks remain mapped + are cached for reuse, so creating and
+/// destroying threads usually avoids the Page Frame Manager entirely.  Once
+/// the cache holds THREAD_BLOCK_CACHE_SIZE blocks, any additional blocks are
+/// unmapped and their frames released.
+///
+class   thread_block_cache_c;
+typedef thread_block_cache_c *    thread_block_cache_cp;
+typedef thread_block_cache_cp *   thread_block_cache_cpp;
+typedef thread_block_cache_c &    thread_block_cache_cr;
+class   thread_block_cache_c
+	{
+	private:
+		//
+		// Each cached block is overlaid with this link, at the start of its
+		// mapped page
+		//
+		struct  free_block_s;
+		typedef free_block_s *    free_block_sp;
+		typedef free_block_sp *   free_block_spp;
+		typedef free_block_s &    free_block_sr;
+		struct  free_block_s
+			{
+			free_block_sp	next;
+			};
+
+
+		uint32_t				cache_count;
+		free_block_sp			free_list;
+		uint32_t				hit_count;
+		interrupt_spinlock_c	lock;
+		uint32_t				miss_count;
+		bitmap1024_c			slot_map[ THREAD_BLOCK_MAP_COUNT ];
+
+
+		uint8_tp
+			allocate_slot();
+
+		void_t
+			free_slot(const uint8_tp block);
+
+
+	protected:
+
+	public:
+		thread_block_cache_c();
+		~thread_block_cache_c()
+			{ return; }
+
+
+		uint8_tp
+			allocate_block();
+
+		void_t
+			free_block(void_tp block);
+
+
+		//
+		// Statistics
+		//
+
+		/// Number of allocations satisfied from the cache
+		inline
+		uint32_t
+			read_hit_count() const
+				{ return(hit_count); }
+
+		/// Number of allocations that required a new frame
+		inline
+		uint32_t
+			read_miss_count() const
+				{ return(miss_count); }
+	};
+
+
+#endif
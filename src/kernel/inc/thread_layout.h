@@ -1,9 +1,11 @@
 //
 // thread_layout.h
 //
-// Memory layout of each thread execution block.  Each such block is a
-// single memory page consisting of two components: the actual thread_c
-// context (at the low addresses) + its kernel stack (at the high addresses).
+// Memory layout of each thread execution block.  Each such block spans two
+// memory pages.  The lower page is an unmapped guard page, which catches
+// overflows of the kernel stack.  The upper page consists of two components:
+// the actual thread_c context (at the high addresses) + its kernel stack,
+// which grows down from just beneath the context.
 //
 
 #ifndef _THREAD_LAYOUT_H
@@ -13,19 +15,29 @@
 
 
 //
-// Each block is a single memory page
+// Each block is two memory pages, naturally aligned
 //
-#define THREAD_EXECUTION_BLOCK_SIZE				PAGE_SIZE
-#define THREAD_EXECUTION_BLOCK_ALIGNMENT		PAGE_SIZE
+#define THREAD_EXECUTION_BLOCK_SIZE				(2 * PAGE_SIZE)
+#define THREAD_EXECUTION_BLOCK_ALIGNMENT		THREAD_EXECUTION_BLOCK_SIZE
+#define THREAD_GUARD_PAGE_SIZE					PAGE_SIZE
+
+
+//
+// Space reserved for the thread_c context at the top of the block.  The
+// context is also the base of the kernel stack
+//
+#define THREAD_CONTEXT_SIZE						288
+#define THREAD_CONTEXT_OFFSET					\
+	(THREAD_EXECUTION_BLOCK_SIZE - THREAD_CONTEXT_SIZE)
 
 
 //
 // Given a stack pointer (or any other offset into the page that hosts the
-// thread block), mask off the lower bits to locate the thread_c object
+// thread block), mask off the lower bits to locate the start of the block;
+// the thread_c object is then at THREAD_CONTEXT_OFFSET within the block
 //
 #define THREAD_EXECUTION_BLOCK_ALIGNMENT_MASK	\
 	(~(THREAD_EXECUTION_BLOCK_ALIGNMENT - 1))
 
 
 #endif
-
@@ -17,6 +17,7 @@
 #include "hal/spinlock.hpp"
 #include "hash_table.hpp"
 #include "thread.hpp"
+#include "thread_block_cache.hpp"
 
 
 
@@ -56,6 +57,7 @@ class   thread_manager_c
 	private:
 		interrupt_spinlock_c	lock;
 		uint32_t				next_thread_id;
+		thread_block_cache_c	thread_block_cache;
 		thread_table_c			thread_table;
 
 
@@ -86,6 +88,8 @@ class   thread_manager_c
 		//
 		// Basic thread management
 		//
+		thread_cp
+			create_idle_thread(uint32_t processor);
 		thread_cp
 			create_thread(	thread_start_fp		kernel_start,
 							address_space_cp	address_space,
@@ -100,6 +104,14 @@ class   thread_manager_c
 							message_cp		acknowledgement = NULL);
 		thread_cp
 			find_thread(thread_id_t thread_id);
+
+		///
+		/// Release the execution block of a destroyed thread.  See
+		/// thread_c::operator delete()
+		///
+		void_t
+			free_thread_block(void_tp thread)
+				{ thread_block_cache.free_block(thread); }
 	};
 
 
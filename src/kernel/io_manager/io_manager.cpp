@@ -5,6 +5,7 @@
 //
 
 
+#include "dx/signal_thread.h"
 #include "dx/system_call_vectors.h"
 #include "dx/thread_id.h"
 #include "hal/address_space_layout.h"
@@ -13,7 +14,10 @@
 #include "kernel_panic.hpp"
 #include "kernel_subsystems.hpp"
 #include "kernel_threads.hpp"
+#include "klibc.hpp"
+#include "large_message.hpp"
 #include "medium_message.hpp"
+#include "multiboot.hpp"
 #include "small_message.hpp"
 
 
@@ -25,19 +29,70 @@ io_manager_cp	__io_manager = NULL;
 
 
 
+///
+/// Determines whether the given thread may execute on the given processor.
+/// A thread that is waiting for a message cannot execute anywhere; a thread
+/// that is already executing on some other processor cannot also execute
+/// here; and each idle thread only executes on its own processor.  Assumes
+/// the caller holds the I/O Manager lock.  No side effects.
+///
+/// @return TRUE if the thread may be dispatched on this processor; FALSE
+/// otherwise
+///
+static
+inline
+bool_t
+can_run_on(	thread_cr	thread,
+			uint32_t	processor)
+	{
+	bool_t runnable = TRUE;
+
+	if (thread.state != THREAD_STATE_READY)
+		{ runnable = FALSE; }
+	else if (thread.processor != PROCESSOR_INDEX_INVALID &&
+		thread.processor != processor)
+		{ runnable = FALSE; }
+	else if (is_idle_thread(thread) && thread != *__idle_thread[ processor ])
+		{ runnable = FALSE; }
+
+	return(runnable);
+	}
+
+
+
 
 io_manager_c::
 io_manager_c():
 	direct_handoff_count(0),
-	idle_count(0),
+	direct_message_count(0),
 	incomplete_count(0),
 	lottery_count(0),
 	message_count(0),
 	receive_error_count(0),
-	send_error_count(0)
+	send_error_count(0),
+	send_wait_count(0),
+	scheduling_policy(SCHEDULING_POLICY_LOTTERY),
+	stride_pass(0)
 	{
 	TRACE(ALL, "Initializing I/O Manager ...\n");
 
+	memset(scheduling_latency, 0, sizeof(scheduling_latency));
+
+
+	//
+	// The scheduling policy is fixed at boot.  Threads are selected by
+	// lottery, unless the kernel command line requests the deterministic
+	// stride scheduler instead
+	//
+	if ((__multiboot_data->flags & MULTIBOOT_DATA_COMMAND_LINE) &&
+		__multiboot_data->command_line &&
+		strstr(__multiboot_data->command_line, "scheduler=stride"))
+		{
+		scheduling_policy = SCHEDULING_POLICY_STRIDE;
+		}
+	TRACE(ALL, "Using %s scheduler\n",
+		(scheduling_policy == SCHEDULING_POLICY_STRIDE ? "stride" : "lottery"));
+
 
 	//
 	// Seed the PRNG before holding any lotteries
@@ -126,6 +181,62 @@ abort_send_message(	thread_cr		current_thread,
 	}
 
 
+///
+/// Claim a message just removed from the mailbox (or reply queue) of the
+/// current thread: remove it from the lottery pool; and deliver its payload,
+/// if any, into the current address space.  If the payload cannot be
+/// delivered, then the message is discarded, and its sender is notified if
+/// it expects a reply.  See get_message() and receive_reply().
+///
+/// @param message -- the message to claim; reset to NULL on failure
+///
+/// @return STATUS_SUCCESS if the message now belongs to the current thread;
+/// non-zero otherwise
+///
+status_t io_manager_c::
+claim_message(message_cpp message)
+	{
+	status_t status;
+
+	ASSERT(message != NULL);
+	ASSERT(*message != NULL);
+
+
+	//
+	// Remove this message from the global pool of pending messages; since
+	// the current thread has claimed it, it no longer counts towards
+	// future lotteries
+	//
+	lock.acquire();
+	ASSERT(!pending_messages.is_empty());
+	pending_messages -= **message;
+	lock.release();
+
+
+	//
+	// Deliver the message payload, if any, into the address space of
+	// the current thread (i.e., this makes the message payload
+	// visible/available to the recipient).  This potentially faults
+	// if the payload destination is paged-out, so avoid holding any
+	// locks here
+	//
+	status = (*message)->deliver_payload();
+	if (status != STATUS_SUCCESS)
+		{
+		TRACE(ALL, "Unable to deliver message payload\n");
+		receive_error_count++;
+
+		if ((*message)->expects_reply())
+			put_response(**message, MESSAGE_TYPE_ABORT, STATUS_IO_ERROR);
+
+		delete(*message);
+		*message = NULL;
+		}
+
+	return(status);
+	}
+
+
 ///
 /// In preparation for its deletion, discard any messages pending for the
 /// victim thread + prevent it from being rescheduled.  On return, the thread
@@ -137,14 +248,17 @@ void_t io_manager_c::
 delete_messages(thread_cr	victim_thread,
 				message_cp	acknowledgement)
 	{
-	uint32_t		i;
-	message_list_c	leftover_message;
+	direct_message_s	direct_message;
+	uint32_t			i;
+	message_list_c		leftover_message;
+	message_cp			ticket;
 
 
 	//
 	// Disable the victim's mailbox and flush any leftover messages
 	//
-	victim_thread.mark_for_deletion(leftover_message, acknowledgement);
+	victim_thread.mark_for_deletion(leftover_message, acknowledgement,
+		&ticket);
 
 
 	//
@@ -166,8 +280,16 @@ delete_messages(thread_cr	victim_thread,
 		pending_messages -= message;
 		}
 
+	// The scheduling ticket is only pooled while the victim had a bonus or
+	// signals pending.  Either way, it is no longer needed
+	if (ticket && pending_messages.contains(*ticket))
+		{ pending_messages -= *ticket; }
+
 	lock.release();
 
+	if (ticket)
+		{ delete(ticket); }
+
 
 	//
 	// Here, the victim thread may still be active, but it cannot receive any
@@ -183,7 +305,7 @@ delete_messages(thread_cr	victim_thread,
 		{
 		message_cr	message = leftover_message[i];
 
-		if (message.is_blocking())
+		if (message.expects_reply())
 			put_response(message, MESSAGE_TYPE_ABORT, STATUS_THREAD_EXITED);
 
 		// The original message is no longer needed: the victim thread will
@@ -192,6 +314,150 @@ delete_messages(thread_cr	victim_thread,
 		}
 
 
+	//
+	// Likewise abort any direct request that the victim never received
+	//
+	if (victim_thread.get_direct_message(direct_message) &&
+		direct_message.is_blocking())
+		{
+		thread_cp sender = __thread_manager->find_thread(direct_message.source);
+		if (sender)
+			{
+			::put_message(	victim_thread,
+							*sender,
+							MESSAGE_TYPE_ABORT,
+							direct_message.id,
+							void_tp(STATUS_THREAD_EXITED));
+			remove_reference(*sender);
+			}
+		}
+
+
+	return;
+	}
+
+
+///
+/// Drain the submission ring of the given thread, then fulfil any pending
+/// receive operations from its mailbox.  The outcome of each operation is
+/// posted on the thread's completion ring.  Send + delete operations execute
+/// immediately; each receive operation remains pending until a message is
+/// available.  If the completion ring fills, the remaining operations are
+/// deferred until the next drain.  See dx/message_ring.h.
+///
+/// The thread must be the current thread, since its rings (and any message
+/// payloads) are only visible within its own address space.  Each clock tick
+/// that preempts user code also drains the ring, with wait_for_completion
+/// FALSE, as the thread returns to user mode; see dispatch_interrupt().
+///
+/// @param thread				-- the current thread
+/// @param wait_for_completion	-- if no completions are pending, and the
+///								   thread is waiting to receive a message,
+///								   then block until a message arrives
+///
+void_t io_manager_c::
+drain_message_ring(	thread_cr	thread,
+					bool_t		wait_for_completion)
+	{
+	uint32_t			completion_tail;
+	uint32_t			head;
+	message_operation_s	operation;
+	message_ring_sp		ring = thread.message_ring;
+	uint32_t			tail;
+
+
+	ASSERT(&thread == &__hal->read_current_thread());
+
+	do
+		{
+		//
+		// Nothing to do here if the thread has no rings; or if an earlier
+		// drain is still under way
+		//
+		if (!ring || thread.message_ring_busy)
+			break;
+
+		thread.message_ring_busy = TRUE;
+
+
+		//
+		// Drain the submission ring.  The ring indices are writable by the
+		// thread, so sanity-check them first
+		//
+		head			= ring->submission_head;
+		tail			= ring->submission_tail;
+		completion_tail	= ring->completion_tail;
+		if (tail - head > MESSAGE_RING_SIZE)
+			{
+			TRACE(ALL, "Discarding corrupt message ring (%#x, %#x) "
+				"on thread %#x\n", head, tail, thread.id);
+			head = tail;
+			}
+
+		for (; head != tail; head++)
+			{
+			// Stop if there is no room for any more completions
+			if (completion_tail - ring->completion_head >= MESSAGE_RING_SIZE)
+				break;
+
+			// Copy the operation out of the ring, so the thread cannot
+			// modify it while it is in progress
+			operation = ring->submission[ head & MESSAGE_RING_MASK ];
+
+			if (operation.type == MESSAGE_OPERATION_RECEIVE ||
+				operation.type == MESSAGE_OPERATION_RECEIVE_WAIT)
+				{
+				// Fulfilled below, whenever a message is available
+				thread.message_ring_receive_count++;
+				}
+			else
+				{
+				// Never block here on a reply; the thread may poll again
+				if (operation.type == MESSAGE_OPERATION_RECEIVE_REPLY_WAIT)
+					{ operation.type = MESSAGE_OPERATION_RECEIVE_REPLY; }
+
+				// Nor wait for room in a full mailbox
+				process_message(&operation, FALSE);
+				ring->completion[ completion_tail & MESSAGE_RING_MASK ] =
+					operation;
+				completion_tail++;
+				}
+			}
+
+		ring->submission_head = head;
+
+
+		//
+		// Now fulfil any pending receive operations.  Only block if the
+		// thread has nothing else to consume
+		//
+		while (thread.message_ring_receive_count > 0 &&
+			completion_tail - ring->completion_head < MESSAGE_RING_SIZE)
+			{
+			operation.type =
+				(wait_for_completion && completion_tail == ring->completion_head ?
+				MESSAGE_OPERATION_RECEIVE_WAIT : MESSAGE_OPERATION_RECEIVE);
+			process_message(&operation, FALSE);
+			if (operation.status == STATUS_MAILBOX_EMPTY)
+				break;
+
+			ring->completion[ completion_tail & MESSAGE_RING_MASK ] = operation;
+			completion_tail++;
+			thread.message_ring_receive_count--;
+			}
+
+
+		//
+		// Publish the new completions.  The entries themselves must be
+		// visible before the updated tail
+		//
+		__asm volatile("" : : : "memory");
+		ring->completion_tail = completion_tail;
+
+		thread.message_ring_busy = FALSE;
+
+		} while(0);
+
 	return;
 	}
 
@@ -242,37 +508,11 @@ get_message(message_cpp message)
 
 
 		//
-		// Remove this message from the global pool of pending messages; since
-		// the current thread has claimed it, it no longer counts towards
-		// future lotteries
+		// Claim the message + its payload
 		//
-		lock.acquire();
-		ASSERT(*message != NULL);
-		ASSERT(!pending_messages.is_empty());
-		pending_messages -= **message;
-		lock.release();
-
-
-		//
-		// Deliver the message payload, if any, into the address space of
-		// the current thread (i.e., this makes the message payload
-		// visible/available to the recipient).  This potentially faults
-		// if the payload destination is paged-out, so avoid holding any
-		// locks here
-		//
-		status = (*message)->deliver_payload();
+		status = claim_message(message);
 		if (status != STATUS_SUCCESS)
-			{
-			TRACE(ALL, "Unable to deliver message payload\n");
-			receive_error_count++;
-
-			if ((*message)->is_blocking())
-				put_response(**message, MESSAGE_TYPE_ABORT, STATUS_IO_ERROR);
-
-			delete(*message);
-			*message = NULL;
-			break;
-			}
+			{ break; }
 
 
 		//
@@ -288,6 +528,51 @@ get_message(message_cpp message)
 	}
 
 
+///
+/// Collects all signals, if any, pending for the given thread, as a direct
+/// message of type MESSAGE_TYPE_NOTIFICATION from the null thread; the
+/// payload holds the signal bits.  When nothing else is pending, the thread's
+/// scheduling ticket leaves the lottery pool.  See put_notification().
+///
+/// The thread must be the current thread
+///
+/// @param thread	-- the current thread
+/// @param message	-- on success, receives the notification
+///
+/// @return TRUE if any signals were pending; FALSE otherwise
+///
+bool_t io_manager_c::
+get_notification(	thread_cr			thread,
+					direct_message_sr	message)
+	{
+	bool_t		pending;
+	uint32_t	signal;
+	message_cp	ticket;
+
+	lock.acquire();
+	pending = thread.get_notification(&signal, &ticket);
+	if (ticket)
+		{ pending_messages -= *ticket; }
+	lock.release();
+
+	if (pending)
+		{
+		ASSERT(__null_thread);
+		message.control	= 0;
+		message.id		= MESSAGE_ID_ATOMIC;
+		message.payload	= signal;
+		message.source	= __null_thread->id;
+		message.type	= MESSAGE_TYPE_NOTIFICATION;
+
+		// Interrupt handlers are signalled on the bit of their IRQ line
+		ASSERT(__device_proxy);
+		__device_proxy->record_interrupt_latency(signal);
+		}
+
+	return(pending);
+	}
+
+
 ///
 /// Interrupt handler for scheduling- and messaging-related vectors.  All
 /// context switches (via IRQ0 clock ticks) + IPC/message transactions (via
@@ -304,6 +589,7 @@ handle_interrupt(interrupt_cr interrupt)
 	switch(interrupt.vector)
 		{
 		case INTERRUPT_VECTOR_PIC_IRQ0:
+		case INTERRUPT_VECTOR_LOCAL_TIMER:
 			//
 			// Boot-time initialization?
 			//
@@ -312,20 +598,36 @@ handle_interrupt(interrupt_cr interrupt)
 
 
 			//
-			// The current thread has consumed another clock tick
+			// Drain the message rings of the current thread, if any, so
+			// that its submissions make progress without any system calls.
+			// The drain itself is deferred until the thread returns to user
+			// mode, outside of this handler.  Only when the tick has
+			// preempted user code: otherwise the thread was already inside
+			// the kernel, perhaps holding locks, so the drain waits for a
+			// later tick, or for the next ENTER_MESSAGE_RING call
+			//
+			if (current_thread.message_ring && interrupt.is_user_interrupt())
+				{ interrupt.request_message_ring_drain(); }
+
+
+			//
+			// The current thread has consumed another clock tick.  The idle
+			// thread only sees a tick when it should look for work again;
+			// see hal::stop_clock_tick()
 			//
-			if (current_thread.tick_count.decrement_and_read() > 0)
+			if (current_thread.tick_count.decrement_and_read() > 0 &&
+				!is_idle_thread(current_thread))
 				{ break; }
 
 
 			//
 			// The current thread is unwillingly losing the CPU, so send it
 			// an empty message to ensure it is still a lottery candidate.
-			// The idle thread does not compete for wakeup, so it does not need
+			// The idle threads do not compete for wakeup, so they do not need
 			// these messages; this also avoids unnecessary lotteries when no
 			// threads are ready to execute
 			//
-			if (current_thread != *__null_thread)
+			if (!is_idle_thread(current_thread))
 				{
 				__io_manager->lock.acquire();
 				message = current_thread.maybe_put_bonus_message();
@@ -369,7 +671,62 @@ handle_interrupt(interrupt_cr interrupt)
 		case SYSTEM_CALL_VECTOR_SEND_MESSAGE:
 			syscall = interrupt.validate_syscall();
 			if (syscall)
-				{ __io_manager->syscall_send_message(syscall); }
+				{
+				__io_manager->syscall_send_message(syscall,
+					MESSAGE_CONTROL_NONE, TRUE);
+				}
+			break;
+
+
+		case SYSTEM_CALL_VECTOR_SEND_DONATED_MESSAGE:
+			syscall = interrupt.validate_syscall();
+			if (syscall)
+				{
+				__io_manager->syscall_send_message(syscall,
+					MESSAGE_CONTROL_DONATE, TRUE);
+				}
+			break;
+
+
+		case SYSTEM_CALL_VECTOR_SEND_GATHERED_MESSAGE:
+			syscall = interrupt.validate_syscall();
+			if (syscall)
+				{ __io_manager->syscall_send_gathered_message(syscall); }
+			break;
+
+
+		case SYSTEM_CALL_VECTOR_CREATE_MESSAGE_RING:
+			syscall = interrupt.validate_syscall();
+			if (syscall)
+				{ __io_manager->syscall_create_message_ring(syscall); }
+			break;
+
+
+		case SYSTEM_CALL_VECTOR_ENTER_MESSAGE_RING:
+			syscall = interrupt.validate_syscall();
+			if (syscall)
+				{ __io_manager->syscall_enter_message_ring(syscall); }
+			break;
+
+
+		case SYSTEM_CALL_VECTOR_PROCESS_MESSAGES:
+			syscall = interrupt.validate_syscall();
+			if (syscall)
+				{ __io_manager->syscall_process_messages(syscall); }
+			break;
+
+
+		case SYSTEM_CALL_VECTOR_SET_MAILBOX_LIMIT:
+			syscall = interrupt.validate_syscall();
+			if (syscall)
+				{ __io_manager->syscall_set_mailbox_limit(syscall); }
+			break;
+
+
+		case SYSTEM_CALL_VECTOR_SIGNAL_THREAD:
+			syscall = interrupt.validate_syscall();
+			if (syscall)
+				{ __io_manager->syscall_signal_thread(syscall); }
 			break;
 
 
@@ -403,6 +760,30 @@ handle_interrupt(interrupt_cr interrupt)
 	}
 
 
+///
+/// Preempts the idle thread, if it is executing on the current processor, so
+/// that any work made ready by the current interrupt executes immediately.
+/// The idle processor has no clock tick to trigger a reschedule; see
+/// select_next_thread().  Assumes the caller is an interrupt handler.
+///
+/// @param interrupt -- the interrupt that may have created new work
+///
+void_t io_manager_c::
+preempt_idle_thread(interrupt_cr interrupt)
+	{
+	thread_cr current_thread = __hal->read_current_thread();
+
+	if (is_idle_thread(current_thread) && !interrupt.is_thread_switch_pending())
+		{
+		thread_cr next_thread = select_next_thread(current_thread);
+		if (next_thread != current_thread)
+			{ interrupt.trigger_thread_switch(next_thread); }
+		}
+
+	return;
+	}
+
+
 ///
 /// Queues the given message to its destination thread/mailbox.
 ///
@@ -412,18 +793,31 @@ handle_interrupt(interrupt_cr interrupt)
 /// message cannot be delivered, then the current thread (i.e., the sender)
 /// still owns the message and is responsible for freeing it.
 ///
-/// Non-blocking.  May safely be invoked from interrupt context if necessary.
-/// If invoked from a hardware interrupt handler, the request must *not* be
-/// marked as blocking.
+/// If the destination mailbox is full, the message is refused with
+/// STATUS_WOULD_BLOCK; unless the caller allows the current thread to wait
+/// for room, in which case the current thread yields until the recipient
+/// drains its mailbox, and then retries.  See thread_c::put_message()
+///
+/// Otherwise non-blocking.  May safely be invoked from interrupt context if
+/// necessary, but only without waiting for room.  If invoked from a hardware
+/// interrupt handler, the request must *not* be marked as blocking.
+///
+/// @param message			-- the message to send
+/// @param wait_for_room	-- may the current thread wait for room in a
+///							full mailbox?
 ///
 /// Returns STATUS_SUCCESS if the message was successfully sent; or
 /// non-zero error otherwise.
 ///
 status_t io_manager_c::
-put_message(message_cr message)
+put_message(message_cr	message,
+			bool_t		wait_for_room)
 	{
+	message_cp	bonus;
+	uintptr_t	interrupt_state;
 	status_t	status;
 	thread_cr	thread = message.destination;
+	bool_t		waiting;
 
 	do
 		{
@@ -463,25 +857,64 @@ put_message(message_cr message)
 		// Precondition: the message is queued in neither the destination
 		// maibox nor the lottery pool
 		//
-		lock.acquire();
-		status = thread.put_message(message);
-		if (status == STATUS_SUCCESS)
-			{
-			// This message is now queued on in this mailbox; so update the
-			// global pool of pending messages so that the mailbox owner
-			// is eligible for the lottery
-			pending_messages += message;
-			message_count++;
-			}
-		else
+		// If the destination mailbox is full, the current thread may be
+		// marked as waiting for room; in that case, yield until the
+		// recipient wakes it, then try again.  Disable interrupts so the
+		// thread cannot be preempted before it yields
+		//
+		do
 			{
-			// Message delivery failed.  The current thread remains the
-			// owner of the message + is responsible for message
-			// retransmission/deletion
-			send_error_count++;
-			}
+			interrupt_state = __hal->disable_interrupts();
+			lock.acquire();
 
-		lock.release();
+			status = thread.put_message(message,
+				(wait_for_room ? &waiting : NULL));
+			if (status == STATUS_SUCCESS)
+				{
+				// This message is now queued on in this mailbox; so update
+				// the global pool of pending messages so that the mailbox
+				// owner is eligible for the lottery
+				pending_messages += message;
+				message_count++;
+				waiting = FALSE;
+
+				// If this message wakes the recipient, start measuring its
+				// scheduling latency
+				if (thread.ticket_count == 1 &&
+					thread.state == THREAD_STATE_READY &&
+					thread.processor == PROCESSOR_INDEX_INVALID)
+					{ thread.ready_timestamp = __hal->read_timestamp32(); }
+				}
+			else if (wait_for_room && waiting)
+				{
+				// The mailbox is full; wait for room + then retry.  Pool a
+				// bonus message for the current thread, if necessary, so
+				// that it can still win the CPU once it is woken
+				send_wait_count++;
+				bonus = __hal->read_current_thread().maybe_put_bonus_message();
+				if (bonus)
+					{
+					pending_messages += *bonus;
+					message_count++;
+					}
+				}
+			else
+				{
+				// Message delivery failed.  The current thread remains the
+				// owner of the message + is responsible for message
+				// retransmission/deletion
+				send_error_count++;
+				waiting = FALSE;
+				}
+
+			lock.release();
+
+			if (waiting)
+				{ thread_yield(); }
+
+			__hal->enable_interrupts(interrupt_state);
+
+			} while(waiting);
 
 		//
 		// Postcondition: the message is now pending in both the mailbox + the
@@ -491,85 +924,276 @@ put_message(message_cr message)
 		} while(0);
 
 
-	//
-	// If this request failed because the destination mailbox is full, then
-	// assume the parent thread has crashed/hung or is otherwise unresponsive;
-	// in this situation, automatically kill the mailbox owner
-	//
-	if (status == STATUS_MAILBOX_OVERFLOW)
-		{
-		ASSERT(__cleanup_thread != NULL);
-		ASSERT(__null_thread != NULL);
-
-		printf("Killing thread %#x after mailbox overflow\n", thread.id);
-		::put_message(	*__null_thread,
-						*__cleanup_thread,
-						MESSAGE_TYPE_DELETE_THREAD,
-						MESSAGE_ID_ATOMIC,
-						void_tp(thread.id));
-		}
-
-
 	return(status);
 	}
 
 
 ///
-/// Read the messaging + scheduling statistics.  Usually only invoked in the
-/// context of a SYSTEM_CALL_VECTOR_READ_KERNEL_STATS syscall.
+/// Signal the given thread, by raising these bits in its notification word.
+/// The thread receives all of its pending signals at once, as a direct
+/// message, the next time it receives; meanwhile its scheduling ticket keeps
+/// it eligible for the lottery.  Repeated signals before the thread receives
+/// are coalesced.  See thread_c::put_notification().
 ///
-/// @param kernel_stats -- kernel statistics structure, provided by user thread
+/// Non-blocking and never allocates memory, so this is safe to invoke from a
+/// hardware interrupt handler, provided the thread has already enabled
+/// notification; see thread_c::enable_notification()
+///
+/// @param thread	-- the thread to signal
+/// @param signal	-- the signal bits to raise
 ///
 void_t io_manager_c::
-read_stats(volatile kernel_stats_s& kernel_stats)
+put_notification(	thread_cr	thread,
+					uint32_t	signal)
 	{
-	// Messaging stats
-	kernel_stats.message_count			= message_count;
-	kernel_stats.pending_count			= pending_messages.read_count();
-	kernel_stats.incomplete_count		= incomplete_count;
-	kernel_stats.receive_error_count	= receive_error_count;
-	kernel_stats.send_error_count		= send_error_count;
+	message_cp ticket;
 
-	// Lottery/scheduling stats
-	kernel_stats.lottery_count			= lottery_count;
-	kernel_stats.idle_count				= idle_count;
-	kernel_stats.direct_handoff_count	= direct_handoff_count;
+	lock.acquire();
+
+	ticket = thread.put_notification(signal);
+	if (ticket)
+		{
+		pending_messages += *ticket;
+
+		// As in put_message(), start measuring the scheduling latency of
+		// a thread woken here
+		if (thread.ticket_count == 1 &&
+			thread.state == THREAD_STATE_READY &&
+			thread.processor == PROCESSOR_INDEX_INVALID)
+			{ thread.ready_timestamp = __hal->read_timestamp32(); }
+		}
+
+	lock.release();
 
 	return;
 	}
 
 
 ///
-/// Retrieves the next message, if any, pending for the current thread.
-/// If a message is successfully retrieved, the current thread owns the message
-/// and is responsible for its cleanup.  See io_manager::get_message().
+/// Process a single message operation on behalf of the current thread.  Each
+/// operation is translated into the arguments for its equivalent system call,
+/// so it behaves exactly as if the thread had issued the SEND_MESSAGE,
+/// RECEIVE_MESSAGE or DELETE_MESSAGE system call itself.  Asynchronous
+/// requests + replies have no system call of their own, and are only
+/// available here.  See syscall_process_messages() and drain_message_ring().
 ///
-/// This logic executes in the context of the actual recipient/destination
-/// thread (i.e., the current thread should be retrieving a message from
-/// its own mailbox).  More specifically, this logic executes in the address
-/// space of the recipient, and therefore mapping the message payload (if
-/// any) into the current address space makes it visible to to the recipient.
+/// @param operation		-- the operation to process.  On return, its status
+///							is updated; and a receive operation holds the
+///							incoming message
+/// @param wait_for_room	-- may a send operation wait for room in a full
+///							mailbox?
 ///
-/// The current thread may block here until a message arrives, if the
-/// specified mailbox is currently empty and the caller has specified
-/// wait_for_message.  May be safely invoked from within a system-call handler;
-/// should not be invoked from a hardware interrupt handler (because of
-/// the risk of blocking) unless wait_for_message is FALSE.
+/// @return STATUS_SUCCESS if the operation was processed, whatever its own
+/// outcome; STATUS_INVALID_DATA if the operation type is not recognized
 ///
-/// @param message			-- on success, points to retrieved message
-/// @param wait_for_message	-- whether to wait (block) until a message arrives,
+status_t io_manager_c::
+process_message(message_operation_sp	operation,
+				bool_t					wait_for_room)
+	{
+	message_operation_s	copy;
+	message_s&			message	= copy.message;
+	syscall_data_s		request;
+	status_t			status	= STATUS_SUCCESS;
+
+
+	//
+	// The operation may lie in user memory, where the thread can rewrite it
+	// at any time.  Snapshot it once, and only ever use the snapshot
+	//
+	copy = *operation;
+
+	request.size	= sizeof(request);
+	request.status	= STATUS_INVALID_DATA;
+
+	switch(copy.type)
+		{
+		case MESSAGE_OPERATION_SEND:
+		case MESSAGE_OPERATION_SEND_REQUEST:
+			request.data0 = uintptr_t(message.u.destination);
+			request.data1 = uintptr_t(message.type);
+			request.data2 = uintptr_t(message.id);
+			request.data3 = uintptr_t(message.data);
+			request.data4 = uintptr_t(message.data_size);
+			request.data5 = uintptr_t(message.destination_address);
+			if (copy.type == MESSAGE_OPERATION_SEND_REQUEST)
+				syscall_send_request(&request, wait_for_room);
+			else
+				syscall_send_message(&request, MESSAGE_CONTROL_NONE,
+					wait_for_room);
+			break;
+
+		case MESSAGE_OPERATION_RECEIVE:
+		case MESSAGE_OPERATION_RECEIVE_WAIT:
+		case MESSAGE_OPERATION_RECEIVE_REPLY:
+		case MESSAGE_OPERATION_RECEIVE_REPLY_WAIT:
+			if (copy.type == MESSAGE_OPERATION_RECEIVE ||
+				copy.type == MESSAGE_OPERATION_RECEIVE_WAIT)
+				{
+				request.data0 = uintptr_t(copy.type ==
+					MESSAGE_OPERATION_RECEIVE_WAIT);
+				syscall_receive_message(&request);
+				}
+			else
+				{
+				request.data0 = uintptr_t(copy.type ==
+					MESSAGE_OPERATION_RECEIVE_REPLY_WAIT);
+				request.data1 = uintptr_t(message.id);
+				syscall_receive_reply(&request);
+				}
+
+			if (request.status == STATUS_SUCCESS)
+				{
+				message.u.source			= thread_id_t(request.data0);
+				message.type				= message_type_t(request.data1);
+				message.id					= message_id_t(request.data2);
+				message.data				= void_tp(request.data3);
+				message.data_size			= size_t(request.data4);
+				message.destination_address	= NULL;
+
+				// Return the incoming message to the caller
+				operation->message = message;
+				}
+			break;
+
+		case MESSAGE_OPERATION_DELETE:
+			request.data0 = uintptr_t(message.data);
+			request.data1 = uintptr_t(message.data_size);
+			syscall_delete_message(&request);
+			break;
+
+		default:
+			TRACE(ALL, "Invalid message operation %#x\n", copy.type);
+			status = STATUS_INVALID_DATA;
+			break;
+		}
+
+	operation->status = request.status;
+
+	return(status);
+	}
+
+
+///
+/// Process a batch of message operations on behalf of the current thread, in
+/// order.  A failed operation does not prevent the remaining operations from
+/// executing; but processing stops at the first operation of an unrecognized
+/// type, and none of the operations after it are touched.  See
+/// process_message()
+///
+/// @param operation	-- the list of operations
+/// @param count		-- the number of operations
+/// @param processed	-- on return, the number of operations processed
+///
+/// @return STATUS_SUCCESS if every operation was processed; non-zero if the
+/// batch stopped at an invalid operation
+///
+status_t io_manager_c::
+process_messages(	message_operation_sp	operation,
+					uint32_t				count,
+					uint32_tp				processed)
+	{
+	uint32_t	i;
+	status_t	status = STATUS_SUCCESS;
+
+	ASSERT(processed);
+
+	for (i = 0; i < count; i++)
+		{
+		status = process_message(&operation[i], TRUE);
+		if (status != STATUS_SUCCESS)
+			break;
+		}
+
+	*processed = i;
+
+	return(status);
+	}
+
+
+///
+/// Read the messaging + scheduling statistics.  Usually only invoked in the
+/// context of a SYSTEM_CALL_VECTOR_READ_KERNEL_STATS syscall.
+///
+/// @param kernel_stats -- kernel statistics structure, provided by user thread
+///
+void_t io_manager_c::
+read_stats(volatile kernel_stats_s& kernel_stats)
+	{
+	// Messaging stats
+	kernel_stats.message_count			= message_count;
+	kernel_stats.direct_message_count	= direct_message_count;
+	kernel_stats.pending_count			= pending_messages.read_count();
+	kernel_stats.incomplete_count		= incomplete_count;
+	kernel_stats.receive_error_count	= receive_error_count;
+	kernel_stats.send_error_count		= send_error_count;
+	kernel_stats.send_wait_count		= send_wait_count;
+
+	// Scheduling stats
+	kernel_stats.scheduling_policy	= scheduling_policy;
+	for (uint32_t i = 0; i < SCHEDULING_LATENCY_BUCKET_COUNT; i++)
+		{ kernel_stats.scheduling_latency[i] = scheduling_latency[i]; }
+
+	// Message cache stats
+	kernel_stats.message_cache_hit_count	=
+		__large_message_cache->read_hit_count() +
+		__medium_message_cache->read_hit_count() +
+		__small_message_cache->read_hit_count();
+	kernel_stats.message_cache_miss_count	=
+		__large_message_cache->read_miss_count() +
+		__medium_message_cache->read_miss_count() +
+		__small_message_cache->read_miss_count();
+
+	// Lottery/scheduling stats
+	kernel_stats.lottery_count			= lottery_count;
+	kernel_stats.idle_count				= __hal->read_idle_tick_count();
+	kernel_stats.direct_handoff_count	= direct_handoff_count;
+
+	return;
+	}
+
+
+///
+/// Retrieves the next message, if any, pending for the current thread.
+/// If a message is successfully retrieved, the current thread owns the message
+/// and is responsible for its cleanup.  See io_manager::get_message().
+///
+/// This logic executes in the context of the actual recipient/destination
+/// thread (i.e., the current thread should be retrieving a message from
+/// its own mailbox).  More specifically, this logic executes in the address
+/// space of the recipient, and therefore mapping the message payload (if
+/// any) into the current address space makes it visible to to the recipient.
+///
+/// The current thread may block here until a message arrives, if the
+/// specified mailbox is currently empty and the caller has specified
+/// wait_for_message.  May be safely invoked from within a system-call handler;
+/// should not be invoked from a hardware interrupt handler (because of
+/// the risk of blocking) unless wait_for_message is FALSE.
+///
+/// If the caller provides a direct_message buffer, then the thread also
+/// accepts direct messages while waiting; see send_direct_message().  Any
+/// pending signals are also delivered this way; see put_notification().
+///
+/// @param message			-- on success, points to retrieved message
+/// @param wait_for_message	-- whether to wait (block) until a message arrives,
 ///								if the mailbox is currently empty
+/// @param direct_message	-- optional buffer for receiving direct messages
 ///
 /// @return STATUS_SUCCESS if a message was successfully retrieved; in this
-/// case, *message points the message.  May return STATUS_MAILBOX_EMPTY if
+/// case, *message points the message, or is NULL if a direct message was
+/// copied into *direct_message instead.  May return STATUS_MAILBOX_EMPTY if
 /// the caller if wait_for_message is FALSE and mailbox is empty.  Returns
 /// non-zero on other error.
 ///
 status_t io_manager_c::
-receive_message(message_cpp	message,
-				bool_t		wait_for_message)
+receive_message(message_cpp			message,
+				bool_t				wait_for_message,
+				direct_message_sp	direct_message)
 	{
-	status_t status;
+	message_cp	bonus_message;
+	thread_cr	current_thread	= __hal->read_current_thread();
+	uintptr_t	interrupt_state;
+	status_t	status;
+	bool_t		waiting;
 
 
 	//
@@ -579,6 +1203,24 @@ receive_message(message_cpp	message,
 	//
 	for(;;)
 		{
+		// A direct message bypasses the mailbox entirely
+		if (direct_message && message &&
+			current_thread.get_direct_message(*direct_message))
+			{
+			*message = NULL;
+			status = STATUS_SUCCESS;
+			break;
+			}
+
+		// Likewise for any pending signals
+		if (direct_message && message &&
+			get_notification(current_thread, *direct_message))
+			{
+			*message = NULL;
+			status = STATUS_SUCCESS;
+			break;
+			}
+
 		// Attempt to retrieve the next message from this mailbox
 		status = get_message(message);
 
@@ -595,8 +1237,31 @@ receive_message(message_cpp	message,
 			if (!wait_for_message)
 				{ break; }
 
-			// Suspend the thread here until a new message arrives
-			thread_yield();
+			//
+			// Suspend the thread here until a new message arrives.  The
+			// thread leaves the set of runnable threads until the sender
+			// wakes it in thread_c::put_message().  Disable interrupts
+			// across the yield, as in send_message(), so that the thread
+			// cannot be preempted while it is marked as waiting
+			//
+			interrupt_state = __hal->disable_interrupts();
+
+			lock.acquire();
+			waiting = current_thread.wait_on_mailbox(direct_message != NULL);
+			if (waiting)
+				{
+				// A waiting thread cannot win any lotteries, so its
+				// "bonus" message, if any, is no longer useful
+				bonus_message = current_thread.get_bonus_message();
+				if (bonus_message)
+					{ pending_messages -= *bonus_message; }
+				}
+			lock.release();
+
+			if (waiting)
+				{ thread_yield(); }
+
+			__hal->enable_interrupts(interrupt_state);
 
 			// Here, the thread has resumed; a message should be pending
 			// in its mailbox
@@ -608,11 +1273,203 @@ receive_message(message_cpp	message,
 
 
 ///
-/// Select the next thread to execute.  If the current thread is blocked on
-/// another thread, pass the CPU directly to this blocking thread.  Otherwise,
-/// hold a lottery to pseudo-randomly select the next thread, using pending
-/// messages as lottery tickets.  If no messages are pending; and the current
-/// thread is not blocked on I/O, then just dispatch the null thread.
+/// Retrieves the reply to an asynchronous request previously sent by the
+/// current thread via send_request().  Replies are kept apart from the
+/// mailbox, so this never returns an unsolicited message; and unsolicited
+/// messages that arrive meanwhile remain queued for receive_message().  If
+/// a reply is successfully retrieved, the current thread owns it and is
+/// responsible for its cleanup.
+///
+/// As with receive_message(), the current thread may block here; so this
+/// should not be invoked from a hardware interrupt handler unless
+/// wait_for_reply is FALSE.
+///
+/// @param reply			-- on success, points to the reply
+/// @param id				-- id of the original request; or MESSAGE_ID_ANY
+///							   to retrieve the oldest reply to any request
+/// @param wait_for_reply	-- whether to wait (block) until the reply arrives
+///
+/// @return STATUS_SUCCESS if a reply was successfully retrieved.  Returns
+/// STATUS_MAILBOX_EMPTY if wait_for_reply is FALSE and the reply has not yet
+/// arrived; STATUS_INVALID_DATA if no such request is outstanding; or
+/// non-zero on other error
+///
+status_t io_manager_c::
+receive_reply(	message_cpp		reply,
+				message_id_t	id,
+				bool_t			wait_for_reply)
+	{
+	message_cp	bonus_message;
+	thread_cr	current_thread	= __hal->read_current_thread();
+	uintptr_t	interrupt_state;
+	status_t	status;
+	bool_t		waiting;
+
+
+	ASSERT(reply != NULL);
+
+
+	//
+	// Loop/block until the reply arrives.  See receive_message()
+	//
+	for(;;)
+		{
+		status = current_thread.get_reply(reply, id);
+		if (status == STATUS_SUCCESS)
+			{
+			status = claim_message(reply);
+			break;
+			}
+
+		if (status != STATUS_MAILBOX_EMPTY || !wait_for_reply)
+			{ break; }
+
+
+		//
+		// Suspend the thread here until a reply arrives.  Other incoming
+		// messages do not wake the thread; see thread_c::put_message()
+		//
+		interrupt_state = __hal->disable_interrupts();
+
+		lock.acquire();
+		waiting = current_thread.wait_on_reply(id);
+		if (waiting)
+			{
+			bonus_message = current_thread.get_bonus_message();
+			if (bonus_message)
+				{ pending_messages -= *bonus_message; }
+			}
+		lock.release();
+
+		if (waiting)
+			{ thread_yield(); }
+
+		__hal->enable_interrupts(interrupt_state);
+		}
+
+	return(status);
+	}
+
+
+///
+/// Record the scheduling latency of a thread that is about to execute: the
+/// delay since a message woke it, if any.  Assumes the caller holds the I/O
+/// Manager lock.  See kernel_stats_s::scheduling_latency
+///
+/// @param thread -- the thread about to execute
+///
+void_t io_manager_c::
+record_scheduling_latency(thread_cr thread)
+	{
+	uint32_t bucket;
+	uint32_t latency;
+
+	if (thread.ready_timestamp)
+		{
+		latency = (__hal->read_timestamp32() - thread.ready_timestamp) >>
+			SCHEDULING_LATENCY_SHIFT;
+
+		// Each bucket covers twice the range of its predecessor
+		for (bucket = 0; latency > 1; bucket++)
+			{ latency >>= 1; }
+		if (bucket >= SCHEDULING_LATENCY_BUCKET_COUNT)
+			{ bucket = SCHEDULING_LATENCY_BUCKET_COUNT - 1; }
+
+		scheduling_latency[ bucket ]++;
+		thread.ready_timestamp = 0;
+		}
+
+	return;
+	}
+
+
+///
+/// Hold a lottery to pseudo-randomly select the next thread, using pending
+/// messages as lottery tickets.  A thread's share of the CPU thus follows its
+/// share of the pending messages, on average.  Assumes the caller holds the
+/// I/O Manager lock.  See select_next_thread()
+///
+/// @param processor -- the processor that will execute the winner
+///
+/// @return the winning thread; or NULL if no thread can execute here
+///
+thread_cp io_manager_c::
+select_lottery_thread(uint32_t processor)
+	{
+	thread_cp next_thread = NULL;
+
+	for (uint32_t i = 0; i < LOTTERY_DRAW_MAX; i++)
+		{
+		if (pending_messages.is_empty())
+			break;
+
+		//
+		// At least one message is pending.  Hold a lottery to determine
+		// which thread gains the CPU.  Randomly select a message from the
+		// global pool of pending messages (i.e., messages that have been
+		// successfully sent, but are still queued in their destination
+		// mailbox, not yet retrieved by the recipient).  Each such message
+		// constitutes one lottery ticket.  The thread which owns the
+		// selected message will gain the CPU; this thread has won the
+		// lottery
+		//
+		thread_cr winner = pending_messages.select_random().destination;
+
+
+		//
+		// The winning thread may actually be blocked, waiting on a
+		// message from some other thread.  In this case, select the
+		// blocking thread to execute in place of the original winner.  In
+		// effect, a blocked thread passes its "lottery winnings" to the
+		// thread that is preventing it from making forward progress.
+		//
+		thread_cp candidate = winner.find_blocking_thread();
+		if (!candidate)
+			{ candidate = &winner; }
+
+
+		//
+		// If the winner is busy on another processor, then just draw
+		// another ticket
+		//
+		if (!can_run_on(*candidate, processor))
+			continue;
+
+		if (candidate != &winner)
+			{
+			TRACE(ALL, "Thread %#x is blocked, passing lottery winnings "
+				"to thread %#x\n",
+				winner.id, candidate->id);
+			}
+
+		next_thread = candidate;
+
+
+		//
+		// The "bonus" message, if any, has served its purpose and may be
+		// discarded now that this thread has won the lottery
+		//
+		message_cp bonus_message = winner.get_bonus_message();
+		if (bonus_message)
+			{ pending_messages -= *bonus_message; }
+
+		break;
+		}
+
+	return(next_thread);
+	}
+
+
+///
+/// Select the next thread to execute.  If the current thread has just woken
+/// another thread via direct message, pass the CPU directly to that thread.
+/// If the current thread is blocked on another thread, pass the CPU directly
+/// to this blocking thread.  Otherwise,
+/// select the next thread using pending messages as tickets: either by
+/// lottery or by stride, depending on the scheduling policy chosen at boot.
+/// If no messages are pending; and the current
+/// thread is not blocked on I/O, then just dispatch the idle thread of the
+/// current processor.
 ///
 /// This logic may execute in interrupt context, depending on when/why it
 /// is invoked.
@@ -624,6 +1481,8 @@ thread_cr io_manager_c::
 select_next_thread(thread_cr current_thread)
 	{
 	thread_cp	next_thread;
+	uint32_t	processor = __hal->read_current_processor_index();
+	thread_cp	wakeup_thread;
 
 
 	lock.acquire();
@@ -635,14 +1494,29 @@ select_next_thread(thread_cr current_thread)
 	//		response from another thread.  In this case, pass the CPU directly
 	//		from the current thread to the blocking thread in the hope that
 	//		it will reply and resume the current thread;
-	//	(b) One or more messages are pending.  Hold a lottery, using the
-	//		pending messages as tickets, to select the winning thread
+	//	(b) One or more messages are pending.  Hold a lottery (or select by
+	//		stride), using the pending messages as tickets, to select the
+	//		winning thread
 	//	(c) No messages are currently pending and therefore no thread can
 	//		execute.  Automatically dispatch the null/idle thread to fill
 	//		the gap.
 	//
-	next_thread = current_thread.find_blocking_thread();
-	if (next_thread != NULL)
+	// On SMP hosts, the selected thread may already be executing on some
+	// other processor.  In that case, fall back to the next option.
+	//
+	// Ahead of all of these: if the current thread has replied to (or
+	// otherwise woken) some thread via direct message, then that thread has
+	// no lottery tickets.  Switch straight to it now.
+	//
+	wakeup_thread	= current_thread.get_wakeup_thread();
+	next_thread		= current_thread.find_blocking_thread();
+	if (wakeup_thread != NULL && can_run_on(*wakeup_thread, processor))
+		{
+		direct_handoff_count++;
+		next_thread = wakeup_thread;
+		}
+
+	else if (next_thread != NULL && can_run_on(*next_thread, processor))
 		{
 		//
 		// The current thread is blocked.  Automatically give the CPU to the
@@ -653,78 +1527,280 @@ select_next_thread(thread_cr current_thread)
 
 	else
 		{
-		if (!pending_messages.is_empty())
+		//
+		// Select the next thread via its pending messages.  This is option
+		// (b) above
+		//
+		if (scheduling_policy == SCHEDULING_POLICY_STRIDE)
 			{
-			//
-			// The current thread is not blocked; and at least one message is
-			// pending.  Hold a lottery to determine which thread gains the
-			// CPU.  Randomly select a message from the global pool of
-			// pending messages (i.e., messages that have been successfully
-			// sent, but are still queued in their destination mailbox, not
-			// yet retrieved by the recipient).  Each such message
-			// constitutes one lottery ticket.  The thread which owns the
-			// selected message will gain the CPU; this thread has won the
-			// lottery.  This is option (b) above
-			//
-			lottery_count++;
-			next_thread = &(pending_messages.select_random().destination);
-
-
-			//
-			// The "bonus" message, if any, has served its purpose and may be
-			// discarded now that this thread has won the lottery
-			//
-			message_cp bonus_message = next_thread->get_bonus_message();
-			if (bonus_message)
-				{ pending_messages -= *bonus_message; }
+			next_thread = select_stride_thread(pending_messages, processor,
+				&stride_pass);
 			}
+		else
+			{ next_thread = select_lottery_thread(processor); }
 
+		if (next_thread)
+			{
+			lottery_count++;
+			}
 		else
 			{
 			//
 			// The current thread cannot continue; and there are no pending
-			// messages.  Dispatch the null/idle thread.  This is option (c)
-			// above
+			// messages for any thread that can execute here.  Dispatch the
+			// idle thread of this processor.  This is option (c) above
 			//
-			idle_count++;
-			ASSERT(__null_thread);
-			next_thread = __null_thread;
+			next_thread = __idle_thread[ processor ];
+			ASSERT(next_thread);
 			}
+		}
 
 
-		//
-		// The winning thread may actually be blocked, waiting on a message
-		// from some other thread.  In this case, select the blocking thread
-		// to execute in place of the original winner.  In effect, a blocked
-		// thread passes its "lottery winnings" to the thread that is
-		// preventing it from making forward progress.
-		//
-		thread_cp blocking_thread = next_thread->find_blocking_thread();
+	//
+	// Allocate the next scheduling quantum to the winning thread; and claim
+	// it for this processor
+	//
+	ASSERT(next_thread);
+	ASSERT(next_thread->state == THREAD_STATE_READY);
+	next_thread->tick_count	= SCHEDULING_QUANTUM_DEFAULT;
+	next_thread->processor	= processor;
+	record_scheduling_latency(*next_thread);
+
+
+	//
+	// The clock tick only serves to preempt threads; so there is no need for
+	// it while this processor idles.  Any new work arrives via some other
+	// interrupt, which preempts the idle thread; see preempt_idle_thread()
+	//
+	if (is_idle_thread(*next_thread))
+		{ __hal->stop_clock_tick(); }
+	else
+		{ __hal->start_clock_tick(); }
+
+	lock.release();
+
+
+	//
+	// Drop the reference acquired when the current thread woke this thread.
+	// Avoid holding the lock here, in case this is the last reference
+	//
+	if (wakeup_thread)
+		{ remove_reference(*wakeup_thread); }
+
+	return(*next_thread);
+	}
+
+
+///
+/// Deterministically select the next thread, using pending messages as
+/// tickets.  Each thread advances through virtual time (its "pass") at a
+/// rate inversely proportional to its count of tickets; the thread with the
+/// lowest pass executes next.  A thread's share of the CPU thus follows its
+/// share of the pending messages, as with the lottery; but without the
+/// variance of a random draw, so the wait of each thread is bounded.
+///
+/// A thread that has just woken resumes at the current global pass, so it
+/// cannot monopolize the CPU with credit accrued while idle.  As with the
+/// lottery, a blocked thread passes its selection to the thread that is
+/// blocking it.  Assumes the caller holds the I/O Manager lock, or owns the
+/// pool and its threads outright (as in the unit tests).  See
+/// select_next_thread()
+///
+/// @param pool			-- the pending messages/tickets
+/// @param processor	-- the processor that will execute the selected thread
+/// @param global_pass	-- the global virtual time; advanced to the pass of
+///						   the selected thread
+///
+/// @return the selected thread; or NULL if no thread can execute here
+///
+thread_cp io_manager_c::
+select_stride_thread(	message_pool_cr	pool,
+						uint32_t		processor,
+						uint32_tp		global_pass)
+	{
+	thread_cp	candidate;
+	uint32_t	count = pool.read_count();
+	thread_cp	next_thread = NULL;
+	uint32_t	pass = 0;
+	thread_cp	winner = NULL;
 
-		if (blocking_thread)
+
+	//
+	// Find the ticket-holder with the lowest pass that can execute here,
+	// either directly or via the thread blocking it
+	//
+	//@linear scan of the pool; a heap of threads ordered by pass would
+	//@scale better with many pending messages
+	for (uint32_t i = 0; i < count; i++)
+		{
+		thread_cr thread = pool[i].destination;
+
+		candidate = thread.find_blocking_thread();
+		if (!candidate)
+			{ candidate = &thread; }
+
+		if (!can_run_on(*candidate, processor))
+			continue;
+
+		// Passes may wrap, so compare them by signed distance.  Threads
+		// that fell behind the global pass while idle resume at it
+		uint32_t thread_pass = thread.pass;
+		if (int32_t(thread_pass - *global_pass) < 0)
+			{ thread_pass = *global_pass; }
+
+		if (!winner || int32_t(thread_pass - pass) < 0)
 			{
-			TRACE(ALL, "Thread %#x is blocked, passing lottery winnings to "
-				"thread %#x\n",
-				next_thread->id, blocking_thread->id);
-			next_thread = blocking_thread;
+			winner		= &thread;
+			next_thread	= candidate;
+			pass		= thread_pass;
 			}
 		}
 
 
-	//@@@on SMP, winning thread could already be executing on another CPU
+	//
+	// Charge the winner for the quantum it is about to receive; and discard
+	// its "bonus" message, if any, as with the lottery
+	//
+	if (winner)
+		{
+		ASSERT(winner->ticket_count > 0);
+		*global_pass	= pass;
+		winner->pass	= pass + STRIDE_ONE / winner->ticket_count;
+
+		message_cp bonus_message = winner->get_bonus_message();
+		if (bonus_message)
+			{ pool -= *bonus_message; }
+		}
+
+	return(next_thread);
+	}
+
+
+///
+/// Fast path for small (register-sized) messages.  If the destination
+/// thread is already suspended in a receive, then copy the system-call
+/// arguments directly into it + switch straight to it, without allocating a
+/// message_c or touching the lottery pool.  If the caller waits for a reply,
+/// and the destination replies the same way, then the reply is likewise
+/// copied straight back into the system-call arguments.
+///
+/// This is the common case for RPC-style transactions, where a client sends
+/// a small request to a server thread that is idle, waiting for work.  If the
+/// destination is not ready for a direct message, then nothing happens here;
+/// the caller should fall back to the normal message path.
+///
+/// May be safely invoked from within a system-call handler; but should not be
+/// invoked from a hardware interrupt handler.
+///
+/// System call input/output is identical to the SEND_MESSAGE and
+/// SEND_AND_RECEIVE_MESSAGE system calls.  The payload size (data4) must be
+/// zero.
+///
+/// @param destination		-- the recipient thread
+/// @param syscall			-- system call arguments
+/// @param wait_for_reply	-- whether to block until the recipient replies
+///
+/// @return TRUE if the message was delivered directly; in this case, the
+/// system call results are already populated.  FALSE if the caller must use
+/// the normal message path instead
+///
+bool_t io_manager_c::
+send_direct_message(thread_cr					destination,
+					volatile syscall_data_s*	syscall,
+					bool_t						wait_for_reply)
+	{
+	thread_cr			current_thread = __hal->read_current_thread();
+	bool_t				delivered;
+	uintptr_t			interrupt_state;
+	direct_message_s	reply;
+	message_cp			reply_message;
+	direct_message_s	request;
+	status_t			status;
+
+
+	ASSERT(syscall->data4 == 0);
+
+	request.control	= (wait_for_reply ? MESSAGE_CONTROL_BLOCKING :
+		MESSAGE_CONTROL_NONE);
+	request.id		= message_id_t(syscall->data2);
+	request.payload	= syscall->data3;
+	request.source	= current_thread.id;
+	request.type	= message_type_t(syscall->data1);
 
 
 	//
-	// Allocate the next scheduling quantum to the winning thread
+	// As in send_message(), briefly disable interrupts here to avoid
+	// blocking the current thread on multiple messages simultaneously
 	//
-	ASSERT(next_thread);
-	ASSERT(next_thread->state == THREAD_STATE_READY);
-	next_thread->tick_count = SCHEDULING_QUANTUM_DEFAULT;
-	//@on SMP, hold ref to thread + addr space until suspended?
+	interrupt_state = __hal->disable_interrupts();
 
+	lock.acquire();
+	delivered = destination.put_direct_message(request);
 	lock.release();
 
-	return(*next_thread);
+	if (!delivered)
+		{
+		__hal->enable_interrupts(interrupt_state);
+		return(FALSE);
+		}
+
+	message_count++;
+	direct_message_count++;
+
+
+	//
+	// The recipient is awake, but has no lottery tickets.  If the current
+	// thread is waiting for a reply, then it is now blocked on the recipient,
+	// so yielding here passes the CPU directly to the recipient.  Otherwise,
+	// the recipient runs the next time the current thread loses the CPU
+	//
+	if (!wait_for_reply)
+		{
+		__hal->enable_interrupts(interrupt_state);
+		syscall->status = STATUS_SUCCESS;
+		return(TRUE);
+		}
+
+	thread_yield();
+
+	__hal->enable_interrupts(interrupt_state);
+
+
+	//
+	// Here, the recipient has replied; either directly, or via a normal
+	// reply message
+	//
+	if (current_thread.get_direct_message(reply))
+		{
+		ASSERT(reply.source == destination.id);
+		syscall->data0 = uintptr_t(reply.source);
+		syscall->data1 = uintptr_t(reply.type);
+		syscall->data2 = uintptr_t(reply.id);
+		syscall->data3 = reply.payload;
+		syscall->data4 = 0;
+		}
+	else
+		{
+		status = get_message(&reply_message);
+		if (status != STATUS_SUCCESS)
+			{
+			reply_message = abort_send_message(current_thread, destination,
+				request.id, status);
+			}
+
+		ASSERT(reply_message);
+		syscall->data0 = uintptr_t(reply_message->source.id);
+		syscall->data1 = uintptr_t(reply_message->type);
+		syscall->data2 = uintptr_t(reply_message->id);
+		syscall->data3 = uintptr_t(reply_message->read_payload());
+		syscall->data4 = uintptr_t(reply_message->read_payload_size());
+
+		delete(reply_message);
+		}
+
+	syscall->status = STATUS_SUCCESS;
+
+	return(TRUE);
 	}
 
 
@@ -737,17 +1813,24 @@ select_next_thread(thread_cr current_thread)
 /// io_manager_c::get_message().
 ///
 /// May be safely invoked from within a system-call handler; but should not be
-/// invoked from a hardware interrupt handler.
+/// invoked from a hardware interrupt handler.  Kernel-internal requests
+/// should not wait for room in a full mailbox, since the kernel may be
+/// acting on behalf of a thread the recipient is waiting for.
 ///
-/// @param request	-- the message/request to send
-/// @param response	-- the response received from the original recipient
+/// @param request			-- the message/request to send
+/// @param response			-- the response received from the original
+///							   recipient
+/// @param wait_for_room	-- if the recipient's mailbox is full, wait for
+///							   room rather than failing the send with
+///							   STATUS_WOULD_BLOCK
 ///
 /// @return STATUS_SUCCESS if the message is successfully sent + a reply was
 /// was received; or non-zero error otherwise.
 ///
 status_t io_manager_c::
 send_message(	message_cr	request,
-				message_cpp	response)
+				message_cpp	response,
+				bool_t		wait_for_room)
 	{
 	thread_cr	current_thread = __hal->read_current_thread();
 	uintptr_t	interrupt_state;
@@ -782,9 +1865,10 @@ send_message(	message_cr	request,
 
 
 	//
-	// Attempt to queue this message on the recipient's mailbox
+	// Attempt to queue this message on the recipient's mailbox, waiting for
+	// room if the caller allows it
 	//
-	status = put_message(request);
+	status = put_message(request, wait_for_room);
 	if (status == STATUS_SUCCESS)
 		{
 		//
@@ -830,59 +1914,312 @@ send_message(	message_cr	request,
 	remove_reference(recipient);
 
 
-	return(status);
+	return(status);
+	}
+
+
+///
+/// Send the given message to its destination thread as an asynchronous
+/// request.  Returns without waiting for the reply, so the current thread may
+/// have several requests outstanding at once; collect each reply later via
+/// receive_reply().  The reply is recognized by the id of the request, which
+/// must be unique among the outstanding requests of the current thread.
+///
+/// As with a blocking request, the reply always reaches the current thread,
+/// even if its mailbox is otherwise full; and if the recipient exits without
+/// replying, the current thread receives an abort message in its place.
+///
+/// On success, the message belongs to the recipient.  On failure, the current
+/// thread still owns the message.
+///
+/// @param request			-- the message/request to send
+/// @param wait_for_room	-- may the current thread wait for room in a full
+///							mailbox?  See put_message()
+///
+/// @return STATUS_SUCCESS if the request is successfully sent; or non-zero
+/// error otherwise
+///
+status_t io_manager_c::
+send_request(	message_cr	request,
+				bool_t		wait_for_room)
+	{
+	thread_cr	current_thread = __hal->read_current_thread();
+	status_t	status;
+
+	ASSERT(request.source == current_thread);
+	ASSERT(!request.is_blocking());
+
+
+	//
+	// Record the request before sending it, since the reply could otherwise
+	// arrive first
+	//
+	status = current_thread.add_request(request.destination.id, request.id);
+	if (status == STATUS_SUCCESS)
+		{
+		request.control |= MESSAGE_CONTROL_REQUEST;
+
+		status = put_message(request, wait_for_room);
+		if (status != STATUS_SUCCESS)
+			{
+			// No reply will ever arrive
+			current_thread.cancel_request(request.destination.id,
+				request.id);
+			}
+		}
+
+	return(status);
+	}
+
+
+///
+/// Allocate a pair of submission + completion rings for the given thread, and
+/// map them into its address space.  If the thread already has rings, then
+/// do nothing.  See dx/message_ring.h.
+///
+/// @param thread -- the current thread
+///
+/// @return STATUS_SUCCESS if the thread has rings; non-zero otherwise
+///
+status_t io_manager_c::
+create_message_ring(thread_cr thread)
+	{
+	physical_address_t	frame;
+	void_tp				page	= NULL;
+	status_t			status	= STATUS_SUCCESS;
+
+	ASSERT(&thread == &__hal->read_current_thread());
+
+	do
+		{
+		if (thread.message_ring)
+			break;
+
+
+		//
+		// The rings occupy a single page in the payload area of the
+		// thread's address space, where the kernel can safely assume it
+		// remains mapped.  The page comes from its own pool, so the thread
+		// cannot release it as if it were a payload.  The page is released
+		// along with the thread; see thread_c::~thread_c()
+		//
+		page = thread.address_space.allocate_message_ring_page();
+		if (!page)
+			{
+			status = STATUS_INSUFFICIENT_MEMORY;
+			break;
+			}
+
+		status = __memory_manager->allocate_frames(&frame, 1, 0);
+		if (status != STATUS_SUCCESS)
+			{
+			thread.address_space.free_message_ring_page(page);
+			break;
+			}
+
+		status = thread.address_space.commit_frame(page, 1, &frame,
+			MEMORY_USER | MEMORY_WRITABLE);
+		if (status != STATUS_SUCCESS)
+			{
+			__memory_manager->free_frames(&frame, 1);
+			thread.address_space.free_message_ring_page(page);
+			break;
+			}
+
+
+		//
+		// Initially, both rings are empty
+		//
+		memset(page, 0, PAGE_SIZE);
+		thread.message_ring = message_ring_sp(page);
+
+		} while(0);
+
+	return(status);
+	}
+
+
+///
+/// Handler for CREATE_MESSAGE_RING system calls.  Allocate a pair of
+/// submission + completion rings for the current thread, and map them into
+/// its address space.  If the thread already has rings, then just return
+/// them.  See create_message_ring().
+///
+/// System call output:
+///		syscall->status	= status of ring allocation
+///		syscall->data0	= address of the message_ring_s structure
+///
+/// @param syscall -- system call arguments
+///
+void_t io_manager_c::
+syscall_create_message_ring(volatile syscall_data_s* syscall)
+	{
+	thread_cr thread = __hal->read_current_thread();
+
+	TRACE(SYSCALL, "System call: create message ring, %p\n", syscall);
+
+	syscall->status	= create_message_ring(thread);
+	syscall->data0	= uintptr_t(thread.message_ring);
+
+	return;
+	}
+
+
+///
+/// Handler for DELETE_MESSAGE system calls.  The current thread is discarding
+/// the contents of a message after (presumably) processing it.  The message
+/// payload is freed here, so the thread cannot touch this memory again.
+///
+/// System call input:
+///		syscall->data0 = payload pointer/word
+///		syscall->data1 = payload size
+///
+/// System call output:
+///		syscall->status	= status of message deletion
+///
+/// @param syscall -- system call arguments
+///
+void_t io_manager_c::
+syscall_delete_message(volatile syscall_data_s* syscall)
+	{
+	void_tp		data		= void_tp(syscall->data0);
+	size_t		data_size	= size_t(syscall->data1);
+	status_t	status;
+
+	TRACE(SYSCALL, "System call: delete message, %p\n", syscall);
+
+	if (data_size > 0)
+		{
+		thread_cr thread = __hal->read_current_thread();
+
+		ASSERT(data);
+		if (uintptr_t(data) >= MESSAGE_RING_POOL_BASE ||
+			data_size > MESSAGE_RING_POOL_BASE - uintptr_t(data))
+			{
+			// Never a payload; perhaps the thread's own message rings.  The
+			// kernel still uses those, and releases them itself
+			status = STATUS_INVALID_DATA;
+			}
+		else if (data >= void_tp(LARGE_PAYLOAD_POOL_BASE))
+			{
+			// Assume this was a large_message_c
+			thread.address_space.unshare_frame(data, data_size);
+			status = thread.address_space.free_large_payload_block(data);
+			}
+		else
+			{
+			// Assume this was a medium_message_c
+			ASSERT(data >= void_tp(MEDIUM_PAYLOAD_POOL_BASE));
+			ASSERT(data_size <= MEDIUM_MESSAGE_PAYLOAD_SIZE);
+			status = thread.address_space.free_medium_payload_block(data);
+			}
+		}
+	else
+		{
+		// This was a small_message_c and no cleanup is required
+		status = STATUS_SUCCESS;
+		}
+
+	syscall->status = status;
+
+	return;
+	}
+
+
+///
+/// Handler for ENTER_MESSAGE_RING system calls.  Drain the current thread's
+/// submission ring + post any completions.  The kernel also drains the rings
+/// on each clock tick, so this is only necessary when the thread wants its
+/// submissions processed immediately; or has nothing else to do, and wants
+/// to wait for an incoming message.
+///
+/// System call input:
+///		syscall->data0	= if no completions are pending, wait until a
+///						  message arrives?
+///
+/// System call output:
+///		syscall->status	= status of ring processing
+///		syscall->data0	= number of completions pending
+///
+/// @param syscall -- system call arguments
+///
+void_t io_manager_c::
+syscall_enter_message_ring(volatile syscall_data_s* syscall)
+	{
+	message_ring_sp	ring;
+	thread_cr		thread = __hal->read_current_thread();
+
+	TRACE(SYSCALL, "System call: enter message ring, %p\n", syscall);
+
+	ring = thread.message_ring;
+	if (ring)
+		{
+		drain_message_ring(thread, bool_t(syscall->data0));
+		syscall->data0	= ring->completion_tail - ring->completion_head;
+		syscall->status	= STATUS_SUCCESS;
+		}
+	else
+		{
+		// No rings; see syscall_create_message_ring()
+		syscall->status = STATUS_INVALID_DATA;
+		}
+
+	return;
 	}
 
 
 ///
-/// Handler for DELETE_MESSAGE system calls.  The current thread is discarding
-/// the contents of a message after (presumably) processing it.  The message
-/// payload is freed here, so the thread cannot touch this memory again.
+/// Handler for PROCESS_MESSAGES system calls.  Process a batch of send,
+/// receive and delete operations, in order, within a single kernel entry.
+/// Each operation behaves exactly like the corresponding SEND_MESSAGE,
+/// RECEIVE_MESSAGE or DELETE_MESSAGE system call, and has its own status.  A
+/// failed operation does not prevent the remaining operations from executing;
+/// but the batch stops at an operation of unknown type.  A RECEIVE_WAIT
+/// operation may block, as in RECEIVE_MESSAGE.  See process_messages().
+///
+/// This allows a server to discard a request, send its reply(s) and wait for
+/// the next request, all with a single trap.
 ///
 /// System call input:
-///		syscall->data0 = payload pointer/word
-///		syscall->data1 = payload size
+///		syscall->data0	= pointer to array of message_operation_s
+///		syscall->data1	= number of operations
 ///
 /// System call output:
-///		syscall->status	= status of message deletion
+///		syscall->status	= STATUS_SUCCESS if the batch itself was valid;
+///						  see each operation for its individual status
+///		syscall->data0	= number of operations processed
 ///
 /// @param syscall -- system call arguments
 ///
 void_t io_manager_c::
-syscall_delete_message(volatile syscall_data_s* syscall)
+syscall_process_messages(volatile syscall_data_s* syscall)
 	{
-	void_tp		data		= void_tp(syscall->data0);
-	size_t		data_size	= size_t(syscall->data1);
-	status_t	status;
+	uint32_t				count		= uint32_t(syscall->data1);
+	uint32_t				processed	= 0;
+	message_operation_sp	operation	= message_operation_sp(syscall->data0);
+	status_t				status;
 
-	TRACE(SYSCALL, "System call: delete message, %p\n", syscall);
+	TRACE(SYSCALL, "System call: process messages, %p\n", syscall);
 
-	if (data_size > 0)
-		{
-		thread_cr thread = __hal->read_current_thread();
 
-		ASSERT(data);
-		if (data >= void_tp(LARGE_PAYLOAD_POOL_BASE))
-			{
-			// Assume this was a large_message_c
-			thread.address_space.unshare_frame(data, data_size);
-			status = thread.address_space.free_large_payload_block(data);
-			}
-		else
-			{
-			// Assume this was a medium_message_c
-			ASSERT(data >= void_tp(MEDIUM_PAYLOAD_POOL_BASE));
-			ASSERT(data_size <= MEDIUM_MESSAGE_PAYLOAD_SIZE);
-			status = thread.address_space.free_medium_payload_block(data);
-			}
+	//
+	// The batch must lie entirely in user memory
+	//
+	if (count == 0 ||
+		count > MESSAGE_OPERATION_COUNT_MAX ||
+		!__memory_manager->is_user_address(operation) ||
+		!__memory_manager->is_user_address(operation + count))
+		{
+		status = STATUS_INVALID_DATA;
 		}
 	else
 		{
-		// This was a small_message_c and no cleanup is required
-		status = STATUS_SUCCESS;
+		// Process each operation, in order
+		status = process_messages(operation, count, &processed);
 		}
 
-	syscall->status = status;
+	syscall->data0	= processed;
+	syscall->status	= status;
 
 	return;
 	}
@@ -908,13 +2245,24 @@ syscall_delete_message(volatile syscall_data_s* syscall)
 void_t io_manager_c::
 syscall_receive_message(volatile syscall_data_s* syscall)
 	{
-	message_cp	message;
-	bool_t		wait_for_message = bool_t(syscall->data0);
+	direct_message_s	direct_message;
+	message_cp			message;
+	bool_t				wait_for_message = bool_t(syscall->data0);
 
 	TRACE(SYSCALL, "System call: rx message, %p\n", syscall);
 
-	syscall->status = receive_message(&message, wait_for_message);
-	if (syscall->status == STATUS_SUCCESS)
+	syscall->status = receive_message(&message, wait_for_message,
+		&direct_message);
+	if (syscall->status == STATUS_SUCCESS && !message)
+		{
+		// Received a direct message; no payload and nothing to clean up
+		syscall->data0 = uintptr_t(direct_message.source);
+		syscall->data1 = uintptr_t(direct_message.type);
+		syscall->data2 = uintptr_t(direct_message.id);
+		syscall->data3 = direct_message.payload;
+		syscall->data4 = 0;
+		}
+	else if (syscall->status == STATUS_SUCCESS)
 		{
 		ASSERT(message);
 
@@ -932,6 +2280,53 @@ syscall_receive_message(volatile syscall_data_s* syscall)
 	}
 
 
+///
+/// Handler for RECEIVE_REPLY message operations.  Retrieve the reply to an
+/// asynchronous request and return it.  There is no dedicated vector for
+/// this; it is only available via PROCESS_MESSAGES.  See process_message().
+///
+/// System call input:
+///		syscall->data0	= if the reply has not arrived, wait until it does?
+///		syscall->data1	= id of original request; or MESSAGE_ID_ANY
+///
+/// System call output:
+///		syscall->status	= status of reply retrieval
+///		syscall->data0	= id of replying thread
+///		syscall->data1	= message type
+///		syscall->data2	= message id
+///		syscall->data3	= payload pointer/word
+///		syscall->data4	= payload size
+///
+/// @param syscall -- system call arguments
+///
+void_t io_manager_c::
+syscall_receive_reply(volatile syscall_data_s* syscall)
+	{
+	message_cp	reply;
+	bool_t		wait_for_reply = bool_t(syscall->data0);
+
+	TRACE(SYSCALL, "System call: rx reply, %p\n", syscall);
+
+	syscall->status = receive_reply(&reply, message_id_t(syscall->data1),
+		wait_for_reply);
+	if (syscall->status == STATUS_SUCCESS)
+		{
+		ASSERT(reply);
+
+		syscall->data0 = uintptr_t(reply->source.id);
+		syscall->data1 = uintptr_t(reply->type);
+		syscall->data2 = uintptr_t(reply->id);
+		syscall->data3 = uintptr_t(reply->read_payload());
+		syscall->data4 = uintptr_t(reply->read_payload_size());
+
+		// Message owner is responsible for cleanup
+		delete(reply);
+		}
+
+	return;
+	}
+
+
 ///
 /// Handler for SEND_AND_RECEIVE_MESSAGE system call.  Send a single message,
 /// based on the contents of the system call arguments.  Then block until a
@@ -980,6 +2375,17 @@ syscall_send_and_receive_message(volatile syscall_data_s* syscall)
 			}
 
 
+		//
+		// Small requests to an idle thread take the direct-switch fast path
+		//
+		if (syscall->data4 == 0 &&
+			send_direct_message(*destination, syscall, TRUE))
+			{
+			status = syscall->status;
+			break;
+			}
+
+
 		//
 		// Build the outgoing message according to the syscall arguments
 		//
@@ -1002,7 +2408,7 @@ syscall_send_and_receive_message(volatile syscall_data_s* syscall)
 		//
 		// Send the message + wait for a reply
 		//
-		status = send_message(*request_message, &reply_message);
+		status = send_message(*request_message, &reply_message, TRUE);
 		if (status != STATUS_SUCCESS)
 			{
 			// Current thread is responsible for cleanup on failed transmission
@@ -1048,9 +2454,138 @@ syscall_send_and_receive_message(volatile syscall_data_s* syscall)
 
 
 ///
-/// Handler for SEND_MESSAGE system call.  Send a single message, based on the
-/// contents of the system call arguments.  Returns without waiting for any
-/// response.
+/// Handler for SEND_GATHERED_MESSAGE system call.  Send a single message,
+/// whose payload is gathered from a list of fragments in the sender's address
+/// space.  The fragments may have any size + alignment; the kernel shares
+/// whole pages where possible, and copies the rest.  Returns without waiting
+/// for any response.
+///
+/// System call input:
+///		syscall->data0 = id of destination thread
+///		syscall->data1 = message type
+///		syscall->data2 = message id
+///		syscall->data3 = pointer to array of message_fragment_s
+///		syscall->data4 = number of fragments
+///		syscall->data5 = delivery address in recipient's address space
+///
+/// System call output:
+///		syscall->status	= status of message delivery
+///
+/// @param syscall -- system call arguments
+///
+void_t io_manager_c::
+syscall_send_gathered_message(volatile syscall_data_s* syscall)
+	{
+	thread_cp					destination		= NULL;
+	message_fragment_s			fragment[ MESSAGE_FRAGMENT_COUNT_MAX ];
+	uint32_t					fragment_count	= uint32_t(syscall->data4);
+	const message_fragment_s*	fragment_list	=
+		(const message_fragment_s*)(syscall->data3);
+	large_message_cp			message;
+	size_t						size			= 0;
+	status_t					status			= STATUS_SUCCESS;
+
+	TRACE(SYSCALL, "System call: send gathered message (%p) to thread %#x, "
+		"type %#x\n", syscall, syscall->data0, syscall->data1);
+
+	do
+		{
+		//
+		// Validate + snapshot the list of fragments, so the sender cannot
+		// modify it after validation.  The list itself must lie entirely in
+		// user memory
+		//
+		if (fragment_count == 0 ||
+			fragment_count > MESSAGE_FRAGMENT_COUNT_MAX ||
+			!__memory_manager->is_user_address(void_tp(fragment_list)) ||
+			!__memory_manager->is_user_address(
+				void_tp(fragment_list + fragment_count)))
+			{
+			status = STATUS_INVALID_DATA;
+			break;
+			}
+
+		for (uint32_t i = 0; i < fragment_count; i++)
+			{
+			fragment[i] = fragment_list[i];
+
+			// Reject fragments that wrap around the address space, or that
+			// overflow the total payload size
+			if (uintptr_t(fragment[i].data) + fragment[i].size <
+					uintptr_t(fragment[i].data) ||
+				size + fragment[i].size < size)
+				{
+				status = STATUS_INVALID_DATA;
+				break;
+				}
+
+			size += fragment[i].size;
+			}
+
+		if (status != STATUS_SUCCESS)
+			break;
+
+		if (size == 0)
+			{
+			status = STATUS_INVALID_DATA;
+			break;
+			}
+
+
+		//
+		// Lookup the destination thread
+		//
+		destination = __thread_manager->find_thread(syscall->data0);
+		if (!destination)
+			{
+			status = STATUS_INVALID_DATA;
+			break;
+			}
+
+
+		//
+		// Build + send the message.  Return without waiting for a reply
+		//
+		message = new large_message_c(	__hal->read_current_thread(),
+										*destination,
+										syscall->data1,				// type
+										syscall->data2,				// id
+										fragment,
+										fragment_count,
+										void_tp(syscall->data5));	// address
+		if (!message)
+			{
+			status = STATUS_INSUFFICIENT_MEMORY;
+			break;
+			}
+
+		status = put_message(*message, TRUE);
+
+		// On failure, the current thread still owns this message and is
+		// responsible for cleanup
+		if (status != STATUS_SUCCESS)
+			{ delete(message); }
+
+		} while(0);
+
+
+	//
+	// Cleanup
+	//
+	if (destination)
+		{ remove_reference(*destination); }
+
+	syscall->status = status;
+
+	return;
+	}
+
+
+///
+/// Handler for SEND_MESSAGE and SEND_DONATED_MESSAGE system calls.  Send a
+/// single message, based on the contents of the system call arguments.
+/// Returns without waiting for any response.  A donated payload is surrendered
+/// by the sender, rather than shared; see address_space_c::donate_frame().
 ///
 /// System call input:
 ///		syscall->data0 = id of destination thread
@@ -1063,10 +2598,15 @@ syscall_send_and_receive_message(volatile syscall_data_s* syscall)
 /// System call output:
 ///		syscall->status	= status of message delivery
 ///
-/// @param syscall -- system call arguments
+/// @param syscall			-- system call arguments
+/// @param control			-- message control flags; see message.hpp
+/// @param wait_for_room	-- may the current thread wait for room in a full
+///							mailbox?  See put_message()
 ///
 void_t io_manager_c::
-syscall_send_message(volatile syscall_data_s* syscall)
+syscall_send_message(	volatile syscall_data_s*	syscall,
+						uintptr_t					control,
+						bool_t						wait_for_room)
 	{
 	thread_cp	destination;
 
@@ -1082,15 +2622,91 @@ syscall_send_message(volatile syscall_data_s* syscall)
 		{
 		thread_cr current_thread	= __hal->read_current_thread();
 
-		// Queue the message to its destination, return without waiting
-		// for a reply
-		syscall->status = ::put_message(current_thread,
-										*destination,
-										syscall->data1,				// type
-										syscall->data2,				// id
-										void_tp(syscall->data3),	// data
-										size_t(syscall->data4),		// size
-										void_tp(syscall->data5));	// address
+		// Small messages (typically replies) to a waiting thread take the
+		// direct-switch fast path; otherwise, queue the message to its
+		// destination.  Either way, return without waiting for a reply
+		if (syscall->data4 > 0 ||
+			!send_direct_message(*destination, syscall, FALSE))
+			{
+			syscall->status = ::put_message(current_thread,
+											*destination,
+											syscall->data1,				// type
+											syscall->data2,				// id
+											void_tp(syscall->data3),	// data
+											size_t(syscall->data4),		// size
+											void_tp(syscall->data5),	// address
+											control,
+											wait_for_room);
+			}
+
+		remove_reference(*destination);
+		}
+	else
+		{
+		syscall->status = STATUS_INVALID_DATA;
+		}
+
+	return;
+	}
+
+
+///
+/// Handler for SEND_REQUEST message operations.  Send a single message as an
+/// asynchronous request, based on the contents of the system call arguments.
+/// There is no dedicated vector for this; it is only available via
+/// PROCESS_MESSAGES.  See process_message() and send_request().
+///
+/// System call input:
+///		syscall->data0 = id of destination thread
+///		syscall->data1 = message type
+///		syscall->data2 = message id; the reply carries the same id
+///		syscall->data3 = payload pointer/word
+///		syscall->data4 = payload size
+///		syscall->data5 = delivery address in recipient's address space
+///
+/// System call output:
+///		syscall->status	= status of message delivery
+///
+/// @param syscall			-- system call arguments
+/// @param wait_for_room	-- may the current thread wait for room in a full
+///							mailbox?  See put_message()
+///
+void_t io_manager_c::
+syscall_send_request(	volatile syscall_data_s*	syscall,
+						bool_t						wait_for_room)
+	{
+	thread_cp	destination;
+	message_cp	request;
+
+	TRACE(SYSCALL, "System call: send request (%p) to thread %#x, type %#x\n",
+		syscall, syscall->data0, syscall->data1);
+
+
+	//
+	// Lookup the destination thread
+	//
+	destination = __thread_manager->find_thread(syscall->data0);
+	if (destination)
+		{
+		// Requests always take the normal message path, so that the
+		// recipient knows a reply is expected
+		request = allocate_message(	__hal->read_current_thread(),
+									*destination,
+									syscall->data1,				// type
+									syscall->data2,				// id
+									void_tp(syscall->data3),	// data
+									size_t(syscall->data4),		// size
+									void_tp(syscall->data5));	// address
+		if (request)
+			{
+			syscall->status = send_request(*request, wait_for_room);
+			if (syscall->status != STATUS_SUCCESS)
+				{ delete(request); }
+			}
+		else
+			{
+			syscall->status = STATUS_INSUFFICIENT_MEMORY;
+			}
 
 		remove_reference(*destination);
 		}
@@ -1102,3 +2718,78 @@ syscall_send_message(volatile syscall_data_s* syscall)
 	return;
 	}
 
+
+///
+/// Handler for SET_MAILBOX_LIMIT system call.  Set the maximum number of
+/// messages that may be queued in the mailbox of the current thread.  Once
+/// the mailbox is full, further senders wait for room (or receive
+/// STATUS_WOULD_BLOCK) until the thread drains its mailbox.  Replies are
+/// never subject to this limit.
+///
+/// System call input:
+///		syscall->data0 = new mailbox limit, between 1 and MAILBOX_LIMIT_MAX
+///
+/// System call output:
+///		syscall->status	= status of the request
+///
+/// @param syscall -- system call arguments
+///
+void_t io_manager_c::
+syscall_set_mailbox_limit(volatile syscall_data_s* syscall)
+	{
+	thread_cr current_thread = __hal->read_current_thread();
+
+	TRACE(SYSCALL, "System call: set mailbox limit (%p) to %d\n",
+		syscall, syscall->data0);
+
+	syscall->status = current_thread.set_mailbox_limit(syscall->data0);
+
+	return;
+	}
+
+
+///
+/// Handler for SIGNAL_THREAD system call.  Raise one or more signal bits in
+/// the notification word of the destination thread.  Unlike SEND_MESSAGE,
+/// this allocates nothing in the steady state, and never blocks: repeated
+/// signals coalesce until the destination receives them, as a single
+/// MESSAGE_TYPE_NOTIFICATION message.  See put_notification().  The IRQ
+/// bits are reserved for interrupt delivery; see SIGNAL_IRQ_MASK.
+///
+/// System call input:
+///		syscall->data0 = id of destination thread
+///		syscall->data1 = signal bits to raise; user bits only
+///
+/// System call output:
+///		syscall->status	= status of the request
+///
+/// @param syscall -- system call arguments
+///
+void_t io_manager_c::
+syscall_signal_thread(volatile syscall_data_s* syscall)
+	{
+	thread_cp	destination;
+	uint32_t	signal = uint32_t(syscall->data1);
+
+	TRACE(SYSCALL, "System call: signal thread (%p), %#x to %#x\n",
+		syscall, signal, syscall->data0);
+
+	destination = __thread_manager->find_thread(thread_id_t(syscall->data0));
+	if (destination && signal && !(signal & SIGNAL_IRQ_MASK))
+		{
+		// The first signal allocates the destination's scheduling ticket,
+		// if necessary; thereafter, signals never allocate
+		syscall->status = destination->enable_notification();
+		if (syscall->status == STATUS_SUCCESS)
+			{ put_notification(*destination, signal); }
+		}
+	else
+		{
+		syscall->status = STATUS_INVALID_DATA;
+		}
+
+	if (destination)
+		{ remove_reference(*destination); }
+
+	return;
+	}
@@ -23,12 +23,50 @@ large_message_c(thread_cr		message_source,
 				size_t			message_payload_size,
 				void_tp			message_receiver_payload):
 	message_c(message_source, message_destination, message_type, message_id),
+	fragment_count(1),
 	payload_size(message_payload_size),
-	receiver_payload(message_receiver_payload),
-	sender_payload(message_sender_payload)
+	receiver_offset(0),
+	receiver_payload(message_receiver_payload)
 	{
 	ASSERT(payload_size > 0);
-	ASSERT(sender_payload != NULL);
+	ASSERT(message_sender_payload != NULL);
+
+	fragment[0].data = message_sender_payload;
+	fragment[0].size = message_payload_size;
+
+	return;
+	}
+
+
+///
+/// Constructor.  Load (cache) the list of payload fragments, but defer all
+/// validation until collect_payload().  The fragments are concatenated, in
+/// order, to form the recipient's payload
+///
+large_message_c::
+large_message_c(thread_cr					message_source,
+				thread_cr					message_destination,
+				message_type_t				message_type,
+				message_id_t				message_id,
+				const message_fragment_s*	message_fragment,
+				uint32_t					message_fragment_count,
+				void_tp						message_receiver_payload):
+	message_c(message_source, message_destination, message_type, message_id),
+	fragment_count(message_fragment_count),
+	payload_size(0),
+	receiver_offset(0),
+	receiver_payload(message_receiver_payload)
+	{
+	ASSERT(message_fragment != NULL);
+	ASSERT(fragment_count > 0);
+	ASSERT(fragment_count <= MESSAGE_FRAGMENT_COUNT_MAX);
+
+	for (uint32_t i = 0; i < fragment_count; i++)
+		{
+		fragment[i]		=  message_fragment[i];
+		payload_size	+= message_fragment[i].size;
+		}
+
 	return;
 	}
 
@@ -54,6 +92,13 @@ large_message_c::
 /// thread).  The pages shared here will later be mapped into the recipient's
 /// address space via deliver_payload().
 ///
+/// Only whole pages of the payload are shared.  The partial pages at either
+/// end of the payload, and any data that is not aligned with the recipient's
+/// pages, are copied instead.  See address_space_c::gather_frame().
+///
+/// If the sender has donated the payload, then the pages are surrendered
+/// rather than shared, where possible.  See address_space_c::donate_frame()
+///
 /// @return STATUS_SUCCESS if the payload is successfully shared; nonzero
 /// otherwise
 ///
@@ -68,7 +113,7 @@ collect_payload()
 		//
 		// The sender must provide the payload here
 		//
-		if (!sender_payload)
+		if (payload_size == 0)
 			{
 			status = STATUS_INVALID_DATA;
 			break;
@@ -92,18 +137,6 @@ collect_payload()
 				}
 
 
-			// The payload pointers must be congruent modulo the page size;
-			// otherwise, the receiver will look for the payload at the wrong
-			// offset within the shared page
-			if (PAGE_OFFSET(sender_payload) != PAGE_OFFSET(receiver_payload))
-				{
-				TRACE(ALL, "Cannot deliver misaligned payload from %p to %p\n",
-					sender_payload, receiver_payload);
-				status = STATUS_IO_ERROR;
-				break;
-				}
-
-
 			// Destination address must be in user-visible memory
 			if (!__memory_manager->is_user_address(receiver_payload))
 				{
@@ -112,15 +145,36 @@ collect_payload()
 				status = STATUS_ACCESS_DENIED;
 				break;
 				}
+
+			receiver_offset = PAGE_OFFSET(receiver_payload);
+			}
+		else
+			{
+			// No explicit target, so the recipient's payload appears at the
+			// same offset as the sender's
+			receiver_offset = PAGE_OFFSET(fragment[0].data);
 			}
 
 
 		//
-		// Share the frames that comprise this payload
+		// Donate, share or copy the frames that comprise this payload.  A
+		// donated payload can only be surrendered outright if the recipient
+		// sees it at the same offset within each page
 		//
-		status = thread.address_space.share_frame(	sender_payload,
-													payload_size,
-													frame);
+		if (is_donated() &&
+			fragment_count == 1 &&
+			PAGE_OFFSET(fragment[0].data) == receiver_offset)
+			{
+			status = thread.address_space.donate_frame(
+				void_tp(fragment[0].data), payload_size, frame);
+			}
+		else
+			{
+			status = thread.address_space.gather_frame(	fragment,
+														fragment_count,
+														receiver_offset,
+														frame);
+			}
 
 		} while(0);
 
@@ -156,17 +210,17 @@ deliver_payload()
 		page = thread.address_space.allocate_large_payload_block(
 			frame.read_count());
 
-		// The recipient's payload appears at the same offset as the sender's
-		receiver_payload = uint8_tp(page) + PAGE_OFFSET(sender_payload);
+		// Place the payload at the offset chosen in collect_payload()
+		receiver_payload = uint8_tp(page) + receiver_offset;
 		TRACE(ALL, "Delivering large payload (%db) to thread %#x "
 			"at auto target %p (page %p)\n",
 			payload_size, thread.id, receiver_payload, page);
 		}
 	else
 		{
-		// Explicit target address, should already be correctly aligned with
-		// sender's payload
-		ASSERT(PAGE_OFFSET(sender_payload) == PAGE_OFFSET(receiver_payload));
+		// Explicit target address; the payload frames were already
+		// gathered at the correct offset
+		ASSERT(PAGE_OFFSET(receiver_payload) == receiver_offset);
 		page = void_tp(PAGE_BASE(receiver_payload));
 		TRACE(ALL, "Delivering large payload (%db) to thread %#x "
 			"at explicit target %p\n",
@@ -179,10 +233,9 @@ deliver_payload()
 	//
 	if (page)
 		{
-		//@always COW?
-		uint32_t flags = MEMORY_SHARED | MEMORY_USER | MEMORY_COPY_ON_WRITE;
-
-		status = thread.address_space.commit_frame(page, frame, flags);
+		// Frames donated or copied on behalf of this message now belong to
+		// the recipient; the remaining frames are still shared
+		status = thread.address_space.commit_payload_frame(page, frame);
 		}
 
 
@@ -197,3 +250,25 @@ deliver_payload()
 	return(status);
 	}
 
+
+///
+/// Allocate the memory for a new large_message_c from its dedicated object cache
+///
+void_tp large_message_c::
+operator new(size_t)
+	{
+	ASSERT(__large_message_cache);
+	return(__large_message_cache->allocate_object());
+	}
+
+
+///
+/// Release the memory for a large_message_c back into its object cache
+///
+void_t large_message_c::
+operator delete(void_tp message)
+	{
+	if (message)
+		{ __large_message_cache->free_object(message); }
+	return;
+	}
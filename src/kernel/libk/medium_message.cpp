@@ -2,9 +2,11 @@
 // medium_message.cpp
 //
 
+#include "address_space.hpp"
 #include "kernel_subsystems.hpp"
 #include "klibc.hpp"
 #include "medium_message.hpp"
+#include "thread.hpp"
 
 
 
@@ -17,7 +19,9 @@ medium_message_c(	thread_cr		message_source,
 					void_tp			message_payload,
 					size_t			message_payload_size):
 	message_c(message_source, message_destination, message_type, message_id),
+	direct_copy(FALSE),
 	payload_size(min(message_payload_size, MEDIUM_MESSAGE_PAYLOAD_SIZE)),
+	receiver_payload(NULL),
 	sender_payload(message_payload)
 	{
 	ASSERT(payload_size <= MEDIUM_MESSAGE_PAYLOAD_SIZE);
@@ -27,21 +31,94 @@ medium_message_c(	thread_cr		message_source,
 
 
 ///
-/// Gather the payload from the current address + copy it into the payload
-/// area embedded within this message
+/// Destructor.  If the payload was copied straight into the recipient's
+/// address space, but never delivered, then release the recipient's block.
+/// This may execute in any address space; free_medium_payload_block() takes
+/// the lock on the recipient's address space
+///
+medium_message_c::
+~medium_message_c()
+	{
+	if (direct_copy)
+		{
+		destination.address_space.free_medium_payload_block(
+			receiver_payload);
+		}
+
+	return;
+	}
+
+
+///
+/// Gather the payload from the current address space.  If the recipient is
+/// already waiting for a message, then copy the payload straight into the
+/// recipient's address space; otherwise, copy it into the payload area
+/// embedded within this message
 ///
 /// @return STATUS_SUCCESS
 ///
 status_t medium_message_c::
 collect_payload()
 	{
-	// Copy the user data to the internal payload buffer.  This potentially
-	// faults if the caller (user thread) passed a bad address
-	memcpy(payload, sender_payload, payload_size);
+	if (destination.state != THREAD_STATE_WAITING || !copy_payload())
+		{
+		// Copy the user data to the internal payload buffer.  This potentially
+		// faults if the caller (user thread) passed a bad address
+		memcpy(payload, sender_payload, payload_size);
+		}
+
 	return(STATUS_SUCCESS);
 	}
 
 
+///
+/// Copy the payload from the current address space directly into a new
+/// payload block in the recipient's address space, skipping the embedded
+/// payload buffer.  Always executes in the context of the sender's address
+/// space.  See address_space_c::copy_payload()
+///
+/// @return TRUE if the payload was copied; FALSE if the caller must stage the
+/// payload within this message instead
+///
+bool_t medium_message_c::
+copy_payload()
+	{
+	void_tp				block;
+	address_space_cr	receiver	= destination.address_space;
+	status_t			status		= STATUS_INSUFFICIENT_MEMORY;
+	thread_cr			thread		= __hal->read_current_thread();
+
+	block = receiver.allocate_medium_payload_block();
+	if (block)
+		{
+		if (&receiver == &thread.address_space)
+			{
+			// Sender + recipient share the same address space, so no
+			// temporary mapping is necessary
+			memcpy(block, sender_payload, payload_size);
+			status = STATUS_SUCCESS;
+			}
+		else
+			{
+			status = thread.address_space.copy_payload(receiver, block,
+				sender_payload, payload_size);
+			}
+
+		if (status == STATUS_SUCCESS)
+			{
+			receiver_payload	= block;
+			direct_copy			= TRUE;
+			}
+		else
+			{
+			receiver.free_medium_payload_block(block);
+			}
+		}
+
+	return(direct_copy);
+	}
+
+
 ///
 /// Copy the payload embedded in this message to the recipient's address
 /// space, where the recipient can safely access it.  This always executes in
@@ -59,25 +136,62 @@ deliver_payload()
 	status_t	status = STATUS_INSUFFICIENT_MEMORY;
 	thread_cr	thread = __hal->read_current_thread();
 
-	// Allocate a buffer in the recipient's address space for delivering
-	// the message payload
-	receiver_payload = thread.address_space.allocate_medium_payload_block();
-	if (receiver_payload)
+	if (direct_copy)
 		{
-		// Copy the payload to the recipient's address space
+		// The payload is already waiting in the recipient's address space.
+		// The recipient now owns this block
+		ASSERT(&thread.address_space == &destination.address_space);
 		TRACE(ALL,
-			"Delivering medium payload to thread %#x at auto target %p\n",
+			"Delivered medium payload directly to thread %#x at %p\n",
 			thread.id, receiver_payload);
-		memcpy(receiver_payload, payload, payload_size);
+		direct_copy = FALSE;
 		status = STATUS_SUCCESS;
 		}
 	else
 		{
-		// Unable to deliver this message.  The current thread might misbehave
-		// here, depending on the original contents of this message
-		printf("Unable to deliver message to thread %#x\n", thread.id);
+		// Allocate a buffer in the recipient's address space for delivering
+		// the message payload
+		receiver_payload = thread.address_space.allocate_medium_payload_block();
+		if (receiver_payload)
+			{
+			// Copy the payload to the recipient's address space
+			TRACE(ALL,
+				"Delivering medium payload to thread %#x at auto target %p\n",
+				thread.id, receiver_payload);
+			memcpy(receiver_payload, payload, payload_size);
+			status = STATUS_SUCCESS;
+			}
+		else
+			{
+			// Unable to deliver this message.  The current thread might
+			// misbehave here, depending on the original contents of this
+			// message
+			printf("Unable to deliver message to thread %#x\n", thread.id);
+			}
 		}
 
  	return(status);
 	}
 
+
+///
+/// Allocate the memory for a new medium_message_c from its dedicated object cache
+///
+void_tp medium_message_c::
+operator new(size_t)
+	{
+	ASSERT(__medium_message_cache);
+	return(__medium_message_cache->allocate_object());
+	}
+
+
+///
+/// Release the memory for a medium_message_c back into its object cache
+///
+void_t medium_message_c::
+operator delete(void_tp message)
+	{
+	if (message)
+		{ __medium_message_cache->free_object(message); }
+	return;
+	}
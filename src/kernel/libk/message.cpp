@@ -13,6 +13,15 @@
 
 
 
+///
+/// Object caches for each flavor of message
+///
+object_cache_cp	__large_message_cache	= NULL;
+object_cache_cp	__medium_message_cache	= NULL;
+object_cache_cp	__small_message_cache	= NULL;
+
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // Convenience routines
@@ -21,6 +30,33 @@
 
 
 
+///
+/// Allocate the object caches for the various message flavors.  Must be
+/// invoked once, during kernel initialization, before any messages are
+/// allocated.  The caches are initially empty and grow on demand.
+///
+/// @return STATUS_SUCCESS if the caches are ready; non-zero otherwise
+///
+status_t
+initialize_message_caches()
+	{
+	status_t status = STATUS_SUCCESS;
+
+	ASSERT(!__small_message_cache);
+
+	__large_message_cache	= new object_cache_c(sizeof(large_message_c));
+	__medium_message_cache	= new object_cache_c(sizeof(medium_message_c));
+	__small_message_cache	= new object_cache_c(sizeof(small_message_c));
+
+	if (!__large_message_cache ||
+		!__medium_message_cache ||
+		!__small_message_cache)
+		{ status = STATUS_INSUFFICIENT_MEMORY; }
+
+	return(status);
+	}
+
+
 ///
 /// Factory function for allocating a new message_c according to the input
 /// parameters.  Caller is responsible for then sending the message.
@@ -33,6 +69,8 @@
 /// @param payload_size		-- size of the payload data, in bytes
 /// @param receiver_payload	-- address at which payload should be mapped in
 ///								the recipient's address space (optional)
+/// @param control			-- message control flags (optional).  See
+///								message.hpp
 ///
 /// @return the new message; or NULL on error
 ///
@@ -43,7 +81,8 @@ allocate_message(	thread_cr		source,
 					message_id_t	id,
 					void_tp			payload,
 					size_t			payload_size,
-					void_tp			receiver_payload)
+					void_tp			receiver_payload,
+					uintptr_t		control)
 	{
 	message_cp	message;
 
@@ -76,6 +115,9 @@ allocate_message(	thread_cr		source,
 			uintptr_t(payload));
 		}
 
+	if (message)
+		{ message->control |= control; }
+
 	return(message);
 	}
 
@@ -84,7 +126,9 @@ allocate_message(	thread_cr		source,
 /// Allocates a new message_c according to the input parameters + pushes it
 /// to the recipient.
 ///
-/// Non-blocking.  May be safely invoked from interrupt context
+/// Non-blocking, unless the caller allows the current thread to wait for room
+/// in a full mailbox; see io_manager_c::put_message().  Otherwise, may be
+/// safely invoked from interrupt context
 ///
 /// @return STATUS_SUCCESS on success; or non-zero on error.
 ///
@@ -95,7 +139,9 @@ put_message(thread_cr		source,
 			message_id_t	id,
 			void_tp			payload,
 			size_t			payload_size,
-			void_tp			receiver_payload)
+			void_tp			receiver_payload,
+			uintptr_t		control,
+			bool_t			wait_for_room)
 	{
 	message_cp	message;
 	status_t	status;
@@ -110,14 +156,15 @@ put_message(thread_cr		source,
 								id,
 								payload,
 								payload_size,
-								receiver_payload);
+								receiver_payload,
+								control);
 
 	//
 	// Now deliver the message to its destination
 	//
 	if (message)
 		{
-		status = __io_manager->put_message(*message);
+		status = __io_manager->put_message(*message, wait_for_room);
 
 		// On failure, the current thread still owns this message and is
 		// responsible for cleanup
@@ -270,6 +317,7 @@ message_c(	thread_cr		message_source,
 			message_type_t	message_type,
 			message_id_t	message_id):
 	pool_index(0xFFFFFFFF),
+	queue_next(NULL),
 	control(MESSAGE_CONTROL_NONE),
 	destination(message_destination),
 	id(message_id),
@@ -289,6 +337,7 @@ message_c::
 message_c(	message_cr		request,
 			message_type_t	message_type):
 	pool_index(0xFFFFFFFF),
+	queue_next(NULL),
 	control(MESSAGE_CONTROL_NONE),
 	destination(request.source),
 	id(request.id),
@@ -312,5 +361,26 @@ message_c::
 
 
 
+///
+/// Allocate the memory for a new small_message_c.  Small messages are the
+/// most common flavor, so allocate them from a dedicated object cache
+/// rather than the general kernel heap
+///
+void_tp small_message_c::
+operator new(size_t)
+	{
+	ASSERT(__small_message_cache);
+	return(__small_message_cache->allocate_object());
+	}
 
 
+///
+/// Release the memory for a small_message_c back into its object cache
+///
+void_t small_message_c::
+operator delete(void_tp message)
+	{
+	if (message)
+		{ __small_message_cache->free_object(message); }
+	return;
+	}
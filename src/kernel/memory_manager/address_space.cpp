@@ -4,6 +4,7 @@
 
 #include "address_space.hpp"
 #include "bits.hpp"
+#include "dx/expand_address_space.h"
 #include "dx/hal/memory.h"
 #include "dx/hal/physical_address.h"
 #include "kernel_panic.hpp"
@@ -26,6 +27,8 @@ address_space_c(address_space_id_t address_space_id):
 	io_port_map(NULL),
 	medium_payload_pool(void_tp(MEDIUM_PAYLOAD_POOL_BASE), //@size is 128K,!4MB
 		MEDIUM_MESSAGE_PAYLOAD_SIZE*1024, MEDIUM_MESSAGE_PAYLOAD_SIZE),
+	message_ring_pool(void_tp(MESSAGE_RING_POOL_BASE), PAYLOAD_POOL_SIZE,
+		PAGE_SIZE),
 	shared_frame_table(128),
 	id(address_space_id)
 	{
@@ -89,7 +92,12 @@ address_space_c::
 	// If this address space had an explicit I/O port map, release it now
 	//
 	//@release any remaining ports?
-	delete(io_port_map);
+	if (io_port_map)
+		{
+		// Some processor may still cache this bitmap in its TSS
+		__hal->discard_io_port_map(*io_port_map);
+		delete(io_port_map);
+		}
 
 
 	//
@@ -121,11 +129,15 @@ address_space_c::
 		ASSERT(entry);
 		ASSERT(entry->is_present());
 
-		// Release the underlying physical frame; no need to invalidate the TLB
-		// here, since the current thread is not executing within the victim
-		// address space
-		physical_address_t frame = entry->decommit_frame(NULL);
-		__page_frame_manager->free_frames(&frame, 1);
+		// Release the underlying physical frame(s); no need to invalidate the
+		// TLB here, since the current thread is not executing within the
+		// victim address space
+		bool_t				super_page	= entry->is_super_page();
+		physical_address_t	frame		= entry->decommit_frame(NULL);
+		if (super_page)
+			{ __page_frame_manager->free_super_pages(frame, 1); }
+		else
+			{ __page_frame_manager->free_frames(&frame, 1); }
 
 		// Advance to the next frame in this page directory
 		entry = page_directory->find_present_entry(&page);
@@ -410,21 +422,333 @@ commit_frame(	void_tp					page,
 	}
 
 
+///
+/// Commit the frames of a large message payload to these virtual pages within
+/// the current address space.  Frames held only by the message (i.e., frames
+/// that were donated outright, or that hold a private copy of part of the
+/// payload) become private, writable pages of this address space, with no
+/// shared-frame bookkeeping; the message no longer owns these frames.  Any
+/// remaining frames are still shared with the sender, and are mapped
+/// copy-on-write, as in commit_frame().  See donate_frame() and
+/// gather_frame().
+///
+/// On failure, some of the pages may be bound, some not.  The caller is
+/// responsible for invoking decommit_frame() or otherwise cleaning up.
+///
+/// @param page		-- the first virtual page/address to be bound
+/// @param frame	-- list of physical frames carrying the payload
+///
+/// @return STATUS_SUCCESS on success; non-zero on error
+///
+status_t address_space_c::
+commit_payload_frame(	void_tp					page,
+						shared_frame_list_cr	frame)
+	{
+	uint32_t	page_count	= frame.read_count();
+	status_t	status		= STATUS_SUCCESS;
+
+	ASSERT(is_aligned(page, PAGE_SIZE));
+	ASSERT(page != NULL);
+	ASSERT(page_count > 0);
+
+	lock.acquire();
+
+	for (uint32_t i = 0; i < page_count; i++)
+		{
+		shared_frame_cr	current_frame = frame[i];
+
+		// Locate the page table entry for this next page
+		page_table_entry_cp entry = page_directory->find_entry(page,
+			EXPAND_TREE);
+		if (!entry)
+			{
+			status = STATUS_INSUFFICIENT_MEMORY;
+			break;
+			}
+
+		if (read_reference_count(current_frame) == 1)
+			{
+			// Only the message holds this frame, so this address space now
+			// owns it
+			status = entry->commit_frame(current_frame.address,
+				MEMORY_USER | MEMORY_WRITABLE);
+			if (status != STATUS_SUCCESS)
+				break;
+
+			current_frame.detach_frame();
+			}
+		else
+			{
+			// The sender still shares this frame (e.g., a partial page at
+			// either end of the payload)
+			status = entry->commit_frame(current_frame.address,
+				MEMORY_SHARED | MEMORY_USER | MEMORY_COPY_ON_WRITE);
+			if (status != STATUS_SUCCESS)
+				break;
+
+			add_reference(current_frame);
+			shared_frame_table.add(page, current_frame);
+			}
+
+		// Advance to the next page + frame
+		page = uint8_tp(page) + PAGE_SIZE;
+		}
+
+	lock.release();
+
+	return(status);
+	}
+
+
+///
+/// Allocate a new physical frame, fill it with zeroes + commit it to a page
+/// that was previously reserved via reserve_frame().  The frame is cleared
+/// through the current thread's copy-page before it becomes visible at the
+/// target page, so no other thread in this address space can observe its
+/// stale contents.  Assumes the caller holds the address space lock.
+///
+/// @param entry	-- the (not-present) page table entry for the target page
+/// @param page		-- the target page
+///
+/// @return STATUS_SUCCESS if the page is now present; non-zero otherwise
+///
+status_t address_space_c::
+commit_zero_frame(	page_table_entry_cr	entry,
+					const void_tp		page)
+	{
+	void_tp				copy_page = __hal->read_current_thread().copy_page;
+	page_table_entry_cp	copy_entry;
+	physical_address_t	frame;
+	status_t			status;
+
+	ASSERT(entry.is_demand_zero());
+	ASSERT(is_aligned(page, PAGE_SIZE));
+
+	do
+		{
+		//
+		// Locate the temporary mapping for the new frame
+		//
+		ASSERT(copy_page);
+		copy_entry = page_directory->find_entry(copy_page, EXPAND_TREE);
+		if (!copy_entry)
+			{
+			TRACE(ALL, "Unable to find page table entry for copy-buffer\n");
+			status = STATUS_INSUFFICIENT_MEMORY;
+			break;
+			}
+
+
+		//
+		// Allocate the frame that will back this page
+		//
+		status = __page_frame_manager->allocate_frames(&frame, 1, 0);
+		if (status != STATUS_SUCCESS)
+			{
+			//@how to handle this?  user mem mgr cannot fix, so thread is stuck
+			printf("Unable to allocate frame for demand-zero page %p\n", page);
+			break;
+			}
+
+
+		//
+		// Wipe the frame via the temporary mapping
+		//
+		status = copy_entry->commit_frame(frame, MEMORY_WRITABLE);
+		ASSERT(status == STATUS_SUCCESS);
+		memset(copy_page, 0, PAGE_SIZE);
+		copy_entry->decommit_frame(copy_page);
+
+
+		//
+		// Finally, expose the frame at the target page
+		//
+		status = entry.commit_frame(frame, MEMORY_USER_DEFAULT);
+		ASSERT(status == STATUS_SUCCESS);
+
+		} while(0);
+
+	return(status);
+	}
+
+
+///
+/// Copy part of a gathered payload into a new, private frame.  The frame is
+/// zero-filled, apart from the payload data.  Assumes the caller holds the
+/// address space lock.
+///
+/// The current thread must be able to read the data itself: every source page
+/// must be a user page; or a kernel page explicitly shared via
+/// share_kernel_frames().  Reserved pages are populated first, so that the
+/// copy cannot fault.
+///
+/// @param fragment			-- the list of payload fragments
+/// @param fragment_count	-- the number of fragments
+/// @param position			-- the first payload byte to copy, relative to
+///							   the start of the (concatenated) payload
+/// @param offset			-- offset of this data within the new frame
+/// @param size				-- number of payload bytes to copy
+/// @param shared_frame		-- on success, a descriptor for the new frame
+///
+/// @return STATUS_SUCCESS if the data was copied; nonzero otherwise
+///
+status_t address_space_c::
+copy_fragment(	const message_fragment_s*	fragment,
+				uint32_t					fragment_count,
+				size_t						position,
+				uintptr_t					offset,
+				size_t						size,
+				shared_frame_cpp			shared_frame)
+	{
+	size_t				base;
+	size_t				end;
+	physical_address_t	frame;
+	size_t				start;
+	status_t			status = STATUS_SUCCESS;
+
+
+	ASSERT(offset + size <= PAGE_SIZE);
+	ASSERT(shared_frame);
+	*shared_frame = NULL;
+
+	do
+		{
+		//
+		// Validate + populate each page underneath the data.  This may use
+		// the copy page, so must precede the copy below
+		//
+		base = 0;
+		for (uint32_t i = 0; i < fragment_count; i++)
+			{
+			start	= max(base, position);
+			end		= min(base + fragment[i].size, position + size);
+
+			uint8_tp page	= uint8_tp(PAGE_BASE(uint8_tp(fragment[i].data) +
+								(start - base)));
+			uint8_tp limit	= uint8_tp(fragment[i].data) + (end - base);
+
+			for (; start < end && page < limit; page += PAGE_SIZE)
+				{
+				page_table_entry_cp entry = page_directory->find_entry(page);
+				ASSERT(entry);
+
+				if (entry->is_demand_zero())
+					{
+					status = commit_zero_frame(*entry, page);
+					if (status != STATUS_SUCCESS)
+						break;
+					}
+
+				if (!entry->is_present() ||
+					!(entry->is_user() || shared_frame_table.is_valid(page)))
+					{
+					TRACE(ALL, "Cannot copy payload from page %p\n", page);
+					status = STATUS_ACCESS_DENIED;
+					break;
+					}
+				}
+
+			if (status != STATUS_SUCCESS)
+				break;
+
+			base += fragment[i].size;
+			}
+
+		if (status != STATUS_SUCCESS)
+			break;
+
+
+		//
+		// Locate the thread's preallocated copy page
+		//
+		thread_cr	thread		= __hal->read_current_thread();
+		uint8_tp	copy_page	= uint8_tp(thread.copy_page);
+
+		ASSERT(copy_page);
+		page_table_entry_cp copy_entry =
+			page_directory->find_entry(copy_page, EXPAND_TREE);
+		if (!copy_entry)
+			{
+			status = STATUS_INSUFFICIENT_MEMORY;
+			break;
+			}
+
+
+		//
+		// Allocate the new frame + fill it via the copy page
+		//
+		status = __page_frame_manager->allocate_frames(&frame, 1, 0);
+		if (status != STATUS_SUCCESS)
+			{
+			TRACE(ALL, "Unable to allocate frame for payload copy\n");
+			break;
+			}
+
+		status = copy_entry->commit_frame(frame, MEMORY_WRITABLE);
+		ASSERT(status == STATUS_SUCCESS);
+		memset(copy_page, 0, PAGE_SIZE);
+
+		base = 0;
+		for (uint32_t i = 0; i < fragment_count; i++)
+			{
+			start	= max(base, position);
+			end		= min(base + fragment[i].size, position + size);
+
+			if (start < end)
+				{
+				memcpy(copy_page + offset + (start - position),
+					uint8_tp(fragment[i].data) + (start - base), end - start);
+				}
+
+			base += fragment[i].size;
+			}
+
+		copy_entry->decommit_frame(copy_page);
+
+
+		//
+		// Wrap the new frame in a descriptor, so it can travel with the
+		// other payload frames.  This is the only reference to the frame
+		//
+		*shared_frame = new shared_frame_c(frame);
+		if (!*shared_frame)
+			{
+			__page_frame_manager->free_frames(&frame, 1);
+			status = STATUS_INSUFFICIENT_MEMORY;
+			}
+
+		} while(0);
+
+	return(status);
+	}
+
+
 ///
 /// Copy-on-write handler.  Invoked from the page-fault path to handle a
 /// copy-on-write fault in the current thread/address space.   Allocate a
 /// new physical page frame; and copy the contents of the faulting page to the
 /// new frame.
 ///
-/// @param address -- the faulting address referenced by the current thread
+/// If this address space holds the only remaining reference to the frame
+/// (e.g., the sender of a message has since released its own copy), then no
+/// copy is necessary: the page is simply made writable again, in place.
+///
+/// @param address	-- the faulting address referenced by the current thread
+/// @param copied	-- on success, indicates whether the page was actually
+///					   copied; or merely reclaimed in place
 ///
 /// @return TRUE if this is copy-on-write fault; FALSE if not.
 ///
 bool_t address_space_c::
-copy_on_write(const void_tp address)
+copy_on_write(	const void_tp	address,
+				bool_tp			copied)
 	{
-	status_t	status;
-	bool_t		success = FALSE;
+	shared_frame_cp	shared_frame;
+	status_t		status;
+	bool_t			success = FALSE;
+
+	ASSERT(copied);
+	*copied = FALSE;
 
 	lock.acquire();
 
@@ -447,8 +771,22 @@ copy_on_write(const void_tp address)
 		ASSERT(!entry->is_writable());
 
 
-		//@optimization here: if this is the last reference to the frame, then
-		//@COW is not needed; just fixup the bits in the PTE and return
+		//
+		// If no other address space (or in-flight message) still references
+		// this frame, then this address space is its sole owner.  Restore
+		// write access without copying.  Only user pages are eligible here;
+		// kernel frames are never owned by an address space
+		//
+		void_tp page = void_tp(PAGE_BASE(address));
+		shared_frame = shared_frame_table.find(page);
+		if (shared_frame &&
+			read_reference_count(*shared_frame) == 1 &&
+			page >= void_tp(PAYLOAD_AREA_BASE))
+			{
+			entry->reclaim_frame(page);
+			success = TRUE;
+			break;
+			}
 
 
 		//
@@ -496,7 +834,6 @@ copy_on_write(const void_tp address)
 		// Copy the data from the original page (the original page frame)
 		// to the temporary page (the new frame)
 		//
-		void_tp page = void_tp(PAGE_BASE(address));
 		memcpy(copy_page, page, PAGE_SIZE);
 
 
@@ -526,7 +863,8 @@ copy_on_write(const void_tp address)
 		// The current thread is now free to modify this page as necessary
 		//
 		TRACE(ALL, "COW done!\n");//@
-		success = TRUE;
+		*copied	= TRUE;
+		success	= TRUE;
 
 		} while(0);
 
@@ -537,6 +875,104 @@ copy_on_write(const void_tp address)
 	}
 
 
+///
+/// Copy a small block of data from the current address space straight into
+/// another address space, without staging it in the kernel.  The target block
+/// is temporarily mapped at the current thread's copy-on-write page, as in
+/// copy_on_write().  Always executes in the context of the current (source)
+/// address space.
+///
+/// The data is only copied if every page underneath it is already present;
+/// otherwise, the copy itself could fault while the copy page is in use.  In
+/// that case, nothing is copied and the caller should fall back to some other
+/// means of delivery.
+///
+/// @param target			-- the destination address space
+/// @param target_address	-- destination of the data, within the target
+///							   address space.  Must not span a page boundary
+/// @param data				-- the source data, within the current address
+///							   space
+/// @param size				-- size of the data, in bytes
+///
+/// @return STATUS_SUCCESS if the data was copied; nonzero otherwise
+///
+status_t address_space_c::
+copy_payload(	address_space_cr	target,
+				void_tp				target_address,
+				const void_tp		data,
+				size_t				size)
+	{
+	uint8_tp			page;
+	uint32_t			page_count	= PAGE_COUNT(data, size);
+	status_t			status		= STATUS_INSUFFICIENT_MEMORY;
+	physical_address_t	target_frame;
+
+
+	ASSERT(PAGE_OFFSET(target_address) + size <= PAGE_SIZE);
+	ASSERT(size > 0);
+
+	//
+	// Locate the frame behind the target block.  This acquires the lock on
+	// the target address space, so must precede the lock on this one
+	//
+	target_frame = target.find_frame(target_address);
+
+	lock.acquire();
+
+	do
+		{
+		if (target_frame == INVALID_FRAME)
+			break;
+
+
+		//
+		// Ensure the source data can be read without faulting
+		//
+		page = uint8_tp(PAGE_BASE(data));
+		for (uint32_t i = 0; i < page_count; i++)
+			{
+			page_table_entry_cp entry = page_directory->find_entry(page);
+			if (!entry || !entry->is_present())
+				break;
+			page += PAGE_SIZE;
+			}
+
+		if (page != uint8_tp(PAGE_BASE(data)) + page_count * PAGE_SIZE)
+			{
+			status = STATUS_RESOURCE_CONFLICT;
+			break;
+			}
+
+
+		//
+		// Locate the thread's preallocated copy page
+		//
+		thread_cr	thread		= __hal->read_current_thread();
+		void_tp		copy_page	= thread.copy_page;
+
+		ASSERT(copy_page);
+		page_table_entry_cp copy_entry =
+			page_directory->find_entry(copy_page, EXPAND_TREE);
+		if (!copy_entry)
+			break;
+
+
+		//
+		// Map the target frame temporarily, and copy the data into it
+		//
+		status = copy_entry->commit_frame(target_frame, MEMORY_WRITABLE);
+		ASSERT(status == STATUS_SUCCESS);
+		memcpy(uint8_tp(copy_page) + PAGE_OFFSET(target_address), data, size);
+		copy_entry->decommit_frame(copy_page);
+
+		} while(0);
+
+	lock.release();
+
+	return(status);
+	}
+
+
 ///
 /// Remove the physical frames behind these virtual addresses/pages in the
 /// current address space.  On return, these virtual address are no longer
@@ -578,6 +1014,49 @@ decommit_frame(	void_tp				page,
 	}
 
 
+///
+/// Demand-zero handler.  Invoked from the page-fault path to handle the first
+/// touch of a page that was reserved (but not allocated) via expand().
+/// Allocate a zero-filled frame + map it at the faulting address.
+///
+/// If several threads touch the same reserved page at once, only the first
+/// one (to acquire the lock) commits the frame; the others find the page
+/// already present, and may simply retry their access.
+///
+/// @param address -- the faulting address referenced by the current thread
+///
+/// @return TRUE if this was a demand-zero fault, and the page is now present;
+/// FALSE if not.
+///
+bool_t address_space_c::
+demand_zero(const void_tp address)
+	{
+	status_t	status;
+	bool_t		success = FALSE;
+
+	lock.acquire();
+
+	page_table_entry_cp entry = page_directory->find_entry(address);
+	ASSERT(entry);
+	if (entry->is_demand_zero())
+		{
+		status	= commit_zero_frame(*entry, void_tp(PAGE_BASE(address)));
+		success	= (status == STATUS_SUCCESS ? TRUE : FALSE);
+		}
+	else if (entry->is_present() && entry->is_user() && entry->is_writable())
+		{
+		// Another thread already populated this page while the current
+		// thread was waiting on the lock.  A read-only page here is a true
+		// protection fault, and is not handled here
+		success = TRUE;
+		}
+
+	lock.release();
+
+	return(success);
+	}
+
+
 ///
 /// Disable access to the specified I/O port(s) from this address space.  On
 /// return, threads in this address space may no longer access these ports
@@ -596,21 +1075,108 @@ status_t address_space_c::
 disable_io_port(uint16_t port,
 				uint16_t count)
 	{
-	status_t status;
+	status_t status;
+
+	lock.acquire();
+
+	if (io_port_map)
+		{
+		ASSERT(count > 0);
+		io_port_map->disable(port, count);
+		status = STATUS_SUCCESS;
+		}
+	else
+		{
+		// Cannot disable ports when if the port map was never allocated
+		// (i.e., if the ports were never enabled)
+		status = STATUS_INVALID_DATA;
+		}
+
+	lock.release();
+
+	return(status);
+	}
+
+
+///
+/// Donate the data in these pages to another address space.  Unlike
+/// share_frame(), the current address space surrenders each page that lies
+/// entirely within the payload: the underlying frame is unmapped here, and
+/// its page is reserved again, so any later touch yields a zero-filled page
+/// rather than a fault.  The recipient may then map these frames as its own,
+/// without copy-on-write.  Pages only partially covered by the payload; pages
+/// that are already shared; and pages outside of the user area are merely
+/// shared, as usual.  Typically, this occurs when the current thread is
+/// sending a message that it will never touch again.
+///
+/// On failure, some pages may already be surrendered.  Their frames are
+/// released along with the frame list.
+///
+/// @param address	-- pointer to the data to be donated
+/// @param size		-- the size, in bytes, of the data
+/// @param frame	-- on return, the list of donated + shared frames
+///
+/// @return STATUS_SUCCESS if the data is successfully donated; nonzero
+/// otherwise
+///
+status_t address_space_c::
+donate_frame(	const void_tp			address,
+				size_t					size,
+				shared_frame_list_cr	frame)
+	{
+	const uint8_tp	end			= uint8_tp(address) + size;
+	uint8_tp		page		= uint8_tp(PAGE_BASE(address));
+	uint32_t		page_count	= PAGE_COUNT(address, size);
+	shared_frame_cp	shared_frame;
+	status_t		status		= STATUS_SUCCESS;
+
+	ASSERT(address);
+	ASSERT(size > 0);
 
 	lock.acquire();
 
-	if (io_port_map)
-		{
-		ASSERT(count > 0);
-		io_port_map->disable(port, count);
-		status = STATUS_SUCCESS;
-		}
-	else
+	for (uint32_t i = 0; i < page_count; i++)
 		{
-		// Cannot disable ports when if the port map was never allocated
-		// (i.e., if the ports were never enabled)
-		status = STATUS_INVALID_DATA;
+		page_table_entry_cp entry = page_directory->find_entry(page);
+		ASSERT(entry);
+
+		if (page >= uint8_tp(address) &&
+			page + PAGE_SIZE <= end &&
+			page >= uint8_tp(USER_BASE) &&
+			entry->is_present() &&
+			!entry->is_shared() &&
+			!entry->is_super_page())
+			{
+			// This page is private to the current address space, and holds
+			// only payload data.  Hand its frame to the recipient; this new
+			// descriptor holds the only reference to it.  The decommit
+			// flushes the stale mapping from every processor, so no other
+			// thread in this address space can still write to the frame
+			// once the recipient owns it
+			shared_frame = new shared_frame_c(entry->read_frame());
+			if (shared_frame)
+				{
+				entry->decommit_frame(page);
+				entry->reserve_frame();
+				}
+			}
+		else
+			{
+			// Share this page instead
+			shared_frame = share_frame(page);
+			}
+
+		if (!shared_frame)
+			{
+			status = STATUS_INSUFFICIENT_MEMORY;
+			break;
+			}
+
+		// Save a handle to this frame for later delivery
+		frame += *shared_frame;
+
+		// Advance to the next page
+		page += PAGE_SIZE;
 		}
 
 	lock.release();
@@ -682,6 +1248,10 @@ enable_io_port(	uint16_t port,
 /// address space at the specified address.  On return, threads in this address
 /// space can safely access these new pages.
 ///
+/// If the caller passes EXPAND_ADDRESS_SPACE_RESERVE, then no frames are
+/// allocated here; the range is only reserved, and each page is populated on
+/// first touch via demand_zero().
+///
 /// @param first_new_page	-- target address where pages should be added
 /// @param size				-- size, in bytes, of address space to add
 /// @param flags			-- allocation/expansion flags
@@ -692,14 +1262,16 @@ enable_io_port(	uint16_t port,
 status_t address_space_c::
 expand(	const void_tp		first_new_page,
 		size_t				size,
-		uintptr_t			flags)	//@currently unused
+		uintptr_t			flags)
 	{
 	thread_cr			current_thread = __hal->read_current_thread();
 	physical_address_t	frame[ EXPAND_ADDRESS_SPACE_PAGE_COUNT ];
 	uint32_t			frame_count;
 	void_tp				last_new_page;
+	uint32_t			max_frame_count;
 	void_tp				next_present_page;
 	status_t			status;
+	uint32_t			super_page_count;
 
 
 	do
@@ -716,10 +1288,30 @@ expand(	const void_tp		first_new_page,
 
 
 		//
-		// Must provide a valid size for expansion
+		// Must provide a valid size for expansion.  If the request covers
+		// whole superpages, then map it with 4MB pages; this allows much
+		// larger expansions, and reduces TLB pressure on large heaps
 		//
 		frame_count = PAGE_COUNT(0, size);
-		if (frame_count == 0 || frame_count > EXPAND_ADDRESS_SPACE_PAGE_COUNT)
+		if (flags & EXPAND_ADDRESS_SPACE_RESERVE)
+			{
+			super_page_count	= 0;
+			max_frame_count		= EXPAND_ADDRESS_SPACE_RESERVE_PAGE_COUNT;
+			}
+		else if (is_aligned(first_new_page, SUPER_PAGE_SIZE) &&
+			is_aligned(void_tp(size), SUPER_PAGE_SIZE))
+			{
+			super_page_count	= size / SUPER_PAGE_SIZE;
+			max_frame_count		= EXPAND_ADDRESS_SPACE_SUPER_PAGE_COUNT *
+									(SUPER_PAGE_SIZE / PAGE_SIZE);
+			}
+		else
+			{
+			super_page_count	= 0;
+			max_frame_count		= EXPAND_ADDRESS_SPACE_PAGE_COUNT;
+			}
+
+		if (frame_count == 0 || frame_count > max_frame_count)
 			{
 			TRACE(ALL, "Cannot expand, frame count %d\n", frame_count);
 			status = STATUS_INSUFFICIENT_MEMORY;
@@ -763,6 +1355,27 @@ expand(	const void_tp		first_new_page,
 			}
 
 
+		//
+		// If the caller only wants to reserve this range, then no frames are
+		// required yet
+		//
+		if (flags & EXPAND_ADDRESS_SPACE_RESERVE)
+			{
+			status = reserve_frame(first_new_page, frame_count);
+			break;
+			}
+
+
+		//
+		// Map large requests with superpages
+		//
+		if (super_page_count > 0)
+			{
+			status = expand_super_pages(first_new_page, super_page_count);
+			break;
+			}
+
+
 		//
 		// Allocate enough frames to span the requested size
 		//
@@ -807,6 +1420,122 @@ expand(	const void_tp		first_new_page,
 	}
 
 
+///
+/// Allocate physical superpages and map them into this address space at the
+/// specified address, via 4MB page directory entries.  The caller has already
+/// validated the range; and ensured that no pages are present there.
+///
+/// @param first_new_page	-- target address, aligned on a superpage boundary
+/// @param super_page_count	-- the number of 4MB superpages to add
+///
+/// @return STATUS_SUCCESS if the superpages are added to the address space;
+/// non-zero otherwise.  On failure, no superpages are added
+///
+status_t address_space_c::
+expand_super_pages(	const void_tp	first_new_page,
+					uint32_t		super_page_count)
+	{
+	uint32_t			flags	= MEMORY_PAGED | MEMORY_USER | MEMORY_WRITABLE;
+	uint32_t			i;
+	uint8_tp			page	= uint8_tp(first_new_page);
+	status_t			status	= STATUS_SUCCESS;
+	physical_address_t	super_page;
+
+
+	TRACE(ALL, "Expanding address space %#x: adding %d superpages at %p\n",
+		this->id, super_page_count, first_new_page);
+
+	for (i = 0; i < super_page_count; i++)
+		{
+		super_page = __page_frame_manager->allocate_super_pages(1);
+		if (super_page == INVALID_FRAME)
+			{
+			status = STATUS_INSUFFICIENT_MEMORY;
+			break;
+			}
+
+		//
+		// Wipe any data left in the superpage when its frames were last
+		// used, before any thread can see it.  The range contains no present
+		// pages, but a page table may still cover this address, e.g., after
+		// its pages were released.  If so, the superpage cannot be mapped
+		// here
+		//
+		lock.acquire();
+
+		status = zero_super_page(super_page);
+		if (status == STATUS_SUCCESS)
+			{
+			page_table_entry_cr entry =
+				page_directory->find_directory_entry(page);
+			if (!entry.is_present())
+				{ status = entry.commit_super_page(super_page, flags); }
+			else
+				{ status = STATUS_RESOURCE_CONFLICT; }
+			}
+
+		lock.release();
+
+		if (status != STATUS_SUCCESS)
+			{
+			__page_frame_manager->free_super_pages(super_page, 1);
+			break;
+			}
+
+		page += SUPER_PAGE_SIZE;
+		}
+
+
+	//
+	// On failure, unwind any superpages that were already added
+	//
+	if (status != STATUS_SUCCESS)
+		{
+		printf("Unable to expand address space %#x\n", this->id);
+
+		while (i > 0)
+			{
+			i--;
+			page -= SUPER_PAGE_SIZE;
+
+			lock.acquire();
+			super_page = page_directory->find_directory_entry(page).
+				decommit_frame(page);
+			lock.release();
+
+			__page_frame_manager->free_super_pages(super_page, 1);
+			}
+		}
+
+	return(status);
+	}
+
+
+///
+/// Return the physical frame behind this address.  No side effects
+///
+/// @param address -- any address in this address space
+///
+/// @return the physical frame that backs this address; or INVALID_FRAME if
+/// the address is not present, or lies within a superpage
+///
+physical_address_t address_space_c::
+find_frame(const void_tp address)
+	{
+	physical_address_t frame = INVALID_FRAME;
+
+	lock.acquire();
+
+	page_table_entry_cp entry = page_directory->find_entry(address);
+	if (entry && entry->is_present() && !entry->is_super_page())
+		{ frame = entry->read_frame(); }
+
+	lock.release();
+
+	return(frame);
+	}
+
+
 ///
 /// Release a block previously reserved via allocate_large_payload_block().
 /// The block of memory is freed + is now eligible to be remapped to another
@@ -846,10 +1575,50 @@ free_large_payload_block(const void_tp block)
 	}
 
 
+///
+/// Reserve a page in this address space for the message rings of one of its
+/// threads.  Like allocate_large_payload_block(), this only reserves the
+/// address range; the caller commits the frame.  These pages lie outside of
+/// the payload pools, so no message deletion can ever release them.  Pages
+/// allocated here should later be released via free_message_ring_page().
+///
+/// @return the linear address of the page; or NULL if no page could be
+/// allocated
+///
+void_tp address_space_c::
+allocate_message_ring_page()
+	{
+	void_tp page = message_ring_pool.allocate_block();
+
+	if (!page)
+		{ TRACE(ALL, "Unable to allocate message ring page\n"); }
+
+	return(page);
+	}
+
+
+///
+/// Release a page previously reserved via allocate_message_ring_page().  The
+/// caller is responsible for tearing down its mapping first.
+///
+/// @param page -- the victim page
+///
+/// @return STATUS_SUCCESS if the page is successfully freed; non-zero
+/// otherwise
+///
+status_t address_space_c::
+free_message_ring_page(const void_tp page)
+	{
+	ASSERT(uintptr_t(page) >= MESSAGE_RING_POOL_BASE);
+	return(message_ring_pool.free_block(page));
+	}
+
+
 ///
 /// Release a block previously reserved via allocate_medium_payload_block().
 /// The block of memory is freed + is now eligible to be reused for another
-/// incoming message.
+/// incoming message.  This need not be the current address space (e.g., when
+/// a sender discards a payload that was copied directly to its recipient).
 ///
 /// @param block -- the victim block to be released
 ///
@@ -859,8 +1628,14 @@ free_large_payload_block(const void_tp block)
 status_t address_space_c::
 free_medium_payload_block(const void_tp block)
 	{
-	// Release the payload block back to the pool
-	status_t status = medium_payload_pool.free_block(block);
+	status_t status;
+
+	// Release the payload block back to the pool.  Serialize this with
+	// allocate_medium_payload_block(), which may be populating the page
+	// underneath this same block on behalf of another thread
+	lock.acquire();
+	status = medium_payload_pool.free_block(block);
+	lock.release();
 
 	// Leave the page directory/table unchanged, since there may be other
 	// blocks within this same page still in use
@@ -869,6 +1644,150 @@ free_medium_payload_block(const void_tp block)
 	}
 
 
+///
+/// Gather the data in these fragments for delivery to another address space,
+/// as a single payload beginning at the given offset within its first page.
+/// Wherever a whole page of the recipient's payload corresponds to a whole
+/// page of the sender's data, that page is shared (as in share_frame()).
+/// Everything else -- typically the partial pages at either end of the
+/// payload; or misaligned data -- is copied into new, private frames.
+///
+/// @param fragment			-- the list of payload fragments
+/// @param fragment_count	-- the number of fragments
+/// @param offset			-- offset of the payload within the first page
+///							   of the recipient's payload
+/// @param frame			-- on return, the list of frames that comprise
+///							   the payload
+///
+/// @return STATUS_SUCCESS if the payload is successfully gathered; nonzero
+/// otherwise
+///
+status_t address_space_c::
+gather_frame(	const message_fragment_s*	fragment,
+				uint32_t					fragment_count,
+				uintptr_t					offset,
+				shared_frame_list_cr		frame)
+	{
+	size_t			base;
+	uint32_t		current;
+	size_t			position	= 0;
+	size_t			remaining	= 0;
+	shared_frame_cp	shared_frame;
+	size_t			size;
+	uint8_tp		source;
+	status_t		status		= STATUS_SUCCESS;
+
+
+	ASSERT(fragment);
+	ASSERT(offset < PAGE_SIZE);
+
+	for (uint32_t i = 0; i < fragment_count; i++)
+		{ remaining += fragment[i].size; }
+
+
+	lock.acquire();
+
+	while (remaining > 0)
+		{
+		//
+		// Locate the fragment that holds the next payload byte
+		//
+		base	= 0;
+		current	= 0;
+		while (base + fragment[current].size <= position)
+			{
+			base += fragment[current].size;
+			current++;
+			ASSERT(current < fragment_count);
+			}
+
+		source	= uint8_tp(fragment[current].data) + (position - base);
+		size	= min(PAGE_SIZE - offset, remaining);
+
+
+		//
+		// Share this page, if possible; otherwise, copy it
+		//
+		shared_frame = NULL;
+		if (size == PAGE_SIZE &&
+			PAGE_OFFSET(source) == 0 &&
+			base + fragment[current].size - position >= PAGE_SIZE &&
+			(source >= uint8_tp(PAYLOAD_AREA_BASE) ||
+				shared_frame_table.is_valid(source)))
+			{
+			shared_frame = share_frame(source);
+			}
+
+		if (!shared_frame)
+			{
+			status = copy_fragment(fragment, fragment_count, position,
+				offset, size, &shared_frame);
+			if (status != STATUS_SUCCESS)
+				break;
+			}
+
+		// Save a handle to this frame for later delivery
+		frame += *shared_frame;
+
+		// Advance to the next page of the recipient's payload
+		offset		=  0;
+		position	+= size;
+		remaining	-= size;
+		}
+
+	lock.release();
+
+	return(status);
+	}
+
+
+///
+/// Reserve a range of pages within this address space, without allocating
+/// any physical frames.  Each page is populated on first touch; see
+/// demand_zero().  On failure, some of the pages may remain reserved, but no
+/// frames are consumed.
+///
+/// @param first_new_page	-- the first page to reserve
+/// @param page_count		-- the number of pages to reserve
+///
+/// @return STATUS_SUCCESS if the range is reserved; non-zero otherwise
+///
+status_t address_space_c::
+reserve_frame(	const void_tp	first_new_page,
+				uint32_t		page_count)
+	{
+	uint8_tp	page	= uint8_tp(first_new_page);
+	status_t	status	= STATUS_SUCCESS;
+
+	TRACE(ALL, "Expanding address space %#x: reserving %d pages at %p\n",
+		this->id, page_count, first_new_page);
+
+	lock.acquire();
+
+	for (uint32_t i = 0; i < page_count; i++)
+		{
+		page_table_entry_cp entry = page_directory->find_entry(page,
+			EXPAND_TREE);
+		if (!entry)
+			{
+			status = STATUS_INSUFFICIENT_MEMORY;
+			break;
+			}
+
+		// A reserved page cannot be part of a superpage, since the caller
+		// has already verified that no pages are present in this range
+		ASSERT(!entry->is_present());
+		entry->reserve_frame();
+
+		page += PAGE_SIZE;
+		}
+
+	lock.release();
+
+	return(status);
+	}
+
+
 ///
 /// Share the data in this page with another address space.  Assumes the
 /// current thread already holds the lock protecting this address space.
@@ -896,6 +1815,14 @@ share_frame(const void_tp address)
 		shared_frame = shared_frame_table.find(page);
 		if (shared_frame)
 			{
+			// The page may have been reclaimed for writing after its other
+			// references were released (see copy_on_write()); if so, then
+			// protect it again
+			page_table_entry_cp entry = page_directory->find_entry(page);
+			ASSERT(entry);
+			if (page >= void_tp(PAYLOAD_AREA_BASE) && entry->is_writable())
+				{ entry->share_frame(page); }
+
 			// The caller now holds an additional reference to this frame
 			add_reference(*shared_frame);
 			break;
@@ -921,11 +1848,22 @@ share_frame(const void_tp address)
 			}
 
 
+		//
+		// If this page was reserved, but never touched, then populate it now
+		// so that its (empty) contents can be shared like any other page
+		//
+		if (entry->is_demand_zero() &&
+			commit_zero_frame(*entry, page) != STATUS_SUCCESS)
+			{
+			TRACE(ALL, "Unable to populate reserved page %p\n", page);
+			break;
+			}
+
+
 		//
 		// This frame is currently *not* shared (i.e., it's private/local
 		// to the current address space), so mark it as shared now
 		//
-		//@page might not be present
 		physical_address_t frame = entry->share_frame(page);
 		if (frame == INVALID_FRAME)
 			{
@@ -1028,7 +1966,7 @@ share_kernel_frames(const void_tp	address,
 					size_t			size)
 	{
 	uint8_tp	block  = uint8_tp(PAGE_BASE(address));
-	uint8_tp	end    = block + size;
+	uint8_tp	end    = uint8_tp(address) + size;
 	status_t	status = STATUS_SUCCESS;
 
 	ASSERT(block < void_tp(PAYLOAD_AREA_BASE));
@@ -1046,10 +1984,15 @@ share_kernel_frames(const void_tp	address,
 		{
 		if (!shared_frame_table.is_valid(block))
 			{
-			// Allocate a shared-frame descriptor for this block of data.
-			// Assume the kernel image + ramdisk are both identify-mapped
-			shared_frame_cp shared_frame =
-				new shared_frame_c( physical_address_t(block) );
+			// Locate the frame behind this block.  The kernel image, ramdisk
+			// and fixed heap pools are all identity-mapped; but the heap
+			// extension is mapped with discrete 4KB pages
+			page_table_entry_cp entry = page_directory->find_entry(block);
+			physical_address_t frame = entry->is_super_page() ?
+				physical_address_t(block) : entry->read_frame();
+
+			// Allocate a shared-frame descriptor for this block of data
+			shared_frame_cp shared_frame = new shared_frame_c(frame);
 			if (!shared_frame)
 				{
 				TRACE(ALL, "Unable to allocate shared kernel frame\n");
@@ -1057,9 +2000,14 @@ share_kernel_frames(const void_tp	address,
 				break;
 				}
 
+			// The descriptor would free this frame along with its last
+			// reference; so pin it with an extra reference that is never
+			// removed, since the kernel still owns the frame
+			add_reference(*shared_frame);
+
 			// Add this block to the pool of shared frames, as if it were a
-			// distinct page of memory.  This is the first (and currently only)
-			// reference to this frame
+			// distinct page of memory.  Besides the pin, this is the first
+			// (and currently only) reference to this frame
 			shared_frame_table.add(block, *shared_frame);
 			}
 
@@ -1097,12 +2045,12 @@ unshare_frame(const void_tp address)
 		shared_frame_cr shared_frame = shared_frame_table.remove(page);
 
 		// Update the page directory/table that describes this address space.
-		// Ignore the kernel superpages, since these must always be present +
+		// Ignore the kernel pages, since these must always be present +
 		// mapped; and really these entries are just aliases injected by the
 		// share_kernel_frames() logic
 		ASSERT(entry);
 		ASSERT(entry->is_present());
-		if (!entry->is_super_page())
+		if (page >= void_tp(PAYLOAD_AREA_BASE))
 			{ entry->unshare_frame(page); }
 
 		// This address no longer needs/holds a reference to the shared frame
@@ -1163,3 +2111,59 @@ unshare_frame(	const void_tp	address,
 	return;
 	}
 
+
+///
+/// Fill a physical superpage with zeroes, one frame at a time, through the
+/// current thread's copy-page.  Between frames, only the local TLB is
+/// flushed: the lock is held throughout, so the current thread cannot
+/// migrate; and no other thread uses this copy-page.  The final decommit
+/// flushes every processor.  Assumes the caller holds the address space
+/// lock.
+///
+/// @param super_page -- the physical superpage to wipe
+///
+/// @return STATUS_SUCCESS if the superpage is now zero-filled; non-zero
+/// otherwise
+///
+status_t address_space_c::
+zero_super_page(physical_address_t super_page)
+	{
+	void_tp				copy_page	= __hal->read_current_thread().copy_page;
+	page_table_entry_cp	copy_entry;
+	uint32_t			frame_count	= SUPER_PAGE_SIZE / PAGE_SIZE;
+	status_t			status;
+
+	ASSERT(is_aligned(void_tp(super_page), SUPER_PAGE_SIZE));
+
+	do
+		{
+		ASSERT(copy_page);
+		copy_entry = page_directory->find_entry(copy_page, EXPAND_TREE);
+		if (!copy_entry)
+			{
+			TRACE(ALL, "Unable to find page table entry for copy-buffer\n");
+			status = STATUS_INSUFFICIENT_MEMORY;
+			break;
+			}
+
+		for (uint32_t i = 0; i < frame_count; i++)
+			{
+			status = copy_entry->commit_frame(super_page + i*PAGE_SIZE,
+				MEMORY_WRITABLE);
+			ASSERT(status == STATUS_SUCCESS);
+			memset(copy_page, 0, PAGE_SIZE);
+
+			if (i < frame_count - 1)
+				{
+				copy_entry->decommit_frame(NULL);
+				__hal->invalidate_local_tlb(copy_page);
+				}
+			}
+
+		copy_entry->decommit_frame(copy_page);
+		status = STATUS_SUCCESS;
+
+		} while(0);
+
+	return(status);
+	}
@@ -7,7 +7,10 @@
 #include "bits.hpp"
 #include "debug.hpp"
 #include "hal/address_space_layout.h"
+#include "hal/page_table.hpp"
 #include "kernel_heap.hpp"
+#include "klibc.hpp"
+#include "page_frame_manager.hpp"
 
 
 ///
@@ -18,8 +21,10 @@ kernel_heap_cp	__kernel_heap = NULL;
 
 
 ///
-/// Constructor.  Initialize all of the memory pools.  On return, memory
-/// may be allocated from the heap via allocate_block() or operator new().
+/// Constructor.  Initialize all of the memory pools, and the page tables
+/// that will eventually map the heap extension.  On return, memory may be
+/// allocated from the fixed pools via allocate_block() or operator new();
+/// but the heap cannot expand until enable_expansion().
 ///
 kernel_heap_c::
 kernel_heap_c():
@@ -32,8 +37,36 @@ kernel_heap_c():
 	pool512(	void_tp(KERNEL_POOL512_BASE),	KERNEL_POOL512_SIZE,	512),
 	pool1024(	void_tp(KERNEL_POOL1024_BASE),	KERNEL_POOL1024_SIZE,	1024),
 	pool4096(	void_tp(KERNEL_POOL4096_BASE),	KERNEL_POOL4096_SIZE,	4096),
-	pool8192(	void_tp(KERNEL_POOL8192_BASE),	KERNEL_POOL8192_SIZE,	8192)
+	pool8192(	void_tp(KERNEL_POOL8192_BASE),	KERNEL_POOL8192_SIZE,	8192),
+	expandable(FALSE),
+	slab_count(0),
+	slab_map(KERNEL_HEAP_SLAB_COUNT)
 	{
+	void_tp		block;
+	uint32_t	i;
+
+	ASSERT(sizeof(*this) <= KERNEL_HEAP_DESCRIPTOR_SIZE);
+
+	memset(partial_slab, 0, sizeof(partial_slab));
+	memset(slab_table, 0, sizeof(slab_table));
+
+
+	//
+	// Preallocate the page tables for the heap extension + thread area.
+	// Every page directory shares these same tables, so a page mapped here
+	// later is immediately visible in every address space.  The tables
+	// themselves must be identity-mapped, so allocate them from the fixed
+	// pools
+	//
+	for (i = 0; i < KERNEL_PAGE_TABLE_COUNT; i++)
+		{
+		block = allocate_block(sizeof(page_table_c),
+			MEMORY_ALIGN_PAGE | MEMORY_IDENTITY_MAPPED | MEMORY_ZERO);
+		ASSERT(block);
+
+		page_table[i] = ::new(block) page_table_c();
+		}
+
 	return;
 	}
 
@@ -69,10 +102,10 @@ allocate_block(	size_t		size,
 
 
 	//
-	// Attempt to allocate a block from the corresponding pool.  If the
-	// appropriate pool is already exhausted, then attempt to allocate a
-	// larger block from the next pool, etc, until a free block is found or
-	// until all pools are exhausted
+	// Attempt to allocate a block from the corresponding pool, expanding the
+	// heap if necessary.  If the appropriate pool is already exhausted and
+	// cannot expand, then attempt to allocate a larger block from the next
+	// pool, etc, until a free block is found or until all pools are exhausted
 	//
 	switch(allocation_size)
 		{
@@ -88,53 +121,53 @@ allocate_block(	size_t		size,
 		case 2:
 		case 4:
 		case 8:
-			block = pool8.allocate_block();
+			block = allocate_pool_block(pool8, flags);
 			if (block)
 				{ break; }
 
 		case 16:
-			block = pool16.allocate_block();
+			block = allocate_pool_block(pool16, flags);
 			if (block)
 				{ break; }
 
 		case 32:
-			block = pool32.allocate_block();
+			block = allocate_pool_block(pool32, flags);
 			if (block)
 				{ break; }
 
 		case 64:
-			block = pool64.allocate_block();
+			block = allocate_pool_block(pool64, flags);
 			if (block)
 				{ break; }
 
 		case 128:
-			block = pool128.allocate_block();
+			block = allocate_pool_block(pool128, flags);
 			if (block)
 				{ break; }
 
 		case 256:
-			block = pool256.allocate_block();
+			block = allocate_pool_block(pool256, flags);
 			if (block)
 				{ break; }
 
 		case 512:
-			block = pool512.allocate_block();
+			block = allocate_pool_block(pool512, flags);
 			if (block)
 				{ break; }
 
 		case 1024:
-			block = pool1024.allocate_block();
+			block = allocate_pool_block(pool1024, flags);
 			if (block)
 				{ break; }
 
 		case 2048:
 		case 4096:
-			block = pool4096.allocate_block();
+			block = allocate_pool_block(pool4096, flags);
 			if (block)
 				{ break; }
 
 		case 8192:
-			block = pool8192.allocate_block();
+			block = allocate_pool_block(pool8192, flags);
 			if (block)
 				{ break; }
 
@@ -155,6 +188,238 @@ allocate_block(	size_t		size,
 	}
 
 
+///
+/// Allocate a block from one of the fixed pools.  If the pool is exhausted,
+/// then allocate a block of the same size from the heap extension instead,
+/// expanding the heap if necessary.
+///
+/// @param pool		-- the fixed pool that would normally satisfy this request
+/// @param flags	-- Allocation flags.  See new.hpp
+///
+/// @return a pointer to the new block; or NULL if no block of this size is
+/// available
+///
+void_tp kernel_heap_c::
+allocate_pool_block(memory_pool_cr	pool,
+					uint32_t		flags)
+	{
+	void_tp block = NULL;
+
+	// The pool only reports exhaustion as a hint here, but this avoids
+	// a search (and a trace message) on every allocation once it is full
+	if (!pool.is_empty())
+		{ block = pool.allocate_block(); }
+
+	// Blocks in the heap extension are not identity-mapped, so only the fixed
+	// pools can satisfy requests for identity-mapped memory
+	if (!block && !(flags & MEMORY_IDENTITY_MAPPED))
+		{ block = allocate_slab_block(pool.read_block_size()); }
+
+	return(block);
+	}
+
+
+///
+/// Allocate a block from the slabs in the heap extension, adding a new slab
+/// if all of the current slabs of this size are full
+///
+/// @param block_size -- size of the requested block; must be an exact size
+/// class
+///
+/// @return a pointer to the new block; or NULL if the heap cannot expand
+///
+void_tp kernel_heap_c::
+allocate_slab_block(size_t block_size)
+	{
+	free_block_sp	block		= NULL;
+	heap_slab_sp	slab;
+	uint32_t		size_class	= find_one_bit32(block_size) -
+									HEAP_MIN_BLOCK_ORDER;
+
+	ASSERT(is_2n(block_size));
+	ASSERT(size_class < HEAP_SIZE_CLASS_COUNT);
+
+	for(;;)
+		{
+		lock.acquire();
+
+		// Pop a free block from the first slab that has one
+		slab = partial_slab[ size_class ];
+		if (slab)
+			{
+			ASSERT(slab->free_count > 0);
+			block			= slab->free_list;
+			slab->free_list	= block->next;
+			slab->free_count--;
+
+			// If this slab is now full, then drop it from the list until one
+			// of its blocks is freed
+			if (!slab->free_list)
+				{
+				partial_slab[ size_class ] = slab->next;
+				slab->next = NULL;
+				}
+			}
+
+		lock.release();
+
+
+		//
+		// If all of the slabs are full, then add another slab + try again.
+		// Another thread may claim the new blocks first, in which case this
+		// simply loops
+		//
+		if (block || !expandable)
+			break;
+
+		if (expand(size_class) != STATUS_SUCCESS)
+			break;
+		}
+
+	return(block);
+	}
+
+
+///
+/// Allow the heap to expand beyond its fixed pools.  Invoked by the Memory
+/// Manager once paging is enabled and the Page Frame Manager is available.
+///
+void_t kernel_heap_c::
+enable_expansion()
+	{
+	ASSERT(__page_frame_manager);
+	expandable = TRUE;
+
+	return;
+	}
+
+
+///
+/// Add a new slab to the heap extension.  The slab is backed by frames from
+/// the Page Frame Manager, carved into blocks of the given size class, and
+/// then added to the list of slabs with free blocks.
+///
+/// @param size_class -- the size class of the new slab
+///
+/// @return STATUS_SUCCESS if the heap expanded; non-zero otherwise
+///
+status_t kernel_heap_c::
+expand(uint32_t size_class)
+	{
+	uint8_tp			base;
+	size_t				block_size	= 1 << (size_class + HEAP_MIN_BLOCK_ORDER);
+	uint32_t			block_count	= KERNEL_HEAP_SLAB_SIZE / block_size;
+	physical_address_t	frame[ KERNEL_HEAP_SLAB_PAGE_COUNT ];
+	uint32_t			i;
+	uint32_t			index;
+	status_t			status;
+
+
+	do
+		{
+		//
+		// Reserve some unused portion of the heap extension for the new slab
+		//
+		lock.acquire();
+		index = slab_map.allocate();
+		lock.release();
+
+		if (index >= KERNEL_HEAP_SLAB_COUNT)
+			{
+			TRACE(ALL, "Kernel heap extension is full\n");
+			status = STATUS_INSUFFICIENT_MEMORY;
+			break;
+			}
+
+
+		//
+		// Back the slab with physical memory.  The heap lock cannot be held
+		// here, since the Page Frame Manager may release other free slabs
+		// when memory is low
+		//
+		status = __page_frame_manager->allocate_frames(frame,
+			KERNEL_HEAP_SLAB_PAGE_COUNT, MEMORY_WRITABLE);
+		if (status != STATUS_SUCCESS)
+			{
+			TRACE(ALL, "Unable to expand kernel heap (block size %d)\n",
+				block_size);
+
+			lock.acquire();
+			slab_map.free(index);
+			lock.release();
+			break;
+			}
+
+
+		//
+		// Map the new frames into the kernel.  No other thread can touch this
+		// range until the slab is published below, so no lock is required
+		//
+		base = uint8_tp(KERNEL_HEAP_EXTENSION_BASE +
+			index * KERNEL_HEAP_SLAB_SIZE);
+		for (i = 0; i < KERNEL_HEAP_SLAB_PAGE_COUNT; i++)
+			{
+			find_entry(base + i*PAGE_SIZE)->commit_frame(frame[i],
+				MEMORY_WRITABLE);
+			}
+
+
+		//
+		// Thread all of the new blocks together before publishing the slab,
+		// to keep the critical section short
+		//
+		for (i = 0; i < block_count - 1; i++)
+			{
+			free_block_sp(base + i*block_size)->next =
+				free_block_sp(base + (i+1)*block_size);
+			}
+		free_block_sp(base + i*block_size)->next = NULL;
+
+
+		//
+		// Publish the new slab
+		//
+		lock.acquire();
+
+		heap_slab_sr new_slab = slab_table[ index ];
+		new_slab.free_list	= free_block_sp(base);
+		new_slab.free_count	= block_count;
+		new_slab.size_class	= size_class;
+		new_slab.next		= partial_slab[ size_class ];
+		partial_slab[ size_class ] = &new_slab;
+		slab_count++;
+
+		lock.release();
+
+		status = STATUS_SUCCESS;
+
+		} while(0);
+
+	return(status);
+	}
+
+
+///
+/// Locate the page table entry that maps this page of the heap extension
+/// or the thread area.  No side effects
+///
+/// @param address -- an address within the heap extension or thread area
+///
+/// @return the corresponding page table entry; never NULL
+///
+page_table_entry_cp kernel_heap_c::
+find_entry(const void_tp address)
+	{
+	uint32_t index = (uintptr_t(address) - KERNEL_PAGE_TABLE_AREA_BASE) /
+		SUPER_PAGE_SIZE;
+
+	ASSERT(uintptr_t(address) >= KERNEL_PAGE_TABLE_AREA_BASE);
+	ASSERT(index < KERNEL_PAGE_TABLE_COUNT);
+
+	return(page_table[ index ]->find_entry(address));
+	}
+
+
 ///
 /// Given a block of memory, find the pool from which it was allocated.  No
 /// side effects
@@ -254,11 +519,166 @@ free_block(void_tp block)
 	{
 	memory_pool_cp pool;
 
-	// Locate the pool that owns this block of memory
 	ASSERT(block);
-	pool = find_pool(block);
-	if (pool)
-		{ pool->free_block(block); }
+
+	if (is_extension_block(block))
+		{
+		// Blocks in the heap extension belong to a slab, not a fixed pool
+		free_slab_block(block);
+		}
+	else
+		{
+		// Locate the pool that owns this block of memory
+		pool = find_pool(block);
+		if (pool)
+			{ pool->free_block(block); }
+		}
+
+	return;
+	}
+
+
+///
+/// Release a block back into its slab in the heap extension.  If the slab
+/// was previously full, then it becomes eligible for allocations again.
+///
+/// @param block -- the block being freed
+///
+void_t kernel_heap_c::
+free_slab_block(void_tp block)
+	{
+	uint32_t		index = (uintptr_t(block) - KERNEL_HEAP_EXTENSION_BASE) /
+							KERNEL_HEAP_SLAB_SIZE;
+	heap_slab_sp	slab;
+
+	ASSERT(is_extension_block(block));
+	ASSERT(index < KERNEL_HEAP_SLAB_COUNT);
+
+	lock.acquire();
+
+	slab = &slab_table[ index ];
+	ASSERT(slab_map.is_set(index));
+	ASSERT(is_aligned(block, 1 << (slab->size_class + HEAP_MIN_BLOCK_ORDER)));
+
+	// A full slab is not on the list of partial slabs, so add it back now
+	if (!slab->free_list)
+		{
+		slab->next = partial_slab[ slab->size_class ];
+		partial_slab[ slab->size_class ] = slab;
+		}
+
+	free_block_sp(block)->next	= slab->free_list;
+	slab->free_list				= free_block_sp(block);
+	slab->free_count++;
+
+	lock.release();
 
 	return;
 	}
+
+
+///
+/// Read the kernel heap statistics.  Usually only invoked in the
+/// context of a SYSTEM_CALL_VECTOR_READ_KERNEL_STATS syscall.
+///
+/// @param kernel_stats -- kernel statistics structure, provided by user thread
+///
+void_t kernel_heap_c::
+read_stats(volatile kernel_stats_s& kernel_stats)
+	{
+	kernel_stats.heap_slab_count = slab_count;
+
+	return;
+	}
+
+
+///
+/// Return any completely-free slabs in the heap extension to the Page Frame
+/// Manager.  Free slabs are otherwise cached indefinitely, so this is
+/// typically only invoked when physical memory is low.  See
+/// page_frame_manager_c::allocate_frames().
+///
+/// @return the number of slabs released
+///
+uint32_t kernel_heap_c::
+release_free_slabs()
+	{
+	uint8_tp			base;
+	uint32_t			block_count;
+	physical_address_t	frame[ KERNEL_HEAP_SLAB_PAGE_COUNT ];
+	uint32_t			i;
+	uint32_t			index;
+	heap_slab_spp		link;
+	uint32_t			released	= 0;
+	heap_slab_sp		slab;
+	heap_slab_sp		victim_list	= NULL;
+
+
+	//
+	// Unlink all of the free slabs while holding the lock.  No new blocks
+	// can be allocated from these slabs once they are unlinked
+	//
+	lock.acquire();
+
+	for (i = 0; i < HEAP_SIZE_CLASS_COUNT; i++)
+		{
+		block_count	= KERNEL_HEAP_SLAB_SIZE >> (i + HEAP_MIN_BLOCK_ORDER);
+		link		= &partial_slab[i];
+
+		while (*link)
+			{
+			slab = *link;
+			if (slab->free_count == block_count)
+				{
+				*link		= slab->next;
+				slab->next	= victim_list;
+				victim_list	= slab;
+				}
+			else
+				{ link = &slab->next; }
+			}
+		}
+
+	lock.release();
+
+
+	//
+	// Unmap each victim slab + return its frames.  Decommitting each page
+	// flushes its translation from the TLB of every processor, so no stale
+	// mapping remains by the time the frames are freed.  The frames are
+	// released without the heap lock, since the Page Frame Manager may
+	// itself be calling here
+	//
+	while (victim_list)
+		{
+		slab		= victim_list;
+		victim_list	= slab->next;
+
+		index	= slab - slab_table;
+		base	= uint8_tp(KERNEL_HEAP_EXTENSION_BASE +
+					index * KERNEL_HEAP_SLAB_SIZE);
+
+		for (i = 0; i < KERNEL_HEAP_SLAB_PAGE_COUNT; i++)
+			{
+			uint8_tp page = base + i*PAGE_SIZE;
+			frame[i] = find_entry(page)->decommit_frame(page);
+			}
+
+		__page_frame_manager->free_frames(frame, KERNEL_HEAP_SLAB_PAGE_COUNT);
+
+		// This portion of the heap extension may now be reused
+		lock.acquire();
+		memset(slab, 0, sizeof(*slab));
+		slab_map.free(index);
+		slab_count--;
+		lock.release();
+
+		released++;
+		}
+
+
+	if (released > 0)
+		{ TRACE(ALL, "Released %d free slabs from kernel heap\n", released); }
+
+	return(released);
+	}
@@ -8,6 +8,7 @@
 #include "dx/system_call.h"
 #include "dx/system_call_vectors.h"
 #include "hal/interrupt_vectors.h"
+#include "kernel_heap.hpp"
 #include "kernel_panic.hpp"
 #include "kernel_subsystems.hpp"
 #include "memory_manager.hpp"
@@ -35,7 +36,10 @@ static address_space_manager_cp		address_space_manager;
 ///
 memory_manager_c::
 memory_manager_c():
+	cow_copy_avoided_count(0),
 	cow_fault_count(0),
+	demand_zero_fault_count(0),
+	io_port_fault_count(0),
 	page_fault_count(0)
 	{
 	TRACE(ALL, "Initializing Memory Manager ...\n");
@@ -75,6 +79,14 @@ memory_manager_c():
 	__hal->enable_paging(*kernel_address_space);
 
 
+	//
+	// Now that paging is enabled, the kernel heap may expand beyond its
+	// fixed pools, using frames from the Page Frame Manager
+	//
+	ASSERT(__kernel_heap);
+	__kernel_heap->enable_expansion();
+
+
 	return;
 	}
 
@@ -152,16 +164,29 @@ handle_interrupt(interrupt_cr interrupt)
 
 	switch (interrupt.vector)
 		{
+		case INTERRUPT_VECTOR_GENERAL_PROTECTION:
+			// The I/O port bitmap is loaded lazily, so the first port I/O
+			// instruction after a context switch faults here, with a zero
+			// error code.  Load the bitmap and let the thread retry
+			if (interrupt.data == 0 && __hal->load_io_port_map(thread))
+				{
+				__memory_manager->io_port_fault_count++;
+				break;
+				}
+
+			// Otherwise, this is a genuine protection fault
+			// Fall through
+
 		case INTERRUPT_VECTOR_BOUND_RANGE_EXCEEDED:
 		case INTERRUPT_VECTOR_SEGMENT_NOT_PRESENT:
 		case INTERRUPT_VECTOR_STACK_SEGMENT_FAULT:
-		case INTERRUPT_VECTOR_GENERAL_PROTECTION:
 			TRACE(ALL, "Unhandled memory exception %d\n", interrupt.vector);
 			TRACE(ALL, "Data %#x\n", interrupt.data);
 			ASSERT(0);
 			break;
 
 		case INTERRUPT_VECTOR_PAGE_FAULT:
+			bool_t	copied;
 			void_tp	faulting_address;
 			bool_t	success;
 
@@ -173,13 +198,22 @@ handle_interrupt(interrupt_cr interrupt)
 			__memory_manager->page_fault_count++;
 
 			// The kernel handles copy-on-write faults directly
-			success = thread.address_space.copy_on_write(faulting_address);
+			success = thread.address_space.copy_on_write(faulting_address,
+				&copied);
 			if (success)
 				{
 				// Fixed up the current address space after a copy-on-write
 				// fault, so let the thread continue normally (and retry
 				// the memory write that triggered this fault)
 				__memory_manager->cow_fault_count++;
+				if (!copied)
+					{ __memory_manager->cow_copy_avoided_count++; }
+				}
+			else if (thread.address_space.demand_zero(faulting_address))
+				{
+				// First touch of a reserved page.  The page is now backed by
+				// a zero-filled frame, so let the thread continue normally
+				__memory_manager->demand_zero_fault_count++;
 				}
 			else
 				{
@@ -269,9 +303,16 @@ read_stats(volatile kernel_stats_s& kernel_stats)
 	ASSERT(__page_frame_manager);
 	__page_frame_manager->read_stats(kernel_stats);
 
+	// Kernel heap stats
+	ASSERT(__kernel_heap);
+	__kernel_heap->read_stats(kernel_stats);
+
 	// Misc memory stats
-	kernel_stats.cow_fault_count	= cow_fault_count;
-	kernel_stats.page_fault_count	= page_fault_count;
+	kernel_stats.cow_copy_avoided_count		= cow_copy_avoided_count;
+	kernel_stats.cow_fault_count			= cow_fault_count;
+	kernel_stats.demand_zero_fault_count	= demand_zero_fault_count;
+	kernel_stats.io_port_fault_count		= io_port_fault_count;
+	kernel_stats.page_fault_count			= page_fault_count;
 
 	return;
 	}
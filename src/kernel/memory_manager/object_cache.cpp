@@ -0,0 +1,188 @@
+//
+// object_cache.cpp
+//
+// A cache of fixed-size kernel objects
+//
+
+#include "bits.hpp"
+#include "debug.hpp"
+#include "dx/hal/memory.h"
+#include "kernel_heap.hpp"
+#include "klibc.hpp"
+#include "object_cache.hpp"
+
+
+
+///
+/// Constructor.  The cache is initially empty; the first allocation will
+/// allocate the first slab.
+///
+/// @param size -- size, in bytes, of each object in the cache.  Must be
+///					smaller than a page
+///
+object_cache_c::
+object_cache_c(size_t size):
+	free_list(NULL),
+	hit_count(0),
+	miss_count(0),
+	object_count(0),
+	object_size((max(size, sizeof(free_object_s)) + 7) & ~7),	// 8B-aligned
+	objects_per_slab((PAGE_SIZE - sizeof(slab_s)) / object_size),
+	slab_list(NULL)
+	{
+	ASSERT(sizeof(slab_s) % 8 == 0);
+	ASSERT(objects_per_slab > 0);
+	return;
+	}
+
+
+///
+/// Destructor.  Returns all of the slabs to the kernel heap.  All objects
+/// must already have been freed back into the cache.
+///
+object_cache_c::
+~object_cache_c()
+	{
+	slab_sp slab;
+
+	while(slab_list)
+		{
+		slab		= slab_list;
+		slab_list	= slab->next;
+		__kernel_heap->free_block(slab);
+		}
+
+	return;
+	}
+
+
+///
+/// Allocate a single object from the cache.  Grows the cache if necessary.
+/// The object should later be freed with free_object().  This only allocates
+/// the raw memory; it does not construct the object.
+///
+/// @return a handle to the new object; or NULL if no memory is available
+///
+void_tp object_cache_c::
+allocate_object()
+	{
+	void_tp		object	= NULL;
+	bool_t		miss	= FALSE;
+
+
+	for(;;)
+		{
+		lock.acquire();
+
+		if (free_list)
+			{
+			// Pop the next free object
+			object		= free_list;
+			free_list	= free_list->next;
+
+			if (miss)
+				miss_count++;
+			else
+				hit_count++;
+			}
+
+		lock.release();
+
+
+		//
+		// If the cache is exhausted, then allocate another slab + try again.
+		// Another thread may claim the new objects first, in which case
+		// this simply loops
+		//
+		if (object)
+			break;
+
+		miss = TRUE;
+		if (grow() != STATUS_SUCCESS)
+			break;
+		}
+
+	return(object);
+	}
+
+
+///
+/// Release an object back into the cache.  On return, the object may be
+/// reallocated; the caller must not touch it again.  The object should
+/// already be destroyed here, since this only frees the underlying memory.
+///
+/// @param object -- the object to free
+///
+void_t object_cache_c::
+free_object(void_tp object)
+	{
+	free_object_sp block = free_object_sp(object);
+
+	ASSERT(object);
+	ASSERT(is_aligned(object, 8));
+
+	lock.acquire();
+	block->next	= free_list;
+	free_list	= block;
+	lock.release();
+
+	return;
+	}
+
+
+///
+/// Grow the cache by one slab.  The new slab is carved into objects, which
+/// are then added to the free list.
+///
+/// @return STATUS_SUCCESS if the cache grew; non-zero otherwise
+///
+status_t object_cache_c::
+grow()
+	{
+	free_object_sp	head;
+	uint32_t		i;
+	uint8_tp		object;
+	slab_sp			slab;
+	status_t		status;
+
+
+	do
+		{
+		slab = slab_sp(__kernel_heap->allocate_block(PAGE_SIZE,
+			MEMORY_ALIGN_PAGE));
+		if (!slab)
+			{
+			TRACE(ALL, "Unable to grow cache %p (object size %d)\n",
+				this, object_size);
+			status = STATUS_INSUFFICIENT_MEMORY;
+			break;
+			}
+
+
+		//
+		// Thread all of the new objects together before touching the free
+		// list, to keep the critical section short
+		//
+		object = uint8_tp(slab) + sizeof(*slab);
+		for (i = 0; i < objects_per_slab - 1; i++)
+			{
+			free_object_sp(object + i*object_size)->next =
+				free_object_sp(object + (i+1)*object_size);
+			}
+
+		head = free_object_sp(object);
+
+		lock.acquire();
+		free_object_sp(object + i*object_size)->next = free_list;
+		free_list = head;
+		object_count += objects_per_slab;
+		slab->next = slab_list;
+		slab_list = slab;
+		lock.release();
+
+		status = STATUS_SUCCESS;
+
+		} while(0);
+
+	return(status);
+	}
@@ -6,6 +6,7 @@
 
 #include "bits.hpp"
 #include "hal/address_space_layout.h"
+#include "kernel_heap.hpp"
 #include "klibc.hpp"
 #include "multiboot.hpp"
 #include "new.hpp"
@@ -54,7 +55,7 @@ page_frame_manager_c()
 	uint32_t			last_region		= first_region + paged_region_count;
 
 	ASSERT(last_region <= REGION_COUNT_MAX);
-	ASSERT(last_region <= region_map.size);
+	ASSERT(last_region <= order_map[0].size);
 	for (uint32_t i = first_region; i < last_region; i++)
 		{
 		this->region[i] = new page_frame_region_c(base);
@@ -63,11 +64,18 @@ page_frame_manager_c()
 
 
 	//
-	// Mask off the corresponding ranges within the free map, so that the
-	// available bits match the region[] entries
+	// Mask off the corresponding ranges within the summary maps, so that the
+	// available bits match the region[] entries.  Initially, every valid
+	// region contains only free blocks of the maximum size
 	//
-	region_map.set(0, first_region);
-	region_map.set(last_region, region_map.size - last_region);
+	for (uint32_t i = 0; i < MAX_BLOCK_ORDER; i++)
+		{
+		order_map[i].set(0, first_region);
+		order_map[i].set(last_region, order_map[i].size - last_region);
+		}
+
+	super_page_map.set(0, first_region);
+	super_page_map.set(last_region, super_page_map.size - last_region);
 
 
 	return;
@@ -89,47 +97,33 @@ physical_address_t page_frame_manager_c::
 allocate_block(uint32_t frame_count)
 	{
 	physical_address_t	block = INVALID_FRAME;
+	uint32_t			order = page_frame_region_c::calculate_order(frame_count);
+	uint32_t			region_index;
 
 	lock.acquire();
 
 
 	//
-	// Loop until a block of frames is found, or until all regions are
-	// exhausted
+	// Find a region that contains a block large enough for this request.
+	// This temporarily marks the region as in-use; its summary bits are
+	// recomputed below
 	//
-	for(;;)
+	region_index = order_map[ order ].allocate();
+	if (region_index < order_map[ order ].size)
 		{
-		// Find a region that has free blocks/frames
-		uint32_t region_index = region_map.allocate();
-		if (region_index < region_map.size)
-			{
-			// Attempt to allocate a block of frames from this region
-			ASSERT(this->region[ region_index ]);
-			block = this->region[ region_index ]->allocate_block(frame_count);
-
-			if (block != INVALID_FRAME)
-				{
-				// Success.  Found a free block of frames
-				region_map.free(region_index);
-				break;
-				}
-			else
-				{
-				// Unable to allocate a block of frames from this region.
-				// Leave the region marked as in-use and continue searching
-				//@this is weak: certain patterns of allocation will appear to
-				//@exhaust a region when in fact it still contains free pages
-				TRACE(ALL, "Region %d is completely allocated\n", region_index);
-				}
-			}
+		// Allocate the block.  The summary guarantees this region can
+		// satisfy the request
+		ASSERT(this->region[ region_index ]);
+		block = this->region[ region_index ]->allocate_block(frame_count);
+		ASSERT(block != INVALID_FRAME);
 
-		else
-			{
-			// All regions appear to be fully in-use
-			printf("Unable to allocate %d frames; all regions are allocated!",
-				frame_count);
-			break;
-			}
+		update_order_map(region_index);
+		}
+	else
+		{
+		// No region contains a large enough block
+		printf("Unable to allocate %d frames; all regions are allocated!",
+			frame_count);
 		}
 
 	lock.release();
@@ -145,27 +139,74 @@ allocate_block(uint32_t frame_count)
 /// but this is not absolutely required -- the caller can release the frames
 /// piecemeal if needed.
 ///
+/// If the frames are intended for DMA, then the entire block must also lie
+/// within reach of the device, per the MEMORY_DMA* flags.  A block beyond
+/// this limit is released again, and the request fails.
+///
 /// @param frame		-- On success, contains the set of allocated frames, in
 ///						   order.  The contents of this array are only valid
 ///						   if the returned status indicated success
 /// @param frame_count	-- the requested number of frames
+/// @param flags		-- Memory allocation flags.  See new.hpp
 ///
 /// @return STATUS_SUCCESS if the frames were successfully allocated; non-zero
 /// otherwise.
 ///
 status_t page_frame_manager_c::
 allocate_contiguous_frames(	physical_address_tp	frame,
-							uint32_t			frame_count)
+							uint32_t			frame_count,
+							uint32_t			flags)
 	{
 	physical_address_t	block	= INVALID_FRAME;
+	physical_address_t	excess;
+	physical_address_t	limit	= MEMORY_DMA32_LIMIT;
+	uint32_t			region_count;
 	status_t			status	= STATUS_INSUFFICIENT_MEMORY;
 
 
+	if (flags & MEMORY_DMA16)
+		{ limit = MEMORY_DMA16_LIMIT; }
+
+
 	//
 	// Attempt to allocate a block of contiguous physical frames
 	//
 	if (frame_count <= MAX_BLOCK_SIZE)
 		{ block = allocate_block(frame_count); }
+	else
+		{
+		// Larger requests span one or more complete regions
+		region_count = (frame_count + FRAME_COUNT_PER_REGION - 1) /
+			FRAME_COUNT_PER_REGION;
+		block = allocate_super_pages(region_count);
+
+		// Return any unused frames at the end of the last region
+		for (uint32_t i = frame_count;
+			block != INVALID_FRAME && i < region_count*FRAME_COUNT_PER_REGION;
+			i++)
+			{
+			excess = block + i*PAGE_SIZE;
+			free_frames(&excess, 1);
+			}
+		}
+
+
+	//
+	// The block must lie entirely within reach of the DMA device.  The
+	// allocators do not search by address, so just give up on a block that
+	// lies beyond the limit
+	//
+	if (block != INVALID_FRAME &&
+		block + (frame_count * PAGE_SIZE - 1) > limit)
+		{
+		TRACE(ALL, "Frames at %#x lie beyond DMA limit %#x\n", block, limit);
+		for (uint32_t i = 0; i < frame_count; i++)
+			{
+			excess = block + i*PAGE_SIZE;
+			free_frames(&excess, 1);
+			}
+		block = INVALID_FRAME;
+		}
 
 
 	//
@@ -246,7 +287,7 @@ allocate_frames(physical_address_tp	frame,
 	ASSERT(frame_count > 0);
 
 
-	if (frame_count > 0)
+	while (frame_count > 0)
 		{
 		//
 		// Initially, all of these frames are invalid
@@ -261,17 +302,30 @@ allocate_frames(physical_address_tp	frame,
 		// free frames will suffice
 		//
 		if (flags & (MEMORY_DMA16 | MEMORY_DMA32 | MEMORY_DMA64))
-			{ status = allocate_contiguous_frames(frame, frame_count); }
+			{
+			status = allocate_contiguous_frames(frame, frame_count, flags);
+			}
 		else
 			{ status = allocate_discontiguous_frames(frame, frame_count); }
 
+		if (status == STATUS_SUCCESS)
+			break;
+
 
 		//
 		// If the allocation attempt was unsuccessful, release any frames that
 		// may have been allocated
 		//
-		if (status != STATUS_SUCCESS)
-			{ free_frames(frame, frame_count); }
+		free_frames(frame, frame_count);
+
+
+		//
+		// Memory is low, so reclaim any free slabs cached by the kernel heap
+		// and try again.  If the heap has nothing to release, then give up
+		//
+		ASSERT(__kernel_heap);
+		if (__kernel_heap->release_free_slabs() == 0)
+			break;
 		}
 
 
@@ -279,6 +333,94 @@ allocate_frames(physical_address_tp	frame,
 	}
 
 
+///
+/// Allocate one or more 4MB superpages.  The result is a single, physically
+/// contiguous block, aligned on a superpage boundary; so it may be mapped
+/// directly via 4MB page directory entries.  The block may later be released
+/// via free_super_pages(); or piecemeal, as individual frames, via
+/// free_frames()
+///
+/// @param super_page_count -- the number of contiguous superpages to allocate
+///
+/// @return the physical address of the first superpage; or INVALID_FRAME if
+/// no such block is available
+///
+physical_address_t page_frame_manager_c::
+allocate_super_pages(uint32_t super_page_count)
+	{
+	uint32_t			first_region;
+	physical_address_t	super_page = INVALID_FRAME;
+
+	ASSERT(super_page_count > 0);
+
+	lock.acquire();
+
+	first_region = find_empty_regions(super_page_count);
+	if (first_region < super_page_map.size)
+		{
+		super_page = this->region[ first_region ]->allocate_all();
+		update_order_map(first_region);
+
+		for (uint32_t i = 1; i < super_page_count; i++)
+			{
+			this->region[ first_region + i ]->allocate_all();
+			update_order_map(first_region + i);
+			}
+
+		ASSERT(is_aligned(void_tp(super_page), SUPER_PAGE_SIZE));
+		}
+	else
+		{
+		TRACE(ALL, "Unable to allocate %d contiguous superpages\n",
+			super_page_count);
+		}
+
+	lock.release();
+
+	return(super_page);
+	}
+
+
+///
+/// Locate a run of contiguous regions that are completely free.  Assumes the
+/// caller holds the lock; and that the caller will immediately allocate the
+/// regions, since a single region is claimed directly from the map
+///
+/// @param region_count -- the number of contiguous regions required
+///
+/// @return the index of the first region in the run; or super_page_map.size
+/// if no such run exists
+///
+uint32_t page_frame_manager_c::
+find_empty_regions(uint32_t region_count)
+	{
+	uint32_t first_region	= super_page_map.size;
+	uint32_t run_length		= 0;
+
+	if (region_count == 1)
+		{
+		// Any empty region will suffice
+		first_region = super_page_map.allocate();
+		}
+	else
+		{
+		// Scan for a sufficiently-long run of empty regions
+		for (uint32_t i = 0; i < super_page_map.size; i++)
+			{
+			if (super_page_map.is_set(i))
+				{ run_length = 0; }
+			else if (++run_length == region_count)
+				{
+				first_region = i + 1 - region_count;
+				break;
+				}
+			}
+		}
+
+	return(first_region);
+	}
+
+
 ///
 /// Release a set of frames back to their original region(s).  On return, the
 /// caller must not touch any of these frames again
@@ -329,9 +471,9 @@ free_frames(const physical_address_t*	frame,
 
 			target_region->free_block(frame[i], 1);
 
-			// This region cannot be empty now; at least one block is
-			// available
-			region_map.free(region_index);
+			// This region now contains at least one free block, possibly a
+			// larger one if the frame was coalesced with its buddies
+			update_order_map(region_index);
 
 			lock.release();
 			}
@@ -342,6 +484,38 @@ free_frames(const physical_address_t*	frame,
 
 
 
+///
+/// Release a block of superpages previously allocated with
+/// allocate_super_pages().  On return, the caller must not touch any of
+/// these frames again
+///
+/// @param super_page		-- the physical address of the first superpage
+/// @param super_page_count	-- the number of superpages in the block
+///
+void_t page_frame_manager_c::
+free_super_pages(	physical_address_t	super_page,
+					uint32_t			super_page_count)
+	{
+	uint32_t first_region = super_page / REGION_SIZE;
+
+	ASSERT(is_aligned(void_tp(super_page), SUPER_PAGE_SIZE));
+	ASSERT(first_region + super_page_count <= REGION_COUNT_MAX);
+
+	lock.acquire();
+
+	for (uint32_t i = first_region; i < first_region + super_page_count; i++)
+		{
+		ASSERT(this->region[i]);
+		this->region[i]->free_all();
+		update_order_map(i);
+		}
+
+	lock.release();
+
+	return;
+	}
+
+
 ///
 /// Read the memory management statistics.  Usually only invoked in the
 /// context of a SYSTEM_CALL_VECTOR_READ_KERNEL_STATS syscall.
@@ -358,3 +532,37 @@ read_stats(volatile kernel_stats_s& kernel_stats)
 	return;
 	}
 
+
+///
+/// Recompute the summary bits for a single region, after its free blocks
+/// have changed.  Assumes the caller holds the lock
+///
+/// @param region_index -- the index of the region to summarize
+///
+void_t page_frame_manager_c::
+update_order_map(uint32_t region_index)
+	{
+	ASSERT(this->region[ region_index ]);
+
+	uint32_t max_order = this->region[ region_index ]->find_max_free_order();
+
+	//
+	// The region can satisfy any request up to the size of its largest free
+	// block.  If the region is completely allocated, then max_order is
+	// MAX_BLOCK_ORDER, and the region is marked in-use at every order
+	//
+	for (uint32_t order = 0; order < MAX_BLOCK_ORDER; order++)
+		{
+		if (max_order < MAX_BLOCK_ORDER && order <= max_order)
+			order_map[ order ].free(region_index);
+		else
+			order_map[ order ].set(region_index);
+		}
+
+	if (this->region[ region_index ]->is_empty())
+		super_page_map.free(region_index);
+	else
+		super_page_map.set(region_index);
+
+	return;
+	}
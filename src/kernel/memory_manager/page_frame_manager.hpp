@@ -30,6 +30,13 @@ uint32_t	REGION_COUNT_MAX	= ( intptr_t(-1) / REGION_SIZE ) + 1;
 /// Page frame manager.  Manages the physical address space, allocates + frees
 /// physical page frames
 ///
+/// Each region tracks its own free blocks.  The manager summarizes these with
+/// one bitmap per block order: a region's bit is clear in order_map[N] if it
+/// contains a free block of order N or larger.  Any request can thus locate a
+/// suitable region in constant time.  A separate map tracks the regions that
+/// are completely free, which may be allocated whole as 4MB superpages, or
+/// concatenated into larger contiguous runs
+///
 class   page_frame_manager_c;
 typedef page_frame_manager_c *    page_frame_manager_cp;
 typedef page_frame_manager_cp *   page_frame_manager_cpp;
@@ -38,10 +45,11 @@ class   page_frame_manager_c
 	{
 	private:
 		spinlock_c				lock;	//@access from IRQ path?
+		bitmap1024_c			order_map[ MAX_BLOCK_ORDER ];
 		uint32_t				paged_memory_size;
 		uint32_t				paged_region_count;
 		page_frame_region_cp	region[ REGION_COUNT_MAX ];
-		bitmap1024_c			region_map;
+		bitmap1024_c			super_page_map;
 		uint32_t				total_memory_size;
 
 		//@dedicated pool for ISA/16b DMA?
@@ -52,12 +60,18 @@ class   page_frame_manager_c
 
 		status_t
 			allocate_contiguous_frames(	physical_address_tp	frame,
-										uint32_t			frame_count);
+										uint32_t			frame_count,
+										uint32_t			flags);
 
 		status_t
 			allocate_discontiguous_frames(	physical_address_tp	frame,
 											uint32_t			frame_count);
 
+		uint32_t
+			find_empty_regions(uint32_t region_count);
+
+		void_t
+			update_order_map(uint32_t region_index);
 
 
 	protected:
@@ -73,10 +87,17 @@ class   page_frame_manager_c
 							uint32_t			frame_count,
 							uint32_t			flags);
 
+		physical_address_t
+			allocate_super_pages(uint32_t super_page_count);
+
 		void_t
 			free_frames(const physical_address_t*	frame,
 						uint32_t					frame_count);
 
+		void_t
+			free_super_pages(	physical_address_t	super_page,
+								uint32_t			super_page_count);
+
 		void_t
 			read_stats(volatile kernel_stats_s& kernel_stats);
 	};
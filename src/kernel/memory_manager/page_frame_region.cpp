@@ -30,16 +30,41 @@ page_frame_region_c(physical_address_t region_base):
 	//
 	uint32_t i;
 	for (i = 0; i < MAX_BLOCK_ORDER; i++)
-		{ this->pool[i].set(0, FRAME_COUNT_PER_REGION); }
+		{
+		this->pool[i].set(0, FRAME_COUNT_PER_REGION);
+		this->free_count[i] = 0;
+		}
 
 	uint32_t max_block_size = (1 << (MAX_BLOCK_ORDER-1));
 	for (i = 0; i < FRAME_COUNT_PER_REGION; i += max_block_size)
-		{ this->pool[MAX_BLOCK_ORDER-1].free(i); }
+		{
+		this->pool[MAX_BLOCK_ORDER-1].free(i);
+		this->free_count[MAX_BLOCK_ORDER-1]++;
+		}
 
 	return;
 	}
 
 
+///
+/// Allocate the entire region as a single block, typically to back a 4MB
+/// superpage.  The region must be completely free.  The block may later be
+/// freed via free_all(); or piecemeal, as individual frames, via free_block()
+///
+/// @return the physical address of the region
+///
+physical_address_t page_frame_region_c::
+allocate_all()
+	{
+	ASSERT(is_empty());
+
+	this->pool[MAX_BLOCK_ORDER-1].set(0, FRAME_COUNT_PER_REGION);
+	this->free_count[MAX_BLOCK_ORDER-1] = 0;
+
+	return(this->base);
+	}
+
+
 ///
 /// Allocate a block of physically contiguous frames.  If necessary, repeatedly
 /// split free blocks in half to produce a block of the desired size.  The
@@ -70,6 +95,9 @@ allocate_block(uint32_t frame_count)
 		frame_index = this->pool[i].allocate();
 		if (frame_index < FRAME_COUNT_PER_REGION)
 			{
+			ASSERT(this->free_count[i] > 0);
+			this->free_count[i]--;
+
 			// Success.  If this request was satisfied by allocating a
 			// larger-then-necessary block, then recursively break the parent
 			// block(s) into pairs of buddy blocks for subsequent allocation
@@ -79,6 +107,12 @@ allocate_block(uint32_t frame_count)
 			// Compute the resulting frame/block address and return it to
 			// the caller
 			frame = this->base + (frame_index * PAGE_SIZE);
+
+			// If the request was not a power-of-two, then return the excess
+			// frames at the end of the block to the pool
+			for (uint32_t j = frame_count; j < (1u << order); j++)
+				{ free_block(frame + j*PAGE_SIZE, 1); }
+
 			break;
 			}
 
@@ -90,6 +124,48 @@ allocate_block(uint32_t frame_count)
 	}
 
 
+///
+/// Find the largest block currently available in this region.  The Page Frame
+/// Manager uses this to summarize the state of each region.  No side effects.
+///
+/// @return the 2^N order of the largest free block; or MAX_BLOCK_ORDER if the
+/// region is completely allocated
+///
+uint32_t page_frame_region_c::
+find_max_free_order() const
+	{
+	uint32_t order = MAX_BLOCK_ORDER;
+
+	for (int32_t i = MAX_BLOCK_ORDER-1; i >= 0; i--)
+		{
+		if (this->free_count[i] > 0)
+			{
+			order = i;
+			break;
+			}
+		}
+
+	return(order);
+	}
+
+
+///
+/// Free an entire region previously allocated with allocate_all().  On
+/// return, the caller must not touch any frame within this region again
+///
+void_t page_frame_region_c::
+free_all()
+	{
+	ASSERT(find_max_free_order() == MAX_BLOCK_ORDER);
+
+	for (uint32_t i = 0; i < FRAME_COUNT_PER_REGION; i += MAX_BLOCK_SIZE)
+		{ this->pool[MAX_BLOCK_ORDER-1].free(i); }
+	this->free_count[MAX_BLOCK_ORDER-1] = MAX_BLOCK_COUNT;
+
+	return;
+	}
+
+
 ///
 /// Free a block of one or more contiguous frames previously allocated with
 /// allocate_block().  Releases the block back to the pool of free blocks, and
@@ -115,7 +191,9 @@ free_block(	physical_address_t	frame,
 	// Return this frame/block to the appropriate pool
 	uint32_t order = calculate_order(frame_count);
 	ASSERT(frame_index < FRAME_COUNT_PER_REGION);
+	ASSERT(this->pool[order].is_set(frame_index));
 	this->pool[order].free(frame_index);
+	this->free_count[order]++;
 
 	// Now attempt to coalesce this block with its buddy
 	join(frame_index, order);
@@ -157,7 +235,14 @@ join(	uint32_t frame_index,
 			// into a single parent block
 			this->pool[order].set(frame_index);
 			this->pool[order].set(buddy_index);
+
+			ASSERT(this->free_count[order] >= 2);
+			this->free_count[order] -= 2;
+
+			// The parent block begins at the lower of the two buddies
+			frame_index &= ~(1 << order);
 			this->pool[order+1].free(frame_index);
+			this->free_count[order+1]++;
 			}
 		else
 			{
@@ -206,6 +291,7 @@ split(	uint32_t frame_index,
 
 		// The buddy-block is now available for allocation
 		this->pool[order].free(buddy_index);
+		this->free_count[order]++;
 		}
 
 	return;
@@ -33,14 +33,16 @@ uint32_t	FRAME_COUNT_PER_REGION	= 1024,
 const
 uint32_t	MAX_BLOCK_ORDER			= 7,
 			MAX_BLOCK_SIZE			= 1 << (MAX_BLOCK_ORDER-1),
-			POOL_COUNT_PER_REGION	= MAX_BLOCK_ORDER;
+			POOL_COUNT_PER_REGION	= MAX_BLOCK_ORDER,
+			MAX_BLOCK_COUNT			= FRAME_COUNT_PER_REGION / MAX_BLOCK_SIZE;
 
 
 
 
 ///
 /// A region of contiguous physical memory, subdivided into blocks of 1 or more
-/// contiguous frames
+/// contiguous frames.  A completely free region may also be allocated as a
+/// single block, to back a 4MB superpage
 ///
 class   page_frame_region_c;
 typedef page_frame_region_c *    page_frame_region_cp;
@@ -50,6 +52,7 @@ class   page_frame_region_c
 	{
 	private:
 		const physical_address_t	base;
+		uint16_t					free_count[ POOL_COUNT_PER_REGION ];
 		bitmap1024_c				pool[ POOL_COUNT_PER_REGION ];
 
 
@@ -64,27 +67,6 @@ class   page_frame_region_c
 				{ return (frame_index ^ (1 << order)); }
 
 
-		///
-		/// Compute the 2^N order of contiguous frames required to satisfy a
-		/// request for the specified number of pages.  No side effects.
-		///
-		/// calculate_order(1) => 0	(2^0 = 1 frame)
-		/// calculate_order(2) => 1	(2^1 = 2 frames)
-		/// calculate_order(3) => 2	(2^2 = 4 frames > 3 frames requested)
-		/// calculate_order(4) => 2	(2^2 = 4 frames)
-		/// calculate_order(5) => 3	(2^3 = 8 frames > 5 frames requested)
-		///
-		static
-		inline
-		uint32_t
-			calculate_order(uint32_t frame_count)
-				{
-				ASSERT(frame_count > 0);
-				ASSERT(frame_count < MAX_BLOCK_ORDER);
-				uint32_t order = find_one_bit32(round_up_2n(frame_count));
-				return (order);
-				}
-
 		void_t
 			join(	uint32_t frame_index,
 					uint32_t order);
@@ -102,12 +84,56 @@ class   page_frame_region_c
 		~page_frame_region_c()
 			{ return; }
 
+		physical_address_t
+			allocate_all();
+
 		physical_address_t
 			allocate_block(uint32_t frame_count);
 
+		uint32_t
+			find_max_free_order() const;
+
+		void_t
+			free_all();
+
 		void_t
 			free_block(	physical_address_t	frame,
 						uint32_t			frame_count);
+
+
+		///
+		/// Is this region completely free?  If so, it may be allocated as a
+		/// single 4MB superpage.  No side effects
+		///
+		inline
+		bool_t
+			is_empty() const
+				{
+				return(free_count[ MAX_BLOCK_ORDER-1 ] == MAX_BLOCK_COUNT ?
+					TRUE : FALSE);
+				}
+
+
+		///
+		/// Compute the 2^N order of contiguous frames required to satisfy a
+		/// request for the specified number of pages.  No side effects.
+		///
+		/// calculate_order(1) => 0	(2^0 = 1 frame)
+		/// calculate_order(2) => 1	(2^1 = 2 frames)
+		/// calculate_order(3) => 2	(2^2 = 4 frames > 3 frames requested)
+		/// calculate_order(4) => 2	(2^2 = 4 frames)
+		/// calculate_order(5) => 3	(2^3 = 8 frames > 5 frames requested)
+		///
+		static
+		inline
+		uint32_t
+			calculate_order(uint32_t frame_count)
+				{
+				ASSERT(frame_count > 0);
+				ASSERT(frame_count <= MAX_BLOCK_SIZE);
+				uint32_t order = find_one_bit32(round_up_2n(frame_count));
+				return (order);
+				}
 	};
 
 
@@ -9,13 +9,16 @@
 ///
 /// Destructor.  Release the underlying page frame.  By definition, there are
 /// no remaining references to this frame, so the frame may be returned to the
-/// free pool
+/// free pool.  A detached frame belongs to some other owner, and is left alone
 ///
 shared_frame_c::
 ~shared_frame_c()
 	{
-	TRACE(ALL, "Freeing shared frame %#x\n", address);//@
-	__page_frame_manager->free_frames(&address, 1);
+	if (address != INVALID_FRAME)
+		{
+		TRACE(ALL, "Freeing shared frame %#x\n", address);//@
+		__page_frame_manager->free_frames(&address, 1);
+		}
 
 	return;
 	}
@@ -77,9 +77,11 @@ handle_interrupt(interrupt_cr interrupt)
 		//
 		// Read any stats/data from the various subsystems
 		//
+		__device_proxy->read_stats(*kernel_stats);
 		__io_manager->read_stats(*kernel_stats);
 		__memory_manager->read_stats(*kernel_stats);
 		__thread_manager->read_stats(*kernel_stats);
+		kernel_stats->processor_type = __hal->read_processor_type();
 
 
 		//
@@ -88,7 +88,7 @@ delete_thread(message_cr message)
 		// then obviously no such ack is necessary
 		//
 		small_message_cp acknowledgement = NULL;
-		if (message.source != *victim && message.is_blocking())
+		if (message.source != *victim && message.expects_reply())
 			{
 			// The victim is being forcibly destroyed; and the original thread
 			// is blocked until the deletion is complete.  Build + cache an
@@ -8,6 +8,7 @@
 
 #include "debug.hpp"
 #include "kernel_subsystems.hpp"
+#include "kernel_threads.hpp"
 #include "null_thread.hpp"
 
 
@@ -18,11 +19,18 @@
 thread_cp	__null_thread	= NULL;
 
 
+///
+/// Per-processor idle threads
+///
+thread_cp	__idle_thread[ PROCESSOR_COUNT_MAX ];
+
+
 
 ///
-/// Entry point for the null/idle thread.  Just loops forever.  This thread
-/// should never exit (i.e., this routine never returns) and should never
-/// be destroyed.
+/// Entry point for the null/idle thread(s).  Just loops forever.  These
+/// threads should never exit (i.e., this routine never returns) and should
+/// never be destroyed.  Only the null thread itself normally receives any
+/// messages; the idle threads of the other processors simply idle.
 ///
 void_t
 null_thread_entry()
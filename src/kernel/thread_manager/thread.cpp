@@ -92,19 +92,37 @@ thread_c(	const thread_start_fp	thread_kernel_start,
 			const void_tp			thread_user_start,
 			const void_tp			thread_user_stack):
 	blocking_thread(NULL),
-	bonus_message(NULL),
+	bonus_pending(FALSE),
 	capability_mask(thread_capability_mask),
 	deletion_acknowledgement(NULL),
+	direct_message_pending(FALSE),
+	direct_receive(FALSE),
+	notification(0),
+	queue_next(NULL),
+	reply_wait(FALSE),
+	scheduling_ticket(NULL),
+	send_wait_thread(NULL),
+	wakeup_thread(NULL),
 	address_space(thread_address_space),
 	copy_page(thread_copy_page),
 	id(thread_id),
+	processor(PROCESSOR_INDEX_INVALID),
 	state(THREAD_STATE_READY),
 	tick_count(0),
+	fpu_context(NULL),
+	pass(0),
+	ready_timestamp(0),
+	ticket_count(0),
+	message_ring(NULL),
+	message_ring_busy(FALSE),
+	message_ring_receive_count(0),
 	kernel_start(thread_kernel_start),
 	user_start(thread_user_start),
 	user_stack(thread_user_stack)
 	{
-	ASSERT(is_aligned(this, THREAD_EXECUTION_BLOCK_ALIGNMENT));
+	ASSERT(sizeof(*this) <= THREAD_CONTEXT_SIZE);
+	ASSERT((uintptr_t(this) & ~THREAD_EXECUTION_BLOCK_ALIGNMENT_MASK) ==
+		THREAD_CONTEXT_OFFSET);
 
 
 	//
@@ -141,7 +159,21 @@ thread_c::
 	TRACE(ALL, "Destroying thread %#x\n", id);
 	ASSERT(*this != __hal->read_current_thread());
 	ASSERT(mailbox.message_queue.is_empty());
-	ASSERT(bonus_message == NULL);
+	ASSERT(mailbox.reply_queue.is_empty());
+	ASSERT(mailbox.sender_queue.is_empty());
+	ASSERT(scheduling_ticket == NULL);
+	ASSERT(send_wait_thread == NULL);
+
+
+	//
+	// Release the message rings, if the thread ever created them.  The ring
+	// page is private to this thread, so unsharing it just frees the frame
+	//
+	if (message_ring)
+		{
+		address_space.unshare_frame(void_tp(message_ring), PAGE_SIZE);
+		address_space.free_message_ring_page(void_tp(message_ring));
+		}
 
 
 	//
@@ -150,6 +182,14 @@ thread_c::
 	if (copy_page)
 		{ address_space.free_large_payload_block(copy_page); }
 
+
+	//
+	// Release the saved FPU state, if the thread ever used the FPU.  Its
+	// state may still be live in the registers of some processor
+	//
+	if (fpu_context)
+		{ __hal->discard_fpu_context(*this); }
+
 	//
 	// The victim thread will never execute again, so no it longer needs access
 	// to its parent address space
@@ -166,6 +206,14 @@ thread_c::
 		{ remove_reference(*blocking_thread); }
 
 
+	//
+	// Likewise, if this thread woke another thread via direct message, but
+	// never yielded to it, then remove the leftover reference to that thread
+	//
+	if (wakeup_thread)
+		{ remove_reference(*wakeup_thread); }
+
+
 	//
 	// Finally, wake the original thread that deleted the victim
 	//
@@ -191,6 +239,82 @@ thread_c::
 	}
 
 
+///
+/// Record an asynchronous request from this thread, so that the eventual reply
+/// is routed to its reply queue rather than its mailbox.  The request must be
+/// recorded before it is sent, otherwise the reply could arrive first.  See
+/// io_manager_c::send_request().
+///
+/// A thread should only invoke this method on itself
+///
+/// @param destination	-- the recipient of the request
+/// @param request_id	-- the request id; the reply must carry the same id
+///
+/// @return STATUS_SUCCESS if the request was recorded; STATUS_INVALID_DATA if
+/// the id is reserved; STATUS_RESOURCE_CONFLICT if the id is already in use,
+/// or if the thread has too many requests outstanding
+///
+status_t thread_c::
+add_request(thread_id_t		destination,
+			message_id_t	request_id)
+	{
+	status_t status;
+
+	ASSERT(*this == __hal->read_current_thread());
+
+	if (request_id == MESSAGE_ID_ATOMIC || request_id == MESSAGE_ID_ANY)
+		{
+		status = STATUS_INVALID_DATA;
+		}
+	else
+		{
+		lock.acquire();
+		status = (mailbox.add_request(destination, request_id) ?
+			STATUS_SUCCESS : STATUS_RESOURCE_CONFLICT);
+		lock.release();
+		}
+
+	return(status);
+	}
+
+
+///
+/// Allocate this thread's scheduling ticket, if not already allocated.  The
+/// ticket is a null message that the thread never actually receives; it only
+/// keeps the thread eligible for the lottery, either as a bonus message (see
+/// maybe_put_bonus_message()) or while notifications are pending (see
+/// put_notification()).  It is allocated at most once, then reused for the
+/// lifetime of the thread, so neither path allocates in the steady state.
+///
+/// The ticket is in the lottery pool exactly when a bonus is pending or any
+/// signal bits are pending.  Assumes the caller holds the thread lock.
+///
+/// @return TRUE if the thread has a ticket; FALSE if it could not be
+/// allocated, or if the mailbox is already disabled
+///
+bool_t thread_c::
+allocate_ticket()
+	{
+	if (!scheduling_ticket && mailbox.enabled)
+		{
+		ASSERT(__null_thread);
+		TRACE(SCHED|MESSAGE, "Allocating scheduling ticket for thread %#x\n",
+			id);
+		scheduling_ticket = new small_message_c(*__null_thread,
+												*this,
+												MESSAGE_TYPE_NULL,
+												MESSAGE_ID_ATOMIC);
+		if (!scheduling_ticket)
+			{
+			printf("Unable to allocate scheduling ticket for thread %#x\n",
+				id);
+			}
+		}
+
+	return(scheduling_ticket ? TRUE : FALSE);
+	}
+
+
 ///
 /// Examines the outgoing message to determine if the current (calling) thread
 /// should block until it receives a response.  The logic here does not
@@ -237,6 +361,22 @@ block_on(	thread_cr	recipient,
 	}
 
 
+///
+/// Forget an asynchronous request that could not be sent.  Companion to
+/// thread_c::add_request()
+///
+void_t thread_c::
+cancel_request(	thread_id_t		destination,
+				message_id_t	request_id)
+	{
+	lock.acquire();
+	mailbox.remove_request(destination, request_id);
+	lock.release();
+
+	return;
+	}
+
+
 ///
 /// Determines if sending this message to this thread would cause a scheduling
 /// loop (deadlock).  Returns TRUE if this thread/message combination would
@@ -289,6 +429,33 @@ causes_scheduling_loop(	thread_cr	current_thread,
 	}
 
 
+///
+/// Collect the senders that may now retry a message to this thread, after
+/// room appears in its mailbox.  Wake one sender per free slot; or every
+/// sender if the mailbox is disabled, so that each one sees the error.  The
+/// collected senders should be woken via wake_senders(), after the caller
+/// drops its locks.
+///
+/// Assumes the caller holds the lock on this thread.
+///
+/// @param sender -- on return, contains the senders to wake
+///
+void_t thread_c::
+collect_senders(thread_queue_cr sender)
+	{
+	uint32_t count = mailbox.message_queue.read_count();
+
+	while (!mailbox.sender_queue.is_empty() &&
+		(!mailbox.enabled || count < mailbox.limit))
+		{
+		sender.push(mailbox.sender_queue.pop());
+		count++;
+		}
+
+	return;
+	}
+
+
 ///
 /// Disable access to the specified I/O port(s).  On return, the thread may
 /// no longer access these ports (except at ring-0).  This is typically only
@@ -314,6 +481,37 @@ disable_io_port(uint16_t port,
 	}
 
 
+///
+/// Prepare this thread to receive notifications, by allocating its
+/// scheduling ticket in advance.  Thereafter, put_notification() never
+/// allocates memory, so it may be invoked in interrupt context.  Typically
+/// invoked when the thread registers an interrupt handler; see
+/// device_proxy_c::register_interrupt_handler().
+///
+/// @return STATUS_SUCCESS if the thread may receive notifications;
+/// STATUS_MAILBOX_DISABLED if the thread is exiting;
+/// STATUS_INSUFFICIENT_MEMORY if the ticket could not be allocated
+///
+status_t thread_c::
+enable_notification()
+	{
+	status_t status;
+
+	lock.acquire();
+
+	if (!mailbox.enabled)
+		{ status = STATUS_MAILBOX_DISABLED; }
+	else if (allocate_ticket())
+		{ status = STATUS_SUCCESS; }
+	else
+		{ status = STATUS_INSUFFICIENT_MEMORY; }
+
+	lock.release();
+
+	return(status);
+	}
+
+
 ///
 /// Enable access to the specified I/O port(s).  On return, the thread may
 /// access these ports, even from ring-3.  This is typically only invoked from
@@ -380,32 +578,103 @@ find_blocking_thread() const
 
 
 ///
-/// Retrieve the "bonus" message, if any, previously allocated by
+/// Search the reply queue for the reply to the given request.  The queue is
+/// rotated in place, so the remaining replies keep their original order.
+/// Assumes the caller already holds the lock protecting this thread_c
+/// instance.
+///
+/// @param request_id	-- the request id; or MESSAGE_ID_ANY for the oldest
+///						   reply
+/// @param remove		-- if TRUE, the reply is also removed from the queue
+///
+/// @return the matching reply; or NULL if no such reply has arrived yet
+///
+message_cp thread_c::
+find_reply(	message_id_t	request_id,
+			bool_t			remove)
+	{
+	uint32_t	count	= mailbox.reply_queue.read_count();
+	message_cp	reply	= NULL;
+
+	for (uint32_t i = 0; i < count; i++)
+		{
+		message_cr message = mailbox.reply_queue.pop();
+
+		if (!reply &&
+			(request_id == MESSAGE_ID_ANY || message.id == request_id))
+			{
+			reply = &message;
+			if (remove)
+				continue;
+			}
+
+		mailbox.reply_queue.push(message);
+		}
+
+	return(reply);
+	}
+
+
+///
+/// Retire the "bonus" message, if any, previously pending via
 /// maybe_put_bonus_message().  Typically invoked when this thread wins a
-/// scheduling lottery, since it no longer requires this extra message
+/// scheduling lottery, since it no longer requires this extra ticket
 ///
-/// @return the bonus message; or NULL if this thread had none
+/// @return the scheduling ticket, if the caller should now remove it from
+/// the lottery pool; or NULL otherwise
 ///
 message_cp thread_c::
 get_bonus_message()
 	{
-	message_cp message = NULL;
+	message_cp ticket = NULL;
 
 	lock.acquire();
 
-	// If this thread has an extra message due to quantum exhaustion, then
-	// return/discard it now
-	if (bonus_message)
+	// If this thread has an extra ticket due to quantum exhaustion, then
+	// retire it now.  The ticket stays in the pool while any notifications
+	// are still pending
+	if (bonus_pending)
 		{
 		TRACE(SCHED|MESSAGE, "Discarding bonus/wakeup message for thread %#x\n",
 			id);
-		message = bonus_message;
-		bonus_message = NULL;
+		bonus_pending = FALSE;
+		if (!notification)
+			{ ticket = scheduling_ticket; }
 		}
 
 	lock.release();
 
-	return(message);
+	return(ticket);
+	}
+
+
+///
+/// Retrieve the direct message, if any, pending for this thread.  A direct
+/// message bypasses the mailbox entirely; see thread_c::put_direct_message().
+/// Typically only the current thread should invoke this method on itself;
+/// but the cleanup thread may also invoke this when destroying a thread.
+///
+/// @param message -- on success, receives a copy of the direct message
+///
+/// @return TRUE if a direct message was pending; FALSE otherwise
+///
+bool_t thread_c::
+get_direct_message(direct_message_sr message)
+	{
+	bool_t pending = FALSE;
+
+	lock.acquire();
+
+	if (direct_message_pending)
+		{
+		message					= direct_message;
+		direct_message_pending	= FALSE;
+		pending					= TRUE;
+		}
+
+	lock.release();
+
+	return(pending);
 	}
 
 
@@ -427,7 +696,8 @@ get_bonus_message()
 status_t thread_c::
 get_message(message_cpp message)
 	{
-	status_t status;
+	thread_queue_c	sender;
+	status_t		status;
 
 	ASSERT(message != NULL);
 
@@ -443,6 +713,9 @@ get_message(message_cpp message)
 		// unsolicited input message
 		*message = &mailbox.message_queue.pop();
 		status = STATUS_SUCCESS;
+
+		// Any senders waiting on a full mailbox may now retry
+		collect_senders(sender);
 		}
 	else
 		{
@@ -453,11 +726,113 @@ get_message(message_cpp message)
 
 	lock.release();
 
+	wake_senders(sender);
+
+	return(status);
+	}
+
+
+
+///
+/// Collect all of the signal bits pending for this thread, and clear them.
+/// Once nothing else is pending, the thread no longer requires its scheduling
+/// ticket, so the caller must also remove the ticket from the lottery pool.
+/// See put_notification().
+///
+/// A thread should only invoke this method on itself
+///
+/// @param signal	-- on success, receives the pending signal bits
+/// @param ticket	-- on success, receives the scheduling ticket if it should
+///					   be removed from the lottery pool; otherwise NULL
+///
+/// @return TRUE if any signals were pending; FALSE otherwise
+///
+bool_t thread_c::
+get_notification(	uint32_tp	signal,
+					message_cpp	ticket)
+	{
+	bool_t pending = FALSE;
+
+	*ticket = NULL;
+
+	lock.acquire();
+
+	if (notification)
+		{
+		*signal			= notification;
+		notification	= 0;
+		if (!bonus_pending)
+			{ *ticket = scheduling_ticket; }
+		pending = TRUE;
+		}
+
+	lock.release();
+
+	return(pending);
+	}
+
+
+///
+/// Retrieve the reply to an asynchronous request, if it has arrived.  This is
+/// the counterpart of thread_c::get_message() for replies; see
+/// io_manager_c::receive_reply().  Typically only the current thread should
+/// invoke this method on itself.
+///
+/// @param message		-- on success, points to the reply
+/// @param request_id	-- the request id; or MESSAGE_ID_ANY for any reply
+///
+/// @return STATUS_SUCCESS if the reply was retrieved; STATUS_MAILBOX_EMPTY if
+/// the request is still awaiting its reply; or STATUS_INVALID_DATA if there
+/// is no such request
+///
+status_t thread_c::
+get_reply(	message_cpp		message,
+			message_id_t	request_id)
+	{
+	status_t status;
+
+	ASSERT(message != NULL);
+
+	lock.acquire();
+
+	*message = find_reply(request_id, TRUE);
+	if (*message)
+		{ status = STATUS_SUCCESS; }
+	else if (mailbox.has_pending_request(request_id))
+		{ status = STATUS_MAILBOX_EMPTY; }
+	else
+		{ status = STATUS_INVALID_DATA; }
+
+	lock.release();
+
 	return(status);
 	}
 
 
 
+///
+/// Retrieve the thread, if any, that this thread has woken via a direct
+/// message but not yet yielded to.  The scheduler dispatches this thread
+/// the next time the current thread loses the processor.  Should always be
+/// invoked by the current thread on itself, under the I/O Manager lock.
+///
+/// @return the woken thread, if any; or NULL.  The caller inherits the
+/// reference to this thread and must eventually remove it
+///
+thread_cp thread_c::
+get_wakeup_thread()
+	{
+	thread_cp thread;
+
+	lock.acquire();
+	thread = wakeup_thread;
+	wakeup_thread = NULL;
+	lock.release();
+
+	return(thread);
+	}
+
+
 ///
 /// Lock two threads simultaneously.  This should only be necessary in the
 /// put_message() path.  To avoid SMP deadlocks, always lock the thread with
@@ -504,8 +879,13 @@ lock_both(	thread_cr	thread0,
 ///
 void_t thread_c::
 mark_for_deletion(	message_list_cr	leftover_messages,
-					message_cp		acknowledgement)
+					message_cp		acknowledgement,
+					message_cpp		ticket)
 	{
+	thread_cp		recipient;
+	bool_t			removed = FALSE;
+	thread_queue_c	sender;
+
 	//
 	// Should always be invoked by kernel thread, never by the victim thread
 	// itself
@@ -536,13 +916,41 @@ mark_for_deletion(	message_list_cr	leftover_messages,
 		message_cr message = mailbox.message_queue.pop();
 		leftover_messages += message;
 		}
-	if (bonus_message)
+	while (!mailbox.reply_queue.is_empty())
 		{
-		leftover_messages += *bonus_message;
-		bonus_message = NULL;
+		message_cr message = mailbox.reply_queue.pop();
+		leftover_messages += message;
 		}
 
 
+	//
+	// Likewise detach the scheduling ticket, if any, + discard any pending
+	// signals.  The ticket may or may not still be in the lottery pool, so
+	// the caller removes it as necessary, then releases it.  The ticket
+	// holds a reference to this thread, so this also allows the thread to be
+	// destroyed eventually
+	//
+	*ticket				= scheduling_ticket;
+	scheduling_ticket	= NULL;
+	bonus_pending		= FALSE;
+	notification		= 0;
+
+
+	//
+	// If this thread is waiting for room in another mailbox, it will never
+	// retry its message; withdraw it from that mailbox below
+	//
+	recipient			= send_wait_thread;
+	send_wait_thread	= NULL;
+
+
+	//
+	// Wake any threads waiting for room in this mailbox; they will retry
+	// and see that the mailbox is now disabled
+	//
+	collect_senders(sender);
+
+
 	//
 	// When this thread is finally destroyed, wake the thread that initiated
 	// the deletion.  This assumes that each thread will be deleted at most
@@ -557,28 +965,50 @@ mark_for_deletion(	message_list_cr	leftover_messages,
 
 	lock.release();
 
+	wake_senders(sender);
+
+
+	//
+	// Unlink this thread from the sender queue of the other mailbox, and drop
+	// the reference held by the queue.  The recipient may have already
+	// collected this thread, in which case wake_senders() drops the reference
+	// instead
+	//
+	if (recipient)
+		{
+		recipient->lock.acquire();
+		removed = recipient->mailbox.sender_queue.remove(*this);
+		recipient->lock.release();
+
+		if (removed)
+			{ remove_reference(*this); }
+		remove_reference(*recipient);
+		}
+
 	return;
 	}
 
 
 ///
-/// Insert a null message into this thread's mailbox, if the mailbox is
-/// currently empty.  If this thread's mailbox is not empty, then do nothing.
+/// Make this thread eligible for the lottery, if its mailbox is currently
+/// empty, by pooling its scheduling ticket as a "bonus" message.  If this
+/// thread's mailbox is not empty, then do nothing.
 ///
 /// This is primarily useful when suspending a thread that has exhausted its
 /// scheduling quantum -- it ensures the thread has at least one message
 /// pending and is therefore still eligible for the scheduling lottery.  The
-/// message allocated here, if any, should eventually be freed and discarded
-/// via get_bonus_message()
+/// bonus is eventually retired via get_bonus_message().  The ticket is reused,
+/// so this only allocates the first time; see allocate_ticket()
 ///
 /// Should always be invoked by the current thread on itself
 ///
-/// @return the new message; or NULL if no message was added to the mailbox
+/// @return the scheduling ticket, if the caller should now add it to the
+/// lottery pool; or NULL otherwise
 ///
 message_cp thread_c::
 maybe_put_bonus_message()
 	{
-	message_cp message = NULL;
+	message_cp ticket = NULL;
 
 
 	//
@@ -600,34 +1030,31 @@ maybe_put_bonus_message()
 		//
 		// Does the current thread already have any messages pending?  If so,
 		// then no need to add another, since the thread is already eligible
-		// for the lottery
+		// for the lottery.  Pending notifications already pool the ticket
 		//
 		if (!mailbox.message_queue.is_empty())
 			break;
-		if (bonus_message)
+		if (bonus_pending || notification)
 			break;
 
 
 		//
-		// No messages currently pending, so allocate a new one.  This thread
-		// should never actually read/receive this message; its purpose here is
-		// to aid the scheduling logic.  So the message need not (should not) be
-		// placed in the thread's mailbox
+		// No messages currently pending, so pool the ticket.  This thread
+		// never actually receives this message; its purpose here is to aid
+		// the scheduling logic.  So the message is never placed in the
+		// thread's mailbox
 		//
-		ASSERT(__null_thread);
-		TRACE(SCHED|MESSAGE, "Giving thread %#x a bonus/wakeup message\n", id);
-		bonus_message = message = new small_message_c(	*__null_thread,
-														*this,
-														MESSAGE_TYPE_NULL,
-														MESSAGE_ID_ATOMIC);
-		if (!bonus_message)
+		if (!allocate_ticket())
 			{
 			// The thread is probably stuck now, unless some other thread
 			// sends it an unsolicited message
-			printf("Unable to allocate bonus/wakeup message for thread %#x\n",
-				id);
+			break;
 			}
 
+		TRACE(SCHED|MESSAGE, "Giving thread %#x a bonus/wakeup message\n", id);
+		bonus_pending	= TRUE;
+		ticket			= scheduling_ticket;
+
 		} while(0);
 
 	lock.release();
@@ -635,11 +1062,142 @@ maybe_put_bonus_message()
 
 	//
 	// Postcondition: the current thread has at least one unread message
-	// pending: either a normal message in its mailbox, or the extra message
-	// allocated above
+	// pending: either a normal message in its mailbox, or its ticket
 	//
 
-	return(message);
+	return(ticket);
+	}
+
+
+///
+/// Delivers a register-sized message directly to this thread, bypassing its
+/// mailbox + the lottery pool.  This is the lowest-level logic underneath
+/// io_manager_c::send_direct_message().  Delivery only succeeds if this
+/// thread is suspended in a receive that accepts direct messages, and has
+/// completely released its processor, so that the sender may safely pass the
+/// CPU to it; and if either:
+///	(a) this thread is waiting for any message; or
+///	(b) this thread is blocked, waiting for this specific reply from the
+///		current thread
+///
+/// If delivery succeeds, this thread is ready to execute again.  If the
+/// message requires a response, the current thread is now blocked on this
+/// thread, and will accept a direct reply.  Otherwise, the current thread
+/// records this thread as its wakeup thread, so that it runs the next time
+/// the current thread loses the processor.
+///
+/// Assumes the caller holds the I/O Manager lock, to avoid racing with the
+/// scheduler.
+///
+/// @param message -- the message to deliver
+///
+/// @return TRUE if the message was delivered; FALSE if the caller must fall
+/// back to normal message delivery
+///
+bool_t thread_c::
+put_direct_message(const direct_message_sr message)
+	{
+	thread_cr	current_thread = __hal->read_current_thread();
+	bool_t		delivered = FALSE;
+
+
+	ASSERT(message.source == current_thread.id);
+	if (current_thread == *this)
+		{ return(FALSE); }
+
+
+	// Lock both threads simultaneously
+	lock_both(*this, current_thread);
+
+	do
+		{
+		//
+		// The recipient must be suspended in a receive that accepts direct
+		// messages; and must no longer be executing anywhere
+		//
+		if (!mailbox.enabled || !direct_receive || direct_message_pending)
+			break;
+		if (processor != PROCESSOR_INDEX_INVALID)
+			break;
+
+
+		//
+		// Replies to asynchronous requests must land in the reply queue;
+		// and a thread awaiting such a reply ignores anything else
+		//
+		if (reply_wait ||
+			mailbox.is_pending_request(message.source, message.id))
+			break;
+
+
+		//
+		// A synchronous request may only wake an idle recipient; the sender
+		// then passes the CPU to it via the blocking chain.  Any other
+		// direct message passes the CPU via the wakeup thread, of which
+		// the sender has at most one
+		//
+		if (message.is_blocking())
+			{
+			if (state != THREAD_STATE_WAITING)
+				break;
+			}
+		else if (current_thread.wakeup_thread)
+			{ break; }
+
+
+		//
+		// Wake the recipient.  This is either an unsolicited message to an
+		// idle thread; or the reply to a pending synchronous request
+		//
+		if (state == THREAD_STATE_WAITING)
+			{
+			state = THREAD_STATE_READY;
+			}
+		else if (state == THREAD_STATE_BLOCKED &&
+			blocking_thread == &current_thread &&
+			blocking_message_id == message.id)
+			{
+			state = THREAD_STATE_READY;
+			remove_reference(*blocking_thread);
+			blocking_thread = NULL;
+			}
+		else
+			{
+			break;
+			}
+
+		direct_message			= message;
+		direct_message_pending	= TRUE;
+		direct_receive			= FALSE;
+
+
+		//
+		// Pass the CPU to the recipient: either via the blocking chain, if
+		// the current thread now waits for a reply; or the next time the
+		// current thread loses the processor
+		//
+		if (message.is_blocking())
+			{
+			ASSERT(!current_thread.blocking_thread);
+			current_thread.state				= THREAD_STATE_BLOCKED;
+			current_thread.blocking_message_id	= message.id;
+			current_thread.blocking_thread		= this;
+			current_thread.direct_receive		= TRUE;
+			add_reference(*this);
+			}
+		else
+			{
+			current_thread.wakeup_thread = this;
+			add_reference(*this);
+			}
+
+		delivered = TRUE;
+
+		} while(0);
+
+	unlock_both(*this, current_thread);
+
+	return(delivered);
 	}
 
 
@@ -655,16 +1213,31 @@ maybe_put_bonus_message()
 /// recipient thread and possibly waking it; the current thread may also be
 /// preparing itself for suspension if this is a synchronous request
 ///
+/// If the mailbox is full, the message is refused with STATUS_WOULD_BLOCK.
+/// If the caller allows it, the current thread is then also queued on this
+/// mailbox + marked as waiting for room; the assumption is that the caller
+/// will drop its locks, yield and retry.  See io_manager_c::put_message()
+///
+/// @param message -- the message to queue
+/// @param waiting -- if non-NULL, the current thread may wait for room in a
+/// full mailbox; on return, TRUE if the current thread should yield + retry
+///
 /// Returns STATUS_SUCCESS if the message was successfully queued; or
 /// non-zero error otherwise.
 ///
 status_t thread_c::
-put_message(message_cr message)
+put_message(message_cr	message,
+			bool_tp		waiting)
 	{
 	thread_cr	current_thread = __hal->read_current_thread();
+	bool_t		reply;
 	status_t	status;
 
 
+	if (waiting)
+		{ *waiting = FALSE; }
+
+
 	// Lock both threads simultaneously
 	lock_both(*this, current_thread);
 
@@ -695,12 +1268,14 @@ put_message(message_cr message)
 
 
 		//
-		// Queue the message for the recipient thread.  There are three
+		// Queue the message for the recipient thread.  There are four
 		// possibilities here:
 		// (a) this message wakes the thread, bypasses the mailbox queue;
-		// (b) this message does not wake the thread, queued normally;
-		// (c) this message does not wake the thread, queue overflow
+		// (b) this message is the reply to an asynchronous request;
+		// (c) this message does not wake the thread, queued normally;
+		// (d) this message does not wake the thread, queue overflow
 		//
+		reply = FALSE;
 		if (unblock_on(message))
 			{
 			// This recipient thread is blocked, waiting for this message; now
@@ -712,6 +1287,17 @@ put_message(message_cr message)
 			mailbox.message_queue.push_head(message);
 			status = STATUS_SUCCESS;
 			}
+		else if (!message.expects_reply() &&
+			mailbox.remove_request(message.source.id, message.id))
+			{
+			// This is the reply to an outstanding asynchronous request.  The
+			// thread has already accounted for it, so as with a blocking
+			// reply, it bypasses the overflow limit.  Requests themselves
+			// are never replies, even when a thread sends them to itself
+			mailbox.reply_queue.push(message);
+			reply = TRUE;
+			status = STATUS_SUCCESS;
+			}
 		else if (!mailbox.overflow())
 			{
 			// The thread is not blocked/waiting for this message, so just
@@ -721,14 +1307,52 @@ put_message(message_cr message)
 			}
 		else
 			{
-			// The mailbox is overflowing; the thread has probably
-			// crashed/hung, etc.
-			TRACE(ALL, "Mailbox overflow on thread %#x\n", id);
-			status = STATUS_MAILBOX_OVERFLOW;
+			// The mailbox is full.  Throttle the sender rather than punish
+			// the recipient: the sender may wait for room, unless the
+			// recipient is itself stalled on the sender, in which case
+			// neither thread could ever proceed
+			//@longer cycles of senders + full mailboxes are not detected
+			TRACE(MESSAGE, "Mailbox full on thread %#x\n", id);
+			status = STATUS_WOULD_BLOCK;
+			if (waiting &&
+				current_thread != *this &&
+				state != THREAD_STATE_SENDING &&
+				!(state == THREAD_STATE_BLOCKED &&
+					blocking_thread == &current_thread))
+				{
+				ASSERT(current_thread.state == THREAD_STATE_READY);
+				TRACE(SCHED|MESSAGE, "Thread %#x waiting for room\n",
+					current_thread.id);
+				current_thread.state = THREAD_STATE_SENDING;
+				mailbox.sender_queue.push(current_thread);
+				add_reference(current_thread);
+
+				// Remember where the sender waits, in case it is deleted
+				// before it is woken; see mark_for_deletion()
+				ASSERT(current_thread.send_wait_thread == NULL);
+				current_thread.send_wait_thread = this;
+				add_reference(*this);
+				*waiting = TRUE;
+				}
 			break;
 			}
 
 
+		//
+		// If the recipient thread is idle, waiting for any incoming message,
+		// then this message wakes it.  The thread is eligible to execute
+		// again, now that it has a message pending.  A thread that only
+		// awaits replies keeps waiting until one arrives
+		//
+		if (state == THREAD_STATE_WAITING && (reply || !reply_wait))
+			{
+			TRACE(SCHED|MESSAGE, "Waking thread %#x\n", id);
+			state			= THREAD_STATE_READY;
+			direct_receive	= FALSE;
+			reply_wait		= FALSE;
+			}
+
+
 		//
 		// If the sender (the current thread) must receive a response to this
 		// message before it can proceed, then mark it as blocked; the current
@@ -747,6 +1371,87 @@ put_message(message_cr message)
 	}
 
 
+///
+/// Signal this thread: OR the given bits into its notification word.  This
+/// is the lightweight alternative to put_message() for events that carry no
+/// data beyond the event itself.  It never allocates memory, so it may safely
+/// be invoked from an IRQ handler: repeated signals simply coalesce; and the
+/// thread's scheduling ticket stands in for all of its pending signals in the
+/// lottery pool.  The thread collects its signals via get_notification().
+///
+/// An idle thread wakes only if it accepts direct messages, since the
+/// signals are delivered the same way; see io_manager_c::receive_message().
+/// Assumes the caller holds the I/O Manager lock.
+///
+/// @param signal -- the signal bits to raise
+///
+/// @return the scheduling ticket if it should now be added to the lottery
+/// pool; or NULL if the ticket is already pooled, or if the thread cannot
+/// receive notifications
+///
+message_cp thread_c::
+put_notification(uint32_t signal)
+	{
+	message_cp ticket = NULL;
+
+	lock.acquire();
+
+	if (mailbox.enabled && scheduling_ticket && signal)
+		{
+		if (!notification && !bonus_pending)
+			{ ticket = scheduling_ticket; }
+		notification |= signal;
+
+		if (state == THREAD_STATE_WAITING && direct_receive)
+			{
+			TRACE(SCHED|MESSAGE, "Signalling thread %#x (%#x)\n", id,
+				signal);
+			state			= THREAD_STATE_READY;
+			direct_receive	= FALSE;
+			reply_wait		= FALSE;
+			}
+		}
+
+	lock.release();
+
+	return(ticket);
+	}
+
+
+///
+/// Set the maximum number of messages that may be queued in this thread's
+/// mailbox.  Raising the limit wakes any senders that now fit.
+///
+/// @param limit -- the new limit, between 1 and MAILBOX_LIMIT_MAX
+///
+/// @return STATUS_SUCCESS if the limit is updated; STATUS_INVALID_DATA if
+/// the limit is out of range
+///
+status_t thread_c::
+set_mailbox_limit(uint32_t limit)
+	{
+	thread_queue_c	sender;
+	status_t		status;
+
+	if (limit > 0 && limit <= MAILBOX_LIMIT_MAX)
+		{
+		lock.acquire();
+		mailbox.limit = limit;
+		collect_senders(sender);
+		lock.release();
+
+		wake_senders(sender);
+		status = STATUS_SUCCESS;
+		}
+	else
+		{
+		status = STATUS_INVALID_DATA;
+		}
+
+	return(status);
+	}
+
+
 ///
 /// Determines if the thread is blocked/waiting for this specific message.  If
 /// so, then wake/unblock the thread + mark it as ready to execute again.
@@ -774,7 +1479,8 @@ unblock_on(message_cr message)
 
 		// This thread has been waiting for this specific message; now that
 		// the message is pending, this thread can resume
-		state = THREAD_STATE_READY;
+		state			= THREAD_STATE_READY;
+		direct_receive	= FALSE;
 		remove_reference(*blocking_thread);
 		blocking_thread = NULL;
 
@@ -808,3 +1514,137 @@ unlock_both(thread_cr	thread0,
 	return;
 	}
 
+
+///
+/// Release the execution block that hosts a thread_c context.  This is the
+/// last step in destroying a thread; see ~thread_c()
+///
+void_t thread_c::
+operator delete(void_tp thread)
+	{
+	if (thread)
+		{ __thread_manager->free_thread_block(thread); }
+	return;
+	}
+
+
+///
+/// Suspend this thread until its next message arrives.  If the mailbox is
+/// currently empty, the thread is marked as waiting and is no longer eligible
+/// to execute; the next call to thread_c::put_message() (or
+/// thread_c::put_direct_message() or thread_c::put_notification(), if the
+/// caller accepts direct messages) wakes it again.  Pending signals count as a
+/// pending message here, if the caller accepts direct messages.  The
+/// logic here does not actually yield, it simply marks the thread as waiting;
+/// the assumption is that the caller will drop its locks + then yield.
+///
+/// A thread should only invoke this method on itself.  Assumes the caller
+/// holds the I/O Manager lock, to avoid racing with the scheduler.
+///
+/// @param accept_direct_message -- can the thread receive a direct message?
+///
+/// Returns TRUE if the current thread should yield until a message arrives;
+/// FALSE if a message is already pending
+///
+bool_t thread_c::
+wait_on_mailbox(bool_t accept_direct_message)
+	{
+	bool_t waiting = FALSE;
+
+	ASSERT(*this == __hal->read_current_thread());
+	ASSERT(state == THREAD_STATE_READY);
+
+	lock.acquire();
+
+	if (mailbox.message_queue.is_empty() &&
+		!(accept_direct_message && notification))
+		{
+		state			= THREAD_STATE_WAITING;
+		direct_receive	= accept_direct_message;
+		reply_wait		= FALSE;
+		waiting			= TRUE;
+		}
+
+	lock.release();
+
+	return(waiting);
+	}
+
+
+///
+/// Suspend this thread until the reply to an asynchronous request arrives.
+/// Only a reply wakes the thread; any other incoming message remains queued
+/// in the mailbox until the thread next receives normally.  As with
+/// wait_on_mailbox(), the logic here does not actually yield, it simply marks
+/// the thread as waiting.
+///
+/// A thread should only invoke this method on itself.  Assumes the caller
+/// holds the I/O Manager lock, to avoid racing with the scheduler.
+///
+/// @param request_id -- the request id; or MESSAGE_ID_ANY for any reply
+///
+/// Returns TRUE if the current thread should yield until the reply arrives;
+/// FALSE if the reply is already pending, or if there is no such request
+///
+bool_t thread_c::
+wait_on_reply(message_id_t request_id)
+	{
+	bool_t waiting = FALSE;
+
+	ASSERT(*this == __hal->read_current_thread());
+	ASSERT(state == THREAD_STATE_READY);
+
+	lock.acquire();
+
+	if (!find_reply(request_id, FALSE) &&
+		mailbox.has_pending_request(request_id))
+		{
+		state			= THREAD_STATE_WAITING;
+		direct_receive	= FALSE;
+		reply_wait		= TRUE;
+		waiting			= TRUE;
+		}
+
+	lock.release();
+
+	return(waiting);
+	}
+
+
+///
+/// Wake the senders collected via collect_senders(), so that each may retry
+/// its message.  The caller should not hold any thread locks here.  A sender
+/// that is no longer waiting for room (e.g., because it was deleted) is
+/// simply released.
+///
+/// The wakeup itself only requires the sender's lock: the scheduler never
+/// dispatches a thread that is waiting for room, and the sender will not
+/// retry until it is dispatched again
+///
+/// @param sender -- the senders to wake
+///
+void_t thread_c::
+wake_senders(thread_queue_cr sender)
+	{
+	while (!sender.is_empty())
+		{
+		thread_cr	thread		= sender.pop();
+		thread_cp	recipient;
+
+		thread.lock.acquire();
+		if (thread.state == THREAD_STATE_SENDING)
+			{
+			TRACE(SCHED|MESSAGE, "Waking sender %#x\n", thread.id);
+			thread.state = THREAD_STATE_READY;
+			}
+		recipient				= thread.send_wait_thread;
+		thread.send_wait_thread	= NULL;
+		thread.lock.release();
+
+		if (recipient)
+			{ remove_reference(*recipient); }
+		remove_reference(thread);
+		}
+
+	return;
+	}
@@ -0,0 +1,211 @@
+//
+// thread_block_cache.cpp
+//
+// Allocator for thread execution blocks
+//
+
+#include "bits.hpp"
+#include "debug.hpp"
+#include "hal/page_table_entry.hpp"
+#include "kernel_heap.hpp"
+#include "kernel_subsystems.hpp"
+#include "thread_block_cache.hpp"
+
+
+
+///
+/// Constructor.  Initially, the cache is empty and none of the slots in the
+/// thread area are in use.
+///
+thread_block_cache_c::
+thread_block_cache_c():
+	cache_count(0),
+	free_list(NULL),
+	hit_count(0),
+	miss_count(0)
+	{
+	ASSERT(KERNEL_THREAD_BLOCK_COUNT == THREAD_BLOCK_MAP_COUNT * 1024);
+	return;
+	}
+
+
+///
+/// Allocate a thread execution block.  The block should later be freed with
+/// free_block().  On return, the guard page at the start of the block is
+/// unmapped; the remainder of the block is mapped, but not initialized.
+///
+/// @return a pointer to the start of the new block; or NULL if no block is
+/// available
+///
+uint8_tp thread_block_cache_c::
+allocate_block()
+	{
+	uint8_tp			block	= NULL;
+	bool_t				cached	= FALSE;
+	physical_address_t	frame;
+	status_t			status;
+
+
+	do
+		{
+		//
+		// Reuse a cached block if possible; otherwise, reserve an unused
+		// slot in the thread area
+		//
+		lock.acquire();
+
+		if (free_list)
+			{
+			block		= uint8_tp(free_list) - THREAD_GUARD_PAGE_SIZE;
+			free_list	= free_list->next;
+			cache_count--;
+			hit_count++;
+			cached = TRUE;
+			}
+		else
+			{
+			block = allocate_slot();
+			miss_count++;
+			}
+
+		lock.release();
+
+		if (!block)
+			{
+			TRACE(ALL, "Unable to allocate thread block; thread area is full\n");
+			break;
+			}
+
+		if (cached)
+			break;
+
+
+		//
+		// This is a new slot, so back its upper page with a fresh frame.  The
+		// guard page remains unmapped
+		//
+		status = __memory_manager->allocate_frames(&frame, 1, MEMORY_WRITABLE);
+		if (status != STATUS_SUCCESS)
+			{
+			TRACE(ALL, "Unable to allocate frame for thread block\n");
+			free_slot(block);
+			block = NULL;
+			break;
+			}
+
+		ASSERT(__kernel_heap);
+		__kernel_heap->find_entry(block + THREAD_GUARD_PAGE_SIZE)->
+			commit_frame(frame, MEMORY_WRITABLE);
+
+		} while(0);
+
+
+	ASSERT(!block || is_aligned(block, THREAD_EXECUTION_BLOCK_ALIGNMENT));
+
+	return(block);
+	}
+
+
+///
+/// Reserve an unused slot within the thread area.  Assumes the caller holds
+/// the cache lock.
+///
+/// @return the start of the slot; or NULL if the thread area is full
+///
+uint8_tp thread_block_cache_c::
+allocate_slot()
+	{
+	uint8_tp	block = NULL;
+	uint32_t	index;
+
+	for (uint32_t i = 0; i < THREAD_BLOCK_MAP_COUNT; i++)
+		{
+		index = slot_map[i].allocate();
+		if (index < slot_map[i].size)
+			{
+			block = uint8_tp(KERNEL_THREAD_AREA_BASE) +
+				(i * slot_map[i].size + index) * THREAD_EXECUTION_BLOCK_SIZE;
+			break;
+			}
+		}
+
+	return(block);
+	}
+
+
+///
+/// Release a thread execution block.  The block is cached for reuse if
+/// possible; otherwise, its frame is released and its slot becomes free.  On
+/// return, the caller must not touch the block again.
+///
+/// @param block -- any address within the victim block
+///
+void_t thread_block_cache_c::
+free_block(void_tp block)
+	{
+	uint8_tp			base	= uint8_tp(uintptr_t(block) &
+									THREAD_EXECUTION_BLOCK_ALIGNMENT_MASK);
+	bool_t				cached	= FALSE;
+	physical_address_t	frame;
+	uint8_tp			page	= base + THREAD_GUARD_PAGE_SIZE;
+
+
+	//
+	// The boot thread executes on a static block outside of the thread
+	// area; there is nothing to reclaim here
+	//
+	if (base >= uint8_tp(KERNEL_THREAD_AREA_BASE) &&
+		base < uint8_tp(KERNEL_THREAD_AREA_END))
+		{
+		lock.acquire();
+
+		if (cache_count < THREAD_BLOCK_CACHE_SIZE)
+			{
+			free_block_sp(page)->next	= free_list;
+			free_list					= free_block_sp(page);
+			cache_count++;
+			cached = TRUE;
+			}
+
+		lock.release();
+
+
+		//
+		// The cache is full, so unmap this block + release its frame.
+		// Decommitting the page flushes it from the TLB of every processor,
+		// so the frame cannot be reached via a stale translation once it is
+		// reused
+		//
+		if (!cached)
+			{
+			ASSERT(__kernel_heap);
+			frame = __kernel_heap->find_entry(page)->decommit_frame(page);
+			__memory_manager->free_frames(&frame, 1);
+
+			free_slot(base);
+			}
+		}
+
+	return;
+	}
+
+
+///
+/// Return a slot to the thread area.  The block must already be unmapped.
+///
+/// @param block -- the start of the victim slot
+///
+void_t thread_block_cache_c::
+free_slot(const uint8_tp block)
+	{
+	uint32_t index = (block - uint8_tp(KERNEL_THREAD_AREA_BASE)) /
+		THREAD_EXECUTION_BLOCK_SIZE;
+
+	ASSERT(index < KERNEL_THREAD_BLOCK_COUNT);
+
+	lock.acquire();
+	slot_map[ index / 1024 ].free(index % 1024);
+	lock.release();
+
+	return;
+	}
@@ -40,6 +40,35 @@ thread_manager_c():
 	}
 
 
+///
+/// Allocates the idle thread for an application processor.  The new thread
+/// is bound to that processor: it will only ever execute there.  The HAL
+/// invokes this when starting each processor; the idle thread of the
+/// bootstrap processor is the null thread.
+///
+/// Returns a handle to the new thread, or NULL on error.
+///
+thread_cp thread_manager_c::
+create_idle_thread(uint32_t processor)
+	{
+	thread_cp thread;
+
+	ASSERT(processor < PROCESSOR_COUNT_MAX);
+	ASSERT(__idle_thread[ processor ] == NULL);
+
+	thread = create_thread(null_thread_entry, NULL, THREAD_ID_NULL + processor);
+	if (thread)
+		{
+		// The processor will start executing this thread immediately, without
+		// any lottery; so mark it as already running there
+		thread->processor = processor;
+		__idle_thread[ processor ] = thread;
+		}
+
+	return(thread);
+	}
+
+
 ///
 /// Allocates storage/context for a new thread.  The thread will start
 /// executing in the specified start-routine.
@@ -143,15 +172,13 @@ create_thread(	thread_start_fp		kernel_start,
 
 		//
 		// Allocate a block of memory for the thread; this block hosts both
-		// the thread_c context (at the smaller addresses) and its kernel
-		// stack (at the larger addresses).  This assumes that the
-		// placement-new operator returns this exact block with no additional
-		// fixups; and that delete(thread_c) is smart enough to reclaim the
-		// entire block, not just the thread_c object
+		// the thread_c context (at the top of the block) and its kernel
+		// stack (immediately beneath the context).  The thread_c object is
+		// later destroyed via thread_c::operator delete(), which returns the
+		// entire block to the cache
 		//
-		ASSERT(sizeof(thread_c) < THREAD_EXECUTION_BLOCK_SIZE);
-		thread_block = new(THREAD_EXECUTION_BLOCK_ALIGNMENT)
-			uint8_t[THREAD_EXECUTION_BLOCK_SIZE];
+		ASSERT(sizeof(thread_c) <= THREAD_CONTEXT_SIZE);
+		thread_block = thread_block_cache.allocate_block();
 		if (!thread_block)
 			break;
 
@@ -160,13 +187,14 @@ create_thread(	thread_start_fp		kernel_start,
 		// Initialize the actual thread context on top of the memory block;
 		// this also automatically creates a reference for the calling thread
 		//
-		thread = new(thread_block) thread_c(kernel_start,
-											*address_space,
-											id,
-											copy_page,
-											effective_mask,
-											user_start,
-											user_stack);
+		thread = new(thread_block + THREAD_CONTEXT_OFFSET)
+			thread_c(	kernel_start,
+						*address_space,
+						id,
+						copy_page,
+						effective_mask,
+						user_start,
+						user_stack);
 		ASSERT(thread);
 
 
@@ -199,7 +227,8 @@ create_thread(	thread_start_fp		kernel_start,
 		if (address_space)
 			{ address_space->free_large_payload_block(copy_page); }
 
-		delete[](thread_block);
+		if (thread_block)
+			{ thread_block_cache.free_block(thread_block); }
 		}
 
 	return(thread);
@@ -266,12 +295,19 @@ delete_thread(	thread_cr	victim_thread,
 	ASSERT(thread_table.is_valid(victim_thread.id));
 	thread_table.remove(victim_thread.id);
 	lock.release();
-	remove_reference(victim_thread);
 
 
-	//@on SMP machine, thread could still be running on another CPU here; keep
-	//@extra reference to thread when it has the CPU to prevent premature
-	//@deletion in this situation
+	//
+	// On an SMP host, the victim may still be executing on another processor
+	// (e.g., it has queued its own deletion request, but has not yet switched
+	// off of its stack).  Wait for it to release the processor before
+	// destroying its context.  The victim can no longer win any lotteries,
+	// so this should be very brief
+	//
+	while(victim_thread.processor != PROCESSOR_INDEX_INVALID)
+		{ __hal->pause_processor(); }
+
+	remove_reference(victim_thread);
 
 
 	return;
@@ -382,6 +418,7 @@ initialize_system_threads()
 	{
 	address_space_cp	address_space;
 	thread_cp			boot_thread;
+	void_tp				copy_page;
 
 
 	//
@@ -395,15 +432,19 @@ initialize_system_threads()
 	// Initialize the context for the boot thread.  The storage for this
 	// context already exists, just initialize it in-place.  No need to
 	// allocate a second context here.  The boot thread should not receive
-	// any messages, so no COW buffer allocated here
+	// any messages, but it still needs a copy page: any partial pages in the
+	// payloads it sends are copied through this page
 	//
 	address_space =
 		__memory_manager->find_address_space(ADDRESS_SPACE_ID_KERNEL);
 	ASSERT(address_space);
+	copy_page = address_space->allocate_large_payload_block(1);
+	if (!copy_page)
+		{ kernel_panic(KERNEL_PANIC_REASON_UNABLE_TO_CREATE_SYSTEM_THREAD); }
 	boot_thread = new(&original_context) thread_c(	NULL,
 													*address_space,
 													THREAD_ID_BOOT,
-													NULL,
+													copy_page,
 													CAPABILITY_ALL,
 													NULL,
 													NULL);
@@ -417,6 +458,12 @@ initialize_system_threads()
 	boot_thread->tick_count = int32_t(0x7FFFFFFF);
 
 
+	//
+	// The boot thread is already running here, on the bootstrap processor
+	//
+	boot_thread->processor = __hal->read_current_processor_index();
+
+
 	//
 	// Save a reference to the thread for later use
 	//
@@ -436,9 +483,12 @@ initialize_system_threads()
 	__cleanup_thread =
 		create_thread(cleanup_thread_entry, NULL, THREAD_ID_CLEANUP);
 
-	//@on SMP host, must allocate one idle/null thread for each CPU
+	// The null thread doubles as the idle thread of the bootstrap processor.
+	// The idle threads for any other processors are allocated when the HAL
+	// starts those processors
 	ASSERT(__null_thread == NULL);
 	__null_thread = create_thread(null_thread_entry, NULL, THREAD_ID_NULL);
+	__idle_thread[ PROCESSOR_INDEX_BOOT ] = __null_thread;
 
 	if (!__cleanup_thread || !__null_thread)
 		{ kernel_panic(KERNEL_PANIC_REASON_UNABLE_TO_CREATE_SYSTEM_THREAD); }
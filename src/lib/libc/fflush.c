@@ -2,6 +2,7 @@
 // fflush.c
 //
 
+#include "read.h"
 #include "stdlib.h"
 #include "stream.h"
 #include "dx/delete_message.h"
@@ -21,8 +22,10 @@ fflush(FILE *stream)
 	if (stream)
 		{
 		//
-		// Discard any buffered input data
+		// Discard any buffered input data, including any data still being
+		// read ahead
 		//
+		discard_prefetch(stream);
 		if (stream->input_message)
 			{
 			delete_message(stream->input_message);
@@ -101,6 +101,11 @@ fopen(const char* filename, const char* mode)
 		file->cookie	= reply_data->cookie;
 		file->flags		= flags | STREAM_OPEN;
 
+		// Sequential reads from the file can overlap with the caller's
+		// consumption of the data.  See maybe_read()
+		if (flags & STREAM_READ)
+			{ file->flags |= STREAM_PREFETCH; }
+
 
 		} while(0);
 
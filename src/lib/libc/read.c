@@ -4,6 +4,7 @@
 
 #include "assert.h"
 #include "dx/delete_message.h"
+#include "dx/post_request.h"
 #include "dx/send_and_receive_message.h"
 #include "dx/status.h"
 #include "dx/stream_message.h"
@@ -12,10 +13,37 @@
 #include "string.h"
 
 
+static void prefetch(FILE* stream, size_t size_hint);
 static message_sp read(FILE* stream, size_t buffer_size);
 
 
 
+///
+/// Discard the read-ahead data, if any, still outstanding on this stream.
+/// Typically invoked when the stream is flushed or closed, since the data
+/// will never be consumed
+///
+/// @param stream -- the input stream
+///
+void
+discard_prefetch(FILE* stream)
+	{
+	message_s reply;
+
+	if (stream && (stream->flags & STREAM_READ_AHEAD))
+		{
+		stream->flags &= ~STREAM_READ_AHEAD;
+
+		// The reply is guaranteed to arrive, so wait for it here rather than
+		// leave it pending indefinitely
+		if (receive_reply(stream->prefetch_id, &reply, TRUE) == STATUS_SUCCESS)
+			{ delete_message(&reply); }
+		}
+
+	return;
+	}
+
+
 ///
 /// Read data (possibly buffered) from an input stream.  Blocks until data
 /// arrives, if necessary
@@ -114,13 +142,54 @@ maybe_read(	FILE*	stream,
 	}
 
 
+///
+/// Request the next block of data on this stream, without waiting for it to
+/// arrive.  The next call to read() collects the reply.  The stream driver
+/// services its requests in order, so this simply reads ahead of the caller.
+/// If the request cannot be sent, then the next read() falls back to a
+/// synchronous request.
+///
+/// @param stream    -- the input stream
+/// @param size_hint -- size of caller's input buffer, in bytes
+///
+static
+void
+prefetch(FILE* stream, size_t size_hint)
+	{
+	read_stream_request_s	payload;
+	message_s				request;
+
+	assert(stream);
+	assert(!(stream->flags & STREAM_READ_AHEAD));
+
+	payload.cookie		= stream->cookie;
+	payload.size_hint	= size_hint;
+
+	initialize_message(&request);
+	request.u.destination	= stream->thread_id;
+	request.type			= MESSAGE_TYPE_READ;
+	request.id				= rand();
+	request.data			= &payload;
+	request.data_size		= sizeof(payload);
+	if (post_request(&request) == STATUS_SUCCESS)
+		{
+		stream->prefetch_id = request.id;
+		stream->flags |= STREAM_READ_AHEAD;
+		}
+
+	return;
+	}
+
+
 ///
 /// Read data from an input stream.  No buffering.  Blocks until data arrives,
 /// if necessary
 ///
-/// This is the only input routine that invokes send_and_receive_message(), to
-/// the appropriate stream driver.  All other input routines should eventually
-/// invoke this one.
+/// This is the only input routine that issues READ requests, to the
+/// appropriate stream driver.  All other input routines should eventually
+/// invoke this one.  On streams that allow it, this also reads ahead: after
+/// each successful read, the next block is requested immediately, so that the
+/// driver can produce it while the caller consumes the current block.
 ///
 /// @param stream    -- the input stream
 /// @param size_hint -- size of caller's input buffer, in bytes, mostly as a
@@ -170,20 +239,34 @@ read(FILE* stream, size_t size_hint)
 		assert(stream->input_message);
 
 
-		//@send message to stream driver, waiting for I/O?
+		//
+		// If the next block was already requested, then collect it here;
+		// block until it arrives, if necessary
+		//
+		status = STATUS_MAILBOX_EMPTY;
+		if (stream->flags & STREAM_READ_AHEAD)
+			{
+			stream->flags &= ~STREAM_READ_AHEAD;
+			status = receive_reply(stream->prefetch_id, stream->input_message,
+				TRUE);
+			}
 
 
 		//
-		// Read the next block of data on this stream; block here until it
-		// arrives
+		// Otherwise, read the next block of data on this stream; block here
+		// until it arrives
 		//
-		initialize_message(&request);
-		request.u.destination	= stream->thread_id;
-		request.type			= MESSAGE_TYPE_READ;
-		request.id				= rand();
-		request.data			= &payload;
-		request.data_size		= sizeof(payload);
-		status = send_and_receive_message(&request, stream->input_message);
+		if (status != STATUS_SUCCESS)
+			{
+			initialize_message(&request);
+			request.u.destination	= stream->thread_id;
+			request.type			= MESSAGE_TYPE_READ;
+			request.id				= rand();
+			request.data			= &payload;
+			request.data_size		= sizeof(payload);
+			status = send_and_receive_message(&request, stream->input_message);
+			}
+
 		if (status == STATUS_SUCCESS)
 			{
 			assert(	stream->input_message->type == MESSAGE_TYPE_READ_COMPLETE ||
@@ -192,6 +275,19 @@ read(FILE* stream, size_t size_hint)
 			}
 		}
 
+
+	//
+	// Request the next block now, while the caller consumes this one.  Stop
+	// reading ahead at EOF or on error
+	//
+	if (stream->input_message &&
+		(stream->flags & STREAM_PREFETCH) &&
+		stream->input_message->type == MESSAGE_TYPE_READ_COMPLETE &&
+		stream->input_message->data_size > 0)
+		{
+		prefetch(stream, size_hint);
+		}
+
 	return(stream->input_message);
 	}
 
@@ -7,6 +7,9 @@
 
 #include "stream.h"
 
+void
+discard_prefetch(FILE* stream);
+
 size_t
 maybe_read(FILE* stream, void* buffer, size_t buffer_size);
 
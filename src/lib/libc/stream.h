@@ -6,6 +6,7 @@
 #define _STREAM_H
 
 #include "dx/message.h"
+#include "dx/message_id.h"
 #include "dx/thread_id.h"
 #include "stdint.h"
 #include "stdio.h"
@@ -21,6 +22,7 @@ typedef struct file
 	uintptr_t		cookie;			/// opaque I/O thread context
 	uintptr_t		flags;
 	message_sp		input_message;
+	message_id_t	prefetch_id;	/// outstanding read-ahead request, if any
 	unsigned char	pushback;		/// last character pushed back via ungetc()
 	thread_id_t		thread_id;		/// thread handling the I/O on this stream
 	} FILE;
@@ -33,9 +35,11 @@ typedef struct file
 #define STREAM_EOF			0x02	/// Stream is at end-of-file
 #define STREAM_ERROR		0x04	/// Stream has I/O error
 #define STREAM_PUSHBACK		0x08	/// Pushback data is valid
+#define STREAM_PREFETCH		0x10	/// Read ahead while input is consumed
 #define STREAM_BUFFER_NONE	0x00	/// No buffering at all
 #define STREAM_BUFFER_LINE	0x20	/// Line-buffered
 #define STREAM_BUFFER_FULL	0x40	/// Fully-buffered
+#define STREAM_READ_AHEAD		0x80	/// Read-ahead request is outstanding
 
 //@read/write/append?  orientation?  text/binary?
 
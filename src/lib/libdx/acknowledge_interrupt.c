@@ -0,0 +1,33 @@
+//
+// acknowledge_interrupt.c
+//
+
+#include "call_kernel.h"
+#include "dx/acknowledge_interrupt.h"
+#include "dx/system_call.h"
+#include "dx/system_call_vectors.h"
+
+
+///
+/// Unmask an IRQ line after handling its interrupt.  The kernel masks each
+/// line as it interrupts, so the line remains silent until one of its
+/// handlers acknowledges it here.  The caller must be a registered handler
+/// on this line; see map_device().
+///
+/// @param irq -- the IRQ line to acknowledge
+///
+/// @return STATUS_SUCCESS if the line is unmasked; nonzero otherwise
+///
+status_t
+acknowledge_interrupt(uintptr_t irq)
+	{
+	syscall_data_s	syscall;
+
+	syscall.size	= sizeof(syscall);
+	syscall.data0	= irq;
+
+	CALL_KERNEL(&syscall, SYSTEM_CALL_VECTOR_ACKNOWLEDGE_INTERRUPT);
+
+	return(syscall.status);
+	}
+
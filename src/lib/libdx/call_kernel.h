@@ -5,20 +5,43 @@
 #ifndef _CALL_KERNEL_H
 #define _CALL_KERNEL_H
 
+#include "dx/fast_system_call.h"
+
 
 ///
-/// Common sequence of instructions for issuing a system call to the kernel
+/// Common sequence of instructions for issuing a system call to the kernel.
+/// If the kernel + processor support it, enter the kernel via SYSENTER, with
+/// the vector in ESI and the return address + stack in EDX + ECX; otherwise,
+/// fall back to a software interrupt on the vector itself.
 ///
 /// @param syscall_data		-- pointer to system_call_data_s structure
 /// @param syscall_vector	-- system call vector to be invoked, must be
 ///							   an integer literal
 ///
-#define CALL_KERNEL(syscall_data, syscall_vector)			\
-	__asm volatile(	"movl %0, %%eax;"						\
-					"int  %1"								\
-			:												\
-			: "g"(syscall_data), "i"(syscall_vector)		\
-			: "eax", "cc", "memory");
+#define CALL_KERNEL(syscall_data, syscall_vector)						\
+	do																	\
+		{																\
+		if (__fast_system_call)											\
+			{															\
+			__asm volatile(	"movl %0, %%eax;"							\
+							"movl %1, %%esi;"							\
+							"movl %%esp, %%ecx;"						\
+							"movl $1f, %%edx;"							\
+							"sysenter;"									\
+							"1:"										\
+					:													\
+					: "g"(syscall_data), "i"(syscall_vector)			\
+					: "eax", "ecx", "edx", "esi", "cc", "memory");		\
+			}															\
+		else															\
+			{															\
+			__asm volatile(	"movl %0, %%eax;"							\
+							"int  %1"									\
+					:													\
+					: "g"(syscall_data), "i"(syscall_vector)			\
+					: "eax", "cc", "memory");							\
+			}															\
+		} while(0)
 
 
 #endif
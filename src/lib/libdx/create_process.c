@@ -146,7 +146,7 @@ create_process_from_image(	const uint8_t*		image,
 		//
 		// Install the (user mode) stack for the new thread
 		//
-		size_t stack_size = 4 * PAGE_SIZE;	//@allow the caller to specify?
+		size_t stack_size = 16 * PAGE_SIZE;	//@allow the caller to specify?
 		status = send_stack(address_space, stack, stack_size);
 		if (status != STATUS_SUCCESS)
 			break;
@@ -156,8 +156,9 @@ create_process_from_image(	const uint8_t*		image,
 		// Install the initial heap for this address space
 		//
 		//@malloc() needs > 1 page for init?
-		//@lualibs need > 8 pages, and >4 at run-time
-		size_t heap_size = 24 * PAGE_SIZE;	//@allow the caller to specify?
+		//@lualibs need > 8 pages, and >4 at run-time.  The heap is only
+		//@reserved here, so unused pages cost no physical memory
+		size_t heap_size = 1024 * PAGE_SIZE;	//@allow the caller to specify?
 		status = send_heap(address_space, heap, heap_size);
 		if (status != STATUS_SUCCESS)
 			break;
@@ -295,7 +296,7 @@ send_bss(	address_space_id_t			address_space,
 			status = expand_address_space(	address_space,
 											bss_first_page,
 											bss_size,
-											0);
+											EXPAND_ADDRESS_SPACE_RESERVE);
 			}
 		else
 			{
@@ -412,9 +413,10 @@ send_environment_block(	thread_id_t			thread,
 
 
 		//
-		// Finally send the environment block to the new thread
+		// Finally send the environment block to the new thread.  The block is
+		// discarded below, so its pages may be handed over outright
 		//
-		status = send_message(&message);
+		status = send_donated_message(&message);
 
 		} while(0);
 
@@ -431,9 +433,9 @@ send_environment_block(	thread_id_t			thread,
 
 
 ///
-/// Add uninitialized pages to this address space, to serve as the run-time
-/// heap for its initial thread.  This actually consumes unused page frames,
-/// so the initial heap size should be relatively conservative.
+/// Reserve pages in this address space, to serve as the run-time heap for its
+/// initial thread.  Each page is allocated + zero-filled by the kernel when
+/// first touched, so unused heap space consumes no page frames.
 ///
 /// @param address_space	-- id of the target address space
 /// @param heap				-- base address of the heap
@@ -452,9 +454,10 @@ send_heap(	address_space_id_t	address_space,
 
 	if (heap_size > 0)
 		{
-		// Add uninitialized pages to the address space, for use as its initial
-		// runtime heap
-		status = expand_address_space(address_space, heap, heap_size, 0);
+		// Reserve pages in the address space, for use as its initial runtime
+		// heap
+		status = expand_address_space(address_space, heap, heap_size,
+			EXPAND_ADDRESS_SPACE_RESERVE);
 		}
 	else
 		{
@@ -624,10 +627,10 @@ send_segments(	thread_id_t			thread,
 
 
 ///
-/// Add pages to this address space, to be used as the runtime stack for its
-/// initial thread.  The new stack will grow (expand) downward as needed from
-/// the specified base address.  This actually consumes unused page frames,
-/// so the initial stack size should be relatively conservative.
+/// Reserve pages in this address space, to be used as the runtime stack for
+/// its initial thread.  The new stack will grow (expand) downward as needed
+/// from the specified base address.  Each page is allocated + zero-filled by
+/// the kernel when first touched.
 ///
 /// @param address_space	-- id of the target address space
 /// @param stack			-- base of the new stack
@@ -650,8 +653,9 @@ send_stack(	address_space_id_t	address_space,
 	stack_top = (uint8_t*)(PAGE_ALIGN(stack)) - stack_size;
 
 
-	// Add the stack pages at this address
-	status = expand_address_space(address_space, stack_top, stack_size, 0);
+	// Reserve the stack pages at this address
+	status = expand_address_space(address_space, stack_top, stack_size,
+		EXPAND_ADDRESS_SPACE_RESERVE);
 
 
 	return(status);
@@ -0,0 +1,37 @@
+//
+// fast_system_call.c
+//
+
+#include "dx/fast_system_call.h"
+#include "dx/hal/processor_type.h"
+#include "dx/read_kernel_stats.h"
+
+
+
+///
+/// Enter the kernel via SYSENTER rather than INT?  Initially FALSE, so that
+/// every system call is safe before initialize_fast_system_call()
+///
+bool_t __fast_system_call = FALSE;
+
+
+
+///
+/// Determine whether system calls can use the SYSENTER fast entry path.  The
+/// kernel only configures SYSENTER on processors that support it, so this
+/// relies on the processor type reported in the kernel statistics.  Invoked
+/// once per address space, before main(); see setup_main()
+///
+void_t
+initialize_fast_system_call()
+	{
+	kernel_stats_s stats;
+
+	if (read_kernel_stats(&stats) == STATUS_SUCCESS &&
+		stats.processor_type >= PROCESSOR_TYPE_FAST_SYSTEM_CALL)
+		{
+		__fast_system_call = TRUE;
+		}
+
+	return;
+	}
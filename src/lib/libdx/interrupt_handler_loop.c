@@ -5,6 +5,7 @@
 //
 
 #include "assert.h"
+#include "dx/acknowledge_interrupt.h"
 #include "dx/delete_message.h"
 #include "dx/map_device.h"
 #include "dx/receive_message.h"
@@ -28,7 +29,6 @@
 void_t
 interrupt_handler_loop()
 	{
-	message_s				ack;
 	interrupt_handler_fp	handler				= NULL;
 	void_tp					handler_context		= NULL;
 	uintptr_t				irq					= (uintptr_t)(-1);
@@ -36,16 +36,6 @@ interrupt_handler_loop()
 	message_s				reply;
 
 
-	//
-	// Partially initialize the interrupt-acknowledgement message in advance,
-	// to avoid repeatedly reloading these constants on every interrupt
-	//
-	ack.type				= MESSAGE_TYPE_ACKNOWLEDGE_INTERRUPT;
-	ack.data_size			= 0;
-	ack.destination_address	= NULL;
-
-
-
 	//
 	// Loop here, handling interrupt messages, until explicitly told to exit
 	//
@@ -57,7 +47,7 @@ interrupt_handler_loop()
 
 		//
 		// Wait for the next request.  The vast majority of incoming messages
-		// will be interrupt events
+		// will be interrupt notifications
 		//
 		status = receive_message(&message, WAIT_FOR_MESSAGE);
 		if (status != STATUS_SUCCESS)
@@ -69,18 +59,23 @@ interrupt_handler_loop()
 		//
 		switch(message.type)
 			{
-			case MESSAGE_TYPE_HANDLE_INTERRUPT:
+			case MESSAGE_TYPE_NOTIFICATION:
+				// The kernel signals one bit per IRQ line; ignore any other
+				// signal bits
+				if (!((uintptr_t)(message.data) & (1 << irq)))
+					{ break; }
+
 				// Invoke the actual device-specific interrupt handler; expect
-				// this handler to invoke defer_interrupt(), possibly
-				// repeatedly
+				// this handler to invoke defer_interrupt() or
+				// signal_thread(), possibly repeatedly
 				assert(handler);
 				assert(parent_thread != THREAD_ID_INVALID);
 				handler(parent_thread, handler_context);
 
-				// Resume the thread that actually took the interrupt
-				ack.u.destination	= message.u.source;
-				ack.id				= message.id;
-				send_message(&ack);
+				// The kernel masked the IRQ line when it interrupted; now
+				// that the device is serviced, let it interrupt again.  The
+				// interrupted thread itself never waited on this handler
+				acknowledge_interrupt(irq);
 
 				break;
 
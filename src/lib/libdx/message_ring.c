@@ -0,0 +1,178 @@
+//
+// message_ring.c
+//
+
+#include "call_kernel.h"
+#include "dx/message_ring.h"
+#include "dx/system_call.h"
+#include "dx/system_call_vectors.h"
+
+
+
+///
+/// Allocate a pair of submission + completion rings for the current thread.
+/// Each thread has at most one pair; if the thread already has rings, then
+/// this just returns them.  See dx/message_ring.h
+///
+/// @param ring -- on return, the rings for the current thread
+///
+/// @return STATUS_SUCCESS if the rings are available; non-zero on error
+///
+status_t
+create_message_ring(message_ring_spp ring)
+	{
+	status_t status;
+
+	if (ring)
+		{
+		syscall_data_s syscall;
+
+		syscall.size = sizeof(syscall);
+
+		CALL_KERNEL(&syscall, SYSTEM_CALL_VECTOR_CREATE_MESSAGE_RING);
+
+		*ring	= (message_ring_sp)(syscall.data0);
+		status	= syscall.status;
+		}
+	else
+		{
+		status = STATUS_INVALID_DATA;
+		}
+
+	return(status);
+	}
+
+
+
+///
+/// Ask the kernel to process the submission ring immediately, and post any
+/// completions.  The kernel also processes the ring on each clock tick, so
+/// this is only necessary when the caller cannot wait; or when the caller has
+/// nothing else to do, and wants to block until a message arrives.
+///
+/// @param ring					-- the rings for the current thread
+/// @param wait_for_completion	-- if no completions are pending, and a receive
+///								   operation is outstanding, then block until
+///								   a message arrives
+///
+/// @return STATUS_SUCCESS if the ring was processed; non-zero on error
+///
+status_t
+enter_message_ring(	message_ring_sp	ring,
+					bool_t			wait_for_completion)
+	{
+	status_t status;
+
+	if (ring)
+		{
+		syscall_data_s syscall;
+
+		syscall.size	= sizeof(syscall);
+		syscall.data0	= (uintptr_t)(wait_for_completion);
+
+		CALL_KERNEL(&syscall, SYSTEM_CALL_VECTOR_ENTER_MESSAGE_RING);
+
+		status = syscall.status;
+		}
+	else
+		{
+		status = STATUS_INVALID_DATA;
+		}
+
+	return(status);
+	}
+
+
+
+///
+/// Retrieve the next completion, if any, from the completion ring.  Does not
+/// trap into the kernel.
+///
+/// @param ring			-- the rings for the current thread
+/// @param completion	-- on return, the completed operation, including its
+///						   final status.  A completed receive operation holds
+///						   the incoming message
+///
+/// @return STATUS_SUCCESS if a completion was retrieved; STATUS_MAILBOX_EMPTY
+/// if no completions are pending; non-zero on error
+///
+status_t
+get_message_completion(	message_ring_sp			ring,
+						message_operation_s*	completion)
+	{
+	uint32_t	head;
+	status_t	status;
+
+	if (ring && completion)
+		{
+		head = ring->completion_head;
+		if (head != ring->completion_tail)
+			{
+			*completion = ring->completion[ head & MESSAGE_RING_MASK ];
+
+			// Only release the entry once it has been consumed
+			__asm volatile("" : : : "memory");
+			ring->completion_head = head + 1;
+			status = STATUS_SUCCESS;
+			}
+		else
+			{
+			status = STATUS_MAILBOX_EMPTY;
+			}
+		}
+	else
+		{
+		status = STATUS_INVALID_DATA;
+		}
+
+	return(status);
+	}
+
+
+
+///
+/// Queue an operation -- send, receive or delete a message -- on the
+/// submission ring.  Does not trap into the kernel; the operation executes
+/// asynchronously, and its outcome eventually appears on the completion ring.
+/// See get_message_completion().
+///
+/// Any payload must remain valid, and unmodified, until the operation
+/// completes.
+///
+/// @param ring			-- the rings for the current thread
+/// @param operation	-- the operation to queue
+///
+/// @return STATUS_SUCCESS if the operation was queued; STATUS_MAILBOX_OVERFLOW
+/// if the submission ring is full; non-zero on error
+///
+status_t
+put_message_operation(	message_ring_sp				ring,
+						const message_operation_s*	operation)
+	{
+	uint32_t	tail;
+	status_t	status;
+
+	if (ring && operation)
+		{
+		tail = ring->submission_tail;
+		if (tail - ring->submission_head < MESSAGE_RING_SIZE)
+			{
+			ring->submission[ tail & MESSAGE_RING_MASK ] = *operation;
+
+			// The entry must be visible before the updated tail
+			__asm volatile("" : : : "memory");
+			ring->submission_tail = tail + 1;
+			status = STATUS_SUCCESS;
+			}
+		else
+			{
+			status = STATUS_MAILBOX_OVERFLOW;
+			}
+		}
+	else
+		{
+		status = STATUS_INVALID_DATA;
+		}
+
+	return(status);
+	}
@@ -0,0 +1,168 @@
+//
+// post_request.c
+//
+
+#include "dx/post_request.h"
+#include "dx/process_messages.h"
+
+
+
+///
+/// Send the given message as an asynchronous request.  Returns without
+/// waiting for the reply, so the caller may have several requests in flight
+/// at once (up to MESSAGE_REQUEST_COUNT_MAX); collect each reply later with
+/// receive_reply() or receive_all_replies().
+///
+/// The request id is the correlation token: the reply carries the same id,
+/// so the id must be unique among the caller's outstanding requests, and
+/// may be neither MESSAGE_ID_ATOMIC nor MESSAGE_ID_ANY.  As with
+/// send_and_receive_message(), the kernel guarantees that the reply reaches
+/// the caller; if the recipient exits first, then an abort message is
+/// returned in place of the reply.  Replies never appear via
+/// receive_message().
+///
+/// @param request -- the outgoing message, as for send_message()
+///
+/// @return STATUS_SUCCESS if the request is successfully sent; non-zero on
+/// error
+///
+status_t
+post_request(const message_s* request)
+	{
+	message_operation_s	operation;
+	status_t			status;
+
+	do
+		{
+		if (!request)
+			{
+			status = STATUS_INVALID_DATA;
+			break;
+			}
+
+		operation.type		= MESSAGE_OPERATION_SEND_REQUEST;
+		operation.message	= *request;
+
+		status = process_messages(&operation, 1);
+		if (status != STATUS_SUCCESS)
+			break;
+
+		status = operation.status;
+
+		} while(0);
+
+	return(status);
+	}
+
+
+
+///
+/// Wait for the replies to several outstanding requests, with a single trap
+/// into the kernel.  On return, reply[i] holds the reply to request id[i].
+/// The caller is responsible for deleting each reply payload, if any.
+///
+/// @param id		-- the ids of the original requests
+/// @param reply	-- on return, the replies
+/// @param count	-- the number of requests; at most
+///					   MESSAGE_REQUEST_COUNT_MAX
+///
+/// @return STATUS_SUCCESS if every reply was received; otherwise the status
+/// of the first failed reply.  Check each reply's id to determine which ones
+/// succeeded
+///
+status_t
+receive_all_replies(const message_id_t*	id,
+					message_s*			reply,
+					size_t				count)
+	{
+	size_t				i;
+	message_operation_s	operation[ MESSAGE_REQUEST_COUNT_MAX ];
+	status_t			status;
+
+	do
+		{
+		if (!id || !reply || count == 0 || count > MESSAGE_REQUEST_COUNT_MAX)
+			{
+			status = STATUS_INVALID_DATA;
+			break;
+			}
+
+		for (i = 0; i < count; i++)
+			{
+			operation[i].type		= MESSAGE_OPERATION_RECEIVE_REPLY_WAIT;
+			operation[i].message.id	= id[i];
+			}
+
+		status = process_messages(operation, count);
+		if (status != STATUS_SUCCESS)
+			break;
+
+		for (i = 0; i < count; i++)
+			{
+			if (operation[i].status == STATUS_SUCCESS)
+				{
+				reply[i] = operation[i].message;
+				}
+			else
+				{
+				initialize_message(&reply[i]);
+				if (status == STATUS_SUCCESS)
+					{ status = operation[i].status; }
+				}
+			}
+
+		} while(0);
+
+	return(status);
+	}
+
+
+
+///
+/// Retrieve the reply to an asynchronous request previously sent via
+/// post_request().  The caller is responsible for deleting the reply
+/// payload, if any, as for receive_message().
+///
+/// @param id				-- id of the original request; or MESSAGE_ID_ANY
+///							   to retrieve the first reply to any request
+/// @param reply			-- on success, the reply
+/// @param wait_for_reply	-- whether to block until the reply arrives
+///
+/// @return STATUS_SUCCESS if the reply was retrieved; STATUS_MAILBOX_EMPTY if
+/// wait_for_reply is FALSE and the reply has not yet arrived;
+/// STATUS_INVALID_DATA if no such request is outstanding; non-zero on other
+/// error
+///
+status_t
+receive_reply(	message_id_t	id,
+				message_s*		reply,
+				bool_t			wait_for_reply)
+	{
+	message_operation_s	operation;
+	status_t			status;
+
+	do
+		{
+		if (!reply)
+			{
+			status = STATUS_INVALID_DATA;
+			break;
+			}
+
+		operation.type = (wait_for_reply ?
+			MESSAGE_OPERATION_RECEIVE_REPLY_WAIT :
+			MESSAGE_OPERATION_RECEIVE_REPLY);
+		operation.message.id = id;
+
+		status = process_messages(&operation, 1);
+		if (status != STATUS_SUCCESS)
+			break;
+
+		status = operation.status;
+		if (status == STATUS_SUCCESS)
+			{ *reply = operation.message; }
+
+		} while(0);
+
+	return(status);
+	}
@@ -0,0 +1,120 @@
+//
+// process_messages.c
+//
+
+#include "call_kernel.h"
+#include "dx/process_messages.h"
+#include "dx/system_call.h"
+#include "dx/system_call_vectors.h"
+
+
+
+///
+/// Discard the payload of a received message, then receive the next incoming
+/// message into the same descriptor.  Equivalent to delete_message() followed
+/// by receive_message(), but with only a single trap into the kernel.  This is
+/// the typical tail of a server's message loop.
+///
+/// @param message			-- on entry, the message to be discarded; on
+///							   return, the next incoming message
+/// @param wait_for_message	-- whether to block until a message arrives
+///
+/// @return STATUS_SUCCESS if the next message was successfully retrieved;
+/// non-zero on error
+///
+status_t
+delete_and_receive_message(	message_sp	message,
+							bool_t		wait_for_message)
+	{
+	uint32_t			count = 0;
+	message_operation_s	operation[2];
+	status_t			status;
+
+	do
+		{
+		if (!message)
+			{
+			status = STATUS_INVALID_DATA;
+			break;
+			}
+
+
+		// Discard the old payload, if any
+		if (message->data_size > 0)
+			{
+			operation[count].type		= MESSAGE_OPERATION_DELETE;
+			operation[count].message	= *message;
+			count++;
+			}
+
+
+		// Retrieve the next message
+		operation[count].type = (wait_for_message ?
+			MESSAGE_OPERATION_RECEIVE_WAIT : MESSAGE_OPERATION_RECEIVE);
+		count++;
+
+		status = process_messages(operation, count);
+		if (status != STATUS_SUCCESS)
+			break;
+
+		status = operation[count - 1].status;
+		if (status != STATUS_SUCCESS)
+			{
+			// No message here; ensure the caller cannot delete the old
+			// payload a second time
+			message->data		= NULL;
+			message->data_size	= 0;
+			break;
+			}
+
+		*message = operation[count - 1].message;
+
+		} while(0);
+
+	return(status);
+	}
+
+
+
+///
+/// Process a batch of message operations -- sending, receiving and deleting
+/// messages -- with a single trap into the kernel.  The operations execute
+/// in order, exactly as if the caller had invoked send_message(),
+/// receive_message() or delete_message() for each one.  The kernel records
+/// the outcome of each operation in its status field; a failed operation
+/// does not prevent the remaining operations from executing.  The kernel
+/// stops at an operation of unknown type, and leaves the rest untouched.
+///
+/// @param operation		-- the list of operations
+/// @param operation_count	-- the number of operations; at most
+///							   MESSAGE_OPERATION_COUNT_MAX
+///
+/// @return STATUS_SUCCESS if the batch was processed; non-zero if the batch
+/// itself was invalid, or stopped at an invalid operation.  Check the status
+/// of each operation individually
+///
+status_t
+process_messages(	message_operation_s*	operation,
+					size_t					operation_count)
+	{
+	status_t status;
+
+	if (operation)
+		{
+		syscall_data_s syscall;
+
+		syscall.size	= sizeof(syscall);
+		syscall.data0	= (uintptr_t)(operation);
+		syscall.data1	= (uintptr_t)(operation_count);
+
+		CALL_KERNEL(&syscall, SYSTEM_CALL_VECTOR_PROCESS_MESSAGES);
+
+		status = syscall.status;
+		}
+	else
+		{
+		status = STATUS_INVALID_DATA;
+		}
+
+	return(status);
+	}
@@ -2,14 +2,10 @@
 // send_message.c
 //
 
-#include "assert.h"
 #include "call_kernel.h"
-#include "dx/hal/memory.h"
 #include "dx/send_message.h"
 #include "dx/system_call.h"
 #include "dx/system_call_vectors.h"
-#include "stdlib.h"
-#include "string.h"
 
 
 
@@ -67,123 +63,120 @@ send_message (const message_s* message)
 
 
 ///
-/// Slower, more flexible version of send_message().  If the payload must land
-/// at a specific address in the recipient's address space, but is not
-/// properly aligned to allow this, then copy the payload to a new buffer to
-/// ensure the alignment.  In general, this should be relatively rare.
+/// Send the given message, and surrender its payload to the recipient.
+/// Otherwise identical to send_message().
 ///
-/// @see send_message()
+/// Each page that lies entirely within the payload is unmapped from the
+/// current address space and handed to the recipient, which may then modify
+/// it without any copy-on-write overhead.  If the caller touches these pages
+/// again, it will find fresh, zero-filled pages.  Any partial pages at either
+/// end of the payload are shared as usual.  Only use this when the caller will
+/// never read the payload again (e.g., a temporary buffer that is freed
+/// immediately after sending).
+///
+/// @param message -- the outgoing message
+///
+/// @return STATUS_SUCCESS if the message is successfully sent; non-zero on
+/// error
 ///
 status_t
-send_misaligned_message(const message_s* misaligned_message)
+send_donated_message(const message_s* message)
 	{
-	message_s		aligned_message;
-	uint8_tp		buffer = NULL;
-	uintptr_t		buffer_offset;
-	uintptr_t		destination_offset;
-	status_t		status;
+	status_t status;
 
+	if (message)
+		{
+		syscall_data_s syscall;
 
-	do
+		syscall.size	= sizeof(syscall);
+		syscall.data0	= (uintptr_t)(message->u.destination);
+		syscall.data1	= (uintptr_t)(message->type);
+		syscall.data2	= (uintptr_t)(message->id);
+		syscall.data3	= (uintptr_t)(message->data);
+		syscall.data4	= (uintptr_t)(message->data_size);
+		syscall.data5	= (uintptr_t)(message->destination_address);
+
+		CALL_KERNEL(&syscall, SYSTEM_CALL_VECTOR_SEND_DONATED_MESSAGE);
+
+		status = syscall.status;
+		}
+	else
 		{
-		//
-		// Must provide a message here
-		//
-		if (!misaligned_message)
-			{
-			status = STATUS_INVALID_DATA;
-			break;
-			}
-
-
-		//
-		// If the payload has no alignment requirement; or is already correctly
-		// aligned; then just send it directly
-		//
-		if ((!misaligned_message->destination_address) ||
-			(PAGE_OFFSET(misaligned_message->data) ==
-				PAGE_OFFSET(misaligned_message->destination_address)))
-			{
-			status = send_message(misaligned_message);
-			break;
-			}
-
-
-		//
-		// Copy the original message descriptor to avoid overwriting the
-		// caller's buffer.  Only the payload pointer needs to be fixed
-		//
-		memcpy(&aligned_message, misaligned_message, sizeof(aligned_message));
-
-
-		//
-		// Allocate a new payload buffer with enough overhead to allow for
-		// proper alignment
-		//
-		buffer = malloc(misaligned_message->data_size + PAGE_SIZE - 1);
-		if (!buffer)
-			{
-			status = STATUS_INSUFFICIENT_MEMORY;
-			break;
-			}
-
-
-		//
-		// Locate the position within the payload buffer that matches the
-		// alignment of the desired destination address
-		//
-		buffer_offset		= PAGE_OFFSET(buffer);
-		destination_offset	= PAGE_OFFSET(misaligned_message->destination_address);
-
-		if (buffer_offset < destination_offset)
-			{
-			// Advance to the matching offset within the current page
-			aligned_message.data =
-				buffer + (destination_offset - buffer_offset);
-			}
-
-		else if (buffer_offset > destination_offset)
-			{
-			// Advance to the matching offset on the next page
-			aligned_message.data =
-				(uint8_tp)(PAGE_ALIGN(buffer)) + destination_offset;
-			}
-
-		else
-			{
-			// The allocated buffer happens to be exactly aligned to the
-			// destination
-			aligned_message.data = buffer;
-			}
-
-		assert((uint8_tp)aligned_message.data - buffer < PAGE_SIZE);
-		assert(PAGE_OFFSET(aligned_message.data) ==
-			PAGE_OFFSET(aligned_message.destination_address));
-
-
-		//
-		// Copy the (misaligned) original payload into the (now aligned)
-		// temporary buffer
-		//
-		memcpy(aligned_message.data, misaligned_message->data,
-			misaligned_message->data_size);
-
-
-		//
-		// Send the aligned data
-		//
-		status = send_message(&aligned_message);
-
-		} while(0);
-
-
-	//
-	// Cleanup if necessary
-	//
-	if (buffer)
-		{ free(buffer); }
+		// No message descriptor
+		status = STATUS_INVALID_DATA;
+		}
+
+	return(status);
+	}
 
 
+
+///
+/// Send a message whose payload is scattered across several buffers in the
+/// current address space.  The kernel concatenates the fragments, in order,
+/// into a single payload in the recipient's address space.  Otherwise
+/// identical to send_message().
+///
+/// The fragments may have any size and alignment.  Pages that lie entirely
+/// within a fragment, and that align with the recipient's pages, are shared
+/// as usual; everything else (typically just the partial pages at either end
+/// of each fragment) is copied by the kernel.  The message->data and
+/// message->data_size fields are ignored here.
+///
+/// @param message			-- the outgoing message
+/// @param fragment			-- the list of payload fragments
+/// @param fragment_count	-- the number of fragments; at most
+///							   MESSAGE_FRAGMENT_COUNT_MAX
+///
+/// @return STATUS_SUCCESS if the message is successfully sent; non-zero on
+/// error
+///
+status_t
+send_gathered_message(	const message_s*			message,
+						const message_fragment_s*	fragment,
+						size_t						fragment_count)
+	{
+	status_t status;
+
+	if (message && fragment)
+		{
+		syscall_data_s syscall;
+
+		syscall.size	= sizeof(syscall);
+		syscall.data0	= (uintptr_t)(message->u.destination);
+		syscall.data1	= (uintptr_t)(message->type);
+		syscall.data2	= (uintptr_t)(message->id);
+		syscall.data3	= (uintptr_t)(fragment);
+		syscall.data4	= (uintptr_t)(fragment_count);
+		syscall.data5	= (uintptr_t)(message->destination_address);
+
+		CALL_KERNEL(&syscall, SYSTEM_CALL_VECTOR_SEND_GATHERED_MESSAGE);
+
+		status = syscall.status;
+		}
+	else
+		{
+		// No message descriptor or payload
+		status = STATUS_INVALID_DATA;
+		}
+
 	return(status);
 	}
 
+
+
+///
+/// Send a message whose payload must land at a specific address in the
+/// recipient's address space, but is not aligned with that address.  The
+/// kernel now handles misaligned payloads directly, by copying whatever
+/// cannot be shared; so this is simply send_message().  Retained for
+/// existing callers.
+///
+/// @see send_message()
+///
+status_t
+send_misaligned_message(const message_s* misaligned_message)
+	{
+	return(send_message(misaligned_message));
+	}
+
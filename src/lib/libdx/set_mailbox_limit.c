@@ -0,0 +1,34 @@
+//
+// set_mailbox_limit.c
+//
+
+
+#include "call_kernel.h"
+#include "dx/set_mailbox_limit.h"
+#include "dx/system_call.h"
+#include "dx/system_call_vectors.h"
+
+
+///
+/// Set the maximum number of messages that may be queued in the mailbox of
+/// the current thread.  Once the mailbox is full, senders wait for room (or
+/// receive STATUS_WOULD_BLOCK) until this thread receives some of its pending
+/// messages.  Replies to outstanding requests are not subject to this limit
+///
+/// @param limit -- the new limit, between 1 and 1024 messages.  The default
+/// is 64 messages
+///
+/// @return STATUS_SUCCESS if the limit is updated; nonzero otherwise
+///
+status_t
+set_mailbox_limit(uint32_t limit)
+	{
+	syscall_data_s syscall;
+
+	syscall.size  = sizeof(syscall);
+	syscall.data0 = (uintptr_t)(limit);
+
+	CALL_KERNEL(&syscall, SYSTEM_CALL_VECTOR_SET_MAILBOX_LIMIT);
+
+	return(syscall.status);
+	}
@@ -0,0 +1,37 @@
+//
+// signal_thread.c
+//
+
+#include "call_kernel.h"
+#include "dx/signal_thread.h"
+#include "dx/system_call.h"
+#include "dx/system_call_vectors.h"
+
+
+///
+/// Raise one or more signal bits on another thread.  The kernel ORs the bits
+/// into the thread's notification word; the thread collects all pending
+/// bits at once as a single MESSAGE_TYPE_NOTIFICATION message, whose data
+/// field holds the signal bits.  Repeated signals coalesce, and the kernel
+/// allocates no message for each signal, so this never blocks and never
+/// fails for lack of memory once the thread has been signalled.
+///
+/// @param thread -- the thread to signal
+/// @param signal -- the signal bits to raise; must be nonzero, and must lie
+///                  within SIGNAL_USER_MASK
+///
+/// @return STATUS_SUCCESS if the bits are raised; nonzero otherwise
+///
+status_t
+signal_thread(thread_id_t thread, uintptr_t signal)
+	{
+	syscall_data_s	syscall;
+
+	syscall.size	= sizeof(syscall);
+	syscall.data0	= thread;
+	syscall.data1	= signal;
+
+	CALL_KERNEL(&syscall, SYSTEM_CALL_VECTOR_SIGNAL_THREAD);
+
+	return(syscall.status);
+	}
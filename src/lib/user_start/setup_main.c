@@ -4,6 +4,7 @@
 
 #include "assert.h"
 #include "dx/address_space_environment.h"
+#include "dx/fast_system_call.h"
 #include "dx/types.h"
 #include "stdlib.h"
 #include "string.h"
@@ -85,6 +86,7 @@ setup_main()
 	//
 	initialize_bss();
 	initialize_argv();
+	initialize_fast_system_call();
 
 
 	//
@@ -4,8 +4,8 @@
 
 #include "assert.h"
 #include "console_context.h"
-#include "dx/delete_message.h"
 #include "dx/hal/keyboard_input.h"
+#include "dx/process_messages.h"
 #include "dx/receive_message.h"
 #include "dx/send_message.h"
 #include "dx/status.h"
@@ -214,12 +214,15 @@ wait_for_messages(console_context_sp console)
 	// Message loop.  Listen for incoming messages + dispatch them as
 	// appropriate
 	//
+	status = receive_message(&message, WAIT_FOR_MESSAGE);
 	for(;;)
 		{
-		// Wait for the next request
-		status = receive_message(&message, WAIT_FOR_MESSAGE);
+		// Retry if unable to retrieve the next request
 		if (status != STATUS_SUCCESS)
+			{
+			status = receive_message(&message, WAIT_FOR_MESSAGE);
 			continue;
+			}
 
 
 		// Dispatch the request as needed
@@ -259,8 +262,9 @@ wait_for_messages(console_context_sp console)
 			}
 
 
-		// Done with this request
-		delete_message(&message);
+		// Done with this request; discard it + wait for the next one, with
+		// a single trap into the kernel
+		status = delete_and_receive_message(&message, WAIT_FOR_MESSAGE);
 		}
 
 	return;
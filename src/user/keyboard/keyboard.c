@@ -5,7 +5,6 @@
 //
 
 #include "assert.h"
-#include "dx/defer_interrupt.h"
 #include "dx/delete_message.h"
 #include "dx/hal/io_port.h"
 #include "dx/hal/keyboard_input.h"
@@ -13,6 +12,7 @@
 #include "dx/receive_message.h"
 #include "dx/register_interrupt_handler.h"
 #include "dx/send_message.h"
+#include "dx/signal_thread.h"
 #include "dx/status.h"
 #include "dx/unmap_device.h"
 #include "dx/unregister_interrupt_handler.h"
@@ -26,6 +26,9 @@
 static void_t handle_make_code(	keyboard_context_sp	keyboard,
 								uint8_t				scan_code);
 
+static void_t handle_scan_code(	keyboard_context_sp	keyboard,
+								uint8_t				scan_code);
+
 static void_t toggle_leds(const keyboard_context_s* keyboard);
 
 static char8_t translate_scan_code(	const keyboard_context_s*	keyboard,
@@ -134,33 +137,32 @@ handle_break_code(	keyboard_context_sp	keyboard,
 ///
 /// Handler for processing (deferred) keyboard interrupts.  This is the second
 /// (deferred) portion of handle_interrupt.  Runs in the context of the main
-/// keyboard thread, outside interrupt context.
+/// keyboard thread, outside interrupt context.  Drains every scan code that
+/// the interrupt handler has added to the ring since the last notification.
 ///
 /// @param keyboard		-- driver context
-/// @param message		-- deferred interrupt message from interrupt handler
 ///
 static
 void_t
-handle_deferred_interrupt(	keyboard_context_sp	keyboard,
-							const message_s*	message)
+handle_deferred_interrupt(keyboard_context_sp keyboard)
 	{
-	// Scan code is embedded in message payload
-	uint8_t scan_code = (uintptr_t)(message->data);
-
-	// Key down?
-	if (IS_SIMPLE_MAKE_CODE(scan_code))
-		{ handle_make_code(keyboard, scan_code); }
+	uint32_t	head;
+	uint8_t		scan_code;
 
-	// Key up?
-	else if (IS_SIMPLE_BREAK_CODE(scan_code))
-		{ handle_break_code(keyboard, scan_code); }
+	head = keyboard->scan_code_head;
+	while (head != keyboard->scan_code_tail)
+		{
+		// Only read the scan code once the handler has published it
+		__asm volatile("" : : : "memory");
+		scan_code = keyboard->scan_code[ head & KEYBOARD_SCAN_CODE_RING_MASK ];
 
-	// An MF-II extended sequence?
-	else if (IS_EXTENSION_PREFIX(scan_code))
-		{ keyboard->modifier_mask |= KEYBOARD_MODIFIER_EXTENSION; }
+		// Only release the entry once it has been consumed
+		__asm volatile("" : : : "memory");
+		head++;
+		keyboard->scan_code_head = head;
 
-	// Some kind of control byte/reply @@ack from LED update, etc
-	//@else handle_control_code()
+		handle_scan_code(keyboard, scan_code);
+		}
 
 	return;
 	}
@@ -170,7 +172,7 @@ handle_deferred_interrupt(	keyboard_context_sp	keyboard,
 /// Keyboard interrupt handler.  Runs in interrupt context, within the
 /// dedicated interrupt handler thread for the keyboard driver.  Consume the
 /// next pending data or error from the keyboard, pass it back to the main
-/// keyboard thread
+/// keyboard thread via the scan-code ring
 ///
 /// @see handle_deferred_interrupt()
 ///
@@ -182,8 +184,9 @@ void_t
 handle_interrupt(	thread_id_t	parent_thread,
 					void_tp		context)
 	{
-	uint8_t		keyboard_status;
-	uint8_t		scan_code;
+	keyboard_context_sp	keyboard	= (keyboard_context_sp)(context);
+	uint8_t				keyboard_status;
+	uint32_t			tail		= keyboard->scan_code_tail;
 
 	for(uintptr_t i = 0; i < 8; i++)
 		{
@@ -195,9 +198,15 @@ handle_interrupt(	thread_id_t	parent_thread,
 			{
 			// Consume the next scan code from the keyboard.  Delegate all
 			// further processing + scan code translation to the main keyboard
-			// thread
-			scan_code = io_port_read8(KEYBOARD_OUTPUT_BUFFER);
-			defer_interrupt(parent_thread, scan_code);
+			// thread.  If the ring is full, then the main thread is far
+			// behind; drop the scan code
+			uint8_t scan_code = io_port_read8(KEYBOARD_OUTPUT_BUFFER);
+			if (tail - keyboard->scan_code_head < KEYBOARD_SCAN_CODE_RING_SIZE)
+				{
+				keyboard->scan_code[ tail & KEYBOARD_SCAN_CODE_RING_MASK ] =
+					scan_code;
+				tail++;
+				}
 			}
 		else
 			{
@@ -208,6 +217,20 @@ handle_interrupt(	thread_id_t	parent_thread,
 		//@if (timeout or parity error), send RESEND command?
 		}
 
+
+	//
+	// Publish the new scan codes, if any, and wake the main thread.  Repeated
+	// signals coalesce, so the main thread drains the ring once per wakeup,
+	// with no message allocated per scan code
+	//
+	if (tail != keyboard->scan_code_tail)
+		{
+		// The scan codes must be visible before the updated tail
+		__asm volatile("" : : : "memory");
+		keyboard->scan_code_tail = tail;
+		signal_thread(parent_thread, KEYBOARD_SIGNAL_INPUT);
+		}
+
 	return;
 	}
 
@@ -291,6 +314,36 @@ handle_make_code(	keyboard_context_sp	keyboard,
 	}
 
 
+///
+/// Process a single scan code from the keyboard controller
+///
+/// @param keyboard		-- driver context
+/// @param scan_code	-- scan code retrieved from keyboard controller
+///
+static
+void_t
+handle_scan_code(	keyboard_context_sp	keyboard,
+					uint8_t				scan_code)
+	{
+	// Key down?
+	if (IS_SIMPLE_MAKE_CODE(scan_code))
+		{ handle_make_code(keyboard, scan_code); }
+
+	// Key up?
+	else if (IS_SIMPLE_BREAK_CODE(scan_code))
+		{ handle_break_code(keyboard, scan_code); }
+
+	// An MF-II extended sequence?
+	else if (IS_EXTENSION_PREFIX(scan_code))
+		{ keyboard->modifier_mask |= KEYBOARD_MODIFIER_EXTENSION; }
+
+	// Some kind of control byte/reply @@ack from LED update, etc
+	//@else handle_control_code()
+
+	return;
+	}
+
+
 ///
 /// Driver initialization.  Runs once, at load time.  Allocates or initializes
 /// all runtime resources.  Configures the keyboard hardware for runtime
@@ -572,8 +625,9 @@ wait_for_messages(keyboard_context_sp keyboard)
 		// Dispatch the request as needed
 		switch(message.type)
 			{
-			case MESSAGE_TYPE_DEFER_INTERRUPT:
-				handle_deferred_interrupt(keyboard, &message);
+			case MESSAGE_TYPE_NOTIFICATION:
+				if ((uintptr_t)(message.data) & KEYBOARD_SIGNAL_INPUT)
+					{ handle_deferred_interrupt(keyboard); }
 				break;
 
 			case MESSAGE_TYPE_NULL:
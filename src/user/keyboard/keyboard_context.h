@@ -5,11 +5,28 @@
 #ifndef _KEYBOARD_CONTEXT_H
 #define _KEYBOARD_CONTEXT_H
 
+#include "dx/signal_thread.h"
 #include "dx/thread_id.h"
 #include "dx/types.h"
 
 
 
+///
+/// Size of the scan-code ring between the interrupt handler and the main
+/// keyboard thread.  Must be a power of two
+///
+#define KEYBOARD_SCAN_CODE_RING_SIZE	32
+#define KEYBOARD_SCAN_CODE_RING_MASK	(KEYBOARD_SCAN_CODE_RING_SIZE - 1)
+
+
+///
+/// Signal raised on the main keyboard thread when the interrupt handler adds
+/// new scan codes to the ring.  Must be a user bit; see SIGNAL_USER_MASK
+///
+#define KEYBOARD_SIGNAL_INPUT			SIGNAL_USER_FIRST
+
+
+
 ///
 /// Driver context.  Contains the runtime context/data for the keyboard driver
 ///
@@ -23,6 +40,14 @@ typedef struct keyboard_context
 	/// Interrupt handler
 	thread_id_t	interrupt_handler_thread;
 
+	/// Ring of scan codes, from the interrupt handler to the main keyboard
+	/// thread.  The handler only advances scan_code_tail; the main thread
+	/// only advances scan_code_head.  Both indices run freely, and are
+	/// reduced modulo KEYBOARD_SCAN_CODE_RING_SIZE on each access
+	volatile uint32_t	scan_code_head;
+	volatile uint32_t	scan_code_tail;
+	uint8_t				scan_code[ KEYBOARD_SCAN_CODE_RING_SIZE ];
+
 	} keyboard_context_s;
 
 typedef keyboard_context_s *    keyboard_context_sp;
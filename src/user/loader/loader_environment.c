@@ -62,13 +62,14 @@ initialize_environment()
 
 
 		//
-		// Allocate enough pages to span the initial heap
+		// Reserve enough pages to span the initial heap.  The kernel only
+		// allocates each page when it is first touched
 		//
 		//@is this enough?, must be larger than any misaligned ELF section
 		//@in ramdisk executables.  shell + lualibs needs 70 pages.
-		heap_size = 96 * PAGE_SIZE;
+		heap_size = 1024 * PAGE_SIZE;
 		status = expand_address_space(ADDRESS_SPACE_ID_USER_LOADER, heap,
-			heap_size, 0);
+			heap_size, EXPAND_ADDRESS_SPACE_RESERVE);
 		if (status != STATUS_SUCCESS)
 			{ break; }
 
@@ -8,6 +8,7 @@
 #include "dx/delete_message.h"
 #include "dx/hal/memory.h"
 #include "dx/libtar.h"
+#include "dx/process_messages.h"
 #include "dx/receive_message.h"
 #include "dx/send_message.h"
 #include "dx/stream_message.h"
@@ -636,13 +637,15 @@ wait_for_messages(loader_context_sp context)
 	// Message loop.  Listen for incoming messages + dispatch them as
 	// appropriate
 	//
+	status = receive_message(&message, WAIT_FOR_MESSAGE);
 	while(mounted)
 		{
-		// Wait for the next request
-		status = receive_message(&message, WAIT_FOR_MESSAGE);
-
+		// Retry if unable to retrieve the next request
 		if (status != STATUS_SUCCESS)
+			{
+			status = receive_message(&message, WAIT_FOR_MESSAGE);
 			continue;
+			}
 
 
 		// Dispatch the request as needed
@@ -679,8 +682,12 @@ wait_for_messages(loader_context_sp context)
 			}
 
 
-		// Done with this request
-		delete_message(&message);
+		// Done with this request.  Unless unmounting, discard it + wait for
+		// the next one, with a single trap into the kernel
+		if (mounted)
+			{ status = delete_and_receive_message(&message, WAIT_FOR_MESSAGE); }
+		else
+			{ delete_message(&message); }
 		}
 
 	return;
@@ -2,7 +2,11 @@
 // lua.c
 //
 
+#include "dx/message_ring.h"
+#include "dx/message_type.h"
 #include "dx/read_kernel_stats.h"
+#include "dx/receive_message.h"
+#include "dx/send_message.h"
 #include "dx/status.h"
 #include "dx/types.h"
 #include "dx/version.h"
@@ -15,6 +19,7 @@
 
 #define TOP_OF_STACK	(-1)
 
+static int benchmark_message_ring(lua_State* lua);
 static int syscall_read_kernel_stats(lua_State* lua);
 
 
@@ -62,6 +67,38 @@ export_string(lua_State* lua, const char* key, const char* value)
 	}
 
 
+///
+/// Store an array of integral values in a lua table, as a nested array
+/// (indexed from 1), for later consumption by lua code
+///
+/// @param lua		-- lua context
+/// @param key		-- key (string)
+/// @param value	-- values (integers)
+/// @param count	-- number of values
+///
+static
+void
+export_array(lua_State* lua, const char* key, const uint32_t* value,
+	uint32_t count)
+	{
+	uint32_t i;
+
+	// Assume table is already on top of stack (index -1)
+	lua_pushstring(lua, key);
+	lua_newtable(lua);
+	for (i = 0; i < count; i++)
+		{
+		lua_pushnumber(lua, value[i]);
+		lua_rawseti(lua, -2, i + 1);
+		}
+
+	// Pushed the key and array, so table is now at index -3
+	lua_rawset(lua, -3);
+
+	return;
+	}
+
+
 ///
 /// Store a function pointer in a lua table, for later callbacks.  This is
 /// primarily intended for exposing dx system calls to lua code
@@ -134,6 +171,7 @@ main(int argc, char** argv)
 		// access dx system calls and other platform-specific functionality
 		//
 		lua_newtable(lua);
+		export_callback(lua, "benchmark_message_ring", benchmark_message_ring);
 		export_callback(lua, "read_kernel_stats", syscall_read_kernel_stats);
 		export_string(lua, "version", DX_VERSION);
 		export_string(lua, "build_type", DX_BUILD_TYPE);
@@ -189,6 +227,110 @@ main(int argc, char** argv)
 	}
 
 
+///
+/// Read the low 32 bits of the processor timestamp counter
+///
+static
+inline
+uint32_t
+read_timestamp32(void)
+	{
+	uint32_t high;
+	uint32_t low;
+
+	__asm volatile("rdtsc" : "=a"(low), "=d"(high));
+
+	return(low);
+	}
+
+
+///
+/// Compare the cost of exchanging small messages via one system call per
+/// send + receive, against the cost of exchanging the same messages via the
+/// shared submission/completion rings.  Each message is sent to, and received
+/// by, the current thread.  Results are in processor cycles per message.
+///
+static
+int benchmark_message_ring(lua_State* lua)
+	{
+	const uint32_t		BATCH_SIZE		= MESSAGE_RING_SIZE / 2;
+	const uint32_t		MESSAGE_COUNT	= 1024;
+	message_operation_s	completion;
+	message_s			message;
+	message_operation_s	operation;
+	message_ring_sp		ring;
+	uint32_t			ring_cycles		= 0;
+	uint32_t			start;
+	status_t			status;
+	uint32_t			trap_cycles;
+
+
+	//
+	// Trap path: two system calls per message
+	//
+	initialize_message(&message);
+	message.u.destination = THREAD_ID_LOOPBACK;
+
+	start = read_timestamp32();
+	for (uint32_t i = 0; i < MESSAGE_COUNT; i++)
+		{
+		send_message(&message);
+		receive_message(&message, WAIT_FOR_MESSAGE);
+		message.u.destination = THREAD_ID_LOOPBACK;
+		}
+	trap_cycles = (read_timestamp32() - start) / MESSAGE_COUNT;
+
+
+	//
+	// Ring path: queue a batch of sends + receives, then a single system
+	// call to process them all.  Each batch yields two completions per
+	// message, so exactly fills the completion ring
+	//
+	initialize_message(&message);
+	message.u.destination = THREAD_ID_LOOPBACK;
+
+	status = create_message_ring(&ring);
+	if (status == STATUS_SUCCESS)
+		{
+		start = read_timestamp32();
+		for (uint32_t i = 0; i < MESSAGE_COUNT; i += BATCH_SIZE)
+			{
+			operation.type		= MESSAGE_OPERATION_SEND;
+			operation.message	= message;
+			for (uint32_t j = 0; j < BATCH_SIZE; j++)
+				{ put_message_operation(ring, &operation); }
+
+			operation.type = MESSAGE_OPERATION_RECEIVE;
+			for (uint32_t j = 0; j < BATCH_SIZE; j++)
+				{ put_message_operation(ring, &operation); }
+
+			enter_message_ring(ring, FALSE);
+
+			while (get_message_completion(ring, &completion) ==
+				STATUS_SUCCESS)
+				{ }
+			}
+		ring_cycles = (read_timestamp32() - start) / MESSAGE_COUNT;
+		}
+
+
+	//
+	// Discard any leftover messages, e.g., if some other message arrived
+	// during the benchmark
+	//
+	while (receive_message(&message, POLL_FOR_MESSAGE) == STATUS_SUCCESS)
+		{ }
+
+
+	lua_newtable(lua);
+	export_int(lua, "message_count",	MESSAGE_COUNT);
+	export_int(lua, "trap_cycles",		trap_cycles);
+	export_int(lua, "ring_cycles",		ring_cycles);
+
+	return(1);
+	}
+
+
 static
 int syscall_read_kernel_stats(lua_State* lua)
 	{
@@ -204,21 +346,45 @@ int syscall_read_kernel_stats(lua_State* lua)
 		export_int(lua, "total_memory_size",	kernel_stats.total_memory_size/1024/1024);
 		export_int(lua, "paged_memory_size",	kernel_stats.paged_memory_size/1024/1024);
 		export_int(lua, "paged_region_count",	kernel_stats.paged_region_count);
+		export_int(lua, "heap_slab_count",		kernel_stats.heap_slab_count);
 		export_int(lua, "address_space_count",	kernel_stats.address_space_count);
 		export_int(lua, "cow_fault_count",		kernel_stats.cow_fault_count);
+		export_int(lua, "cow_copy_avoided_count",	kernel_stats.cow_copy_avoided_count);
+		export_int(lua, "demand_zero_fault_count",	kernel_stats.demand_zero_fault_count);
+		export_int(lua, "io_port_fault_count",	kernel_stats.io_port_fault_count);
 		export_int(lua, "page_fault_count",		kernel_stats.page_fault_count);
 
 		// Messaging
 		export_int(lua, "message_count",		kernel_stats.message_count);
+		export_int(lua, "direct_message_count",	kernel_stats.direct_message_count);
 		export_int(lua, "pending_count",		kernel_stats.pending_count);
 		export_int(lua, "incomplete_count",		kernel_stats.incomplete_count);
 		export_int(lua, "send_error_count",		kernel_stats.send_error_count);
+		export_int(lua, "send_wait_count",		kernel_stats.send_wait_count);
 		export_int(lua, "receive_error_count",	kernel_stats.receive_error_count);
+		export_int(lua, "message_cache_hit_count",	kernel_stats.message_cache_hit_count);
+		export_int(lua, "message_cache_miss_count",	kernel_stats.message_cache_miss_count);
 
 		// Scheduling
 		export_int(lua, "lottery_count",		kernel_stats.lottery_count);
 		export_int(lua, "idle_count",			kernel_stats.idle_count);
 		export_int(lua, "direct_handoff_count",	kernel_stats.direct_handoff_count);
+		export_string(lua, "scheduling_policy",
+			(kernel_stats.scheduling_policy == SCHEDULING_POLICY_STRIDE ?
+			"stride" : "lottery"));
+
+		// Scheduling latency histogram, as a nested array
+		export_array(lua, "scheduling_latency",
+			kernel_stats.scheduling_latency,
+			SCHEDULING_LATENCY_BUCKET_COUNT);
+
+		// Interrupts, as nested arrays indexed by IRQ + 1
+		export_array(lua, "interrupt_count",
+			kernel_stats.interrupt_count, INTERRUPT_STATS_IRQ_COUNT);
+		export_array(lua, "interrupt_latency",
+			kernel_stats.interrupt_latency, INTERRUPT_STATS_IRQ_COUNT);
+		export_array(lua, "interrupt_latency_max",
+			kernel_stats.interrupt_latency_max, INTERRUPT_STATS_IRQ_COUNT);
 
 		// Threads
 		export_int(lua, "thread_count", kernel_stats.thread_count);
@@ -1,8 +1,25 @@
 
+--
+-- Compare the cost of message-passing via one system call per operation,
+-- against the shared message rings
+--
+function bench()
+	local b = dx.benchmark_message_ring()
+
+	print('Messaging (' .. b.message_count .. ' messages, cycles/message):')
+	print('    trap per op    ' .. b.trap_cycles)
+	print('    message ring   ' .. b.ring_cycles)
+	print()
+
+	return 0
+end
+
+
 --
 -- Display command help, etc
 --
 function help()
+	print('bench       -- Compare message-passing costs')
 	print('help        -- Show this help message')
 	print('stats       -- Show kernel stats')
 	print('version     -- Show the current system version')
@@ -28,25 +45,53 @@ function stats()
 	print('    total physical ' .. s.total_memory_size .. ' (MB)')
 	print('    paged physical ' .. s.paged_memory_size .. ' (MB)')
 	print('    paged regions  ' .. s.paged_region_count)
+	print('    heap slabs     ' .. s.heap_slab_count)
 	print('    address spaces ' .. s.address_space_count)
 	print('    page faults    ' .. s.page_fault_count)
 	print('    COW faults     ' .. s.cow_fault_count)
+	print('    COW no-copy    ' .. s.cow_copy_avoided_count)
+	print('    zero faults    ' .. s.demand_zero_fault_count)
+	print('    I/O faults     ' .. s.io_port_fault_count)
 	print()
 
 	print('Messaging:')
 	print('    total          ' .. s.message_count)
+	print('    direct         ' .. s.direct_message_count)
 	print('    pending        ' .. s.pending_count)
 	print('    incomplete     ' .. s.incomplete_count)
 	print('    tx error       ' .. s.send_error_count)
+	print('    tx wait        ' .. s.send_wait_count)
 	print('    rx error       ' .. s.receive_error_count)
+	print('    cache hit      ' .. s.message_cache_hit_count)
+	print('    cache miss     ' .. s.message_cache_miss_count)
 	print()
 
 	print('Scheduling:')
+	print('    policy         ' .. s.scheduling_policy)
 	print('    lottery        ' .. s.lottery_count)
-	print('    idle           '	.. s.idle_count)
+	print('    idle ticks     '	.. s.idle_count)
 	print('    direct         ' .. s.direct_handoff_count)
 	print()
 
+	-- Bucket N counts wakeup latencies of 2^(N+10) cycles and up
+	print('Scheduling latency (cycles):')
+	for i, count in ipairs(s.scheduling_latency) do
+		if count > 0 then
+			print(string.format('    >= 2^%-2d       %d', i + 9, count))
+		end
+	end
+	print()
+
+	-- Dispatch latency is the delay until a handler receives the interrupt
+	print('Interrupts (count, avg/max cycles):')
+	for i, count in ipairs(s.interrupt_count) do
+		if count > 0 then
+			print(string.format('    IRQ %-2d         %d, %d/%d', i - 1,
+				count, s.interrupt_latency[i], s.interrupt_latency_max[i]))
+		end
+	end
+	print()
+
 	print('Threads:')
 	print('    total          ' .. s.thread_count)
 	print()
@@ -75,7 +120,7 @@ end
 banner = string.format('dx v%s (%s) boot shell',
 	dx.version, dx.build_type)
 print(banner)
-local handler = { help=help, stats=stats, version=version }
+local handler = { bench=bench, help=help, stats=stats, version=version }
 
 -- loop forever, handling user commands
 while(1) do